@@ -0,0 +1,114 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <vector>
+
+#include <ctRandomStream.hpp>
+#include <ctVersionConversion.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ctlUnitTest {
+    TEST_CLASS(ctRandomStreamUnitTest)
+    {
+    private:
+        static const char* TestConnectionId()
+        {
+            return "5c7ad3bc-0e4c-4f1e-8a6a-1e3a3c4b0c2d";
+        }
+
+    public:
+        TEST_METHOD(FillMatchesWords)
+        {
+            ctl::ctRandomStream stream(7ULL, TestConnectionId(), 36);
+
+            std::vector<unsigned long long> words(1000);
+            stream.fill(words.data(), words.size() * sizeof(unsigned long long), 0ULL);
+            for (size_t index = 0; index < words.size(); ++index) {
+                Assert::AreEqual(stream.word(index), words[index]);
+            }
+        }
+
+        TEST_METHOD(FillAnyRange)
+        {
+            ctl::ctRandomStream stream(7ULL, TestConnectionId(), 36);
+
+            std::vector<unsigned char> full_stream(4096);
+            stream.fill(full_stream.data(), full_stream.size(), 0ULL);
+
+            // every offset and length regenerates the same bytes, within and across words and blocks
+            for (size_t offset = 0; offset < 80; ++offset) {
+                for (size_t length = 0; length < 200; ++length) {
+                    std::vector<unsigned char> partial_stream(length + 1, 0xcc);
+                    stream.fill(partial_stream.data(), length, offset);
+                    Assert::AreEqual(0, memcmp(full_stream.data() + offset, partial_stream.data(), length));
+                    // nothing is written beyond the requested length
+                    Assert::AreEqual(static_cast<unsigned char>(0xcc), partial_stream[length]);
+                }
+            }
+        }
+
+        TEST_METHOD(CompareFindsTheFirstMismatch)
+        {
+            ctl::ctRandomStream stream(7ULL, TestConnectionId(), 36);
+
+            std::vector<unsigned char> buffer(3000);
+            stream.fill(buffer.data(), buffer.size(), 13ULL);
+            Assert::AreEqual(buffer.size(), stream.compare(buffer.data(), buffer.size(), 13ULL));
+            // the same bytes at a different offset don't match
+            Assert::AreNotEqual(buffer.size(), stream.compare(buffer.data(), buffer.size(), 14ULL));
+
+            buffer[2999] ^= 0x01;
+            Assert::AreEqual(static_cast<size_t>(2999), stream.compare(buffer.data(), buffer.size(), 13ULL));
+            buffer[700] ^= 0x80;
+            Assert::AreEqual(static_cast<size_t>(700), stream.compare(buffer.data(), buffer.size(), 13ULL));
+            buffer[0] ^= 0x01;
+            Assert::AreEqual(static_cast<size_t>(0), stream.compare(buffer.data(), buffer.size(), 13ULL));
+        }
+
+        TEST_METHOD(StreamsAreKeyed)
+        {
+            const ctl::ctRandomStream stream(7ULL, TestConnectionId(), 36);
+            Assert::IsTrue(stream == ctl::ctRandomStream(7ULL, TestConnectionId(), 36));
+            Assert::IsTrue(stream != ctl::ctRandomStream(8ULL, TestConnectionId(), 36));
+            Assert::IsTrue(stream != ctl::ctRandomStream(7ULL, TestConnectionId(), 35));
+            Assert::IsTrue(stream != ctl::ctRandomStream(7ULL));
+
+            // different keys give unrelated bytes
+            unsigned char first_bytes[64];
+            unsigned char second_bytes[64];
+            stream.fill(first_bytes, sizeof(first_bytes), 0ULL);
+            ctl::ctRandomStream(8ULL, TestConnectionId(), 36).fill(second_bytes, sizeof(second_bytes), 0ULL);
+            Assert::AreNotEqual(0, memcmp(first_bytes, second_bytes, sizeof(first_bytes)));
+        }
+
+        TEST_METHOD(BytesAreUniformlyDistributed)
+        {
+            ctl::ctRandomStream stream(0ULL);
+
+            std::vector<unsigned char> buffer(256 * 1024);
+            stream.fill(buffer.data(), buffer.size(), 0ULL);
+            unsigned long counts[256] = {};
+            for (const auto& value : buffer) {
+                ++counts[value];
+            }
+            // 1024 expected per value: allow well beyond 6 standard deviations (~32)
+            for (const auto& count : counts) {
+                Assert::IsTrue(count > 800 && count < 1250);
+            }
+        }
+    };
+}
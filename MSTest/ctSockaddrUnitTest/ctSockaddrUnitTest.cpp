@@ -0,0 +1,177 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include <ctSockaddr.hpp>
+#include <ctVersionConversion.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace ctlUnitTest {
+    TEST_CLASS(ctSockaddrUnitTest)
+    {
+    private:
+        static ctl::ctSockaddr MakeAddress(LPCWSTR _address, unsigned short _port)
+        {
+            ctl::ctSockaddr address;
+            Assert::IsTrue(address.setAddress(_address));
+            address.setPort(_port);
+            return address;
+        }
+
+    public:
+        TEST_CLASS_INITIALIZE(Setup)
+        {
+            WSADATA wsadata;
+            auto startup = ::WSAStartup(WINSOCK_VERSION, &wsadata);
+            Assert::AreEqual(0, startup);
+        }
+
+        TEST_CLASS_CLEANUP(Cleanup)
+        {
+            ::WSACleanup();
+        }
+
+        TEST_METHOD(SetAddressLiterals)
+        {
+            ctl::ctSockaddr v4_address;
+            Assert::IsTrue(v4_address.setAddress(L"10.0.0.1"));
+            Assert::AreEqual(static_cast<short>(AF_INET), v4_address.family());
+            Assert::AreEqual(static_cast<unsigned short>(0), v4_address.port());
+
+            ctl::ctSockaddr v6_address;
+            Assert::IsTrue(v6_address.setAddress("fe80::1"));
+            Assert::AreEqual(static_cast<short>(AF_INET6), v6_address.family());
+
+            // scoped addresses are resolved through GetAddrInfo
+            ctl::ctSockaddr scoped_address;
+            Assert::IsTrue(scoped_address.setAddress(L"fe80::1%3"));
+            Assert::AreEqual(3UL, scoped_address.scopeId());
+
+            ctl::ctSockaddr bad_address;
+            Assert::IsFalse(bad_address.setAddress(L"not an address"));
+        }
+
+        TEST_METHOD(WriteCompleteAddressMatchesWinsock)
+        {
+            ctl::ctSockaddr scoped_address(MakeAddress(L"fe80::1", 0));
+            scoped_address.setScopeId(3);
+
+            const ctl::ctSockaddr test_addresses[] = {
+                MakeAddress(L"10.0.0.1", 0),
+                MakeAddress(L"10.0.0.1", 8080),
+                MakeAddress(L"fe80::1", 0),
+                MakeAddress(L"fe80::1", 8080),
+                scoped_address,
+                MakeAddress(L"::ffff:10.0.0.1", 65535)
+            };
+            for (const auto& address : test_addresses) {
+                WCHAR expected[ctl::IP_STRING_MAX_LENGTH];
+                DWORD expected_length = ctl::IP_STRING_MAX_LENGTH;
+                Assert::AreEqual(0, ::WSAAddressToStringW(address.sockaddr(), address.length(), nullptr, expected, &expected_length));
+
+                WCHAR written[ctl::IP_STRING_MAX_LENGTH];
+                Assert::IsTrue(address.writeCompleteAddress(written));
+                Assert::AreEqual(std::wstring(expected), std::wstring(written));
+
+                CHAR written_narrow[ctl::IP_STRING_MAX_LENGTH];
+                Assert::IsTrue(address.writeCompleteAddress(written_narrow));
+                Assert::AreEqual(std::wstring(expected), std::wstring(written_narrow, written_narrow + ::strlen(written_narrow)));
+            }
+
+            scoped_address.setPort(8080);
+            Assert::AreEqual(std::wstring(L"[fe80::1%3]:8080"), scoped_address.writeCompleteAddress());
+            Assert::AreEqual(std::wstring(L"[fe80::1]:8080"), scoped_address.writeCompleteAddress(true));
+
+            ctl::ctSockaddr unspecified;
+            WCHAR unspecified_string[ctl::IP_STRING_MAX_LENGTH];
+            Assert::IsFalse(unspecified.writeCompleteAddress(unspecified_string));
+        }
+
+        TEST_METHOD(KeyEquality)
+        {
+            ctl::ctSockaddr flow_address(MakeAddress(L"fe80::1", 5000));
+            flow_address.setFlowInfo(7);
+
+            const ctl::ctSockaddrKey key(MakeAddress(L"fe80::1", 5000));
+            Assert::IsTrue(key == MakeAddress(L"fe80::1", 5000).key());
+            Assert::AreEqual(key.hash(), MakeAddress(L"fe80::1", 5000).key().hash());
+            // the flow info is not part of the endpoint
+            Assert::IsTrue(key == flow_address.key());
+
+            Assert::IsTrue(key != MakeAddress(L"fe80::1", 5001).key());
+            Assert::IsTrue(key != MakeAddress(L"fe80::2", 5000).key());
+            ctl::ctSockaddr scoped_address(MakeAddress(L"fe80::1", 5000));
+            scoped_address.setScopeId(3);
+            Assert::IsTrue(key != scoped_address.key());
+            // v4-mapped addresses are not folded into IPv4
+            Assert::IsTrue(MakeAddress(L"10.0.0.1", 80).key() != MakeAddress(L"::ffff:10.0.0.1", 80).key());
+            Assert::IsTrue(ctl::ctSockaddrKey() == ctl::ctSockaddr().key());
+        }
+
+        TEST_METHOD(KeyRebuildsTheAddress)
+        {
+            ctl::ctSockaddr v6_address(MakeAddress(L"fe80::1", 5000));
+            v6_address.setScopeId(3);
+            const ctl::ctSockaddr v4_address(MakeAddress(L"10.0.0.1", 80));
+
+            Assert::IsTrue(v6_address == v6_address.key().sockaddr());
+            Assert::IsTrue(v4_address == v4_address.key().sockaddr());
+            Assert::AreEqual(static_cast<unsigned short>(5000), v6_address.key().port());
+            Assert::AreEqual(3UL, v6_address.key().scopeId());
+            Assert::AreEqual(static_cast<short>(AF_INET), v4_address.key().family());
+        }
+
+        TEST_METHOD(KeyOrdering)
+        {
+            std::map<ctl::ctSockaddrKey, int> ordered_keys;
+            ordered_keys[MakeAddress(L"10.0.0.2", 1).key()] = 3;
+            ordered_keys[MakeAddress(L"10.0.0.1", 2).key()] = 2;
+            ordered_keys[MakeAddress(L"10.0.0.1", 1).key()] = 1;
+            ordered_keys[MakeAddress(L"::1", 1).key()] = 4;
+            ordered_keys[MakeAddress(L"10.0.0.1", 1).key()] = 1;
+            Assert::AreEqual(static_cast<size_t>(4), ordered_keys.size());
+
+            // IPv4 addresses are ordered by their network order bytes, then by port
+            int expected_value = 1;
+            for (const auto& entry : ordered_keys) {
+                Assert::AreEqual(expected_value, entry.second);
+                ++expected_value;
+            }
+
+            const ctl::ctSockaddrKey key(MakeAddress(L"10.0.0.1", 1));
+            Assert::IsFalse(key < key);
+        }
+
+        TEST_METHOD(StdHashSupport)
+        {
+            std::unordered_map<ctl::ctSockaddrKey, unsigned short> keys;
+            std::unordered_map<ctl::ctSockaddr, unsigned short> addresses;
+            const unsigned short AddressCount = 4096;
+            for (unsigned short port = 1; port <= AddressCount; ++port) {
+                keys[MakeAddress(L"10.1.2.3", port).key()] = port;
+                addresses[MakeAddress(L"fe80::1", port)] = port;
+            }
+            Assert::AreEqual(static_cast<size_t>(AddressCount), keys.size());
+            Assert::AreEqual(static_cast<size_t>(AddressCount), addresses.size());
+            Assert::AreEqual(static_cast<unsigned short>(42), keys[MakeAddress(L"10.1.2.3", 42).key()]);
+            Assert::AreEqual(static_cast<unsigned short>(42), addresses[MakeAddress(L"fe80::1", 42)]);
+        }
+    };
+}
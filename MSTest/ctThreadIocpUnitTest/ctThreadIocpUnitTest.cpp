@@ -0,0 +1,220 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <functional>
+
+#include <WinSock2.h>
+#include <Windows.h>
+
+#include <ctVersionConversion.hpp>
+#include <ctThreadIocp.hpp>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+///
+/// Counting allocator: every operator new in this module is counted
+///
+static volatile LONG s_AllocationCount = 0;
+
+void* operator new(size_t _size)
+{
+    ::InterlockedIncrement(&s_AllocationCount);
+    void* allocation = ::malloc(_size != 0 ? _size : 1);
+    if (nullptr == allocation) {
+        throw std::bad_alloc();
+    }
+    return allocation;
+}
+void operator delete(void* _allocation) NOEXCEPT
+{
+    ::free(_allocation);
+}
+void* operator new[](size_t _size)
+{
+    return operator new(_size);
+}
+void operator delete[](void* _allocation) NOEXCEPT
+{
+    ::free(_allocation);
+}
+static LONG AllocationCount() NOEXCEPT
+{
+    return s_AllocationCount;
+}
+
+namespace ctsUnitTest {
+    TEST_CLASS(ctThreadIocpUnitTest)
+    {
+    private:
+        // about the size of the ctsIOTask captured by the IO completion callbacks
+        struct CapturedTask {
+            long long values[8];
+        };
+
+        struct CompletionCounter {
+            volatile LONG count = 0;
+            HANDLE completed_event = nullptr;
+        };
+
+        static SOCKET CreateLoopbackSocket(_Out_ sockaddr_in* _bound_address)
+        {
+            SOCKET udp_socket = ::WSASocketW(AF_INET, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_OVERLAPPED);
+            Assert::AreNotEqual(INVALID_SOCKET, udp_socket);
+
+            ::ZeroMemory(_bound_address, sizeof(sockaddr_in));
+            _bound_address->sin_family = AF_INET;
+            _bound_address->sin_addr.s_addr = ::htonl(INADDR_LOOPBACK);
+            Assert::AreEqual(0, ::bind(udp_socket, reinterpret_cast<sockaddr*>(_bound_address), sizeof(sockaddr_in)));
+            int address_length = sizeof(sockaddr_in);
+            Assert::AreEqual(0, ::getsockname(udp_socket, reinterpret_cast<sockaddr*>(_bound_address), &address_length));
+            return udp_socket;
+        }
+
+    public:
+        TEST_CLASS_INITIALIZE(Setup)
+        {
+            WSADATA wsadata;
+            auto startup = ::WSAStartup(WINSOCK_VERSION, &wsadata);
+            Assert::AreEqual(0, startup);
+        }
+
+        TEST_CLASS_CLEANUP(Cleanup)
+        {
+            ::WSACleanup();
+        }
+
+        TEST_METHOD(InlineCallbacksDoNotAllocate)
+        {
+            std::shared_ptr<int> shared_value(std::make_shared<int>(1));
+            std::weak_ptr<int> weak_value(shared_value);
+            CapturedTask task = {};
+            task.values[0] = 2;
+            long long invoked = 0;
+
+            const LONG starting_count = AllocationCount();
+            {
+                ctl::ctThreadIocpCallback callback([weak_value, task, &invoked](OVERLAPPED*) {
+                    invoked += task.values[0];
+                });
+                ctl::ctThreadIocpCallback moved_callback(std::move(callback));
+                Assert::IsFalse(static_cast<bool>(callback));
+                Assert::IsTrue(static_cast<bool>(moved_callback));
+                moved_callback(nullptr);
+            }
+            Assert::AreEqual(starting_count, AllocationCount());
+            Assert::AreEqual(2LL, invoked);
+            // the captured weak_ptr was released
+            Assert::AreEqual(1L, shared_value.use_count());
+
+            // callables larger than the inline storage are moved to the heap
+            struct LargeCapture {
+                char bytes[ctl::ctThreadIocpCallback::InlineCallbackSize + 1];
+            } large_capture = {};
+            {
+                ctl::ctThreadIocpCallback callback([large_capture, &invoked](OVERLAPPED*) {
+                    invoked += sizeof(large_capture.bytes);
+                });
+                callback(nullptr);
+            }
+            Assert::AreEqual(starting_count + 1, AllocationCount());
+        }
+
+        TEST_METHOD(CanceledRequestsAreReused)
+        {
+            sockaddr_in bound_address;
+            SOCKET udp_socket = CreateLoopbackSocket(&bound_address);
+            {
+                ctl::ctThreadIocp thread_iocp(udp_socket);
+                std::shared_ptr<int> shared_value(std::make_shared<int>(1));
+                CapturedTask task = {};
+
+                // the first request allocates
+                OVERLAPPED* first_request = thread_iocp.new_request([weak_value = std::weak_ptr<int>(shared_value), task](OVERLAPPED*) {});
+                thread_iocp.cancel_request(first_request);
+
+                const LONG starting_count = AllocationCount();
+                for (unsigned long count = 0; count < 1000; ++count) {
+                    OVERLAPPED* request = thread_iocp.new_request([weak_value = std::weak_ptr<int>(shared_value), task](OVERLAPPED*) {});
+                    Assert::IsTrue(first_request == request);
+                    thread_iocp.cancel_request(request);
+                }
+                Assert::AreEqual(starting_count, AllocationCount());
+                // canceling destroyed every callback
+                Assert::AreEqual(1L, shared_value.use_count());
+            }
+            ::closesocket(udp_socket);
+        }
+
+        TEST_METHOD(SteadyStateIoDoesNotAllocate)
+        {
+            sockaddr_in bound_address;
+            SOCKET udp_socket = CreateLoopbackSocket(&bound_address);
+            CompletionCounter completions;
+            completions.completed_event = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+            Assert::IsNotNull(completions.completed_event);
+            {
+                ctl::ctThreadIocp thread_iocp(udp_socket);
+                std::shared_ptr<int> shared_value(std::make_shared<int>(1));
+                CapturedTask task = {};
+                char recv_buffer[64];
+                char send_buffer[64] = {};
+
+                // the callback signals before its request is released: pooling two requests keeps one free for the next IO
+                OVERLAPPED* first_request = thread_iocp.new_request([](OVERLAPPED*) {});
+                OVERLAPPED* second_request = thread_iocp.new_request([](OVERLAPPED*) {});
+                thread_iocp.cancel_request(first_request);
+                thread_iocp.cancel_request(second_request);
+
+                const unsigned long WarmupIterations = 10;
+                const unsigned long MeasuredIterations = 1000;
+                LONG starting_count = 0;
+                for (unsigned long iteration = 0; iteration < WarmupIterations + MeasuredIterations; ++iteration) {
+                    if (WarmupIterations == iteration) {
+                        starting_count = AllocationCount();
+                    }
+
+                    OVERLAPPED* request = thread_iocp.new_request(
+                        [weak_value = std::weak_ptr<int>(shared_value), task, &completions](OVERLAPPED*) {
+                        ::InterlockedIncrement(&completions.count);
+                        ::SetEvent(completions.completed_event);
+                    });
+                    WSABUF wsabuf;
+                    wsabuf.buf = recv_buffer;
+                    wsabuf.len = sizeof(recv_buffer);
+                    DWORD flags = 0;
+                    if (::WSARecvFrom(udp_socket, &wsabuf, 1, nullptr, &flags, nullptr, nullptr, request, nullptr) != 0) {
+                        Assert::AreEqual(static_cast<int>(WSA_IO_PENDING), ::WSAGetLastError());
+                    }
+
+                    Assert::AreEqual(
+                        static_cast<int>(sizeof(send_buffer)),
+                        ::sendto(udp_socket, send_buffer, sizeof(send_buffer), 0, reinterpret_cast<sockaddr*>(&bound_address), sizeof(bound_address)));
+                    Assert::AreEqual(static_cast<DWORD>(WAIT_OBJECT_0), ::WaitForSingleObject(completions.completed_event, 5000));
+                }
+
+                Assert::AreEqual(starting_count, AllocationCount());
+                const LONG completed_count = completions.count;
+                Assert::AreEqual(static_cast<LONG>(WarmupIterations + MeasuredIterations), completed_count);
+            }
+            ::closesocket(udp_socket);
+            ::CloseHandle(completions.completed_event);
+        }
+    };
+}
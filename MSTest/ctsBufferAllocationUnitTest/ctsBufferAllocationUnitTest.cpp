@@ -0,0 +1,98 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <utility>
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsBufferAllocation.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsBufferAllocationUnitTest)
+    {
+    public:
+        TEST_METHOD(DefaultIsEmpty)
+        {
+            ctsBufferAllocation allocation;
+            Assert::IsTrue(allocation.empty());
+            Assert::IsNull(allocation.get());
+            Assert::AreEqual(static_cast<size_t>(0), allocation.size());
+            Assert::IsFalse(allocation.uses_large_pages());
+        }
+
+        TEST_METHOD(RegularPages)
+        {
+            ctsBufferAllocation allocation(65536, ctsBufferAllocation::AnyNumaNode, 0);
+            Assert::IsFalse(allocation.empty());
+            Assert::AreEqual(static_cast<size_t>(65536), allocation.size());
+            Assert::IsFalse(allocation.uses_large_pages());
+            // committed and writable
+            allocation.get()[0] = 'a';
+            allocation.get()[65535] = 'z';
+            Assert::AreEqual('z', allocation.get()[65535]);
+        }
+
+        TEST_METHOD(PreferredNumaNode)
+        {
+            const unsigned long node = ctsBufferAllocation::CurrentNumaNode();
+            Assert::IsTrue(node < ctsBufferAllocation::NumaNodeCount());
+
+            ctsBufferAllocation allocation(4096, node, 0);
+            Assert::IsFalse(allocation.empty());
+            Assert::AreEqual(node, allocation.preferred_numa_node());
+        }
+
+        TEST_METHOD(LargePagesFallBackToRegularPages)
+        {
+            // test accounts usually don't hold SeLockMemoryPrivilege: either outcome must give a usable buffer
+            const size_t large_page_size = ctsBufferAllocation::EnableLargePages();
+            ctsBufferAllocation allocation(1024, ctsBufferAllocation::AnyNumaNode, large_page_size > 0 ? large_page_size : ::GetLargePageMinimum());
+            Assert::IsFalse(allocation.empty());
+            Assert::AreEqual(static_cast<size_t>(1024), allocation.size());
+            allocation.get()[1023] = 'z';
+            Assert::AreEqual('z', allocation.get()[1023]);
+        }
+
+        TEST_METHOD(MoveTransfersOwnership)
+        {
+            ctsBufferAllocation first(4096, ctsBufferAllocation::AnyNumaNode, 0);
+            char* buffer = first.get();
+
+            ctsBufferAllocation second(std::move(first));
+            Assert::IsTrue(first.empty());
+            Assert::AreEqual(static_cast<void*>(buffer), static_cast<void*>(second.get()));
+
+            ctsBufferAllocation third;
+            third = std::move(second);
+            Assert::IsTrue(second.empty());
+            Assert::AreEqual(static_cast<void*>(buffer), static_cast<void*>(third.get()));
+            Assert::AreEqual(static_cast<size_t>(4096), third.size());
+        }
+
+        TEST_METHOD(ReleaseKeepsThePages)
+        {
+            ctsBufferAllocation allocation(4096, ctsBufferAllocation::AnyNumaNode, 0);
+            char* buffer = allocation.release();
+            Assert::IsTrue(allocation.empty());
+            Assert::IsNotNull(buffer);
+            buffer[0] = 'a';
+            Assert::IsTrue(::VirtualFree(buffer, 0, MEM_RELEASE) != FALSE);
+        }
+    };
+}
@@ -16,6 +16,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // cpp headers
 #include <memory>
 // ctl headers
+#include <ctScopeGuard.hpp>
 #include <ctTimer.hpp>
 #include <ctVersionConversion.hpp>
 // project headers
@@ -107,6 +108,9 @@ namespace ctsTraffic {
         void PrintJitterUpdate(const JitterFrameEntry& current_frame, const JitterFrameEntry& previous_frame, const JitterFrameEntry& first_frame) NOEXCEPT
         {
         }
+        void PrintTimeSeries(_In_z_ const char* _connection_id, const ctsTimeSeries& _time_series) NOEXCEPT
+        {
+        }
         void PrintErrorInfo(_In_z_ _Printf_format_string_ LPCWSTR _text, ...) NOEXCEPT
         {
         }
@@ -194,6 +198,11 @@ namespace ctsUnitTest {
         };
 
         static const unsigned long DefaultTransferSize = 10UL;
+        // the shared buffers are created once per process: Setup sizes them for IO functions posting vectored IO
+        // - a window is one 64KB buffer pattern, so buffers larger than 64KB are split into segments
+        static const unsigned long BufferPatternSize = 0x10000;
+        static const unsigned long SegmentedMaxBufferSize = ctsIOTask::MaxSegments * BufferPatternSize;
+        static const unsigned long SegmentedBufferSize = 4 * BufferPatternSize + 100;
         void SetTestBaseClassDefaults(TestRole _role, TestShutdownMethod _shutdown = Graceful)
         {
             if (Server == _role && Hard == _shutdown) {
@@ -215,6 +224,67 @@ namespace ctsUnitTest {
             s_TransferSize = DefaultTransferSize;
             s_IsListening = (Server == _role);
         }
+        void VerifySegmentLengths(const ctsIOTask& _task)
+        {
+            // four full windows followed by the remaining 100 bytes
+            Assert::AreEqual(SegmentedBufferSize, _task.buffer_length);
+            Assert::AreEqual(5UL, static_cast<unsigned long>(_task.segment_count));
+            unsigned long total_length = 0;
+            for (unsigned long segment = 0; segment < _task.segment_count; ++segment) {
+                Assert::AreEqual((segment < 4) ? BufferPatternSize : 100UL, _task.segments[segment].length);
+                total_length += _task.segments[segment].length;
+            }
+            Assert::AreEqual(_task.buffer_length, total_length);
+            Assert::IsTrue(_task.buffer + _task.buffer_offset == _task.segments[0].buffer);
+        }
+        void RunSegmentedSends()
+        {
+            this->SetTestBaseClassDefaults(Client, Graceful);
+            s_BufferSize = SegmentedBufferSize;
+            s_TransferSize = SegmentedBufferSize * 2;
+
+            std::shared_ptr<ctsIOPattern> test_pattern(ctsIOPattern::MakeIOPattern());
+            ctsIOTask test_task = test_pattern->initiate_io();
+            Assert::AreEqual(ctsStatistics::ConnectionIdLength, test_task.buffer_length);
+            Assert::AreEqual(IOTaskAction::Recv, test_task.ioAction);
+            Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, ctsStatistics::ConnectionIdLength, 0));
+
+            for (unsigned long io_count = 0; io_count < 2; ++io_count) {
+                test_task = test_pattern->initiate_io();
+                Assert::AreEqual(IOTaskAction::Send, test_task.ioAction);
+                Logger::WriteMessage(ctl::ctString::format_string(L"%u: %ws", io_count, ToString<ctsTraffic::ctsIOTask>(test_task).c_str()).c_str());
+                this->VerifySegmentLengths(test_task);
+                if (ctsConfig::Settings->RandomPayload) {
+                    // generated payload is never shared: every segment is its own arena chunk
+                    for (unsigned long segment = 1; segment < test_task.segment_count; ++segment) {
+                        Assert::IsTrue(test_task.segments[segment - 1].buffer != test_task.segments[segment].buffer);
+                    }
+                } else {
+                    // the second send continues the pattern 100 bytes after where the first started
+                    Assert::AreEqual(io_count * 100UL, test_task.buffer_offset);
+                    // a full window ends back at the pattern offset it started at: every segment sends the same window
+                    for (unsigned long segment = 0; segment < test_task.segment_count; ++segment) {
+                        Assert::IsTrue(test_task.buffer + test_task.buffer_offset == test_task.segments[segment].buffer);
+                    }
+                    Assert::AreEqual(0, ::memcmp(test_task.segments[0].buffer, ctsIOPattern::AccessSharedBuffer() + test_task.buffer_offset, BufferPatternSize));
+                }
+                Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, test_task.buffer_length, 0));
+            }
+
+            // recv server completion
+            test_task = test_pattern->initiate_io();
+            Assert::AreEqual(IOTaskAction::Recv, test_task.ioAction);
+            Assert::AreEqual(4UL, test_task.buffer_length);
+            Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, 4, 0));
+
+            test_task = test_pattern->initiate_io();
+            Assert::AreEqual(IOTaskAction::GracefulShutdown, test_task.ioAction);
+            Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, 0, 0));
+
+            test_task = test_pattern->initiate_io();
+            Assert::AreEqual(IOTaskAction::Recv, test_task.ioAction);
+            Assert::AreEqual(ctsIOStatus::CompletedIo, test_pattern->complete_io(test_task, 0, 0));
+        }
     public:
         TEST_CLASS_INITIALIZE(Setup)
         {
@@ -228,6 +298,12 @@ namespace ctsUnitTest {
             ctsConfig::Settings->PrePostRecvs = 1;
             ctsConfig::Settings->PrePostSends = 1;
             ctsConfig::Settings->ConnectionLimit = 8;
+
+            // the default TCP IO function posts vectored IO: buffers larger than one window are split into segments
+            // - the shared buffers are created on first use, so size them before any test sets its own buffer sizes
+            ctsConfig::Settings->MaxIoSegments = ctsIOTask::MaxSegments;
+            s_MaxBufferSize = SegmentedMaxBufferSize;
+            (void) ctsIOPattern::AccessSharedBuffer();
         }
         TEST_CLASS_CLEANUP(Cleanup)
         {
@@ -1781,5 +1857,96 @@ namespace ctsUnitTest {
             Logger::WriteMessage(ToString<ctsTraffic::ctsIOTask>(test_task).c_str());
             Assert::AreEqual(ctsIOStatus::CompletedIo, test_pattern->complete_io(test_task, 0, 0));
         }
+
+        //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        ///
+        /// Segmented sends: buffers larger than the shared buffer window
+        ///
+        ///
+        //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        TEST_METHOD(PushClient_SegmentedSends)
+        {
+            this->RunSegmentedSends();
+        }
+
+        TEST_METHOD(PushClient_RandomPayloadSegmentedSendsReturnEveryChunk)
+        {
+            ctsConfig::Settings->RandomPayload = true;
+            ctlScopeGuard(reset_random_payload, { ctsConfig::Settings->RandomPayload = false; });
+
+            // one connection first: the arena only grows while more chunks are in flight than it holds
+            this->RunSegmentedSends();
+            const unsigned long chunk_count = ctsIOPattern::RecvBufferChunkCount();
+            for (unsigned long connection = 0; connection < 100; ++connection) {
+                this->RunSegmentedSends();
+            }
+            Assert::AreEqual(chunk_count, ctsIOPattern::RecvBufferChunkCount());
+        }
+
+        //
+        // Micro-benchmarks of the initiate_io / complete_io hot path
+        // - only the pattern's bookkeeping is measured: no bytes are copied or verified
+        // - compare the logged rates across builds on the same machine
+        // - ignored by default so regular test runs don't pay for 1M IOs each: remove TEST_IGNORE() locally to run them
+        //
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_InitiateCompleteSends)
+            TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(Benchmark_InitiateCompleteSends)
+        {
+            this->MeasureInitiateComplete(ctsConfig::IoPatternType::Push, IOTaskAction::Send);
+        }
+
+        BEGIN_TEST_METHOD_ATTRIBUTE(Benchmark_InitiateCompleteRecvs)
+            TEST_METHOD_ATTRIBUTE(L"Category", L"Benchmark")
+            TEST_IGNORE()
+        END_TEST_METHOD_ATTRIBUTE()
+        TEST_METHOD(Benchmark_InitiateCompleteRecvs)
+        {
+            this->MeasureInitiateComplete(ctsConfig::IoPatternType::Pull, IOTaskAction::Recv);
+        }
+
+    private:
+        void MeasureInitiateComplete(ctsConfig::IoPatternType _pattern, IOTaskAction _action)
+        {
+            static const unsigned long BenchmarkIoCount = 1000000UL;
+
+            this->SetTestBaseClassDefaults(Client, Graceful);
+            ctsConfig::Settings->IoPattern = _pattern;
+            ctsConfig::Settings->ShouldVerifyBuffers = false;
+            s_TransferSize = static_cast<ctsUnsignedLongLong>(BenchmarkIoCount) * s_BufferSize;
+
+            std::shared_ptr<ctsIOPattern> test_pattern(ctsIOPattern::MakeIOPattern());
+            ctsIOTask test_task = test_pattern->initiate_io();
+            Assert::AreEqual(ctsStatistics::ConnectionIdLength, test_task.buffer_length);
+            Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, ctsStatistics::ConnectionIdLength, 0));
+
+            LARGE_INTEGER frequency;
+            LARGE_INTEGER start_time;
+            LARGE_INTEGER end_time;
+            ::QueryPerformanceFrequency(&frequency);
+            ::QueryPerformanceCounter(&start_time);
+            for (unsigned long io_count = 0; io_count < BenchmarkIoCount - 1; ++io_count) {
+                test_task = test_pattern->initiate_io();
+                if (test_task.ioAction != _action) {
+                    Assert::AreEqual(_action, test_task.ioAction);
+                }
+                test_pattern->complete_io(test_task, test_task.buffer_length, 0);
+            }
+            ::QueryPerformanceCounter(&end_time);
+
+            const double elapsed_seconds = static_cast<double>(end_time.QuadPart - start_time.QuadPart) / static_cast<double>(frequency.QuadPart);
+            Logger::WriteMessage(
+                ctl::ctString::format_string(
+                    L"%ws: %lu initiate_io/complete_io pairs in %.3f seconds (%.0f per second, %.1f ns each) - sizeof(ctsIOTask) == %Iu\n",
+                    ctsIOTask::PrintIOAction(_action),
+                    BenchmarkIoCount - 1,
+                    elapsed_seconds,
+                    (BenchmarkIoCount - 1) / elapsed_seconds,
+                    elapsed_seconds * 1000000000.0 / (BenchmarkIoCount - 1),
+                    sizeof(ctsIOTask)).c_str());
+        }
     };
 }
\ No newline at end of file
@@ -107,6 +107,9 @@ namespace ctsTraffic {
         void PrintJitterUpdate(const JitterFrameEntry& current_frame, const JitterFrameEntry& previous_frame, const JitterFrameEntry& first_frame) NOEXCEPT
         {
         }
+        void PrintTimeSeries(_In_z_ const char* _connection_id, const ctsTimeSeries& _time_series) NOEXCEPT
+        {
+        }
         void PrintErrorInfo(_In_z_ _Printf_format_string_ LPCWSTR _text, ...) NOEXCEPT
         {
         }
@@ -194,6 +197,11 @@ namespace ctsUnitTest {
         };
 
         static const unsigned long DefaultTransferSize = 10UL;
+        // the shared buffers are created once per process: Setup sizes them for IO functions posting vectored IO
+        // - a window is one 64KB buffer pattern, so buffers larger than 64KB are split into segments
+        static const unsigned long BufferPatternSize = 0x10000;
+        static const unsigned long SegmentedMaxBufferSize = ctsIOTask::MaxSegments * BufferPatternSize;
+        static const unsigned long SegmentedBufferSize = 4 * BufferPatternSize + 100;
         void SetTestBaseClassDefaults(TestRole _role, TestShutdownMethod _shutdown = Graceful)
         {
             if (Server == _role && Hard == _shutdown) {
@@ -215,6 +223,70 @@ namespace ctsUnitTest {
             s_TransferSize = DefaultTransferSize;
             s_IsListening = (Server == _role);
         }
+        void VerifySegmentLengths(const ctsIOTask& _task)
+        {
+            // four full windows followed by the remaining 100 bytes
+            Assert::AreEqual(SegmentedBufferSize, _task.buffer_length);
+            Assert::AreEqual(5UL, static_cast<unsigned long>(_task.segment_count));
+            unsigned long total_length = 0;
+            for (unsigned long segment = 0; segment < _task.segment_count; ++segment) {
+                Assert::AreEqual((segment < 4) ? BufferPatternSize : 100UL, _task.segments[segment].length);
+                total_length += _task.segments[segment].length;
+            }
+            Assert::AreEqual(_task.buffer_length, total_length);
+            Assert::IsTrue(_task.buffer + _task.buffer_offset == _task.segments[0].buffer);
+            // every segment is its own arena chunk
+            for (unsigned long segment = 1; segment < _task.segment_count; ++segment) {
+                Assert::IsTrue(_task.segments[segment - 1].buffer != _task.segments[segment].buffer);
+            }
+        }
+        void RecvSegmentedPattern(const ctsIOTask& _task)
+        {
+            // "recv" the correct bytes: the pattern continues from the end of each segment into the next
+            unsigned long bytes_received = 0;
+            for (unsigned long segment = 0; segment < _task.segment_count; ++segment) {
+                ::memcpy(
+                    _task.segments[segment].buffer,
+                    ctsIOPattern::AccessSharedBuffer() + (_task.expected_pattern_offset + bytes_received) % BufferPatternSize,
+                    _task.segments[segment].length);
+                bytes_received += _task.segments[segment].length;
+            }
+        }
+        void RunSegmentedRecvs()
+        {
+            this->SetTestBaseClassDefaults(Server);
+            s_BufferSize = SegmentedBufferSize;
+            s_TransferSize = SegmentedBufferSize * 2;
+
+            std::shared_ptr<ctsIOPattern> test_pattern(ctsIOPattern::MakeIOPattern());
+            ctsIOTask test_task = test_pattern->initiate_io();
+            Assert::AreEqual(ctsStatistics::ConnectionIdLength, test_task.buffer_length);
+            Assert::AreEqual(IOTaskAction::Send, test_task.ioAction);
+            Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, ctsStatistics::ConnectionIdLength, 0));
+
+            for (unsigned long io_count = 0; io_count < 2; ++io_count) {
+                test_task = test_pattern->initiate_io();
+                Assert::AreEqual(IOTaskAction::Recv, test_task.ioAction);
+                Logger::WriteMessage(ctl::ctString::format_string(L"%u: %ws", io_count, ToString<ctsTraffic::ctsIOTask>(test_task).c_str()).c_str());
+                this->VerifySegmentLengths(test_task);
+                // the second recv continues the pattern 100 bytes after where the first started
+                Assert::AreEqual(io_count * 100UL, test_task.expected_pattern_offset);
+
+                this->RecvSegmentedPattern(test_task);
+                Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, test_task.buffer_length, 0));
+            }
+
+            // send server completion
+            test_task = test_pattern->initiate_io();
+            Assert::AreEqual(IOTaskAction::Send, test_task.ioAction);
+            Assert::AreEqual(4UL, test_task.buffer_length);
+            Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, 4, 0));
+
+            // wait for the FIN from the client
+            test_task = test_pattern->initiate_io();
+            Assert::AreEqual(IOTaskAction::Recv, test_task.ioAction);
+            Assert::AreEqual(ctsIOStatus::CompletedIo, test_pattern->complete_io(test_task, 0, 0));
+        }
     public:
         TEST_CLASS_INITIALIZE(Setup)
         {
@@ -228,6 +300,12 @@ namespace ctsUnitTest {
             ctsConfig::Settings->PrePostRecvs = 1;
             ctsConfig::Settings->PrePostSends = 1;
             ctsConfig::Settings->ConnectionLimit = 8;
+
+            // the default TCP IO function posts vectored IO: buffers larger than one window are split into segments
+            // - the shared buffers are created on first use, so size them before any test sets its own buffer sizes
+            ctsConfig::Settings->MaxIoSegments = ctsIOTask::MaxSegments;
+            s_MaxBufferSize = SegmentedMaxBufferSize;
+            (void) ctsIOPattern::AccessSharedBuffer();
         }
         TEST_CLASS_CLEANUP(Cleanup)
         {
@@ -923,5 +1001,77 @@ namespace ctsUnitTest {
 
             Assert::AreEqual(ctsIOStatus::CompletedIo, test_pattern->complete_io(test_task, 0, 0));
         }
+
+        //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        ///
+        /// Segmented recvs: buffers larger than the shared buffer window
+        ///
+        ///
+        //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+        TEST_METHOD(PushServer_SegmentedRecvs)
+        {
+            this->RunSegmentedRecvs();
+        }
+
+        TEST_METHOD(PushServer_SegmentedRecvInvalidBytesInLaterSegment)
+        {
+            this->SetTestBaseClassDefaults(Server);
+            s_BufferSize = SegmentedBufferSize;
+            s_TransferSize = SegmentedBufferSize;
+
+            std::shared_ptr<ctsIOPattern> test_pattern(ctsIOPattern::MakeIOPattern());
+            ctsIOTask test_task = test_pattern->initiate_io();
+            Assert::AreEqual(ctsStatistics::ConnectionIdLength, test_task.buffer_length);
+            Assert::AreEqual(IOTaskAction::Send, test_task.ioAction);
+            Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, ctsStatistics::ConnectionIdLength, 0));
+
+            test_task = test_pattern->initiate_io();
+            Assert::AreEqual(IOTaskAction::Recv, test_task.ioAction);
+            this->VerifySegmentLengths(test_task);
+            // only one byte in the fourth segment does not match the pattern
+            this->RecvSegmentedPattern(test_task);
+            test_task.segments[3].buffer[10] = static_cast<char>(~test_task.segments[3].buffer[10]);
+            Assert::AreEqual(ctsIOStatus::FailedIo, test_pattern->complete_io(test_task, test_task.buffer_length, 0));
+            Assert::AreEqual(ctsStatusErrorDataDidNotMatchBitPattern, test_pattern->get_last_error());
+        }
+
+        TEST_METHOD(PushServer_SegmentedRecvsReturnEveryChunk)
+        {
+            // one connection first: the arena only grows while more chunks are in flight than it holds
+            this->RunSegmentedRecvs();
+            const unsigned long chunk_count = ctsIOPattern::RecvBufferChunkCount();
+            for (unsigned long connection = 0; connection < 100; ++connection) {
+                this->RunSegmentedRecvs();
+            }
+            Assert::AreEqual(chunk_count, ctsIOPattern::RecvBufferChunkCount());
+        }
+
+        TEST_METHOD(MediaStreamServer_ConnectionIdDoesNotHoldRecvBuffers)
+        {
+            ctsConfig::Settings->IoPattern = ctsConfig::IoPatternType::MediaStream;
+            ctsConfig::Settings->Protocol = ctsConfig::ProtocolType::UDP;
+            ctsConfig::Settings->UseSharedBuffer = false;
+            ctsConfig::Settings->ShouldVerifyBuffers = true;
+            s_MediaStreamSettings.FramesPerSecond = 100;
+            s_MediaStreamSettings.FrameProfile = ctsMediaStreamFrameProfile::Constant(1000UL);
+            s_MaxBufferSize = 1000;
+            s_BufferSize = 1000;
+            s_TransferSize = 1000 * 10;
+            s_IsListening = true;
+
+            const unsigned long chunks_before = ctsIOPattern::RecvBufferChunkCount();
+            for (unsigned long connection = 0; connection < 1000; ++connection) {
+                std::shared_ptr<ctsIOPattern> test_pattern(ctsIOPattern::MakeIOPattern());
+
+                ctsIOTask test_task = test_pattern->initiate_io();
+                Assert::IsTrue(ctsIOTask::BufferType::UdpConnectionId == test_task.buffer_type);
+                Assert::AreEqual(IOTaskAction::Send, test_task.ioAction);
+                Assert::AreEqual(UdpDatagramConnectionIdHeaderLength, test_task.buffer_length);
+                Assert::AreEqual(ctsIOStatus::ContinueIo, test_pattern->complete_io(test_task, test_task.buffer_length, 0));
+            }
+            // no connection left a recv buffer checked out of the arena for its connection ID
+            Assert::AreEqual(chunks_before, ctsIOPattern::RecvBufferChunkCount());
+        }
     };
 }
\ No newline at end of file
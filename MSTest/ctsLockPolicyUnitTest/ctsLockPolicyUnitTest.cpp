@@ -0,0 +1,55 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <thread>
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsLockPolicy.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsLockPolicyUnitTest)
+    {
+    public:
+        TEST_METHOD(ThreadSafeExcludesOtherThreads)
+        {
+            ctsLockPolicy<ctsLockThreadSafe> lock;
+            volatile bool other_thread_entered = false;
+
+            lock.lock();
+            std::thread other_thread([&] () {
+                ctsAutoReleaseLock<ctsLockThreadSafe> auto_lock(lock);
+                other_thread_entered = true;
+            });
+            ::Sleep(100);
+            Assert::IsFalse(other_thread_entered);
+            lock.unlock();
+
+            other_thread.join();
+            Assert::IsTrue(other_thread_entered);
+        }
+
+        TEST_METHOD(ThreadSafeIsRecursive)
+        {
+            ctsLockPolicy<ctsLockThreadSafe> lock;
+            ctsAutoReleaseLock<ctsLockThreadSafe> outer_lock(lock);
+            ctsAutoReleaseLock<ctsLockThreadSafe> inner_lock(lock);
+        }
+    };
+}
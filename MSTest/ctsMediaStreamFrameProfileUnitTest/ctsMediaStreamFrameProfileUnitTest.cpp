@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <stdexcept>
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsMediaStreamFrameProfile.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsMediaStreamFrameProfileUnitTest)
+    {
+    public:
+        TEST_METHOD(ConstantFrames)
+        {
+            const ctsMediaStreamFrameProfile profile(ctsMediaStreamFrameProfile::Constant(1000UL));
+            Assert::AreEqual(1UL, profile.cycle_length());
+            Assert::AreEqual(1000UL, profile.frame_size(1LL));
+            Assert::AreEqual(1000UL, profile.frame_size(12345LL));
+            Assert::AreEqual(1000UL, profile.maximum_frame_size());
+            Assert::AreEqual(25000ULL, profile.total_bytes(25UL));
+            // sequence numbers start at 1
+            Assert::AreEqual(0UL, profile.frame_size(0LL));
+        }
+
+        TEST_METHOD(GroupOfPictures)
+        {
+            // P == 10 * 1000 / (10 - 1 + 8) == 588, the I frame takes the rest of the 10000 bytes
+            const ctsMediaStreamFrameProfile profile(ctsMediaStreamFrameProfile::GroupOfPictures(1000UL, 10UL, 8UL));
+            Assert::AreEqual(10UL, profile.cycle_length());
+            Assert::AreEqual(4708UL, profile.frame_size(1LL));
+            for (long long sequence_number = 2; sequence_number <= 10; ++sequence_number) {
+                Assert::AreEqual(588UL, profile.frame_size(sequence_number));
+            }
+            // the next GOP starts with an I frame
+            Assert::AreEqual(4708UL, profile.frame_size(11LL));
+            Assert::AreEqual(588UL, profile.frame_size(12LL));
+            Assert::AreEqual(4708UL, profile.maximum_frame_size());
+
+            // each whole GOP averages the frame size
+            Assert::AreEqual(10000ULL, profile.total_bytes(10UL));
+            Assert::AreEqual(20000ULL, profile.total_bytes(20UL));
+            // a partial GOP is the sum of its frames
+            Assert::AreEqual(20000ULL + 4708ULL + 4ULL * 588ULL, profile.total_bytes(25UL));
+        }
+
+        TEST_METHOD(TraceIsScaledToTheAverage)
+        {
+            const std::vector<unsigned long> trace{ 3UL, 1UL, 1UL, 1UL };
+            const ctsMediaStreamFrameProfile profile(ctsMediaStreamFrameProfile::FromTrace(trace, 100UL));
+            Assert::AreEqual(4UL, profile.cycle_length());
+            Assert::AreEqual(200UL, profile.frame_size(1LL));
+            Assert::AreEqual(200UL, profile.maximum_frame_size());
+            // the frames keep their proportions and sum exactly to the cycle
+            Assert::AreEqual(400ULL, profile.total_bytes(4UL));
+            Assert::AreEqual(800ULL, profile.total_bytes(8UL));
+            for (long long sequence_number = 2; sequence_number <= 4; ++sequence_number) {
+                Assert::IsTrue(profile.frame_size(sequence_number) >= 66UL && profile.frame_size(sequence_number) <= 67UL);
+            }
+        }
+
+        TEST_METHOD(FramesMustHoldTheHeaders)
+        {
+            Assert::ExpectException<std::invalid_argument>([]() { ctsMediaStreamFrameProfile::Constant(39UL); });
+            // the P frames would be smaller than the minimum
+            Assert::ExpectException<std::invalid_argument>([]() { ctsMediaStreamFrameProfile::GroupOfPictures(100UL, 30UL, 100UL); });
+            Assert::ExpectException<std::invalid_argument>([]() { ctsMediaStreamFrameProfile::GroupOfPictures(1000UL, 0UL, 8UL); });
+            Assert::ExpectException<std::invalid_argument>([]() { ctsMediaStreamFrameProfile::FromTrace(std::vector<unsigned long>{ 100UL, 1UL }, 100UL); });
+            Assert::ExpectException<std::invalid_argument>([]() { ctsMediaStreamFrameProfile::FromTrace(std::vector<unsigned long>(), 100UL); });
+        }
+    };
+}
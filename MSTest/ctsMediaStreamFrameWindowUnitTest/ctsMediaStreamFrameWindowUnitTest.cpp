@@ -0,0 +1,110 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsMediaStreamFrameWindow.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsMediaStreamFrameWindowUnitTest)
+    {
+    public:
+        TEST_METHOD(WindowSizeIsAPowerOfTwo)
+        {
+            Assert::AreEqual(1UL, ctsMediaStreamFrameWindow::WindowSize(0UL));
+            Assert::AreEqual(1UL, ctsMediaStreamFrameWindow::WindowSize(1UL));
+            Assert::AreEqual(2UL, ctsMediaStreamFrameWindow::WindowSize(2UL));
+            Assert::AreEqual(4UL, ctsMediaStreamFrameWindow::WindowSize(3UL));
+            Assert::AreEqual(64UL, ctsMediaStreamFrameWindow::WindowSize(60UL));
+            Assert::AreEqual(1024UL, ctsMediaStreamFrameWindow::WindowSize(1024UL));
+
+            ctsMediaStreamFrameWindow frame_window;
+            frame_window.resize(6UL);
+            Assert::AreEqual(8UL, frame_window.size());
+            Assert::AreEqual(1LL, frame_window.head_sequence());
+            Assert::AreEqual(8LL, frame_window.tail_sequence());
+        }
+
+        TEST_METHOD(ContainsOnlyTheWindow)
+        {
+            ctsMediaStreamFrameWindow frame_window;
+            frame_window.resize(4UL);
+            Assert::IsFalse(frame_window.contains(0LL));
+            Assert::IsTrue(frame_window.contains(1LL));
+            Assert::IsTrue(frame_window.contains(4LL));
+            Assert::IsFalse(frame_window.contains(5LL));
+
+            frame_window.advance();
+            Assert::IsFalse(frame_window.contains(1LL));
+            Assert::IsTrue(frame_window.contains(5LL));
+            Assert::IsFalse(frame_window.contains(6LL));
+        }
+
+        TEST_METHOD(SlotsAreReusedAfterAdvancing)
+        {
+            ctsMediaStreamFrameWindow frame_window;
+            frame_window.resize(4UL);
+            for (long long sequence_number = 1; sequence_number <= 4; ++sequence_number) {
+                frame_window.received(sequence_number) = static_cast<unsigned long>(sequence_number * 100);
+                frame_window.timestamps(sequence_number).sender_qpc = sequence_number;
+            }
+
+            frame_window.advance();
+            frame_window.advance();
+            Assert::AreEqual(3LL, frame_window.head_sequence());
+            Assert::AreEqual(6LL, frame_window.tail_sequence());
+            // frames still in the window keep their details
+            Assert::AreEqual(300UL, frame_window.received(3LL));
+            Assert::AreEqual(4LL, frame_window.timestamps(4LL).sender_qpc);
+            // the slots of the rendered frames now track the new tail, cleared
+            Assert::AreEqual(0UL, frame_window.received(5LL));
+            Assert::AreEqual(0UL, frame_window.received(6LL));
+            Assert::AreEqual(0LL, frame_window.timestamps(6LL).sender_qpc);
+
+            // wrap around the window many times
+            for (long long sequence_number = 3; sequence_number < 1003; ++sequence_number) {
+                frame_window.received(frame_window.tail_sequence()) = 1UL;
+                Assert::AreEqual(sequence_number, frame_window.head_sequence());
+                frame_window.advance();
+            }
+            Assert::AreEqual(1003LL, frame_window.head_sequence());
+            Assert::AreEqual(1UL, frame_window.received(1005LL));
+            Assert::AreEqual(0UL, frame_window.received(1006LL));
+        }
+
+        TEST_METHOD(ReceivedAfterHead)
+        {
+            ctsMediaStreamFrameWindow frame_window;
+            frame_window.resize(4UL);
+            Assert::IsFalse(frame_window.received_after_head());
+
+            frame_window.received(1LL) = 10UL;
+            Assert::IsFalse(frame_window.received_after_head());
+
+            frame_window.received(4LL) = 10UL;
+            Assert::IsTrue(frame_window.received_after_head());
+
+            frame_window.advance();
+            frame_window.advance();
+            frame_window.advance();
+            // 4 is now the head
+            Assert::IsFalse(frame_window.received_after_head());
+        }
+    };
+}
@@ -0,0 +1,111 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsMediaStreamOneWayDelay.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsMediaStreamOneWayDelayUnitTest)
+    {
+    public:
+        TEST_METHOD(SymmetricProbeGivesTheOffset)
+        {
+            ctsMediaStreamClockEstimator estimator;
+            Assert::IsFalse(estimator.synchronized());
+
+            // the server clock is 5000 us ahead: 2000 us each way, held 10 us at the server
+            Assert::IsTrue(estimator.add_probe(1000LL, 8000LL, 8010LL, 5010LL));
+            Assert::IsTrue(estimator.synchronized());
+            Assert::AreEqual(5000LL, estimator.offset_at(5010LL));
+            Assert::AreEqual(4000LL, estimator.round_trip_microseconds());
+            Assert::AreEqual(0.0, estimator.skew());
+        }
+
+        TEST_METHOD(OnlyTheFastestProbeIsTrusted)
+        {
+            ctsMediaStreamClockEstimator estimator;
+            Assert::IsTrue(estimator.add_probe(1000LL, 8000LL, 8010LL, 5010LL));
+            // queued 3000 us on the way to the server: the offset would be off by 1500 us
+            Assert::IsFalse(estimator.add_probe(100000LL, 110000LL, 110010LL, 107010LL));
+            Assert::AreEqual(5000LL, estimator.offset_at(107010LL));
+            Assert::AreEqual(2LL, estimator.probes());
+
+            // a reply held longer than its round trip is rejected outright
+            Assert::IsFalse(estimator.add_probe(200000LL, 205000LL, 210000LL, 201000LL));
+            Assert::AreEqual(2LL, estimator.probes());
+
+            // the fastest probe ages out once ProbeFilterSize more probes are added
+            for (unsigned long probe = 0; probe < ctsMediaStreamClockEstimator::ProbeFilterSize - 2; ++probe) {
+                const long long originate = 300000LL + probe * 100000LL;
+                Assert::IsFalse(estimator.add_probe(originate, originate + 10000LL, originate + 10010LL, originate + 7010LL));
+            }
+            Assert::IsTrue(estimator.add_probe(1000000LL, 1010000LL, 1010010LL, 1007010LL));
+            Assert::AreEqual(6500LL, estimator.offset_at(1007010LL));
+        }
+
+        TEST_METHOD(SkewIsTrackedAcrossProbes)
+        {
+            ctsMediaStreamClockEstimator estimator;
+            // the server clock starts 5000 us ahead and gains 100 us every second
+            for (long long originate = 0LL; originate < 10000000LL; originate += 100000LL) {
+                const long long offset = 5000LL + originate / 10000LL;
+                const long long receive = originate + 2000LL + offset;
+                const long long transmit = receive + 10LL;
+                estimator.add_probe(originate, receive, transmit, transmit - offset + 2000LL);
+            }
+            Assert::AreEqual(100LL, static_cast<long long>(estimator.skew() * 1000000.0 + 0.5));
+            // extrapolated 10 seconds past the last probe
+            const long long offset = estimator.offset_at(20000000LL);
+            Assert::IsTrue(offset >= 6990LL && offset <= 7010LL);
+        }
+
+        TEST_METHOD(DelayBuckets)
+        {
+            // small values are exact
+            Assert::AreEqual(0UL, ctsMediaStreamDelayDistribution::BucketIndex(-5LL));
+            Assert::AreEqual(15UL, ctsMediaStreamDelayDistribution::BucketIndex(15LL));
+            Assert::AreEqual(15LL, ctsMediaStreamDelayDistribution::BucketValue(15UL));
+            // larger values are within 1/SubBuckets of the bucket value
+            for (long long value = 16LL; value < 10000000LL; value = value * 3 + 1) {
+                const long long bucket_value = ctsMediaStreamDelayDistribution::BucketValue(ctsMediaStreamDelayDistribution::BucketIndex(value));
+                const long long difference = (bucket_value > value) ? bucket_value - value : value - bucket_value;
+                Assert::IsTrue(difference * static_cast<long long>(ctsMediaStreamDelayDistribution::SubBuckets) <= value);
+            }
+            // values past the last bucket are counted in it
+            Assert::AreEqual(ctsMediaStreamDelayDistribution::BucketCount - 1, ctsMediaStreamDelayDistribution::BucketIndex(MAXLONGLONG));
+        }
+
+        TEST_METHOD(DelayPercentiles)
+        {
+            ctsMediaStreamDelayDistribution distribution;
+            Assert::AreEqual(0LL, distribution.percentile(50));
+
+            for (long long value = 1LL; value <= 100LL; ++value) {
+                distribution.add_value(value * 100LL);
+            }
+            Assert::AreEqual(100LL, distribution.count());
+            const long long p50 = distribution.percentile(50);
+            const long long p99 = distribution.percentile(99);
+            Assert::IsTrue(p50 >= 5000LL * 7 / 8 && p50 <= 5000LL * 9 / 8);
+            Assert::IsTrue(p99 >= 9900LL * 7 / 8 && p99 <= 9900LL * 9 / 8);
+            Assert::AreEqual(100LL, distribution.percentile(0));
+        }
+    };
+}
@@ -0,0 +1,230 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <vector>
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsMediaStreamParity.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsMediaStreamParityUnitTest)
+    {
+    private:
+        static const unsigned long PayloadLength = 37;
+
+        static std::vector<char> MakePayload(long long _sequence_number)
+        {
+            std::vector<char> payload(PayloadLength);
+            for (unsigned long index = 0; index < PayloadLength; ++index) {
+                payload[index] = static_cast<char>(_sequence_number * 31 + index * 7);
+            }
+            return payload;
+        }
+
+        static void AssertPayload(long long _sequence_number, const char* _payload)
+        {
+            const std::vector<char> expected(MakePayload(_sequence_number));
+            for (unsigned long index = 0; index < PayloadLength; ++index) {
+                Assert::AreEqual(expected[index], _payload[index]);
+            }
+        }
+
+    public:
+        TEST_METHOD(XorBufferAllLengths)
+        {
+            // covers the unrolled, word and byte loops
+            for (size_t length = 0; length < 80; ++length) {
+                std::vector<char> target(length + 1, 0x5a);
+                std::vector<char> source(length + 1);
+                for (size_t index = 0; index < source.size(); ++index) {
+                    source[index] = static_cast<char>(index * 13 + 1);
+                }
+
+                ctsMediaStreamParity::XorBuffer(target.data(), source.data(), length);
+                for (size_t index = 0; index < length; ++index) {
+                    Assert::AreEqual(static_cast<char>(0x5a ^ source[index]), target[index]);
+                }
+                // must not write past the length
+                Assert::AreEqual(static_cast<char>(0x5a), target[length]);
+
+                ctsMediaStreamParity::XorBuffer(target.data(), source.data(), length);
+                for (size_t index = 0; index < length; ++index) {
+                    Assert::AreEqual(static_cast<char>(0x5a), target[index]);
+                }
+            }
+        }
+
+        TEST_METHOD(GroupLayout)
+        {
+            ctsMediaStreamParity parity(4, 2, PayloadLength);
+            Assert::IsTrue(parity.is_enabled());
+            Assert::IsFalse(ctsMediaStreamParity().is_enabled());
+
+            Assert::AreEqual(1LL, parity.group_first_sequence(1));
+            Assert::AreEqual(1LL, parity.group_first_sequence(4));
+            Assert::AreEqual(5LL, parity.group_first_sequence(5));
+
+            Assert::AreEqual(0UL, parity.parity_index(1));
+            Assert::AreEqual(1UL, parity.parity_index(2));
+            Assert::AreEqual(0UL, parity.parity_index(3));
+            Assert::AreEqual(1UL, parity.parity_index(8));
+            Assert::AreEqual(1LL, parity.parity_sequence(3));
+            Assert::AreEqual(6LL, parity.parity_sequence(8));
+
+            Assert::AreEqual(2UL, parity.covered_frames(1, 100));
+            // the final group of 5 and 6 - then only frame 5
+            Assert::AreEqual(1UL, parity.covered_frames(5, 6));
+            Assert::AreEqual(1UL, parity.covered_frames(6, 6));
+            Assert::AreEqual(0UL, parity.covered_frames(6, 5));
+
+            Assert::IsTrue(parity.is_group_end(4, 100));
+            Assert::IsFalse(parity.is_group_end(5, 100));
+            Assert::IsTrue(parity.is_group_end(6, 6));
+        }
+
+        TEST_METHOD(RecoversBurstOfParityFrames)
+        {
+            const ctsMediaStreamParity parity(4, 2, PayloadLength);
+            ctsMediaStreamParityEncoder encoder;
+            encoder.initialize(parity);
+            ctsMediaStreamParityDecoder decoder(parity, 8, 100);
+
+            for (long long sequence_number = 1; sequence_number <= 4; ++sequence_number) {
+                const std::vector<char> payload(MakePayload(sequence_number));
+                encoder.add_frame(sequence_number, payload.data(), PayloadLength);
+                // frames 2 and 3 are lost
+                if (sequence_number != 2 && sequence_number != 3) {
+                    Assert::IsTrue(decoder.add_frame(sequence_number, payload.data(), PayloadLength));
+                }
+            }
+            Assert::IsFalse(decoder.can_recover(2));
+            Assert::IsFalse(decoder.can_recover(3));
+
+            Assert::IsTrue(decoder.add_parity(1, encoder.parity_payload(0), PayloadLength, 10LL, 1000LL));
+            Assert::IsTrue(decoder.add_parity(2, encoder.parity_payload(1), PayloadLength, 20LL, 1000LL));
+            // the same parity datagram twice is ignored
+            Assert::IsFalse(decoder.add_parity(2, encoder.parity_payload(1), PayloadLength, 20LL, 1000LL));
+
+            long long sender_qpc;
+            long long sender_qpf;
+            Assert::IsTrue(decoder.can_recover(3));
+            AssertPayload(3, decoder.recovered_payload(3, &sender_qpc, &sender_qpf));
+            Assert::AreEqual(10LL, sender_qpc);
+            Assert::AreEqual(1000LL, sender_qpf);
+            Assert::IsFalse(decoder.can_recover(3));
+
+            Assert::IsTrue(decoder.can_recover(2));
+            AssertPayload(2, decoder.recovered_payload(2, &sender_qpc, &sender_qpf));
+            Assert::AreEqual(20LL, sender_qpc);
+
+            // the encoder starts the next group from zero
+            encoder.clear();
+            const std::vector<char> payload(MakePayload(5));
+            encoder.add_frame(5, payload.data(), PayloadLength);
+            AssertPayload(5, encoder.parity_payload(0));
+        }
+
+        TEST_METHOD(TwoLossesCoveredByOneParityAreUnrecoverable)
+        {
+            const ctsMediaStreamParity parity(4, 1, PayloadLength);
+            ctsMediaStreamParityEncoder encoder;
+            encoder.initialize(parity);
+            ctsMediaStreamParityDecoder decoder(parity, 8, 100);
+
+            for (long long sequence_number = 1; sequence_number <= 4; ++sequence_number) {
+                const std::vector<char> payload(MakePayload(sequence_number));
+                encoder.add_frame(sequence_number, payload.data(), PayloadLength);
+                if (sequence_number % 2 == 0) {
+                    decoder.add_frame(sequence_number, payload.data(), PayloadLength);
+                }
+            }
+            decoder.add_parity(1, encoder.parity_payload(0), PayloadLength, 10LL, 1000LL);
+            Assert::IsFalse(decoder.can_recover(1));
+            Assert::IsFalse(decoder.can_recover(3));
+        }
+
+        TEST_METHOD(ShortFinalGroup)
+        {
+            const ctsMediaStreamParity parity(4, 2, PayloadLength);
+            ctsMediaStreamParityEncoder encoder;
+            encoder.initialize(parity);
+            // the stream ends at frame 5: its group only has the one frame
+            ctsMediaStreamParityDecoder decoder(parity, 8, 5);
+
+            const std::vector<char> payload(MakePayload(5));
+            encoder.add_frame(5, payload.data(), PayloadLength);
+            Assert::IsTrue(parity.is_group_end(5, 5));
+
+            decoder.add_parity(5, encoder.parity_payload(0), PayloadLength, 10LL, 1000LL);
+            long long sender_qpc;
+            long long sender_qpf;
+            Assert::IsTrue(decoder.can_recover(5));
+            AssertPayload(5, decoder.recovered_payload(5, &sender_qpc, &sender_qpf));
+        }
+
+        TEST_METHOD(VariableLengthFrames)
+        {
+            const ctsMediaStreamParity parity(2, 1, PayloadLength);
+            ctsMediaStreamParityEncoder encoder;
+            encoder.initialize(parity);
+            ctsMediaStreamParityDecoder decoder(parity, 4, 100);
+
+            // the parity is only as long as the longest frame added
+            const std::vector<char> first_payload(MakePayload(1));
+            const std::vector<char> second_payload(MakePayload(2));
+            encoder.add_frame(1, first_payload.data(), 11);
+            Assert::AreEqual(11UL, encoder.parity_payload_length(0));
+            encoder.add_frame(2, second_payload.data(), 23);
+            Assert::AreEqual(23UL, encoder.parity_payload_length(0));
+
+            // the shorter frame is lost: rebuilt from the longer frame and the parity
+            Assert::IsTrue(decoder.add_frame(2, second_payload.data(), 23));
+            Assert::IsTrue(decoder.add_parity(1, encoder.parity_payload(0), encoder.parity_payload_length(0), 10LL, 1000LL));
+            long long sender_qpc;
+            long long sender_qpf;
+            Assert::IsTrue(decoder.can_recover(1));
+            const char* recovered = decoder.recovered_payload(1, &sender_qpc, &sender_qpf);
+            for (unsigned long index = 0; index < 11; ++index) {
+                Assert::AreEqual(first_payload[index], recovered[index]);
+            }
+            // past the end of the lost frame the payload is zero
+            for (unsigned long index = 11; index < 23; ++index) {
+                Assert::AreEqual('\0', recovered[index]);
+            }
+
+            encoder.clear();
+            Assert::AreEqual(0UL, encoder.parity_payload_length(0));
+        }
+
+        TEST_METHOD(OlderGroupsAreIgnored)
+        {
+            const ctsMediaStreamParity parity(2, 1, PayloadLength);
+            // 4 queued frames == 4 tracked groups
+            ctsMediaStreamParityDecoder decoder(parity, 4, 100);
+
+            const std::vector<char> payload(MakePayload(1));
+            Assert::IsTrue(decoder.add_frame(1, payload.data(), PayloadLength));
+            // group 5 (frames 9 and 10) reuses the slot of group 1
+            Assert::IsTrue(decoder.add_frame(9, payload.data(), PayloadLength));
+            Assert::IsFalse(decoder.add_frame(2, payload.data(), PayloadLength));
+            Assert::IsFalse(decoder.add_parity(1, payload.data(), PayloadLength, 10LL, 1000LL));
+        }
+    };
+}
@@ -35,6 +35,10 @@ template <> static std::wstring __cdecl Microsoft::VisualStudio::CppUnitTestFram
     switch (_message) {
         case ctsTraffic::MediaStreamAction::START:
             return L"START";
+        case ctsTraffic::MediaStreamAction::TIME_PROBE:
+            return L"TIME_PROBE";
+        case ctsTraffic::MediaStreamAction::START_COMPACT:
+            return L"START_COMPACT";
     }
     return ctl::ctString::format_string(L"Unknown Message (0x%x)", _message);
 }
@@ -169,6 +173,124 @@ namespace ctsUnitTest
             Assert::AreEqual(MediaStreamAction::START, round_trip.action);
         }
 
+        TEST_METHOD(TimeProbeRoundTrip)
+        {
+            char probe[UdpDatagramTimeProbeLength];
+            ctsMediaStreamMessage::MakeTimeProbe(probe, 1000LL);
+            ctsMediaStreamMessage probe_message(ctsMediaStreamMessage::Extract(probe, UdpDatagramTimeProbeLength));
+            Assert::AreEqual(MediaStreamAction::TIME_PROBE, probe_message.action);
+            Assert::AreEqual(1000LL, probe_message.originate_time);
+
+            char reply[UdpDatagramTimeReplyLength];
+            ctsMediaStreamMessage::MakeTimeReply(reply, probe_message.originate_time, 2000LL, 2010LL);
+            ctsIOTask reply_task;
+            reply_task.buffer = reply;
+            reply_task.buffer_length = UdpDatagramTimeReplyLength;
+            Assert::AreEqual(UdpDatagramProtocolHeaderFlagTimeProbe, ctsMediaStreamMessage::GetProtocolHeaderFromTask(reply_task));
+
+            long long originate_time;
+            long long receive_time;
+            long long transmit_time;
+            ctsMediaStreamMessage::GetTimeReplyFromTask(reply_task, &originate_time, &receive_time, &transmit_time);
+            Assert::AreEqual(1000LL, originate_time);
+            Assert::AreEqual(2000LL, receive_time);
+            Assert::AreEqual(2010LL, transmit_time);
+        }
+
+        TEST_METHOD(ParityProtocolHeader)
+        {
+            const unsigned long buffer_size = UdpDatagramDataHeaderLength + 100;
+            ctsMediaStreamSendRequests testbuffer(buffer_size, SequenceNumber, BufferPtr, UdpDatagramProtocolHeaderFlagParity);
+            for (auto& buffer_array : testbuffer) {
+                Assert::AreEqual(UdpDatagramProtocolHeaderFlagLength, buffer_array[0].len);
+                Assert::AreEqual(UdpDatagramProtocolHeaderFlagParity, *reinterpret_cast<unsigned short*>(buffer_array[0].buf));
+            }
+            Assert::AreEqual(1UL, verify_byte_count(testbuffer, buffer_size));
+        }
+
+        TEST_METHOD(ConstructStartCompact)
+        {
+            Assert::AreEqual(UdpDatagramStartCompactStringLength, static_cast<unsigned long>(::strlen(UdpDatagramStartCompactString)));
+
+            ctsIOTask test_task(ctsMediaStreamMessage::Construct(MediaStreamAction::START_COMPACT));
+            ctsMediaStreamMessage round_trip(ctsMediaStreamMessage::Extract(test_task.buffer, test_task.buffer_length));
+            Assert::AreEqual(MediaStreamAction::START_COMPACT, round_trip.action);
+        }
+
+        TEST_METHOD(VarintRoundTrip)
+        {
+            const unsigned long long values[] = { 0ULL, 1ULL, 0x7fULL, 0x80ULL, 0x3fffULL, 0x4000ULL, 0xffffffffULL, 0xffffffffffffffffULL };
+            const unsigned long lengths[] = { 1UL, 1UL, 1UL, 2UL, 2UL, 3UL, 5UL, UdpDatagramVarintMaximumLength };
+            for (size_t index = 0; index < _countof(values); ++index) {
+                char buffer[UdpDatagramVarintMaximumLength];
+                Assert::AreEqual(lengths[index], ctsMediaStreamVarint::Length(values[index]));
+                Assert::AreEqual(lengths[index], ctsMediaStreamVarint::Write(buffer, values[index]));
+
+                unsigned long long read_value;
+                Assert::AreEqual(lengths[index], ctsMediaStreamVarint::Read(buffer, lengths[index], &read_value));
+                Assert::AreEqual(values[index], read_value);
+                // a value cut short can't be read
+                Assert::AreEqual(0UL, ctsMediaStreamVarint::Read(buffer, lengths[index] - 1, &read_value));
+            }
+        }
+
+        TEST_METHOD(CompactSendRequest)
+        {
+            // the 200th frame: a 2-byte varint
+            const long long sequence_number = 200LL;
+            const unsigned long header_length = UdpDatagramProtocolHeaderFlagLength + 2 + UdpDatagramCompactTimestampLength;
+            Assert::AreEqual(header_length, ctsMediaStreamSendRequests::HeaderLength(sequence_number, true));
+            Assert::AreEqual(UdpDatagramDataHeaderLength, ctsMediaStreamSendRequests::HeaderLength(sequence_number, false));
+
+            char payload[100];
+            const unsigned long buffer_size = header_length + 100;
+            ctsMediaStreamSendRequests testbuffer(buffer_size, sequence_number, payload, UdpDatagramProtocolHeaderFlagParity, true);
+            unsigned long datagram_count = 0;
+            for (auto send_request = testbuffer.begin(); send_request != testbuffer.end(); ++send_request) {
+                auto& send_buffers = *send_request;
+                // a single contiguous header, then the payload
+                Assert::AreEqual(2UL, static_cast<unsigned long>(send_request.buffer_count()));
+                Assert::AreEqual(header_length, send_buffers[0].len);
+                Assert::AreEqual(100UL, send_buffers[1].len);
+                Assert::IsTrue(payload == send_buffers[1].buf);
+
+                // parse the header as the client would
+                char datagram[header_length + 100];
+                ::memcpy(datagram, send_buffers[0].buf, header_length);
+                ctsIOTask received_task;
+                received_task.buffer = datagram;
+                received_task.buffer_length = header_length + 100;
+                Assert::IsTrue(ctsMediaStreamMessage::IsCompactHeaderFromTask(received_task));
+                Assert::AreEqual(
+                    static_cast<unsigned short>(UdpDatagramProtocolHeaderFlagParity | UdpDatagramProtocolHeaderFlagCompact),
+                    ctsMediaStreamMessage::GetProtocolHeaderFromTask(received_task));
+                Assert::AreEqual(header_length, ctsMediaStreamMessage::GetDataHeaderLengthFromTask(received_task, header_length + 100));
+                Assert::AreEqual(0UL, ctsMediaStreamMessage::GetDataHeaderLengthFromTask(received_task, header_length - 1));
+                Assert::AreEqual(sequence_number, ctsMediaStreamMessage::GetSequenceNumberFromTask(received_task));
+                ++datagram_count;
+            }
+            Assert::AreEqual(1UL, datagram_count);
+        }
+
+        TEST_METHOD(CompactSendRequestSplitsLargeFrames)
+        {
+            static const unsigned long buffer_size = UdpDatagramMaximumSizeBytes + 1;
+
+            ctsMediaStreamSendRequests testbuffer(buffer_size, SequenceNumber, BufferPtr, UdpDatagramProtocolHeaderFlagData, true);
+            Assert::AreEqual(2UL, verify_byte_count(testbuffer, buffer_size));
+        }
+
+        TEST_METHOD(ExtendCompactTimestamp)
+        {
+            const long long reference = 0x500000000LL + 1000LL;
+            // within +/- 2^31 microseconds of the reference
+            Assert::AreEqual(reference + 10LL, ctsMediaStreamMessage::ExtendCompactTimestamp(1010UL, reference));
+            Assert::AreEqual(reference - 10LL, ctsMediaStreamMessage::ExtendCompactTimestamp(990UL, reference));
+            // across the 32-bit wrap in both directions
+            Assert::AreEqual(0x500000000LL - 16LL, ctsMediaStreamMessage::ExtendCompactTimestamp(0xfffffff0UL, reference));
+            Assert::AreEqual(0x600000000LL + 16LL, ctsMediaStreamMessage::ExtendCompactTimestamp(16UL, 0x600000000LL - 16LL));
+        }
+
     private:
         void verify_protocol_header(ctsMediaStreamSendRequests& _testbuffer)
         {
@@ -20,6 +20,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 #include <ctString.hpp>
 #include <ctSockaddr.hpp>
+#include <ctTimer.hpp>
 #include <ctVersionConversion.hpp>
 
 #include "ctsSafeInt.hpp"
@@ -193,6 +194,16 @@ namespace ctsTraffic {
             Logger::WriteMessage(L"ctsMediaStreamServerUnitTestIOPattern::end_stats\n");
             Assert::IsFalse(true);
         }
+        virtual void sample_stats() NOEXCEPT
+        {
+            Logger::WriteMessage(L"ctsMediaStreamServerUnitTestIOPattern::sample_stats\n");
+            Assert::IsFalse(true);
+        }
+        virtual void record_tcp_info(const ctsTcpInfoSample&) NOEXCEPT
+        {
+            Logger::WriteMessage(L"ctsMediaStreamServerUnitTestIOPattern::record_tcp_info\n");
+            Assert::IsFalse(true);
+        }
         virtual char* connection_id() NOEXCEPT
         {
             Logger::WriteMessage(L"ctsMediaStreamServerUnitTestIOPattern::connection_id\n");
@@ -419,6 +430,116 @@ namespace ctsUnitTest {
             Assert::AreEqual(10UL, callback_invoked);
         }
 
+        TEST_METHOD(MultipleScheduledIOWithScheduler)
+        {
+            s_IOCount = 10;
+            s_IOStatus = ctsIOStatus::ContinueIo;
+            s_IOStatusCode = ERROR_SUCCESS;
+            s_TaskAction = IOTaskAction::None;
+            s_IOTimeOffset = 100; // 100ms apart
+            ::ResetEvent(s_RemovedSocketEvent);
+
+            std::vector<ctl::ctSockaddr> test_addr(ctl::ctSockaddr::ResolveName(L"1.1.1.1"));
+            Assert::AreEqual(static_cast<size_t>(1), test_addr.size());
+
+            std::shared_ptr<ctsSocketState> socket_state(std::make_shared<ctsSocketState>(std::weak_ptr<ctsSocketBroker>()));
+            std::shared_ptr<ctsSocket> test_socket(std::make_shared<ctsSocket>(socket_state));
+            test_socket->set_socket(INVALID_SOCKET);
+
+            const long long initial_scheduled_count = ctsConfig::Settings->FrameSchedulingLatenessHistogram.count();
+            ctsMediaStreamServerScheduler test_scheduler;
+
+            unsigned long callback_invoked = 0;
+            // the scheduler requires connected sockets be owned by a shared_ptr
+            auto test_connected_socket(std::make_shared<ctsMediaStreamServerConnectedSocket>(
+                std::weak_ptr<ctsSocket>(test_socket),
+                INVALID_SOCKET,
+                test_addr[0],
+                [&] (ctsMediaStreamServerConnectedSocket* _socket_object) -> wsIOResult {
+                ++callback_invoked;
+
+                Assert::AreEqual(test_addr[0], _socket_object->get_address());
+
+                if (callback_invoked == 10) {
+                    s_IOStatus = ctsIOStatus::CompletedIo;
+                }
+                s_IOStatusCode = WSAENOBUFS;
+                return wsIOResult(WSAENOBUFS);
+            },
+                &test_scheduler));
+
+            ctsIOTask test_task;
+            test_task.ioAction = IOTaskAction::Send;
+            // directly scheduling the first task
+            s_IOPended = 1;
+            test_connected_socket->schedule_task(test_task);
+            // should complete within 1 second (a few ms after 900ms)
+            Assert::AreEqual(WAIT_OBJECT_0, ::WaitForSingleObject(s_RemovedSocketEvent, 1000));
+            Assert::AreEqual(10UL, callback_invoked);
+            // the first send was immediate: the other 9 went through the scheduler
+            Assert::AreEqual(initial_scheduled_count + 9LL, ctsConfig::Settings->FrameSchedulingLatenessHistogram.count());
+        }
+
+        TEST_METHOD(PacedDatagramsWithPreciseScheduler)
+        {
+            s_IOCount = 1;
+            s_IOStatus = ctsIOStatus::ContinueIo;
+            s_IOStatusCode = ERROR_SUCCESS;
+            s_TaskAction = IOTaskAction::None;
+            s_IOTimeOffset = 0;
+            ::ResetEvent(s_RemovedSocketEvent);
+
+            std::vector<ctl::ctSockaddr> test_addr(ctl::ctSockaddr::ResolveName(L"1.1.1.1"));
+            Assert::AreEqual(static_cast<size_t>(1), test_addr.size());
+
+            std::shared_ptr<ctsSocketState> socket_state(std::make_shared<ctsSocketState>(std::weak_ptr<ctsSocketBroker>()));
+            std::shared_ptr<ctsSocket> test_socket(std::make_shared<ctsSocket>(socket_state));
+            test_socket->set_socket(INVALID_SOCKET);
+
+            const long long initial_gap_count = ctsConfig::Settings->DatagramGapHistogram.count();
+            const long long initial_gap_sum = ctsConfig::Settings->DatagramGapHistogram.sum();
+            ctsMediaStreamServerScheduler test_scheduler(true);
+
+            unsigned long callback_invoked = 0;
+            long long first_send_time = 0LL;
+            long long second_send_time = 0LL;
+            auto test_connected_socket(std::make_shared<ctsMediaStreamServerConnectedSocket>(
+                std::weak_ptr<ctsSocket>(test_socket),
+                INVALID_SOCKET,
+                test_addr[0],
+                [&] (ctsMediaStreamServerConnectedSocket* _socket_object) -> wsIOResult {
+                ++callback_invoked;
+                Assert::IsTrue(_socket_object->paces_datagrams());
+
+                const long long send_time = ctl::ctTimer::snap_qpc_as_usec();
+                _socket_object->record_datagram_sent(send_time);
+                if (1 == callback_invoked) {
+                    // the rest of the frame is due in 500 us: less than a timer tick
+                    first_send_time = send_time;
+                    _socket_object->schedule_datagram(send_time + 500LL);
+                    return wsIOResult(WSA_IO_PENDING);
+                }
+
+                second_send_time = send_time;
+                s_IOStatus = ctsIOStatus::CompletedIo;
+                return wsIOResult();
+            },
+                &test_scheduler));
+
+            ctsIOTask test_task;
+            test_task.ioAction = IOTaskAction::Send;
+            s_IOPended = 1;
+            test_connected_socket->schedule_task(test_task);
+            Assert::AreEqual(WAIT_OBJECT_0, ::WaitForSingleObject(s_RemovedSocketEvent, 1000));
+            // the pended send was only completed once, after the last datagram
+            Assert::AreEqual(2UL, callback_invoked);
+            Assert::AreEqual(0UL, s_IOCount.load());
+            Assert::IsTrue(second_send_time - first_send_time >= 500LL);
+
+            Assert::AreEqual(initial_gap_count + 1LL, ctsConfig::Settings->DatagramGapHistogram.count());
+            Assert::IsTrue(ctsConfig::Settings->DatagramGapHistogram.sum() - initial_gap_sum >= 500LL);
+        }
+
         TEST_METHOD(FailSingleIO)
         {
             // should fail the first one
@@ -0,0 +1,461 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include <ctSockaddr.hpp>
+#include <ctHandle.hpp>
+#include <ctScopeGuard.hpp>
+#include <ctVersionConversion.hpp>
+
+#include "ctsSafeInt.hpp"
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsSocketState.h"
+#include "ctsSockaddrHashTable.hpp"
+
+#include "ctsMediaStreamServer.h"
+#include "ctsMediaStreamServerConnectedSocket.h"
+#include "ctsMediaStreamServerListeningSocket.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace Microsoft {
+    namespace VisualStudio {
+        namespace CppUnitTestFramework {
+            template<> static std::wstring ToString<ctl::ctSockaddr>(const ctl::ctSockaddr& _value)
+            {
+                return _value.writeCompleteAddress();
+            }
+        }
+    }
+}
+
+ctsTraffic::ctsConfig::MediaStreamSettings s_MediaStreamSettings;
+// the one UDP socket the fake CreateSocket created for the server to 'listen' on
+SOCKET s_ListeningSocket = INVALID_SOCKET;
+// the number of ctsSocket objects completed back to their ctsSocketState
+std::atomic<unsigned long> s_CompletedSockets = 0;
+///
+/// Fakes
+///
+namespace ctsTraffic {
+    namespace ctsConfig {
+        ctsConfigSettings* Settings;
+
+        void PrintConnectionResults(const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _remote_addr, unsigned long _error) NOEXCEPT
+        {
+        }
+        void PrintConnectionResults(const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _remote_addr, unsigned long _error, const ctsTcpStatistics& _stats) NOEXCEPT
+        {
+        }
+        void PrintConnectionResults(const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _remote_addr, unsigned long _error, const ctsUdpStatistics& _stats) NOEXCEPT
+        {
+        }
+        void PrintNewConnection(const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _remote_addr) NOEXCEPT
+        {
+        }
+        void PrintDebug(_In_z_ _Printf_format_string_ LPCWSTR _text, ...) NOEXCEPT
+        {
+        }
+        void PrintException(const std::exception& e) NOEXCEPT
+        {
+        }
+        void PrintErrorInfo(_In_z_ _Printf_format_string_ LPCWSTR _text, ...) NOEXCEPT
+        {
+        }
+
+        bool IsListening() NOEXCEPT
+        {
+            return true;
+        }
+
+        const MediaStreamSettings& GetMediaStream() NOEXCEPT
+        {
+            return s_MediaStreamSettings;
+        }
+
+        SOCKET CreateSocket(int af, int type, int protocol, DWORD dwFlags)
+        {
+            SOCKET new_socket = ::WSASocket(af, type, protocol, nullptr, 0, dwFlags);
+            if (INVALID_SOCKET == new_socket) {
+                throw ctl::ctException(::WSAGetLastError(), L"WSASocket", L"ctsMediaStreamServerUnitTest", false);
+            }
+            s_ListeningSocket = new_socket;
+            return new_socket;
+        }
+
+        int SetPreBindOptions(SOCKET, const ctl::ctSockaddr&)
+        {
+            return NO_ERROR;
+        }
+
+        ctsUnsignedLongLong GetTransferSize() NOEXCEPT
+        {
+            return 0ULL;
+        }
+
+        ctsUnsignedLong GetMaxBufferSize() NOEXCEPT
+        {
+            return 0UL;
+        }
+
+        float GetStatusTimeStamp() NOEXCEPT
+        {
+            return 0.0f;
+        }
+        bool ShutdownCalled() NOEXCEPT
+        {
+            return false;
+        }
+        unsigned long ConsoleVerbosity() NOEXCEPT
+        {
+            return 0;
+        }
+    }
+
+    ctsIOPattern::ctsIOPattern(unsigned long)
+    {
+    }
+
+    ctsIOPattern::~ctsIOPattern()
+    {
+    }
+
+    // no IO is started by these tests
+    ctsIOTask ctsIOPattern::initiate_io() NOEXCEPT
+    {
+        return ctsIOTask();
+    }
+
+    ctsIOStatus ctsIOPattern::complete_io(const ctsIOTask&, unsigned long, unsigned long) NOEXCEPT
+    {
+        return ctsIOStatus::FailedIo;
+    }
+
+    // test IO pattern for fakes for this test
+    class ctsMediaStreamServerUnitTestIOPattern : public ctsIOPattern
+    {
+    public:
+        // default the base class 1 recv buffer
+        ctsMediaStreamServerUnitTestIOPattern() : ctsIOPattern(1)
+        {
+        }
+
+        // none of these are called - required to be defined
+        virtual void print_stats(const ctl::ctSockaddr&, const ctl::ctSockaddr&) NOEXCEPT
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::print_stats");
+        }
+        virtual ctsIOTask next_task()
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::next_task");
+            return ctsIOTask();
+        }
+        virtual ctsIOPatternProtocolError completed_task(const ctsIOTask&, unsigned long) NOEXCEPT
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::completed_task");
+            return ctsIOPatternProtocolError::NoError;
+        }
+        virtual void start_stats() NOEXCEPT
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::start_stats");
+        }
+        virtual void end_stats() NOEXCEPT
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::end_stats");
+        }
+        virtual void sample_stats() NOEXCEPT
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::sample_stats");
+        }
+        virtual void record_tcp_info(const ctsTcpInfoSample&) NOEXCEPT
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::record_tcp_info");
+        }
+        virtual char* connection_id() NOEXCEPT
+        {
+            Assert::Fail(L"ctsMediaStreamServerUnitTestIOPattern::connection_id");
+            return nullptr;
+        }
+    };
+
+    // ctsSocketState fakes
+    ctsSocketState::ctsSocketState(std::weak_ptr<ctsSocketBroker>)
+    {
+    }
+    ctsSocketState::~ctsSocketState()
+    {
+    }
+    // ctsSocket fakes
+    ctsSocket::ctsSocket(std::weak_ptr<ctsSocketState>)
+    {
+        this->pattern = std::make_shared<ctsMediaStreamServerUnitTestIOPattern>();
+    }
+    ctsSocket::~ctsSocket()
+    {
+    }
+    void ctsSocket::lock_socket() const NOEXCEPT
+    {
+    }
+    void ctsSocket::unlock_socket() const NOEXCEPT
+    {
+    }
+    void ctsSocket::complete_state(unsigned long) NOEXCEPT
+    {
+        ++s_CompletedSockets;
+    }
+    const ctl::ctSockaddr& ctsSocket::local_address() const NOEXCEPT
+    {
+        return this->local_sockaddr;
+    }
+    void ctsSocket::set_local_address(const ctl::ctSockaddr& _local) NOEXCEPT
+    {
+        this->local_sockaddr = _local;
+    }
+    const ctl::ctSockaddr& ctsSocket::target_address() const NOEXCEPT
+    {
+        return this->target_sockaddr;
+    }
+    void ctsSocket::set_target_address(const ctl::ctSockaddr& _target) NOEXCEPT
+    {
+        this->target_sockaddr = _target;
+    }
+    std::shared_ptr<ctsIOPattern> ctsSocket::io_pattern() const NOEXCEPT
+    {
+        return this->pattern;
+    }
+    long ctsSocket::pended_io() NOEXCEPT
+    {
+        return this->io_count;
+    }
+
+    // ctsMediaStreamServerListeningSocket fakes
+    // - no recvs are posted: the tests call ctsMediaStreamServerImpl::start() directly, as each recv completion would
+    ctsMediaStreamServerListeningSocket::ctsMediaStreamServerListeningSocket(ctl::ctScopedSocket&& _listening_socket, const ctl::ctSockaddr& _listening_addr) :
+        object_guard(),
+        recv_contexts(),
+        thread_iocp(),
+        socket(std::move(_listening_socket)),
+        listening_addr(_listening_addr),
+        scheduler()
+    {
+        if (!::InitializeCriticalSectionEx(&object_guard, 4000, 0)) {
+            throw ctl::ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsMediaStreamServerUnitTest", false);
+        }
+    }
+    ctsMediaStreamServerListeningSocket::~ctsMediaStreamServerListeningSocket() NOEXCEPT
+    {
+        this->reset();
+        ::DeleteCriticalSection(&object_guard);
+    }
+    SOCKET ctsMediaStreamServerListeningSocket::get_socket() const NOEXCEPT
+    {
+        return this->socket.get();
+    }
+    ctl::ctSockaddr ctsMediaStreamServerListeningSocket::get_address() const NOEXCEPT
+    {
+        return this->listening_addr;
+    }
+    ctsMediaStreamServerScheduler* ctsMediaStreamServerListeningSocket::get_scheduler() NOEXCEPT
+    {
+        return &this->scheduler;
+    }
+    void ctsMediaStreamServerListeningSocket::reset() NOEXCEPT
+    {
+        this->socket.reset();
+    }
+    void ctsMediaStreamServerListeningSocket::initiate_recv() NOEXCEPT
+    {
+    }
+
+    namespace ctsMediaStreamServerImpl {
+        // defined in ctsMediaStreamServer.cpp: inspected to count the streams that were connected
+        extern ctsSockaddrHashTable<ctsMediaStreamServerConnectedSocket> connected_sockets;
+    }
+}
+///
+/// End of Fakes
+///
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsMediaStreamServerUnitTest)
+    {
+    private:
+        // the listening socket's 4 recvs can each complete a START at the same time
+        static const unsigned long ConcurrentStartCount = 4;
+
+        static ctl::ctSockaddr MakeRemoteAddress(_In_z_ LPCWSTR _address)
+        {
+            std::vector<ctl::ctSockaddr> remote_addr(ctl::ctSockaddr::ResolveName(_address));
+            Assert::AreEqual(static_cast<size_t>(1), remote_addr.size());
+            return remote_addr[0];
+        }
+
+        static std::shared_ptr<ctsSocket> MakeSocket()
+        {
+            std::shared_ptr<ctsSocketState> socket_state(std::make_shared<ctsSocketState>(std::weak_ptr<ctsSocketBroker>()));
+            return std::make_shared<ctsSocket>(socket_state);
+        }
+
+        // process a START as the listening socket's recv completion would
+        static void ReceiveStart(const ctl::ctSockaddr& _remote_addr)
+        {
+            // the listening socket still owns the socket: don't close it when this goes out of scope
+            ctl::ctScopedSocket listening_socket(s_ListeningSocket);
+            ctlScopeGuard(releaseListeningSocket, { listening_socket.release(); });
+            ctsMediaStreamServerImpl::start(listening_socket, ctsConfig::Settings->ListenAddresses[0], _remote_addr, false);
+        }
+
+    public:
+        TEST_CLASS_INITIALIZE(Setup)
+        {
+            WSADATA wsadata;
+            auto startup = ::WSAStartup(WINSOCK_VERSION, &wsadata);
+            Assert::AreEqual(0, startup);
+
+            ctsConfig::Settings = new ctsConfig::ctsConfigSettings;
+            ctsConfig::Settings->Protocol = ctsConfig::ProtocolType::UDP;
+            ctsConfig::Settings->ListenAddresses = ctl::ctSockaddr::ResolveName(L"127.0.0.1");
+            Assert::AreEqual(static_cast<size_t>(1), ctsConfig::Settings->ListenAddresses.size());
+
+            ctsMediaStreamServerImpl::init_once();
+            Assert::AreNotEqual(INVALID_SOCKET, s_ListeningSocket);
+        }
+
+        TEST_CLASS_CLEANUP(Cleanup)
+        {
+            ::WSACleanup();
+            delete ctsConfig::Settings;
+        }
+
+        TEST_METHOD(DuplicateStartForQueuedEndpoint)
+        {
+            const ctl::ctSockaddr remote_addr(MakeRemoteAddress(L"1.1.1.1"));
+            const unsigned long initial_completed = s_CompletedSockets;
+            const size_t initial_connected = ctsMediaStreamServerImpl::connected_sockets.size();
+
+            // no ctsSocket is waiting yet: both STARTs are queued in awaiting_endpoints
+            ReceiveStart(remote_addr);
+            ReceiveStart(remote_addr);
+            Assert::AreEqual(initial_completed, s_CompletedSockets.load());
+
+            auto first_socket(MakeSocket());
+            ctsMediaStreamServerListener(first_socket);
+            Assert::AreEqual(initial_completed + 1, s_CompletedSockets.load());
+            Assert::AreEqual(remote_addr, first_socket->target_address());
+
+            // the repeated START was not queued a second time: this ctsSocket is left waiting
+            auto second_socket(MakeSocket());
+            ctsMediaStreamServerListener(second_socket);
+            Assert::AreEqual(initial_completed + 1, s_CompletedSockets.load());
+            Assert::AreEqual(initial_connected + 1, ctsMediaStreamServerImpl::connected_sockets.size());
+
+            // a new endpoint is completed on the waiting ctsSocket
+            const ctl::ctSockaddr next_remote_addr(MakeRemoteAddress(L"1.1.1.2"));
+            ReceiveStart(next_remote_addr);
+            Assert::AreEqual(initial_completed + 2, s_CompletedSockets.load());
+            Assert::AreEqual(next_remote_addr, second_socket->target_address());
+
+            ctsMediaStreamServerImpl::remove_socket(remote_addr);
+            ctsMediaStreamServerImpl::remove_socket(next_remote_addr);
+            Assert::AreEqual(initial_connected, ctsMediaStreamServerImpl::connected_sockets.size());
+        }
+
+        TEST_METHOD(DuplicateStartForConnectedEndpoint)
+        {
+            const ctl::ctSockaddr remote_addr(MakeRemoteAddress(L"1.1.1.3"));
+            const unsigned long initial_completed = s_CompletedSockets;
+            const size_t initial_connected = ctsMediaStreamServerImpl::connected_sockets.size();
+
+            auto first_socket(MakeSocket());
+            ctsMediaStreamServerListener(first_socket);
+            ReceiveStart(remote_addr);
+            Assert::AreEqual(initial_completed + 1, s_CompletedSockets.load());
+            Assert::AreEqual(remote_addr, first_socket->target_address());
+            auto connected_socket(ctsMediaStreamServerImpl::connected_sockets.find(remote_addr));
+            Assert::IsNotNull(connected_socket.get());
+
+            // the repeated START neither replaces the connected socket nor is queued for the next ctsSocket
+            ReceiveStart(remote_addr);
+            Assert::AreEqual(initial_completed + 1, s_CompletedSockets.load());
+            Assert::IsTrue(connected_socket == ctsMediaStreamServerImpl::connected_sockets.find(remote_addr));
+
+            auto second_socket(MakeSocket());
+            ctsMediaStreamServerListener(second_socket);
+            Assert::AreEqual(initial_completed + 1, s_CompletedSockets.load());
+            Assert::AreEqual(initial_connected + 1, ctsMediaStreamServerImpl::connected_sockets.size());
+
+            const ctl::ctSockaddr next_remote_addr(MakeRemoteAddress(L"1.1.1.4"));
+            ReceiveStart(next_remote_addr);
+            Assert::AreEqual(initial_completed + 2, s_CompletedSockets.load());
+            Assert::AreEqual(next_remote_addr, second_socket->target_address());
+
+            connected_socket.reset();
+            ctsMediaStreamServerImpl::remove_socket(remote_addr);
+            ctsMediaStreamServerImpl::remove_socket(next_remote_addr);
+            Assert::AreEqual(initial_connected, ctsMediaStreamServerImpl::connected_sockets.size());
+        }
+
+        TEST_METHOD(ConcurrentStartsForOneEndpoint)
+        {
+            const ctl::ctSockaddr remote_addr(MakeRemoteAddress(L"1.1.1.5"));
+            const unsigned long initial_completed = s_CompletedSockets;
+            const size_t initial_connected = ctsMediaStreamServerImpl::connected_sockets.size();
+
+            auto first_socket(MakeSocket());
+            ctsMediaStreamServerListener(first_socket);
+
+            // release every START at once, as when each outstanding recv completes the same client's START
+            ctl::ctScopedHandle start_event(::CreateEventW(nullptr, TRUE, FALSE, nullptr));
+            Assert::IsNotNull(start_event.get());
+            std::vector<std::thread> start_threads;
+            for (unsigned long count = 0; count < ConcurrentStartCount; ++count) {
+                start_threads.emplace_back([&] () {
+                    ::WaitForSingleObject(start_event.get(), INFINITE);
+                    ReceiveStart(remote_addr);
+                });
+            }
+            ::SetEvent(start_event.get());
+            for (auto& start_thread : start_threads) {
+                start_thread.join();
+            }
+
+            Assert::AreEqual(initial_completed + 1, s_CompletedSockets.load());
+            Assert::AreEqual(remote_addr, first_socket->target_address());
+            Assert::AreEqual(initial_connected + 1, ctsMediaStreamServerImpl::connected_sockets.size());
+
+            // none of the STARTs that lost the race were queued for the next ctsSocket
+            auto second_socket(MakeSocket());
+            ctsMediaStreamServerListener(second_socket);
+            Assert::AreEqual(initial_completed + 1, s_CompletedSockets.load());
+
+            const ctl::ctSockaddr next_remote_addr(MakeRemoteAddress(L"1.1.1.6"));
+            ReceiveStart(next_remote_addr);
+            Assert::AreEqual(initial_completed + 2, s_CompletedSockets.load());
+            Assert::AreEqual(next_remote_addr, second_socket->target_address());
+
+            ctsMediaStreamServerImpl::remove_socket(remote_addr);
+            ctsMediaStreamServerImpl::remove_socket(next_remote_addr);
+            Assert::AreEqual(initial_connected, ctsMediaStreamServerImpl::connected_sockets.size());
+        }
+    };
+}
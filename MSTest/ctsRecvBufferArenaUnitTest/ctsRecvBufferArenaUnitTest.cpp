@@ -0,0 +1,114 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <vector>
+#include <set>
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsRecvBufferArena.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsRecvBufferArenaUnitTest)
+    {
+    public:
+        TEST_METHOD(NoRegionsUntilFirstCheckOut)
+        {
+            ctsRecvBufferArena arena(4096, 16, 0, false);
+            Assert::AreEqual(4096UL, arena.chunk_bytes());
+            Assert::AreEqual(0UL, arena.region_count());
+            Assert::AreEqual(0UL, arena.chunk_count());
+
+            const ctsRecvBufferArena::Chunk chunk(arena.check_out());
+            Assert::AreEqual(1UL, arena.region_count());
+            Assert::AreEqual(16UL, arena.chunk_count());
+            // without RIO the chunk is addressed directly
+            Assert::AreEqual(0UL, chunk.buffer_offset);
+            Assert::IsTrue(RIO_INVALID_BUFFERID == chunk.rio_bufferid);
+            arena.check_in(chunk);
+        }
+
+        TEST_METHOD(ChunksDoNotOverlap)
+        {
+            ctsRecvBufferArena arena(1000, 8, 0, false);
+            std::vector<ctsRecvBufferArena::Chunk> chunks;
+            std::set<char*> addresses;
+            for (unsigned long count = 0; count < 20; ++count) {
+                chunks.push_back(arena.check_out());
+                char* address = ctsRecvBufferArena::chunk_address(chunks.back());
+                // the full chunk is writeable
+                address[0] = 'a';
+                address[999] = 'z';
+                Assert::IsTrue(addresses.insert(address).second);
+            }
+            // 20 chunks in flight need 3 regions of 8
+            Assert::AreEqual(3UL, arena.region_count());
+
+            for (const auto& chunk : chunks) {
+                Assert::AreEqual('z', ctsRecvBufferArena::chunk_address(chunk)[999]);
+                for (const auto& other_chunk : chunks) {
+                    char* address = ctsRecvBufferArena::chunk_address(chunk);
+                    char* other_address = ctsRecvBufferArena::chunk_address(other_chunk);
+                    if (address != other_address) {
+                        Assert::IsTrue(address + 1000 <= other_address || other_address + 1000 <= address);
+                    }
+                }
+            }
+            for (const auto& chunk : chunks) {
+                arena.check_in(chunk);
+            }
+        }
+
+        TEST_METHOD(MemoryFollowsChunksInFlight)
+        {
+            ctsRecvBufferArena arena(512, 4, 0, false);
+            // many connections each posting and completing one recv at a time never need more than one region
+            for (unsigned long connection = 0; connection < 1000; ++connection) {
+                const ctsRecvBufferArena::Chunk first(arena.check_out());
+                const ctsRecvBufferArena::Chunk second(arena.check_out());
+                arena.check_in(first);
+                arena.check_in(second);
+            }
+            Assert::AreEqual(1UL, arena.region_count());
+            Assert::AreEqual(4UL, arena.chunk_count());
+        }
+
+        TEST_METHOD(ReturnedChunksAreReused)
+        {
+            ctsRecvBufferArena arena(512, 64, 0, false);
+            std::vector<ctsRecvBufferArena::Chunk> chunks;
+            for (unsigned long count = 0; count < 64; ++count) {
+                chunks.push_back(arena.check_out());
+            }
+            Assert::AreEqual(1UL, arena.region_count());
+            // more than a processor cache worth returned: the overflow goes back to the arena
+            for (const auto& chunk : chunks) {
+                arena.check_in(chunk);
+            }
+            chunks.clear();
+            for (unsigned long count = 0; count < 64; ++count) {
+                chunks.push_back(arena.check_out());
+            }
+            Assert::AreEqual(1UL, arena.region_count());
+            for (const auto& chunk : chunks) {
+                arena.check_in(chunk);
+            }
+        }
+    };
+}
@@ -0,0 +1,113 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsSendWindowController.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    static const unsigned long BufferSize = 0x10000;
+    static const unsigned long Mss = 1460;
+
+    TEST_CLASS(ctsSendWindowControllerUnitTest)
+    {
+    public:
+        TEST_METHOD(FollowsTheCongestionWindow)
+        {
+            // cwnd 4 buffers, not yet full
+            Assert::AreEqual(
+                BufferSize * 4,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, BufferSize * 4, BufferSize * 16, Mss, BufferSize));
+        }
+
+        TEST_METHOD(FollowsTheSendWindow)
+        {
+            Assert::AreEqual(
+                BufferSize * 2,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, BufferSize * 16, BufferSize * 2, Mss, 0));
+        }
+
+        TEST_METHOD(IgnoresAnUnknownSendWindow)
+        {
+            Assert::AreEqual(
+                BufferSize * 4,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, BufferSize * 4, 0, Mss, 0));
+        }
+
+        TEST_METHOD(KeepsOneMoreBufferWhenTheCongestionWindowIsFull)
+        {
+            Assert::AreEqual(
+                BufferSize * 5,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, BufferSize * 4, BufferSize * 16, Mss, BufferSize * 4 - Mss));
+        }
+
+        TEST_METHOD(RoundsUpToWholeBuffers)
+        {
+            Assert::AreEqual(
+                BufferSize * 2,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, BufferSize + 1, BufferSize * 16, Mss, 0));
+        }
+
+        TEST_METHOD(NeverLessThanOneBuffer)
+        {
+            Assert::AreEqual(
+                BufferSize,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, Mss * 2, BufferSize * 16, Mss, 0));
+            Assert::AreEqual(
+                BufferSize,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, 0, 0, 0, 0));
+        }
+
+        TEST_METHOD(GrowsImmediately)
+        {
+            Assert::AreEqual(
+                BufferSize * 16,
+                ctsSendWindowController::NextSendBacklog(BufferSize, BufferSize, BufferSize * 16, BufferSize * 32, Mss, 0));
+        }
+
+        TEST_METHOD(ShrinksHalfWay)
+        {
+            // target of 2 buffers from 16: 2 + (16 - 2) / 2, then 2 + (9 - 2) / 2 rounded down
+            unsigned long backlog = ctsSendWindowController::NextSendBacklog(BufferSize * 16, BufferSize, BufferSize * 2, BufferSize * 32, Mss, 0);
+            Assert::AreEqual(BufferSize * 9, backlog);
+            backlog = ctsSendWindowController::NextSendBacklog(backlog, BufferSize, BufferSize * 2, BufferSize * 32, Mss, 0);
+            Assert::AreEqual(BufferSize * 5, backlog);
+            // the last buffer above the target is also given up
+            for (unsigned long count = 0; count < 8; ++count) {
+                backlog = ctsSendWindowController::NextSendBacklog(backlog, BufferSize, BufferSize * 2, BufferSize * 32, Mss, 0);
+            }
+            Assert::AreEqual(BufferSize * 2, backlog);
+        }
+
+        TEST_METHOD(StaysWithinAnUnsignedLong)
+        {
+            const unsigned long backlog = ctsSendWindowController::NextSendBacklog(MAXULONG32, BufferSize, MAXULONG32, MAXULONG32, Mss, MAXULONG32);
+            Assert::IsTrue(backlog <= MAXULONG32);
+            Assert::AreEqual(0UL, backlog % BufferSize);
+        }
+
+        TEST_METHOD(ZeroBufferSizeKeepsTheCurrentBacklog)
+        {
+            Assert::AreEqual(
+                BufferSize,
+                ctsSendWindowController::NextSendBacklog(BufferSize, 0, BufferSize * 4, BufferSize * 4, Mss, 0));
+        }
+    };
+}
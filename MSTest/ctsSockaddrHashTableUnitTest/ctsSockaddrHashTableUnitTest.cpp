@@ -0,0 +1,107 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <memory>
+#include <vector>
+
+#include <ctSockaddr.hpp>
+#include <ctVersionConversion.hpp>
+
+#include "ctsSockaddrHashTable.hpp"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsSockaddrHashTableUnitTest)
+    {
+    private:
+        static ctl::ctSockaddr MakeAddress(LPCWSTR _address, unsigned short _port)
+        {
+            ctl::ctSockaddr address;
+            Assert::IsTrue(address.setAddress(_address));
+            address.setPort(_port);
+            return address;
+        }
+
+    public:
+        TEST_CLASS_INITIALIZE(Setup)
+        {
+            WSADATA wsadata;
+            auto startup = ::WSAStartup(WINSOCK_VERSION, &wsadata);
+            Assert::AreEqual(0, startup);
+        }
+
+        TEST_CLASS_CLEANUP(Cleanup)
+        {
+            ::WSACleanup();
+        }
+
+        TEST_METHOD(InsertFindRemove)
+        {
+            ctsSockaddrHashTable<int> table;
+            const ctl::ctSockaddr v4_address(MakeAddress(L"10.0.0.1", 5000));
+            const ctl::ctSockaddr v6_address(MakeAddress(L"fe80::1", 5000));
+
+            Assert::IsFalse(static_cast<bool>(table.find(v4_address)));
+            Assert::IsTrue(table.insert(v4_address, std::make_shared<int>(4)));
+            Assert::IsTrue(table.insert(v6_address, std::make_shared<int>(6)));
+            Assert::AreEqual(static_cast<size_t>(2), table.size());
+
+            Assert::AreEqual(4, *table.find(v4_address));
+            Assert::AreEqual(6, *table.find(v6_address));
+            // the port is part of the key
+            Assert::IsFalse(static_cast<bool>(table.find(MakeAddress(L"10.0.0.1", 5001))));
+
+            auto removed = table.remove(v4_address);
+            Assert::AreEqual(4, *removed);
+            Assert::IsFalse(static_cast<bool>(table.find(v4_address)));
+            Assert::IsFalse(static_cast<bool>(table.remove(v4_address)));
+            Assert::AreEqual(static_cast<size_t>(1), table.size());
+        }
+
+        TEST_METHOD(DuplicateInsertKeepsFirst)
+        {
+            ctsSockaddrHashTable<int> table;
+            const ctl::ctSockaddr address(MakeAddress(L"192.168.1.1", 80));
+
+            Assert::IsTrue(table.insert(address, std::make_shared<int>(1)));
+            Assert::IsFalse(table.insert(address, std::make_shared<int>(2)));
+            Assert::AreEqual(1, *table.find(address));
+            Assert::AreEqual(static_cast<size_t>(1), table.size());
+        }
+
+        TEST_METHOD(ManyAddressesAcrossStripes)
+        {
+            ctsSockaddrHashTable<unsigned short> table;
+            const unsigned short AddressCount = 4096;
+            for (unsigned short port = 1; port <= AddressCount; ++port) {
+                Assert::IsTrue(table.insert(MakeAddress(L"10.1.2.3", port), std::make_shared<unsigned short>(port)));
+            }
+            Assert::AreEqual(static_cast<size_t>(AddressCount), table.size());
+
+            for (unsigned short port = 1; port <= AddressCount; ++port) {
+                auto found = table.find(MakeAddress(L"10.1.2.3", port));
+                Assert::IsTrue(static_cast<bool>(found));
+                Assert::AreEqual(port, *found);
+            }
+            for (unsigned short port = 1; port <= AddressCount; port += 2) {
+                Assert::IsTrue(static_cast<bool>(table.remove(MakeAddress(L"10.1.2.3", port))));
+            }
+            Assert::AreEqual(static_cast<size_t>(AddressCount / 2), table.size());
+        }
+    };
+}
@@ -140,6 +140,16 @@ public:
                 [&] (const std::weak_ptr<ctsSocketState>& _weak_ptr) { return _weak_ptr.expired(); }),
             std::end(state_objects));
     }
+    void remove_object(const ctsSocketState* _state_object) NOEXCEPT
+    {
+        ctl::ctAutoReleaseCriticalSection hold_lock(&cs);
+        state_objects.erase(
+            std::remove_if(
+                std::begin(state_objects),
+                std::end(state_objects),
+                [&] (const std::weak_ptr<ctsSocketState>& _weak_ptr) { return _weak_ptr.lock().get() == _state_object; }),
+            std::end(state_objects));
+    }
     void reset() NOEXCEPT
     {
         ctl::ctAutoReleaseCriticalSection hold_lock(&cs);
@@ -222,6 +232,13 @@ void ctsSocketState::start() NOEXCEPT
     s_SocketPool->add_object(this->shared_from_this());
 }
 
+void ctsSocketState::reset() NOEXCEPT
+{
+    // a recycled object is tracked again once the broker calls start()
+    s_SocketPool->remove_object(this);
+    this->state = ctsSocketState::InternalState::Creating;
+}
+
 void ctsSocketState::complete_state(DWORD _error_code) NOEXCEPT
 {
     if (NO_ERROR == _error_code) {
@@ -1108,5 +1125,44 @@ namespace ctsUnitTest {
             ::Sleep(333);
             s_SocketPool->validate_expected_count(0);
         }
+
+        TEST_METHOD(ClosedClientConnectionsAreRecycled)
+        {
+            s_SocketPool->reset();
+
+            // Initialize config for this test
+            // a client (connecting), not a server (accepting)
+            ctsConfig::Settings->AcceptFunction = nullptr;
+            ctsConfig::Settings->Iterations = 3;
+            ctsConfig::Settings->ConnectionLimit = 1;
+            ctsConfig::Settings->ConnectionThrottleLimit = 1;
+            // these are not applicable to client
+            ctsConfig::Settings->ServerExitLimit = 0;
+            ctsConfig::Settings->AcceptLimit = 0;
+
+            const long long allocated = ctsConfig::Settings->ConnectionStatusDetails.allocated_object_count.get();
+            const long long recycled = ctsConfig::Settings->ConnectionStatusDetails.recycled_object_count.get();
+
+            std::shared_ptr<ctsSocketBroker> test_broker(std::make_shared<ctsSocketBroker>());
+            test_broker->start();
+
+            for (long long iteration = 0; iteration < 3; ++iteration) {
+                s_SocketPool->validate_expected_count(1, ctsSocketState::InternalState::Creating);
+                // only the first connection allocates: the closed connection is reused for each following iteration
+                Assert::AreEqual(allocated + 1, ctsConfig::Settings->ConnectionStatusDetails.allocated_object_count.get());
+                Assert::AreEqual(recycled + iteration, ctsConfig::Settings->ConnectionStatusDetails.recycled_object_count.get());
+
+                s_SocketPool->complete_state(NO_ERROR);
+                s_SocketPool->complete_state(NO_ERROR);
+                ::Sleep(500); // allowing the timer to coalesce
+            }
+
+            auto completed = test_broker->wait(1000);
+            Assert::IsTrue(completed);
+            // let the TP complete
+            ::Sleep(333);
+            // nothing is kept once no more connections will be made
+            s_SocketPool->validate_expected_count(0);
+        }
     };
 }
\ No newline at end of file
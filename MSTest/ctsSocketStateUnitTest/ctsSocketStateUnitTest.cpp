@@ -24,6 +24,8 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsSocketState.h"
 #include "ctsSocketBroker.h"
 #include "ctsWinsockLayer.h"
+#include "ctsTcpInfoSampler.h"
+#include "ctsTimeSeriesSampler.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace std;
@@ -100,6 +102,16 @@ namespace ctsTraffic {
     void ctsSocketBroker::closing(bool _was_active) NOEXCEPT
     {
     }
+
+    /// ctsTcpInfoSampler stub - only called when -TcpInfoInterval is set
+    void ctsTcpInfoSampler::AddSocket(const std::weak_ptr<ctsSocket>&) NOEXCEPT
+    {
+    }
+
+    /// ctsTimeSeriesSampler stub - only called when -TimeSeriesFilename is set
+    void ctsTimeSeriesSampler::AddSocket(const std::weak_ptr<ctsSocket>&) NOEXCEPT
+    {
+    }
 }
 ///
 /// End of Fakes
@@ -114,6 +126,7 @@ static DWORD s_CreateReturnCode = 0UL;
 static DWORD s_ConnectReturnCode = 0UL;
 static DWORD s_IOReturnCode = 0UL;
 static DWORD s_ShouldNeverHitErrorCode = 0xffffffffUL;
+static std::weak_ptr<ctsSocket> s_LastSocket;
 void ResetStatics(DWORD _create = s_ShouldNeverHitErrorCode, DWORD _connect = s_ShouldNeverHitErrorCode, DWORD _io = s_ShouldNeverHitErrorCode)
 {
     s_CallbackCount = 0L;
@@ -129,6 +142,7 @@ void CreateFunctionHook(std::weak_ptr<ctsSocket> _socket) NOEXCEPT
 
     Assert::AreNotEqual(s_ShouldNeverHitErrorCode, s_CreateReturnCode);
 
+    s_LastSocket = _socket;
     ctl::ctMemoryGuardIncrement(&s_CallbackCount);
     if (shared_socket) {
         shared_socket->complete_state(s_CreateReturnCode);
@@ -246,5 +260,46 @@ namespace ctsUnitTest {
 
             Assert::AreEqual(3L, ctl::ctMemoryGuardRead(&s_CallbackCount));
         }
+
+        TEST_METHOD(ResetAllowsAnotherConnection)
+        {
+            ResetStatics(0, 0, 0);
+
+            std::shared_ptr<ctsSocketState> test(std::make_shared<ctsSocketState>(std::weak_ptr<ctsSocketBroker>()));
+            for (long iteration = 1; iteration <= 3; ++iteration) {
+                test->start();
+
+                do {
+                    ::Sleep(100);
+                } while (ctsSocketState::InternalState::Closed != test->current_state());
+
+                Assert::AreEqual(3L * iteration, ctl::ctMemoryGuardRead(&s_CallbackCount));
+
+                test->reset();
+                Assert::IsTrue(ctsSocketState::InternalState::Creating == test->current_state());
+            }
+        }
+
+        TEST_METHOD(ResetDetachesThePriorSocket)
+        {
+            ResetStatics(0, 0, 0);
+
+            std::shared_ptr<ctsSocketState> test(std::make_shared<ctsSocketState>(std::weak_ptr<ctsSocketBroker>()));
+            test->start();
+
+            do {
+                ::Sleep(100);
+            } while (ctsSocketState::InternalState::Closed != test->current_state());
+
+            // a callback still holding the prior connection's socket
+            auto prior_socket(s_LastSocket.lock());
+            Assert::IsNotNull(prior_socket.get());
+
+            test->reset();
+            // must not be able to complete states on the recycled object
+            prior_socket->complete_state(1);
+            ::Sleep(100);
+            Assert::IsTrue(ctsSocketState::InternalState::Creating == test->current_state());
+        }
     };
 }
\ No newline at end of file
@@ -22,6 +22,8 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsSocketState.h"
 #include "ctsIOPattern.h"
 #include "ctsWinsockLayer.h"
+#include "ctsTcpInfoSampler.h"
+#include "ctsTimeSeriesSampler.h"
 
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -113,6 +115,16 @@ namespace ctsTraffic {
             return 0;
         }
     }
+
+    /// ctsTcpInfoSampler stub - only called when -TcpInfoInterval is set
+    void ctsTcpInfoSampler::AddSocket(const std::weak_ptr<ctsSocket>&) NOEXCEPT
+    {
+    }
+
+    /// ctsTimeSeriesSampler stub - only called when -TimeSeriesFilename is set
+    void ctsTimeSeriesSampler::AddSocket(const std::weak_ptr<ctsSocket>&) NOEXCEPT
+    {
+    }
 }
 ///
 /// End of Fakes
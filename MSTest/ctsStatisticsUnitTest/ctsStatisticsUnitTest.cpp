@@ -15,6 +15,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "CppUnitTest.h"
 
 #include <memory>
+#include <vector>
 
 #include <ctString.hpp>
 #include <ctVersionConversion.hpp>
@@ -125,5 +126,214 @@ namespace ctsUnitTest {
             ctsUdpStatistics udp_stats;
             ctsConnectionStatistics conn_stats;
         }
+
+        TEST_METHOD(HistogramBuckets)
+        {
+            ctsHistogramStatistics histogram;
+            Assert::AreEqual(0LL, histogram.count());
+            Assert::AreEqual(0LL, histogram.sum());
+
+            // bounds are inclusive
+            histogram.add_value(0LL);
+            histogram.add_value(1LL);
+            histogram.add_value(2LL);
+            histogram.add_value(1000LL);
+            histogram.add_value(MAXLONGLONG / 2);
+
+            Assert::AreEqual(2LL, histogram.bucket_value(0));
+            Assert::AreEqual(1LL, histogram.bucket_value(1));
+            Assert::AreEqual(1LL, histogram.bucket_value(6));
+            Assert::AreEqual(1LL, histogram.bucket_value(ctsHistogramStatistics::BucketCount - 1));
+            Assert::AreEqual(5LL, histogram.count());
+
+            long long total = 0LL;
+            for (unsigned long bucket = 0; bucket < ctsHistogramStatistics::BucketCount; ++bucket) {
+                total += histogram.bucket_value(bucket);
+            }
+            Assert::AreEqual(histogram.count(), total);
+            Assert::AreEqual(MAXLONGLONG, ctsHistogramStatistics::bucket_bound(ctsHistogramStatistics::BucketCount - 1));
+            Assert::AreEqual(0LL, histogram.bucket_value(ctsHistogramStatistics::BucketCount));
+        }
+
+        TEST_METHOD(TcpInfoStatistics)
+        {
+            ctsTcpStatistics tcp_stats;
+            Assert::AreEqual(0LL, tcp_stats.tcp_info.sample_count.get());
+            Assert::AreEqual(0LL, tcp_stats.tcp_info.rtt_avg_us());
+
+            ctsTcpInfoSample sample;
+            sample.sample_time = 1000LL;
+            sample.rtt_us = 300LL;
+            sample.min_rtt_us = 250LL;
+            sample.cwnd_bytes = 14600LL;
+            sample.delivered_bytes = 10000LL;
+            tcp_stats.record_tcp_info(sample);
+            // the delivery rate needs two samples
+            Assert::AreEqual(0LL, tcp_stats.tcp_info.delivery_rate.get());
+
+            sample.sample_time = 1500LL;
+            sample.rtt_us = 100LL;
+            sample.min_rtt_us = 90LL;
+            sample.cwnd_bytes = 29200LL;
+            sample.delivered_bytes = 60000LL;
+            sample.bytes_retransmitted = 1460LL;
+            sample.retransmits = 1LL;
+            tcp_stats.record_tcp_info(sample);
+
+            Assert::AreEqual(2LL, tcp_stats.tcp_info.sample_count.get());
+            Assert::AreEqual(90LL, tcp_stats.tcp_info.rtt_min_us.get());
+            Assert::AreEqual(300LL, tcp_stats.tcp_info.rtt_max_us.get());
+            Assert::AreEqual(200LL, tcp_stats.tcp_info.rtt_avg_us());
+            Assert::AreEqual(29200LL, tcp_stats.tcp_info.cwnd_bytes.get());
+            Assert::AreEqual(1460LL, tcp_stats.tcp_info.bytes_retransmitted.get());
+            Assert::AreEqual(1LL, tcp_stats.tcp_info.retransmits.get());
+            // 50000 bytes over 500 ms
+            Assert::AreEqual(100000LL, tcp_stats.tcp_info.delivery_rate.get());
+
+            // copies carry the transport details
+            ctsTcpStatistics copied_stats(tcp_stats);
+            Assert::AreEqual(200LL, copied_stats.tcp_info.rtt_avg_us());
+        }
+
+        TEST_METHOD(UdpPlayoutStatistics)
+        {
+            ctsUdpStatistics udp_stats;
+            Assert::AreEqual(0LL, udp_stats.playout_delay_milliseconds());
+
+            udp_stats.successful_frames.add(3LL);
+            udp_stats.dropped_frames.increment();
+            udp_stats.playout_delay_total.add(400LL);
+            udp_stats.rebuffer_count.increment();
+            udp_stats.buffering_milliseconds.add(250LL);
+            // averaged across both rendered and dropped frames
+            Assert::AreEqual(100LL, udp_stats.playout_delay_milliseconds());
+
+            ctsUdpStatistics snapped_stats(udp_stats.snap_view(true));
+            Assert::AreEqual(1LL, snapped_stats.rebuffer_count.get());
+            Assert::AreEqual(250LL, snapped_stats.buffering_milliseconds.get());
+            Assert::AreEqual(100LL, snapped_stats.playout_delay_milliseconds());
+            // the next view only sees the changes since the last snap
+            udp_stats.error_frames.increment();
+            ctsUdpStatistics next_stats(udp_stats.snap_view(true));
+            Assert::AreEqual(0LL, next_stats.rebuffer_count.get());
+            Assert::AreEqual(0LL, next_stats.duplicate_frames.get());
+            Assert::AreEqual(1LL, next_stats.error_frames.get());
+        }
+
+        TEST_METHOD(TimeSeriesReservesFromBudget)
+        {
+            const long long sample_size = static_cast<long long>(sizeof(ctsTimeSeries::Sample));
+            ctStatsTracking memory_remaining(sample_size * 20);
+            {
+                ctsTimeSeries first_series(10LL, 16, memory_remaining);
+                Assert::AreEqual(static_cast<size_t>(16), first_series.capacity());
+                Assert::AreEqual(sample_size * 4, memory_remaining.get());
+
+                // not enough left for MinimumCapacity: it's reserved regardless, leaving the budget in debt
+                ctsTimeSeries second_series(10LL, 16, memory_remaining);
+                Assert::AreEqual(static_cast<size_t>(ctsTimeSeries::MinimumCapacity), second_series.capacity());
+                Assert::AreEqual(sample_size * -4, memory_remaining.get());
+                Assert::IsTrue(second_series.sample_due(100LL));
+
+                long long counters[ctsTimeSeries::CounterCount] = { 1LL, 2LL, 3LL };
+                second_series.add_sample(100LL, 0LL, counters);
+                Assert::AreEqual(static_cast<size_t>(1), second_series.size());
+                // the second series holds only MinimumCapacity: it has nothing to give back
+                Assert::AreEqual(sample_size * -4, memory_remaining.get());
+
+                // the first series gives back half its storage with its next sample
+                first_series.add_sample(100LL, 0LL, counters);
+                Assert::AreEqual(static_cast<size_t>(8), first_series.capacity());
+                Assert::AreEqual(20LL, first_series.sample_interval());
+                Assert::AreEqual(sample_size * 4, memory_remaining.get());
+            }
+            // all memory is returned when the series are destroyed
+            Assert::AreEqual(sample_size * 20, memory_remaining.get());
+        }
+
+        TEST_METHOD(TimeSeriesDownsamplesOlderSamples)
+        {
+            ctStatsTracking memory_remaining(static_cast<long long>(sizeof(ctsTimeSeries::Sample)) * 8);
+            ctsTimeSeries series(10LL, 8, memory_remaining);
+            Assert::AreEqual(static_cast<size_t>(8), series.capacity());
+
+            Assert::IsTrue(series.sample_due(0LL));
+            for (long long sample = 0; sample < 8; ++sample) {
+                long long counters[ctsTimeSeries::CounterCount] = { sample * 100, sample * 200, 0LL };
+                series.add_sample(sample * 10, sample * 10, counters);
+                Assert::IsFalse(series.sample_due(sample * 10 + 9));
+                Assert::IsTrue(series.sample_due(sample * 10 + 10));
+            }
+            Assert::AreEqual(static_cast<size_t>(8), series.size());
+
+            // full: the older half [0,10,20,30] is thinned to [10,30], the newer half is kept
+            long long counters[ctsTimeSeries::CounterCount] = { 800LL, 1600LL, 0LL };
+            series.add_sample(80LL, 80LL, counters);
+            const long long expected_offsets[] = { 10LL, 30LL, 40LL, 50LL, 60LL, 70LL, 80LL };
+            Assert::AreEqual(_countof(expected_offsets), series.size());
+            for (size_t index = 0; index < series.size(); ++index) {
+                Assert::AreEqual(expected_offsets[index], series[index].time_offset);
+                // counters are cumulative: each retained sample still holds its own totals
+                Assert::AreEqual(expected_offsets[index] * 10, series[index].counters[0]);
+                Assert::AreEqual(expected_offsets[index] * 20, series[index].counters[1]);
+            }
+        }
+
+        TEST_METHOD(TimeSeriesGivesBackStorageEvenly)
+        {
+            const long long sample_size = static_cast<long long>(sizeof(ctsTimeSeries::Sample));
+            ctStatsTracking memory_remaining(sample_size * 32);
+            ctsTimeSeries series(10LL, 32, memory_remaining);
+            for (long long sample = 0; sample < 9; ++sample) {
+                long long counters[ctsTimeSeries::CounterCount] = { sample * 100, 0LL, 0LL };
+                series.add_sample(sample * 10, sample * 10, counters);
+            }
+
+            // another connection has put the budget in debt
+            memory_remaining.add(sample_size * -1);
+
+            // [0 .. 80] keeps the later of each pair plus the unpaired last, then the new sample is added
+            long long counters[ctsTimeSeries::CounterCount] = { 900LL, 0LL, 0LL };
+            series.add_sample(90LL, 90LL, counters);
+            Assert::AreEqual(static_cast<size_t>(16), series.capacity());
+            Assert::AreEqual(20LL, series.sample_interval());
+            Assert::IsFalse(series.sample_due(109LL));
+            Assert::IsTrue(series.sample_due(110LL));
+            Assert::AreEqual(sample_size * 15, memory_remaining.get());
+
+            const long long expected_offsets[] = { 10LL, 30LL, 50LL, 70LL, 80LL, 90LL };
+            Assert::AreEqual(_countof(expected_offsets), series.size());
+            for (size_t index = 0; index < series.size(); ++index) {
+                Assert::AreEqual(expected_offsets[index], series[index].time_offset);
+                Assert::AreEqual(expected_offsets[index] * 10, series[index].counters[0]);
+            }
+        }
+
+        TEST_METHOD(TimeSeriesEveryConnectionKeepsASeries)
+        {
+            const long long sample_size = static_cast<long long>(sizeof(ctsTimeSeries::Sample));
+            const long long budget = sample_size * 256;
+            ctStatsTracking memory_remaining(budget);
+            {
+                std::vector<std::unique_ptr<ctsTimeSeries>> connections;
+                for (long long connection = 0; connection < 32; ++connection) {
+                    connections.emplace_back(new ctsTimeSeries(10LL, ctsTimeSeries::DefaultCapacity, memory_remaining));
+                    Assert::IsTrue(connections.back()->capacity() >= ctsTimeSeries::MinimumCapacity);
+
+                    // every connection samples once: those holding more than they need give it back
+                    for (auto& series : connections) {
+                        long long counters[ctsTimeSeries::CounterCount] = { connection, 0LL, 0LL };
+                        series->add_sample(connection * 10, connection * 10, counters);
+                    }
+                }
+
+                // 32 connections at MinimumCapacity fit the budget exactly: the debt is repaid
+                Assert::IsTrue(memory_remaining.get() >= 0LL);
+                for (const auto& series : connections) {
+                    Assert::IsTrue(series->size() > 0);
+                }
+            }
+            Assert::AreEqual(budget, memory_remaining.get());
+        }
     };
 }
\ No newline at end of file
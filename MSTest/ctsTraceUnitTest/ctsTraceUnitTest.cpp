@@ -0,0 +1,92 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#include <SDKDDKVer.h>
+#include "CppUnitTest.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include <ctVersionConversion.hpp>
+
+#include "ctsTrace.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+using namespace ctsTraffic;
+namespace ctsUnitTest {
+    TEST_CLASS(ctsTraceUnitTest)
+    {
+    private:
+        static const wchar_t* TestTraceFilename;
+
+        static std::string ReadTraceFile()
+        {
+            std::ifstream trace_file(TestTraceFilename);
+            return std::string(std::istreambuf_iterator<char>(trace_file), std::istreambuf_iterator<char>());
+        }
+
+    public:
+        TEST_CLASS_CLEANUP(Cleanup)
+        {
+            ::DeleteFileW(TestTraceFilename);
+        }
+
+        TEST_METHOD(RecordsPerThreadEvents)
+        {
+            // other tests may have recorded events on this thread already
+            const unsigned long long initial_count = ctsTrace::Export(TestTraceFilename);
+
+            std::thread first_thread([] {
+                for (long long value = 0; value < 5; ++value) {
+                    ctsTracePoint("ctsTraceUnitTest::first", nullptr, "value", value, "unused", 0);
+                }
+            });
+            first_thread.join();
+
+            Assert::AreEqual(initial_count + 5ULL, ctsTrace::Export(TestTraceFilename));
+
+            const std::string trace_text(ReadTraceFile());
+            Assert::IsTrue(trace_text.find("\"traceEvents\"") != std::string::npos);
+            Assert::IsTrue(trace_text.find("ctsTraceUnitTest::first") != std::string::npos);
+            Assert::IsTrue(trace_text.find("\"ph\":\"i\"") != std::string::npos);
+        }
+
+        TEST_METHOD(WrappedBufferKeepsNewestEvents)
+        {
+            const unsigned long long initial_count = ctsTrace::Export(TestTraceFilename);
+
+            std::thread wrapping_thread([] {
+                for (unsigned long value = 0; value < ctsTrace::EventsPerThread + 7; ++value) {
+                    ctsTraceCounter("ctsTraceUnitTest::wrapping", "value", value, "unused", 0);
+                }
+            });
+            wrapping_thread.join();
+
+            // only the most recent EventsPerThread events are kept
+            Assert::AreEqual(initial_count + ctsTrace::EventsPerThread, ctsTrace::Export(TestTraceFilename));
+
+            const std::string trace_text(ReadTraceFile());
+            Assert::IsTrue(trace_text.find("\"ph\":\"C\"") != std::string::npos);
+            const std::string newest_value("\"value\":" + std::to_string(ctsTrace::EventsPerThread + 6));
+            Assert::IsTrue(trace_text.find(newest_value) != std::string::npos);
+            // the first 7 events were overwritten
+            Assert::IsTrue(trace_text.find("\"value\":6,") == std::string::npos);
+            Assert::IsTrue(trace_text.find("\"value\":7,") != std::string::npos);
+        }
+    };
+
+    const wchar_t* ctsTraceUnitTest::TestTraceFilename = L"ctsTraceUnitTest.trace.json";
+}
@@ -0,0 +1,257 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <cstring>
+// os headers
+#include <Windows.h>
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+// ctl headers
+#include "ctVersionConversion.hpp"
+
+namespace ctl {
+
+    /// A seekable stream of pseudo-random bytes
+    ///
+    /// The stream is counter-based: the 8 bytes at stream offset (8 * N) are a pure function of
+    /// the stream's key and N. Any range of the stream can be generated - or regenerated to verify
+    /// it - without generating what precedes it, and without any state beyond the 8-byte key.
+    ///
+    /// Each 64-bit word is the SplitMix64 output for counter N:
+    ///   word(N) == mix(key + (N + 1) * gamma)
+    /// - SplitMix64 passes BigCrush: the bytes are incompressible, though not cryptographically strong
+    /// - the key is derived from a 64-bit seed and any number of key bytes (for example a connection id)
+    ///   streams with different keys are different (distant) positions within one 2^64 word sequence
+    ///
+    /// On processors with AVX2, fill() and compare() generate 8 words (64 bytes) per iteration
+    /// - AVX2 has no 64-bit multiply: each is built from three 32-bit multiplies, still ~1.5x the scalar rate
+    /// - the instructions are only executed after checking CPUID, so no /arch:AVX2 build is needed
+    class ctRandomStream {
+    public:
+        /// The stream for a seed alone
+        explicit ctRandomStream(unsigned long long _seed = 0ULL) NOEXCEPT;
+
+        /// The stream for a seed and a key (for example, a connection id)
+        ctRandomStream(unsigned long long _seed, _In_reads_bytes_(_key_length) const void* _key, size_t _key_length) NOEXCEPT;
+
+        /// The 8 bytes at stream offset (_word_index * 8), in little-endian order
+        unsigned long long word(unsigned long long _word_index) const NOEXCEPT;
+
+        /// Writes bytes [_stream_offset, _stream_offset + _length) of the stream into _buffer
+        void fill(_Out_writes_bytes_(_length) void* _buffer, size_t _length, unsigned long long _stream_offset) const NOEXCEPT;
+
+        /// Returns the number of leading bytes of _buffer which match the stream from _stream_offset
+        /// - returns _length when every byte matches (as does RtlCompareMemory)
+        size_t compare(_In_reads_bytes_(_length) const void* _buffer, size_t _length, unsigned long long _stream_offset) const NOEXCEPT;
+
+        bool operator==(const ctRandomStream& _other) const NOEXCEPT
+        {
+            return (this->key == _other.key);
+        }
+        bool operator!=(const ctRandomStream& _other) const NOEXCEPT
+        {
+            return !(*this == _other);
+        }
+
+        /// true if fill() and compare() are using the AVX2 instructions on this processor
+        static bool UsesAvx2() NOEXCEPT;
+
+    private:
+        static const unsigned long long Gamma = 0x9e3779b97f4a7c15ULL;
+        static const unsigned long long Multiplier1 = 0xbf58476d1ce4e5b9ULL;
+        static const unsigned long long Multiplier2 = 0x94d049bb133111ebULL;
+        static const size_t WordSize = sizeof(unsigned long long);
+        // the bytes generated per iteration of the AVX2 loop
+        static const size_t BlockSize = 8 * WordSize;
+        // compare() regenerates the stream this many bytes at a time
+        static const size_t CompareChunkSize = 512;
+
+        unsigned long long key;
+
+        static unsigned long long Mix(unsigned long long _value) NOEXCEPT
+        {
+            _value = (_value ^ (_value >> 30)) * Multiplier1;
+            _value = (_value ^ (_value >> 27)) * Multiplier2;
+            return _value ^ (_value >> 31);
+        }
+
+        // the counter for word N
+        unsigned long long counter(unsigned long long _word_index) const NOEXCEPT
+        {
+            return this->key + (_word_index + 1) * Gamma;
+        }
+
+        // writes _block_count blocks of BlockSize bytes starting at _counter, returns the counter following them
+        static unsigned long long FillBlocksAvx2(_Out_writes_bytes_(_block_count * BlockSize) unsigned char* _output, size_t _block_count, unsigned long long _counter) NOEXCEPT;
+    };
+
+
+    // Implementation
+
+    inline ctRandomStream::ctRandomStream(unsigned long long _seed) NOEXCEPT :
+        key(Mix(_seed))
+    {
+    }
+
+    inline ctRandomStream::ctRandomStream(unsigned long long _seed, _In_reads_bytes_(_key_length) const void* _key, size_t _key_length) NOEXCEPT :
+        key(Mix(_seed))
+    {
+        // fold the key bytes in 8 at a time, mixing after each: reordered key bytes give a different stream
+        const unsigned char* key_bytes = static_cast<const unsigned char*>(_key);
+        while (_key_length > 0) {
+            unsigned long long key_word = 0ULL;
+            const size_t copy_length = (_key_length < WordSize) ? _key_length : WordSize;
+            ::memcpy(&key_word, key_bytes, copy_length);
+            this->key = Mix(this->key ^ key_word) + Gamma;
+            key_bytes += copy_length;
+            _key_length -= copy_length;
+        }
+    }
+
+    inline unsigned long long ctRandomStream::word(unsigned long long _word_index) const NOEXCEPT
+    {
+        return Mix(this->counter(_word_index));
+    }
+
+    inline void ctRandomStream::fill(_Out_writes_bytes_(_length) void* _buffer, size_t _length, unsigned long long _stream_offset) const NOEXCEPT
+    {
+        unsigned char* output = static_cast<unsigned char*>(_buffer);
+        unsigned long long word_index = _stream_offset / WordSize;
+
+        // a stream offset within a word starts with the tail of that word
+        const size_t leading_offset = static_cast<size_t>(_stream_offset % WordSize);
+        if (leading_offset != 0 && _length > 0) {
+            const unsigned long long leading_word = this->word(word_index);
+            const size_t leading_length = (_length < WordSize - leading_offset) ? _length : WordSize - leading_offset;
+            ::memcpy(output, reinterpret_cast<const unsigned char*>(&leading_word) + leading_offset, leading_length);
+            output += leading_length;
+            _length -= leading_length;
+            ++word_index;
+        }
+
+        unsigned long long counter = this->counter(word_index);
+        if (_length >= BlockSize && UsesAvx2()) {
+            const size_t block_count = _length / BlockSize;
+            counter = FillBlocksAvx2(output, block_count, counter);
+            output += block_count * BlockSize;
+            _length -= block_count * BlockSize;
+        }
+        while (_length > 0) {
+            const unsigned long long next_word = Mix(counter);
+            const size_t word_length = (_length < WordSize) ? _length : WordSize;
+            ::memcpy(output, &next_word, word_length);
+            counter += Gamma;
+            output += word_length;
+            _length -= word_length;
+        }
+    }
+
+    inline size_t ctRandomStream::compare(_In_reads_bytes_(_length) const void* _buffer, size_t _length, unsigned long long _stream_offset) const NOEXCEPT
+    {
+        const unsigned char* input = static_cast<const unsigned char*>(_buffer);
+        unsigned char expected[CompareChunkSize];
+
+        size_t length_matched = 0;
+        while (length_matched < _length) {
+            const size_t remaining = _length - length_matched;
+            const size_t compare_length = (remaining < CompareChunkSize) ? remaining : CompareChunkSize;
+            this->fill(expected, compare_length, _stream_offset + length_matched);
+            if (0 != ::memcmp(expected, input + length_matched, compare_length)) {
+                size_t chunk_matched = 0;
+                while (expected[chunk_matched] == input[length_matched + chunk_matched]) {
+                    ++chunk_matched;
+                }
+                return length_matched + chunk_matched;
+            }
+            length_matched += compare_length;
+        }
+        return length_matched;
+    }
+
+    inline bool ctRandomStream::UsesAvx2() NOEXCEPT
+    {
+#if defined(_M_IX86) || defined(_M_X64)
+        static const bool s_UsesAvx2 = [] () -> bool {
+            int cpu_info[4];
+            ::__cpuid(cpu_info, 0);
+            if (cpu_info[0] < 7) {
+                return false;
+            }
+            // the processor supports AVX and XSAVE, and the OS saves the YMM registers across context switches
+            ::__cpuid(cpu_info, 1);
+            const int avx_osxsave = (1 << 27) | (1 << 28);
+            if ((cpu_info[2] & avx_osxsave) != avx_osxsave || (::_xgetbv(0) & 0x6) != 0x6) {
+                return false;
+            }
+            ::__cpuidex(cpu_info, 7, 0);
+            return (cpu_info[1] & (1 << 5)) != 0;
+        }();
+        return s_UsesAvx2;
+#else
+        return false;
+#endif
+    }
+
+    inline unsigned long long ctRandomStream::FillBlocksAvx2(_Out_writes_bytes_(_block_count * BlockSize) unsigned char* _output, size_t _block_count, unsigned long long _counter) NOEXCEPT
+    {
+#if defined(_M_IX86) || defined(_M_X64)
+        // (a * b) mod 2^64 from 32-bit multiplies: lo(a) * lo(b) + ((hi(a) * lo(b) + lo(a) * hi(b)) << 32)
+        auto multiply = [] (__m256i _value, __m256i _multiplier_lo, __m256i _multiplier_hi) -> __m256i {
+            const __m256i low_product = _mm256_mul_epu32(_value, _multiplier_lo);
+            const __m256i cross_products = _mm256_add_epi64(
+                _mm256_mul_epu32(_mm256_srli_epi64(_value, 32), _multiplier_lo),
+                _mm256_mul_epu32(_value, _multiplier_hi));
+            return _mm256_add_epi64(low_product, _mm256_slli_epi64(cross_products, 32));
+        };
+        auto mix = [&multiply] (__m256i _value) -> __m256i {
+            const __m256i multiplier1_lo = _mm256_set1_epi64x(static_cast<long long>(Multiplier1 & 0xffffffffULL));
+            const __m256i multiplier1_hi = _mm256_set1_epi64x(static_cast<long long>(Multiplier1 >> 32));
+            const __m256i multiplier2_lo = _mm256_set1_epi64x(static_cast<long long>(Multiplier2 & 0xffffffffULL));
+            const __m256i multiplier2_hi = _mm256_set1_epi64x(static_cast<long long>(Multiplier2 >> 32));
+            _value = multiply(_mm256_xor_si256(_value, _mm256_srli_epi64(_value, 30)), multiplier1_lo, multiplier1_hi);
+            _value = multiply(_mm256_xor_si256(_value, _mm256_srli_epi64(_value, 27)), multiplier2_lo, multiplier2_hi);
+            return _mm256_xor_si256(_value, _mm256_srli_epi64(_value, 31));
+        };
+
+        // two independent vectors of 4 counters each: words [0, 4) and [4, 8) of every block
+        __m256i low_counters = _mm256_set_epi64x(
+            static_cast<long long>(_counter + 3 * Gamma),
+            static_cast<long long>(_counter + 2 * Gamma),
+            static_cast<long long>(_counter + Gamma),
+            static_cast<long long>(_counter));
+        const __m256i half_block_step = _mm256_set1_epi64x(static_cast<long long>(4 * Gamma));
+        const __m256i block_step = _mm256_set1_epi64x(static_cast<long long>(8 * Gamma));
+        __m256i high_counters = _mm256_add_epi64(low_counters, half_block_step);
+
+        for (size_t block = 0; block < _block_count; ++block) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output), mix(low_counters));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(_output + BlockSize / 2), mix(high_counters));
+            low_counters = _mm256_add_epi64(low_counters, block_step);
+            high_counters = _mm256_add_epi64(high_counters, block_step);
+            _output += BlockSize;
+        }
+        _mm256_zeroupper();
+        return _counter + _block_count * (BlockSize / WordSize) * Gamma;
+#else
+        UNREFERENCED_PARAMETER(_output);
+        UNREFERENCED_PARAMETER(_block_count);
+        return _counter;
+#endif
+    }
+
+} // namespace ctl
@@ -15,6 +15,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 // cpp headers
 #include <algorithm>
+#include <functional>
 #include <string>
 #include <vector>
 // os headers
@@ -42,6 +43,8 @@ namespace ctl {
 
     static const DWORD IP_STRING_MAX_LENGTH = 65;
 
+    class ctSockaddrKey;
+
     class ctSockaddr {
     public:
 
@@ -88,6 +91,9 @@ namespace ctl {
 
         void swap(_Inout_ ctSockaddr&) NOEXCEPT;
 
+        // the compact, hashed form of this address for lookups and comparisons
+        ctSockaddrKey key() const NOEXCEPT;
+
         bool setSocketAddress(SOCKET) NOEXCEPT;
 
         void setSockaddr(_In_reads_bytes_(length) const SOCKADDR*, int length) NOEXCEPT;
@@ -104,6 +110,7 @@ namespace ctl {
         void mapDualMode4To6() NOEXCEPT;
 
         // setting by string returns a bool if was able to convert to an address
+        // - literal addresses without a scope id are converted in place, only scoped addresses need GetAddrInfo
         bool setAddress(_In_ PCWSTR) NOEXCEPT;
         bool setAddress(_In_ LPCSTR) NOEXCEPT;
 
@@ -126,6 +133,7 @@ namespace ctl {
         bool writeAddress(WCHAR (&address)[IP_STRING_MAX_LENGTH]) const NOEXCEPT;
         bool writeAddress(CHAR (&address)[IP_STRING_MAX_LENGTH]) const NOEXCEPT;
         // writeCompleteAddress prints the IP address, scope, and port
+        // - the same strings as WSAAddressToString, formatted directly instead of through the Winsock provider
         std::wstring writeCompleteAddress(bool trim_scope = false) const;
         bool writeCompleteAddress(WCHAR (&address)[IP_STRING_MAX_LENGTH], bool trim_scope = false) const NOEXCEPT;
         bool writeCompleteAddress(CHAR (&address)[IP_STRING_MAX_LENGTH], bool trim_scope = false) const NOEXCEPT;
@@ -152,6 +160,52 @@ namespace ctl {
         SOCKADDR_STORAGE saddr;
     };
 
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctSockaddrKey
+    /// - a normalized IPv4 or IPv6 endpoint: the family, 16 address bytes, port, and scope id
+    ///   the flow info and the unused bytes of the SOCKADDR_STORAGE are not part of the key
+    /// - 32 bytes instead of the 128 byte SOCKADDR_STORAGE, so it is cheap to copy and to scan in a vector
+    /// - the 64-bit hash is computed once when the key is built:
+    ///   hashing is a load, and equality compares the hashes before comparing the endpoints
+    ///
+    /// IPv4 addresses are stored in the first 4 address bytes, the remaining bytes are zero
+    /// - IPv4 and v4-mapped IPv6 addresses are different keys, as they are different ctSockaddr objects
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctSockaddrKey {
+    public:
+        ctSockaddrKey() NOEXCEPT;
+        explicit ctSockaddrKey(const ctSockaddr&) NOEXCEPT;
+
+        bool operator==(const ctSockaddrKey&) const NOEXCEPT;
+        bool operator!=(const ctSockaddrKey&) const NOEXCEPT;
+        // a total order: by family, then address bytes (in network order), then scope id, then port
+        bool operator< (const ctSockaddrKey&) const NOEXCEPT;
+
+        unsigned long long hash() const NOEXCEPT;
+        short              family() const NOEXCEPT;
+        unsigned short     port() const NOEXCEPT;
+        unsigned long      scopeId() const NOEXCEPT;
+        // rebuilds the full address (without flow info) to pass to Winsock
+        ctSockaddr         sockaddr() const NOEXCEPT;
+
+    private:
+        // compared and hashed as one block of 24 bytes: the layout must not have padding
+        struct Endpoint {
+            unsigned char address[16];
+            unsigned long scope_id;
+            unsigned short family;
+            // network byte order, as in the SOCKADDR
+            unsigned short port;
+        };
+        Endpoint endpoint;
+        unsigned long long hash_value;
+
+        static unsigned long long HashEndpoint(const Endpoint&) NOEXCEPT;
+    };
+    static_assert(sizeof(ctSockaddrKey) == 32, "ctSockaddrKey must stay packed into 32 bytes");
+
     //
     // non-member swap
     //
@@ -353,6 +407,11 @@ namespace ctl {
         swap(saddr, inAddr.saddr);
     }
 
+    inline ctSockaddrKey ctSockaddr::key() const NOEXCEPT
+    {
+        return ctSockaddrKey(*this);
+    }
+
     inline bool ctSockaddr::setSocketAddress(SOCKET s) NOEXCEPT
     {
         int namelen = this->length();
@@ -479,6 +538,19 @@ namespace ctl {
 
     inline bool ctSockaddr::setAddress(_In_ LPCWSTR wszAddr) NOEXCEPT
     {
+        IN_ADDR v4_addr;
+        if (1 == ::InetPtonW(AF_INET, wszAddr, &v4_addr)) {
+            this->reset(AF_INET);
+            this->setAddress(&v4_addr);
+            return true;
+        }
+        IN6_ADDR v6_addr;
+        if (1 == ::InetPtonW(AF_INET6, wszAddr, &v6_addr)) {
+            this->reset(AF_INET6);
+            this->setAddress(&v6_addr);
+            return true;
+        }
+
         ADDRINFOW addr_hints;
         ::ZeroMemory(&addr_hints, sizeof(addr_hints));
         addr_hints.ai_flags = AI_NUMERICHOST;
@@ -495,6 +567,19 @@ namespace ctl {
 
     inline bool ctSockaddr::setAddress(_In_ LPCSTR szAddr) NOEXCEPT
     {
+        IN_ADDR v4_addr;
+        if (1 == ::InetPtonA(AF_INET, szAddr, &v4_addr)) {
+            this->reset(AF_INET);
+            this->setAddress(&v4_addr);
+            return true;
+        }
+        IN6_ADDR v6_addr;
+        if (1 == ::InetPtonA(AF_INET6, szAddr, &v6_addr)) {
+            this->reset(AF_INET6);
+            this->setAddress(&v6_addr);
+            return true;
+        }
+
         ADDRINFOA addr_hints;
         ::ZeroMemory(&addr_hints, sizeof(addr_hints));
         addr_hints.ai_flags = AI_NUMERICHOST;
@@ -574,67 +659,59 @@ namespace ctl {
         return_string[IP_STRING_MAX_LENGTH - 1] = L'\0';
         return return_string;
     }
+    //
+    // IPv4: address or address:port
+    // IPv6: address%scope or [address%scope]:port
+    // - the port is only written when non-zero, the scope only when non-zero and not trimmed
+    //
     inline bool ctSockaddr::writeCompleteAddress(WCHAR (&address)[IP_STRING_MAX_LENGTH], bool trim_scope) const NOEXCEPT
     {
-        ::ZeroMemory(address, IP_STRING_MAX_LENGTH * sizeof(WCHAR));
+        WCHAR ip_string[IP_STRING_MAX_LENGTH];
+        if (!this->writeAddress(ip_string)) {
+            ::ZeroMemory(address, IP_STRING_MAX_LENGTH * sizeof(WCHAR));
+            return false;
+        }
 
-        DWORD addressLength = IP_STRING_MAX_LENGTH;
-        if (0 == ::WSAAddressToStringW(this->sockaddr(), static_cast<DWORD>(SADDR_SIZE), nullptr, address, &addressLength)) {
-            if ((this->family() == AF_INET6) && trim_scope) {
-                WCHAR* end = address + addressLength;
-                WCHAR* scope_ptr = std::find(address, end, L'%');
-                if (scope_ptr != end) {
-                    const WCHAR* move_ptr = std::find(address, end, L']');
-                    if (move_ptr != end) {
-                        while (move_ptr != end) {
-                            *scope_ptr = *move_ptr;
-                            ++scope_ptr;
-                            ++move_ptr;
-                        }
-                    } else {
-                        // no port was appended
-                        while (scope_ptr != end) {
-                            *scope_ptr = L'\0';
-                            ++scope_ptr;
-                        }
-                    }
-                }
-            }
-            return true;
+        // '%' and up to 10 digits
+        WCHAR scope_string[12] = L"";
+        if (!trim_scope && this->scopeId() != 0) {
+            ::swprintf_s(scope_string, L"%%%lu", this->scopeId());
         }
-        return false;
+
+        int written;
+        if (0 == this->port()) {
+            written = ::swprintf_s(address, L"%ws%ws", ip_string, scope_string);
+        } else if (AF_INET6 == this->family()) {
+            written = ::swprintf_s(address, L"[%ws%ws]:%u", ip_string, scope_string, this->port());
+        } else {
+            written = ::swprintf_s(address, L"%ws:%u", ip_string, this->port());
+        }
+        return (written > 0);
     }
 
     inline bool ctSockaddr::writeCompleteAddress(CHAR (&address)[IP_STRING_MAX_LENGTH], bool trim_scope) const NOEXCEPT
     {
-        ::ZeroMemory(address, IP_STRING_MAX_LENGTH * sizeof(CHAR));
+        CHAR ip_string[IP_STRING_MAX_LENGTH];
+        if (!this->writeAddress(ip_string)) {
+            ::ZeroMemory(address, IP_STRING_MAX_LENGTH * sizeof(CHAR));
+            return false;
+        }
 
-        DWORD addressLength = IP_STRING_MAX_LENGTH;
-#pragma warning( suppress : 4996) 
-        if (0 == ::WSAAddressToStringA(this->sockaddr(), static_cast<DWORD>(SADDR_SIZE), nullptr, address, &addressLength)) {
-            if ((this->family() == AF_INET6) && trim_scope) {
-                CHAR* end = address + addressLength;
-                CHAR* scope_ptr = std::find(address, end, '%');
-                if (scope_ptr != end) {
-                    const CHAR* move_ptr = std::find(address, end, ']');
-                    if (move_ptr != end) {
-                        while (move_ptr != end) {
-                            *scope_ptr = *move_ptr;
-                            ++scope_ptr;
-                            ++move_ptr;
-                        }
-                    } else {
-                        // no port was appended
-                        while (scope_ptr != end) {
-                            *scope_ptr = '\0';
-                            ++scope_ptr;
-                        }
-                    }
-                }
-            }
-            return true;
+        // '%' and up to 10 digits
+        CHAR scope_string[12] = "";
+        if (!trim_scope && this->scopeId() != 0) {
+            ::sprintf_s(scope_string, "%%%lu", this->scopeId());
         }
-        return false;
+
+        int written;
+        if (0 == this->port()) {
+            written = ::sprintf_s(address, "%s%s", ip_string, scope_string);
+        } else if (AF_INET6 == this->family()) {
+            written = ::sprintf_s(address, "[%s%s]:%u", ip_string, scope_string, this->port());
+        } else {
+            written = ::sprintf_s(address, "%s:%u", ip_string, this->port());
+        }
+        return (written > 0);
     }
 
     inline int ctSockaddr::length() const NOEXCEPT
@@ -705,6 +782,118 @@ namespace ctl {
         return const_cast<IN6_ADDR*>(&(addr_in6->sin6_addr));
     }
 
+
+    inline ctSockaddrKey::ctSockaddrKey() NOEXCEPT
+    {
+        ::ZeroMemory(&endpoint, sizeof(endpoint));
+        hash_value = HashEndpoint(endpoint);
+    }
+    inline ctSockaddrKey::ctSockaddrKey(const ctSockaddr& inAddr) NOEXCEPT
+    {
+        ::ZeroMemory(&endpoint, sizeof(endpoint));
+        endpoint.family = static_cast<unsigned short>(inAddr.family());
+        if (AF_INET == inAddr.family()) {
+            ::CopyMemory(endpoint.address, inAddr.in_addr(), sizeof(IN_ADDR));
+            endpoint.port = inAddr.sockaddr_in()->sin_port;
+        } else if (AF_INET6 == inAddr.family()) {
+            ::CopyMemory(endpoint.address, inAddr.in6_addr(), sizeof(IN6_ADDR));
+            endpoint.port = inAddr.sockaddr_in6()->sin6_port;
+            endpoint.scope_id = inAddr.scopeId();
+        }
+        hash_value = HashEndpoint(endpoint);
+    }
+
+    inline bool ctSockaddrKey::operator==(const ctSockaddrKey& _inKey) const NOEXCEPT
+    {
+        return (this->hash_value == _inKey.hash_value) &&
+               (0 == ::memcmp(&this->endpoint, &_inKey.endpoint, sizeof(Endpoint)));
+    }
+    inline bool ctSockaddrKey::operator!=(const ctSockaddrKey& _inKey) const NOEXCEPT
+    {
+        return !(*this == _inKey);
+    }
+    inline bool ctSockaddrKey::operator<(const ctSockaddrKey& rhs) const NOEXCEPT
+    {
+        if (this->endpoint.family != rhs.endpoint.family) {
+            return (this->endpoint.family < rhs.endpoint.family);
+        }
+        const int address_order = ::memcmp(this->endpoint.address, rhs.endpoint.address, sizeof(this->endpoint.address));
+        if (address_order != 0) {
+            return (address_order < 0);
+        }
+        if (this->endpoint.scope_id != rhs.endpoint.scope_id) {
+            return (this->endpoint.scope_id < rhs.endpoint.scope_id);
+        }
+        return (this->port() < rhs.port());
+    }
+
+    inline unsigned long long ctSockaddrKey::hash() const NOEXCEPT
+    {
+        return hash_value;
+    }
+    inline short ctSockaddrKey::family() const NOEXCEPT
+    {
+        return static_cast<short>(endpoint.family);
+    }
+    inline unsigned short ctSockaddrKey::port() const NOEXCEPT
+    {
+        return ::ntohs(endpoint.port);
+    }
+    inline unsigned long ctSockaddrKey::scopeId() const NOEXCEPT
+    {
+        return endpoint.scope_id;
+    }
+    inline ctSockaddr ctSockaddrKey::sockaddr() const NOEXCEPT
+    {
+        ctSockaddr return_addr(this->family());
+        if (AF_INET == endpoint.family) {
+            return_addr.setAddress(reinterpret_cast<const IN_ADDR*>(endpoint.address));
+        } else if (AF_INET6 == endpoint.family) {
+            return_addr.setAddress(reinterpret_cast<const IN6_ADDR*>(endpoint.address));
+            return_addr.setScopeId(endpoint.scope_id);
+        }
+        return_addr.setPort(endpoint.port, ByteOrder::NetworkOrder);
+        return return_addr;
+    }
+
+    inline unsigned long long ctSockaddrKey::HashEndpoint(const Endpoint& _endpoint) NOEXCEPT
+    {
+        // the 64-bit finalizer from MurmurHash3: every input bit can change every output bit,
+        // so both the high and the low bits of the hash are usable as an index
+        auto mix = [] (unsigned long long _value) -> unsigned long long {
+            _value ^= _value >> 33;
+            _value *= 0xff51afd7ed558ccdULL;
+            _value ^= _value >> 33;
+            _value *= 0xc4ceb9fe1a85ec53ULL;
+            _value ^= _value >> 33;
+            return _value;
+        };
+
+        static_assert(sizeof(Endpoint) == 3 * sizeof(unsigned long long), "Endpoint is hashed as 3 64-bit words");
+        unsigned long long words[3];
+        ::CopyMemory(words, &_endpoint, sizeof(words));
+        return mix(words[0] ^ mix(words[1] ^ mix(words[2])));
+    }
+
 } // namespace ctl
 
+namespace std {
+    template <>
+    struct hash<ctl::ctSockaddrKey> {
+        size_t operator()(const ctl::ctSockaddrKey& _key) const NOEXCEPT
+        {
+            return static_cast<size_t>(_key.hash());
+        }
+    };
+
+    // equal ctSockaddr objects always build equal keys
+    template <>
+    struct hash<ctl::ctSockaddr> {
+        size_t operator()(const ctl::ctSockaddr& _address) const NOEXCEPT
+        {
+            return static_cast<size_t>(_address.key().hash());
+        }
+    };
+}
+
 #pragma prefast(pop)
@@ -14,8 +14,10 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #pragma once
 
 // cpp headers
+#include <cstddef>
+#include <new>
 #include <utility>
-#include <functional>
+#include <type_traits>
 // os headers
 #include <excpt.h>
 #include <Windows.h>
@@ -30,24 +32,186 @@ namespace ctl {
     //
     // not using an unnamed namespace as debugging this is unnecessarily difficult with Windows debuggers
     //
-    //
-    // typedef used for the std::function to be given to ctThreadIocpCallbackInfo
-    // - constructed by ctThreadIocp
-    //
-    typedef std::function<void(OVERLAPPED*)> ctThreadIocpCallback_t;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctThreadIocpCallback
+    ///
+    /// A move-only callable with the signature void(OVERLAPPED*), invoked when an IO request completes
+    /// - callables up to InlineCallbackSize bytes are constructed within the object: no heap allocation
+    ///   e.g. a lambda capturing a weak_ptr and an IO task by value
+    /// - larger callables (or those which might throw when moved) are moved to the heap, as std::function would
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctThreadIocpCallback {
+    public:
+        static const size_t InlineCallbackSize = 128;
+
+        ctThreadIocpCallback() NOEXCEPT :
+            operations(nullptr)
+        {
+        }
+
+        // can throw std::bad_alloc if the callable doesn't fit within InlineCallbackSize
+        template <typename Functor, typename = typename std::enable_if<!std::is_same<typename std::decay<Functor>::type, ctThreadIocpCallback>::value>::type>
+        ctThreadIocpCallback(Functor&& _functor) :
+            operations(nullptr)
+        {
+            this->assign(std::forward<Functor>(_functor));
+        }
+
+        ctThreadIocpCallback(ctThreadIocpCallback&& _other) NOEXCEPT :
+            operations(nullptr)
+        {
+            this->move_from(_other);
+        }
+
+        ctThreadIocpCallback& operator=(ctThreadIocpCallback&& _other) NOEXCEPT
+        {
+            if (this != &_other) {
+                this->reset();
+                this->move_from(_other);
+            }
+            return *this;
+        }
+
+        ~ctThreadIocpCallback() NOEXCEPT
+        {
+            this->reset();
+        }
+
+        // non-copyable
+        ctThreadIocpCallback(const ctThreadIocpCallback&) = delete;
+        ctThreadIocpCallback& operator=(const ctThreadIocpCallback&) = delete;
+
+        // replaces any prior callable
+        // - can throw std::bad_alloc if the callable doesn't fit within InlineCallbackSize
+        template <typename Functor>
+        void assign(Functor&& _functor)
+        {
+            typedef typename std::decay<Functor>::type functor_t;
+            this->reset();
+            this->construct<functor_t>(std::forward<Functor>(_functor), StoredInline<functor_t>());
+        }
+
+        void reset() NOEXCEPT
+        {
+            if (this->operations != nullptr) {
+                this->operations->destroy(&this->storage);
+                this->operations = nullptr;
+            }
+        }
+
+        explicit operator bool() const NOEXCEPT
+        {
+            return this->operations != nullptr;
+        }
+
+        void operator()(OVERLAPPED* _overlapped)
+        {
+            this->operations->invoke(&this->storage, _overlapped);
+        }
+
+    private:
+        struct Operations {
+            void (*invoke)(void* _storage, OVERLAPPED* _overlapped);
+            // move-constructs the callable into _destination, then destroys the callable in _source
+            void (*relocate)(void* _destination, void* _source);
+            void (*destroy)(void* _storage);
+        };
+
+        template <typename Functor>
+        using StoredInline = std::integral_constant<bool,
+            sizeof(Functor) <= InlineCallbackSize &&
+            alignof(Functor) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible<Functor>::value>;
+
+        template <typename Functor>
+        struct InlineOperations {
+            static void invoke(void* _storage, OVERLAPPED* _overlapped)
+            {
+                (*static_cast<Functor*>(_storage))(_overlapped);
+            }
+            static void relocate(void* _destination, void* _source)
+            {
+                new (_destination) Functor(std::move(*static_cast<Functor*>(_source)));
+                static_cast<Functor*>(_source)->~Functor();
+            }
+            static void destroy(void* _storage)
+            {
+                static_cast<Functor*>(_storage)->~Functor();
+            }
+            static const Operations* table() NOEXCEPT
+            {
+                static const Operations operations_table = { invoke, relocate, destroy };
+                return &operations_table;
+            }
+        };
+
+        // the storage holds only the pointer to the callable
+        template <typename Functor>
+        struct HeapOperations {
+            static void invoke(void* _storage, OVERLAPPED* _overlapped)
+            {
+                (**static_cast<Functor**>(_storage))(_overlapped);
+            }
+            static void relocate(void* _destination, void* _source)
+            {
+                *static_cast<Functor**>(_destination) = *static_cast<Functor**>(_source);
+            }
+            static void destroy(void* _storage)
+            {
+                delete *static_cast<Functor**>(_storage);
+            }
+            static const Operations* table() NOEXCEPT
+            {
+                static const Operations operations_table = { invoke, relocate, destroy };
+                return &operations_table;
+            }
+        };
+
+        template <typename Functor, typename Argument>
+        void construct(Argument&& _functor, std::true_type /*stored inline*/)
+        {
+            new (&this->storage) Functor(std::forward<Argument>(_functor));
+            this->operations = InlineOperations<Functor>::table();
+        }
+
+        template <typename Functor, typename Argument>
+        void construct(Argument&& _functor, std::false_type /*stored inline*/)
+        {
+            *reinterpret_cast<Functor**>(&this->storage) = new Functor(std::forward<Argument>(_functor));
+            this->operations = HeapOperations<Functor>::table();
+        }
+
+        void move_from(ctThreadIocpCallback& _other) NOEXCEPT
+        {
+            if (_other.operations != nullptr) {
+                _other.operations->relocate(&this->storage, &_other.storage);
+                this->operations = _other.operations;
+                _other.operations = nullptr;
+            }
+        }
+
+        const Operations* operations;
+        typename std::aligned_storage<InlineCallbackSize, alignof(std::max_align_t)>::type storage;
+    };
+
     //
     // structure passed to the ctThreadIocp IO completion function
     // - to allow the callback function to find the callback
     //   associated with that completed OVERLAPPED* 
+    // - owned by the ctThreadIocp: reused for another request once the callback completes
     //
     struct ctThreadIocpCallbackInfo {
         OVERLAPPED ov;
-        PVOID _padding; // required padding before the std::function for the below C_ASSERT alignment/sizing to be correct
-        ctThreadIocpCallback_t callback;
+        // links the requests the ctThreadIocp holds for reuse
+        ctThreadIocpCallbackInfo* next_free_request;
+        ctThreadIocpCallback callback;
 
-        // ReSharper disable once CppPossiblyUninitializedMember
-        explicit ctThreadIocpCallbackInfo(ctThreadIocpCallback_t&& _callback)
-        : callback(std::move(_callback))
+        ctThreadIocpCallbackInfo() NOEXCEPT :
+            next_free_request(nullptr),
+            callback()
         {
             ::ZeroMemory(&ov, sizeof ov);
         }
@@ -57,7 +221,7 @@ namespace ctl {
         ctThreadIocpCallbackInfo& operator=(const ctThreadIocpCallbackInfo&) = delete;
     };
     // asserting at compile time, as we assume this when we reinterpret_cast in the callback
-    C_ASSERT(sizeof(ctThreadIocpCallbackInfo) == sizeof(OVERLAPPED) +sizeof(PVOID) +sizeof(ctThreadIocpCallback_t));
+    C_ASSERT(offsetof(ctThreadIocpCallbackInfo, ov) == 0);
 
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -82,6 +246,10 @@ namespace ctl {
     ///    - that OVERLAPPED* is no longer valid and cannot be reused 
     ///      [new_request must be called again for another OVLERAPPED*]
     ///
+    /// Requests are reused: each ctThreadIocp keeps the requests whose callbacks have completed (or were canceled)
+    /// - once as many requests have been allocated as the most IO ever in flight at once, new_request no longer allocates
+    /// - callbacks small enough to be stored inline in the request are not allocated either (see ctThreadIocpCallback)
+    ///
     /// Additional notes regarding OVERLAPPED I/O:
     /// - the user must call new_request to get a new OVERLAPPED* before every Win32 API being made
     ///   - an OVERLAPPED* is valid only for that one API call and is invalid once the corresponding callback completes
@@ -98,7 +266,7 @@ namespace ctl {
         //
         explicit ctThreadIocp(_In_ HANDLE _handle, _In_opt_ PTP_CALLBACK_ENVIRON _ptp_env = nullptr)
         {
-            ptp_io = ::CreateThreadpoolIo(_handle, IoCompletionCallback, nullptr, _ptp_env);
+            ptp_io = ::CreateThreadpoolIo(_handle, IoCompletionCallback, this, _ptp_env);
             if (nullptr == ptp_io) {
                 throw ctException(::GetLastError(), L"CreateThreadpoolIo", L"ctl::ctThreadIocp::ctThreadIocp", false);
             }
@@ -106,7 +274,7 @@ namespace ctl {
 
         explicit ctThreadIocp(_In_ SOCKET _socket, _In_opt_ PTP_CALLBACK_ENVIRON _ptp_env = nullptr)
         {
-            ptp_io = ::CreateThreadpoolIo(reinterpret_cast<HANDLE>(_socket), IoCompletionCallback, nullptr, _ptp_env);
+            ptp_io = ::CreateThreadpoolIo(reinterpret_cast<HANDLE>(_socket), IoCompletionCallback, this, _ptp_env);
             if (nullptr == ptp_io) {
                 throw ctException(::GetLastError(), L"CreateThreadpoolIo", L"ctl::ctThreadIocp::ctThreadIocp", false);
             }
@@ -116,10 +284,17 @@ namespace ctl {
             // wait for all callbacks
             ::WaitForThreadpoolIoCallbacks(this->ptp_io, FALSE);
             ::CloseThreadpoolIo(this->ptp_io);
+
+            // all callbacks have completed: every request is back in the free list
+            while (this->free_requests != nullptr) {
+                ctThreadIocpCallbackInfo* free_request = this->free_requests;
+                this->free_requests = free_request->next_free_request;
+                delete free_request;
+            }
         }
         //
         // new_request is expected to be called before each call to a Win32 function taking an OVLERAPPED*
-        // - which the caller expects to have their std::function invoked with the following signature:
+        // - which the caller expects to have their callable invoked with the following signature:
         //     void callback_function(OVERLAPPED* _overlapped)
         //
         // The OVERLAPPED* returned is always owned by the object - never by the caller
@@ -137,10 +312,18 @@ namespace ctl {
         // - each call will return a unique OVERLAPPED*
         // - the callback will be given the OVERLAPPED* matching the IO that completed
         //
-        OVERLAPPED* new_request(std::function<void(OVERLAPPED*)> _callback)
+        template <typename Functor>
+        OVERLAPPED* new_request(Functor&& _callback)
         {
             // this can fail by throwing std::bad_alloc
-            ctThreadIocpCallbackInfo* new_callback = new ctThreadIocpCallbackInfo(std::move(_callback));
+            ctThreadIocpCallbackInfo* new_callback = this->allocate_request();
+            try {
+                new_callback->callback.assign(std::forward<Functor>(_callback));
+            }
+            catch (...) {
+                this->release_request(new_callback);
+                throw;
+            }
             // once creating a new request succeeds, start the IO
             // - all below calls are no-fail calls
             ::StartThreadpoolIo(this->ptp_io);
@@ -159,7 +342,7 @@ namespace ctl {
         {
             ::CancelThreadpoolIo(this->ptp_io);
             ctThreadIocpCallbackInfo* old_request = reinterpret_cast<ctThreadIocpCallbackInfo*>(_pov);
-            delete old_request;
+            this->release_request(old_request);
         }
 
         //
@@ -173,9 +356,42 @@ namespace ctl {
     private:
         PTP_IO ptp_io = nullptr;
 
+        SRWLOCK free_requests_lock = SRWLOCK_INIT;
+        _Guarded_by_(free_requests_lock)
+        ctThreadIocpCallbackInfo* free_requests = nullptr;
+
+        // reuses a completed request if available
+        // - can throw std::bad_alloc
+        ctThreadIocpCallbackInfo* allocate_request()
+        {
+            ::AcquireSRWLockExclusive(&this->free_requests_lock);
+            ctThreadIocpCallbackInfo* request = this->free_requests;
+            if (request != nullptr) {
+                this->free_requests = request->next_free_request;
+            }
+            ::ReleaseSRWLockExclusive(&this->free_requests_lock);
+
+            if (nullptr == request) {
+                request = new ctThreadIocpCallbackInfo;
+            }
+            request->next_free_request = nullptr;
+            return request;
+        }
+
+        // destroys the callback (and anything it captured) before the request is available for reuse
+        void release_request(_In_ ctThreadIocpCallbackInfo* _request) NOEXCEPT
+        {
+            _request->callback.reset();
+
+            ::AcquireSRWLockExclusive(&this->free_requests_lock);
+            _request->next_free_request = this->free_requests;
+            this->free_requests = _request;
+            ::ReleaseSRWLockExclusive(&this->free_requests_lock);
+        }
+
         static void CALLBACK IoCompletionCallback(
             PTP_CALLBACK_INSTANCE /*_instance*/,
-            PVOID /*_context*/,
+            PVOID _context,
             PVOID _overlapped,
             ULONG /*_ioresult*/,
             ULONG_PTR /*_numberofbytestransferred*/,
@@ -188,9 +404,11 @@ namespace ctl {
             // we're working really hard to break and never let TP swalling SEH exceptions
             EXCEPTION_POINTERS* exr = nullptr;
             __try {
+                // the ctThreadIocp is never destroyed from its own callbacks: its d'tor waits for all callbacks to complete
+                ctThreadIocp* this_ptr = static_cast<ctThreadIocp*>(_context);
                 ctThreadIocpCallbackInfo* _request = reinterpret_cast<ctThreadIocpCallbackInfo*>(_overlapped);
                 _request->callback(static_cast<OVERLAPPED*>(_overlapped));
-                delete _request;
+                this_ptr->release_request(_request);
             }
             // ReSharper disable once CppAssignedValueIsNeverUsed (exr is used in the except handler)
             __except ((exr = GetExceptionInformation()), EXCEPTION_EXECUTE_HANDLER)
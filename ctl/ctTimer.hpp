@@ -114,6 +114,16 @@ namespace ctl {
             return convert_hundredNs_relative_filetime(convert_msec_hundredNs(_milliseconds));
         }
         ///
+        /// convert_usec_relative_filetime
+        /// : converting microseconds to a 'relative' FILETIME
+        /// (FILETIME records time in one-hundred-nano-seconds)
+        ///
+        inline
+        FILETIME convert_usec_relative_filetime(long long _microseconds) NOEXCEPT
+        {
+            return convert_hundredNs_relative_filetime(_microseconds * 10LL);
+        }
+        ///
         /// convert_filetime_msec
         /// : converting FILETIME to milliseconds
         /// (FILETIME records time in one-hundred-nano-seconds)
@@ -128,6 +138,19 @@ namespace ctl {
             return convert_hundredNs_msec(ulong_integer.QuadPart);
         }
 
+        ///
+        /// convert_qpc_usec
+        /// : converting a QPC value to microseconds with the QPF it was taken with
+        /// - split into whole seconds and the remainder: (qpc * 1000000) would overflow after days of uptime
+        ///
+        inline
+        long long convert_qpc_usec(long long _qpc, long long _qpf) NOEXCEPT
+        {
+            const long long seconds = _qpc / _qpf;
+            const long long remainder = _qpc % _qpf;
+            return seconds * 1000000LL + (remainder * 1000000LL) / _qpf;
+        }
+
         namespace {
             ///
             /// InitOnce the QPF value as it won't change after the OS has booted
@@ -166,6 +189,24 @@ namespace ctl {
             // multiplying by 1000 as (qpc / qpf) == seconds
             return static_cast<long long>((qpc.QuadPart * 1000LL) / s_Qpf.QuadPart);
         }
+#endif
+        ///
+        /// Returns the current 'time' from QPC/QPF in terms of microseconds
+        /// - QPC is already calibrated and monotonic across processors
+        /// - leaving undefined for unit tests which need to control 'time' for their tests
+        ///
+#ifdef CTSTRAFFIC_UNIT_TESTS
+        inline
+        long long snap_qpc_as_usec() NOEXCEPT;
+#else
+        inline
+        long long snap_qpc_as_usec() NOEXCEPT
+        {
+            (void) ::InitOnceExecuteOnce(&s_QpfInitOnce, s_QpfInitOnceCallback, nullptr, nullptr);
+            LARGE_INTEGER qpc;
+            ::QueryPerformanceCounter(&qpc);
+            return convert_qpc_usec(qpc.QuadPart, s_Qpf.QuadPart);
+        }
 #endif
         ///
         /// Returns the current 'time' from QPC/QPF as a FILETIME
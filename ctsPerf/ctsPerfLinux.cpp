@@ -0,0 +1,1220 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+//
+// Linux backend for ctsPerf
+// - collects the Linux equivalents of the counters ctsPerf.cpp collects through WMI,
+//   sourced from /proc/stat, /proc/meminfo, /proc/net/snmp, /proc/net/netstat,
+//   /sys/class/net/*/statistics and /proc/<pid>/stat
+// - writes the same csv schema as ctsWriteDetails to ctsPerf.csv, ctsNetworking.csv and ctsPerProcess.csv
+//   (UTF-8 rather than UTF-16, as there's no consumer on Linux expecting a BOM)
+// - every file is opened once and re-read with pread() at offset 0 into a preallocated buffer
+//   and parsed in place, so each 1 second sample is a handful of syscalls and no allocations
+//
+// ctl is Windows-only, so this file depends only on the C++ runtime and POSIX
+// - it compiles to nothing in the Windows build, and is built on Linux with:
+//   g++ -std=c++14 -O2 -pthread ctsPerfLinux.cpp -o ctsPerf
+//
+#if defined(__linux__)
+
+// cpp headers
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <math.h>
+
+// os headers
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+namespace ctsPerf {
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsProcFile
+    /// - a procfs or sysfs file opened once and re-read from offset 0 on every sample
+    /// - the buffer only grows (if the contents ever outgrow it), so steady-state reads don't allocate
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsProcFile {
+    public:
+        explicit ctsProcFile(const string& _path, size_t _initial_size = 4096) :
+            path(_path),
+            buffer(_initial_size)
+        {
+            this->fd = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (-1 == this->fd) {
+                throw system_error(errno, generic_category(), "open(" + _path + ")");
+            }
+        }
+        ~ctsProcFile() noexcept
+        {
+            ::close(this->fd);
+        }
+        ctsProcFile(const ctsProcFile&) = delete;
+        ctsProcFile& operator=(const ctsProcFile&) = delete;
+
+        //
+        // returns the null-terminated contents, valid until the next call to read()
+        //
+        const char* read()
+        {
+            for (;;) {
+                ssize_t bytes_read = ::pread(this->fd, this->buffer.data(), this->buffer.size() - 1, 0);
+                if (bytes_read < 0) {
+                    if (EINTR == errno) {
+                        continue;
+                    }
+                    throw system_error(errno, generic_category(), "pread(" + this->path + ")");
+                }
+                // a full buffer means the contents may have been truncated
+                if (static_cast<size_t>(bytes_read) < this->buffer.size() - 1) {
+                    this->buffer[bytes_read] = '\0';
+                    return this->buffer.data();
+                }
+                this->buffer.resize(this->buffer.size() * 2);
+            }
+        }
+
+        // for sysfs attribute files holding a single value
+        unsigned long long read_value();
+
+    private:
+        string path;
+        vector<char> buffer;
+        int fd = -1;
+    };
+
+    namespace details {
+        inline const char* SkipSpaces(const char* _text) noexcept
+        {
+            while (' ' == *_text || '\t' == *_text) {
+                ++_text;
+            }
+            return _text;
+        }
+        inline const char* SkipToken(const char* _text) noexcept
+        {
+            _text = SkipSpaces(_text);
+            while (*_text != '\0' && *_text != ' ' && *_text != '\t' && *_text != '\n') {
+                ++_text;
+            }
+            return _text;
+        }
+        inline const char* NextLine(const char* _text) noexcept
+        {
+            const char* end_of_line = ::strchr(_text, '\n');
+            return (nullptr == end_of_line) ? nullptr : end_of_line + 1;
+        }
+        //
+        // parses the unsigned value at _text, returning the position just past it
+        // - the few counters which can be negative (e.g. Tcp MaxConn) are reported as 0
+        //
+        inline const char* ParseValue(const char* _text, unsigned long long* _value) noexcept
+        {
+            _text = SkipSpaces(_text);
+            const bool negative = ('-' == *_text);
+            if (negative) {
+                ++_text;
+            }
+            unsigned long long value = 0ULL;
+            while (*_text >= '0' && *_text <= '9') {
+                value = value * 10ULL + static_cast<unsigned long long>(*_text - '0');
+                ++_text;
+            }
+            *_value = negative ? 0ULL : value;
+            return _text;
+        }
+    }
+
+    unsigned long long ctsProcFile::read_value()
+    {
+        unsigned long long value;
+        details::ParseValue(this->read(), &value);
+        return value;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsProcNetTable
+    /// - /proc/net/snmp and /proc/net/netstat list each protocol as a pair of lines:
+    ///   "Tcp: RtoAlgorithm RtoMin ..." followed by "Tcp: 1 200 ..."
+    /// - the line and column of each requested field is resolved once from the header lines,
+    ///   each sample then only walks to those columns
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsProcNetTable {
+    public:
+        ctsProcNetTable(const char* _path, const vector<pair<string, string>>& _fields) :
+            file(_path)
+        {
+            const char* contents = this->file.read();
+            for (const char* line = contents; line != nullptr && *line != '\0'; line = details::NextLine(line)) {
+                this->line_starts.push_back(line);
+            }
+
+            for (const auto& field : _fields) {
+                bool found = false;
+                // header lines are the first of each pair
+                for (size_t header_line = 0; header_line + 1 < this->line_starts.size() && !found; header_line += 2) {
+                    const char* token = this->line_starts[header_line];
+                    const char* end_of_token = details::SkipToken(token);
+                    // the prefix token includes the trailing ':'
+                    if (static_cast<size_t>(end_of_token - token) != field.first.length() + 1 ||
+                        0 != ::strncmp(token, field.first.c_str(), field.first.length())) {
+                        continue;
+                    }
+
+                    for (size_t column = 0; *end_of_token != '\0' && *end_of_token != '\n'; ++column) {
+                        token = details::SkipSpaces(end_of_token);
+                        end_of_token = details::SkipToken(token);
+                        if (static_cast<size_t>(end_of_token - token) == field.second.length() &&
+                            0 == ::strncmp(token, field.second.c_str(), field.second.length())) {
+                            this->locations.emplace_back(header_line + 1, column);
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+                if (!found) {
+                    throw runtime_error(string("ctsProcNetTable: ") + _path + " does not contain " + field.first + ":" + field.second);
+                }
+            }
+        }
+
+        //
+        // refreshes the value of every field, in the order they were requested
+        //
+        void sample(vector<unsigned long long>& _values)
+        {
+            const char* contents = this->file.read();
+            this->line_starts.clear();
+            for (const char* line = contents; line != nullptr && *line != '\0'; line = details::NextLine(line)) {
+                this->line_starts.push_back(line);
+            }
+
+            _values.resize(this->locations.size());
+            for (size_t field = 0; field < this->locations.size(); ++field) {
+                const auto& location = this->locations[field];
+                if (location.first >= this->line_starts.size()) {
+                    _values[field] = 0ULL;
+                    continue;
+                }
+                // skip the prefix, then each preceding column
+                const char* value = details::SkipToken(this->line_starts[location.first]);
+                for (size_t column = 0; column < location.second; ++column) {
+                    value = details::SkipToken(value);
+                }
+                details::ParseValue(value, &_values[field]);
+            }
+        }
+
+    private:
+        ctsProcFile file;
+        // line_starts keeps its capacity across samples
+        vector<const char*> line_starts;
+        // pair<line, column>
+        vector<pair<size_t, size_t>> locations;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsWriteDetails
+    /// - writes the same rows and columns as the Windows ctsWriteDetails:
+    ///   "Class (Counter),SampleCount,Min,Max,-1Std,Mean,+1Std,-1IQR,Median,+1IQR"
+    ///   or "Class (Counter),SampleCount,Min,Max,Mean" with -MeanOnly
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsWriteDetails {
+    public:
+        explicit ctsWriteDetails(const char* _file_name) : file_name(_file_name)
+        {
+        }
+        ~ctsWriteDetails() noexcept
+        {
+            if (this->file != nullptr) {
+                ::fclose(this->file);
+            }
+        }
+        ctsWriteDetails(const ctsWriteDetails&) = delete;
+        ctsWriteDetails& operator=(const ctsWriteDetails&) = delete;
+
+        void create_file(bool _mean_only)
+        {
+            this->file = ::fopen(this->file_name.c_str(), "w");
+            if (nullptr == this->file) {
+                throw system_error(errno, generic_category(), "fopen(" + this->file_name + ")");
+            }
+            if (_mean_only) {
+                ::fputs("PerfCounter(CounterName),SampleCount,Min,Max,Mean\r\n", this->file);
+            } else {
+                ::fputs("PerfCounter(CounterName),SampleCount,Min,Max,-1Std,Mean,+1Std,-1IQR,Median,+1IQR\r\n", this->file);
+            }
+        }
+
+        void write_row(const string& _text) noexcept
+        {
+            ::fprintf(this->file, "%s\r\n", _text.c_str());
+        }
+        void write_empty_row() noexcept
+        {
+            ::fputs("\r\n", this->file);
+        }
+
+        //
+        // The vector *will* be sorted (this is why it's non-const).
+        //
+        void write_details(const string& _class_name, const string& _counter_name, vector<unsigned long long>& _data) noexcept
+        {
+            if (_data.empty()) {
+                return;
+            }
+            sort(_data.begin(), _data.end());
+            auto std_tuple = SampledStandardDeviation(_data);
+            auto interquartile_tuple = InterquartileRange(_data);
+
+            this->start_row(_class_name, _counter_name);
+            ::fprintf(this->file, ",%lu,%llu,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f",
+                static_cast<unsigned long>(_data.size()),
+                *_data.begin(), *_data.rbegin(),
+                get<0>(std_tuple), get<1>(std_tuple), get<2>(std_tuple),
+                get<0>(interquartile_tuple), get<1>(interquartile_tuple), get<2>(interquartile_tuple));
+            this->end_row();
+        }
+
+        void write_difference(const string& _class_name, const string& _counter_name, unsigned long long _count, unsigned long long _difference) noexcept
+        {
+            this->start_row(_class_name, _counter_name);
+            ::fprintf(this->file, ",%llu,%llu", _count, _difference);
+            this->end_row();
+        }
+
+        void write_mean(const string& _class_name, const string& _counter_name, unsigned long long _count, unsigned long long _min, unsigned long long _max, unsigned long long _mean) noexcept
+        {
+            this->start_row(_class_name, _counter_name);
+            ::fprintf(this->file, ",%llu,%llu,%llu,%llu", _count, _min, _max, _mean);
+            this->end_row();
+        }
+
+    private:
+        string file_name;
+        FILE* file = nullptr;
+
+        void start_row(const string& _class_name, const string& _counter_name) noexcept
+        {
+            string formatted_string(_class_name + " (" + _counter_name + ")");
+            // since writing to csv, can't embed a comma in the data
+            replace(formatted_string.begin(), formatted_string.end(), ',', '-');
+            ::fputs(formatted_string.c_str(), this->file);
+        }
+        void end_row() noexcept
+        {
+            ::fputs("\r\n", this->file);
+        }
+
+        // matches ctSampledStandardDeviation: returns <mean - 1 std, mean, mean + 1 std>
+        static tuple<double, double, double> SampledStandardDeviation(const vector<unsigned long long>& _data) noexcept
+        {
+            if (_data.size() == 1) {
+                return make_tuple(0.0, static_cast<double>(_data[0]), 0.0);
+            }
+            const double mean = accumulate(_data.begin(), _data.end(), 0.0) / static_cast<double>(_data.size());
+            double accum = 0.0;
+            for (const auto& value : _data) {
+                accum += (static_cast<double>(value) - mean) * (static_cast<double>(value) - mean);
+            }
+            const double stdev = ::sqrt(accum / (static_cast<double>(_data.size()) - 1.0));
+            return make_tuple(mean - stdev, mean, mean + stdev);
+        }
+
+        // matches ctInterquartileRange: the halves exclude the median when the count is odd
+        // ** Requires input to be sorted **
+        static tuple<double, double, double> InterquartileRange(const vector<unsigned long long>& _data) noexcept
+        {
+            if (_data.size() < 3) {
+                return make_tuple(0.0, 0.0, 0.0);
+            }
+            if (_data.size() == 3) {
+                return make_tuple(static_cast<double>(_data[0]), static_cast<double>(_data[1]), static_cast<double>(_data[2]));
+            }
+
+            auto median = [&_data] (size_t _begin, size_t _end) -> double {
+                const size_t count = _end - _begin;
+                const size_t middle = _begin + count / 2;
+                if (count % 2 == 1) {
+                    return static_cast<double>(_data[middle]);
+                }
+                // divide first to guard against overflow
+                return static_cast<double>(_data[middle - 1]) / 2.0 + static_cast<double>(_data[middle]) / 2.0;
+            };
+
+            const size_t half = _data.size() / 2;
+            const size_t upper_begin = (_data.size() % 2 == 1) ? half + 1 : half;
+            return make_tuple(median(0, half), median(0, _data.size()), median(upper_begin, _data.size()));
+        }
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsPerfCounter
+    /// - Detailed counters keep every sample (or only count/min/max/sum with -MeanOnly)
+    /// - Difference counters track cumulative values and only keep the first and last
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    enum class ctsPerfCounterType {
+        Detailed,
+        Difference
+    };
+
+    class ctsPerfCounter {
+    public:
+        ctsPerfCounter(const string& _class_name, const string& _counter_name, ctsPerfCounterType _type, bool _mean_only, size_t _expected_samples) :
+            class_name(_class_name),
+            counter_name(_counter_name),
+            type(_type),
+            mean_only(_mean_only)
+        {
+            if (ctsPerfCounterType::Detailed == _type && !_mean_only) {
+                this->samples.reserve(_expected_samples);
+            }
+        }
+
+        void add(unsigned long long _value)
+        {
+            if (0 == this->count) {
+                this->first = _value;
+                this->min = _value;
+                this->max = _value;
+            }
+            ++this->count;
+            this->last = _value;
+            this->min = std::min(this->min, _value);
+            this->max = std::max(this->max, _value);
+            this->sum += _value;
+            if (ctsPerfCounterType::Detailed == this->type && !this->mean_only) {
+                this->samples.push_back(_value);
+            }
+        }
+
+        void write(ctsWriteDetails& _writer)
+        {
+            if (0 == this->count) {
+                return;
+            }
+            if (ctsPerfCounterType::Difference == this->type) {
+                _writer.write_difference(this->class_name, this->counter_name, this->count, this->last - this->first);
+            } else if (this->mean_only) {
+                _writer.write_mean(this->class_name, this->counter_name, this->count, this->min, this->max, this->sum / this->count);
+            } else {
+                _writer.write_details(this->class_name, this->counter_name, this->samples);
+            }
+        }
+
+    private:
+        string class_name;
+        string counter_name;
+        vector<unsigned long long> samples;
+        unsigned long long count = 0ULL;
+        unsigned long long first = 0ULL;
+        unsigned long long last = 0ULL;
+        unsigned long long min = 0ULL;
+        unsigned long long max = 0ULL;
+        unsigned long long sum = 0ULL;
+        ctsPerfCounterType type;
+        bool mean_only;
+    };
+
+    // the per-second rate between two cumulative readings
+    inline unsigned long long RatePerSecond(unsigned long long _previous, unsigned long long _current, double _elapsed_seconds) noexcept
+    {
+        if (_current < _previous || _elapsed_seconds <= 0.0) {
+            return 0ULL;
+        }
+        return static_cast<unsigned long long>(static_cast<double>(_current - _previous) / _elapsed_seconds);
+    }
+    inline unsigned long long Percentage(unsigned long long _part, unsigned long long _total) noexcept
+    {
+        return (0ULL == _total) ? 0ULL : (_part * 100ULL) / _total;
+    }
+}
+
+using namespace ctsPerf;
+
+static const char UsageStatement[] =
+    "ctsPerf usage::\n"
+    " #### <time to run (in seconds)>  [default is 60 seconds]\n"
+    " -Networking [will enable performance and reliability related Network counters]\n"
+    " -MeanOnly  [will save memory by not storing every data point, only a sum and mean\n"
+    "\n"
+    " [optionally the specific interface can be specified\n"
+    "  by default *all* interfaces under /sys/class/net except the loopback are collected]\n"
+    "  -InterfaceDescription:#####\n"
+    "\n"
+    " [optionally one of two process identifiers]\n"
+    "  by default is no process tracking\n"
+    "  -process:<process name>\n"
+    "  -pid:<process id>\n"
+    "\n\n"
+    "For example:\n"
+    "> ctsPerf\n"
+    "  -- will capture processor and memory counters for the default 60 seconds\n"
+    "\n"
+    "> ctsPerf -Networking\n"
+    "  -- will capture processor, memory, network interface, IP, TCP, and UDP counters\n"
+    "\n"
+    "> ctsPerf 300 -process:nginx\n"
+    "  -- will capture processor and memory + process counters for nginx for 300 seconds\n";
+
+// 0 is a possible process ID
+static const long UninitializedProcessId = -1;
+static const unsigned long SampleIntervalMs = 1000;
+
+static const char* g_FileName = "ctsPerf.csv";
+static const char* g_NetworkingFilename = "ctsNetworking.csv";
+static const char* g_ProcessFilename = "ctsPerProcess.csv";
+
+static bool g_MeanOnly = false;
+static size_t g_ExpectedSamples = 0;
+
+/****************************************************************************************************/
+/*                                         Processor                                                */
+/****************************************************************************************************/
+class ProcessorCounters {
+public:
+    ProcessorCounters() : stat_file("/proc/stat")
+    {
+        this->sample_cpu_times();
+        for (const auto& cpu : this->current) {
+            this->processors.emplace_back(cpu.name);
+        }
+        this->previous = this->current;
+    }
+
+    void sample()
+    {
+        this->sample_cpu_times();
+        for (size_t index = 0; index < this->current.size() && index < this->previous.size(); ++index) {
+            const CpuTimes& now = this->current[index];
+            const CpuTimes& then = this->previous[index];
+            const unsigned long long total = now.total() - then.total();
+            const unsigned long long idle = (now.idle + now.iowait) - (then.idle + then.iowait);
+
+            ProcessorDetails& processor = this->processors[index];
+            processor.raw_cpu_usage.add(Percentage(total - idle, total));
+            processor.percent_dpc_time.add(Percentage((now.irq + now.softirq) - (then.irq + then.softirq), total));
+            processor.percent_privileged_time.add(Percentage(now.system - then.system, total));
+            processor.percent_user_time.add(Percentage((now.user + now.nice) - (then.user + then.nice), total));
+        }
+        swap(this->previous, this->current);
+    }
+
+    void process(ctsWriteDetails& _writer)
+    {
+        for (auto& processor : this->processors) {
+            _writer.write_row("Processor " + processor.name);
+            processor.raw_cpu_usage.write(_writer);
+            processor.percent_dpc_time.write(_writer);
+            processor.percent_privileged_time.write(_writer);
+            processor.percent_user_time.write(_writer);
+        }
+        _writer.write_empty_row();
+    }
+
+private:
+    struct CpuTimes {
+        string name;
+        unsigned long long user = 0ULL;
+        unsigned long long nice = 0ULL;
+        unsigned long long system = 0ULL;
+        unsigned long long idle = 0ULL;
+        unsigned long long iowait = 0ULL;
+        unsigned long long irq = 0ULL;
+        unsigned long long softirq = 0ULL;
+        unsigned long long steal = 0ULL;
+
+        // guest time is already accounted for in user time
+        unsigned long long total() const noexcept
+        {
+            return this->user + this->nice + this->system + this->idle + this->iowait + this->irq + this->softirq + this->steal;
+        }
+    };
+    struct ProcessorDetails {
+        explicit ProcessorDetails(const string& _name) :
+            name(_name),
+            raw_cpu_usage("Processor", "Raw CPU Usage", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+            percent_dpc_time("Processor", "Percent DPC Time (irq + softirq)", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+            percent_privileged_time("Processor", "Percent Privileged Time", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+            percent_user_time("Processor", "Percent User Time", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples)
+        {
+        }
+        string name;
+        ctsPerfCounter raw_cpu_usage;
+        ctsPerfCounter percent_dpc_time;
+        ctsPerfCounter percent_privileged_time;
+        ctsPerfCounter percent_user_time;
+    };
+
+    ctsProcFile stat_file;
+    vector<CpuTimes> previous;
+    vector<CpuTimes> current;
+    vector<ProcessorDetails> processors;
+
+    void sample_cpu_times()
+    {
+        const char* contents = this->stat_file.read();
+        size_t index = 0;
+        // the aggregate "cpu" line is followed by one "cpuN" line per processor
+        for (const char* line = contents; line != nullptr && 0 == ::strncmp(line, "cpu", 3); line = details::NextLine(line)) {
+            if (this->current.size() <= index) {
+                // only grows on the first sample: names never change afterwards
+                const char* end_of_name = details::SkipToken(line);
+                string name(line + 3, end_of_name);
+                this->current.emplace_back();
+                this->current.back().name = name.empty() ? string("_Total") : name;
+            }
+            CpuTimes& cpu = this->current[index];
+            const char* value = details::SkipToken(line);
+            value = details::ParseValue(value, &cpu.user);
+            value = details::ParseValue(value, &cpu.nice);
+            value = details::ParseValue(value, &cpu.system);
+            value = details::ParseValue(value, &cpu.idle);
+            value = details::ParseValue(value, &cpu.iowait);
+            value = details::ParseValue(value, &cpu.irq);
+            value = details::ParseValue(value, &cpu.softirq);
+            details::ParseValue(value, &cpu.steal);
+            ++index;
+        }
+    }
+};
+
+/****************************************************************************************************/
+/*                                            Memory                                                */
+/****************************************************************************************************/
+class MemoryCounters {
+public:
+    MemoryCounters() : meminfo_file("/proc/meminfo")
+    {
+        // slab memory is the closest equivalent to the paged / non-paged pool
+        this->counters.emplace_back("MemAvailable:", ctsPerfCounter("Memory", "AvailableBytes", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples));
+        this->counters.emplace_back("Committed_AS:", ctsPerfCounter("Memory", "CommittedBytes", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples));
+        this->counters.emplace_back("SReclaimable:", ctsPerfCounter("Memory", "SlabReclaimableBytes", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples));
+        this->counters.emplace_back("SUnreclaim:", ctsPerfCounter("Memory", "SlabUnreclaimableBytes", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples));
+    }
+
+    void sample()
+    {
+        const char* contents = this->meminfo_file.read();
+        for (auto& counter : this->counters) {
+            for (const char* line = contents; line != nullptr; line = details::NextLine(line)) {
+                if (0 == ::strncmp(line, counter.first, ::strlen(counter.first))) {
+                    unsigned long long kilobytes;
+                    details::ParseValue(line + ::strlen(counter.first), &kilobytes);
+                    counter.second.add(kilobytes * 1024ULL);
+                    break;
+                }
+            }
+        }
+    }
+
+    void process(ctsWriteDetails& _writer)
+    {
+        for (auto& counter : this->counters) {
+            counter.second.write(_writer);
+        }
+    }
+
+private:
+    ctsProcFile meminfo_file;
+    vector<pair<const char*, ctsPerfCounter>> counters;
+};
+
+/****************************************************************************************************/
+/*                                     NetworkInterface                                             */
+/****************************************************************************************************/
+class NetworkInterfaceCounters {
+public:
+    explicit NetworkInterfaceCounters(const string& _track_interface)
+    {
+        DIR* net_directory = ::opendir("/sys/class/net");
+        if (nullptr == net_directory) {
+            throw system_error(errno, generic_category(), "opendir(/sys/class/net)");
+        }
+        vector<string> names;
+        while (const dirent* entry = ::readdir(net_directory)) {
+            const string name(entry->d_name);
+            if (name == "." || name == "..") {
+                continue;
+            }
+            if (_track_interface.empty() ? (name == "lo") : (name != _track_interface)) {
+                continue;
+            }
+            names.push_back(name);
+        }
+        ::closedir(net_directory);
+
+        if (names.empty()) {
+            throw runtime_error("Unable to find an interface to report on under /sys/class/net" +
+                (_track_interface.empty() ? string() : " matching " + _track_interface));
+        }
+        sort(names.begin(), names.end());
+        for (const auto& name : names) {
+            this->interfaces.emplace_back(new InterfaceDetails(name));
+        }
+    }
+
+    void sample(double _elapsed_seconds)
+    {
+        for (auto& network_interface : this->interfaces) {
+            network_interface->sample(_elapsed_seconds);
+        }
+    }
+
+    void process(ctsWriteDetails& _writer)
+    {
+        _writer.write_row("NetworkInterface");
+        for (auto& network_interface : this->interfaces) {
+            network_interface->bytes_total_per_sec.write(_writer);
+            network_interface->packets_per_sec.write(_writer);
+            network_interface->packets_outbound_discarded.write(_writer);
+            network_interface->packets_outbound_errors.write(_writer);
+            network_interface->packets_received_discarded.write(_writer);
+            network_interface->packets_received_errors.write(_writer);
+            _writer.write_empty_row();
+        }
+    }
+
+private:
+    struct InterfaceDetails {
+        explicit InterfaceDetails(const string& _name) :
+            rx_bytes(StatisticsPath(_name, "rx_bytes"), 64),
+            tx_bytes(StatisticsPath(_name, "tx_bytes"), 64),
+            rx_packets(StatisticsPath(_name, "rx_packets"), 64),
+            tx_packets(StatisticsPath(_name, "tx_packets"), 64),
+            rx_dropped(StatisticsPath(_name, "rx_dropped"), 64),
+            tx_dropped(StatisticsPath(_name, "tx_dropped"), 64),
+            rx_errors(StatisticsPath(_name, "rx_errors"), 64),
+            tx_errors(StatisticsPath(_name, "tx_errors"), 64),
+            bytes_total_per_sec("NetworkInterface", "BytesTotalPerSec for interface " + _name, ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+            packets_per_sec("NetworkInterface", "PacketsPerSec for interface " + _name, ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+            packets_outbound_discarded("NetworkInterface", "PacketsOutboundDiscarded for interface " + _name, ctsPerfCounterType::Difference, g_MeanOnly, 0),
+            packets_outbound_errors("NetworkInterface", "PacketsOutboundErrors for interface " + _name, ctsPerfCounterType::Difference, g_MeanOnly, 0),
+            packets_received_discarded("NetworkInterface", "PacketsReceivedDiscarded for interface " + _name, ctsPerfCounterType::Difference, g_MeanOnly, 0),
+            packets_received_errors("NetworkInterface", "PacketsReceivedErrors for interface " + _name, ctsPerfCounterType::Difference, g_MeanOnly, 0)
+        {
+            this->previous_bytes = this->rx_bytes.read_value() + this->tx_bytes.read_value();
+            this->previous_packets = this->rx_packets.read_value() + this->tx_packets.read_value();
+        }
+
+        static string StatisticsPath(const string& _name, const char* _statistic)
+        {
+            return "/sys/class/net/" + _name + "/statistics/" + _statistic;
+        }
+
+        void sample(double _elapsed_seconds)
+        {
+            const unsigned long long current_bytes = this->rx_bytes.read_value() + this->tx_bytes.read_value();
+            const unsigned long long current_packets = this->rx_packets.read_value() + this->tx_packets.read_value();
+            this->bytes_total_per_sec.add(RatePerSecond(this->previous_bytes, current_bytes, _elapsed_seconds));
+            this->packets_per_sec.add(RatePerSecond(this->previous_packets, current_packets, _elapsed_seconds));
+            this->previous_bytes = current_bytes;
+            this->previous_packets = current_packets;
+
+            this->packets_outbound_discarded.add(this->tx_dropped.read_value());
+            this->packets_outbound_errors.add(this->tx_errors.read_value());
+            this->packets_received_discarded.add(this->rx_dropped.read_value());
+            this->packets_received_errors.add(this->rx_errors.read_value());
+        }
+
+        ctsProcFile rx_bytes;
+        ctsProcFile tx_bytes;
+        ctsProcFile rx_packets;
+        ctsProcFile tx_packets;
+        ctsProcFile rx_dropped;
+        ctsProcFile tx_dropped;
+        ctsProcFile rx_errors;
+        ctsProcFile tx_errors;
+        unsigned long long previous_bytes = 0ULL;
+        unsigned long long previous_packets = 0ULL;
+
+        ctsPerfCounter bytes_total_per_sec;
+        ctsPerfCounter packets_per_sec;
+        ctsPerfCounter packets_outbound_discarded;
+        ctsPerfCounter packets_outbound_errors;
+        ctsPerfCounter packets_received_discarded;
+        ctsPerfCounter packets_received_errors;
+    };
+
+    vector<unique_ptr<InterfaceDetails>> interfaces;
+};
+
+/****************************************************************************************************/
+/*                                     TCPIP IPv4 / TCPv4 / UDPv4                                   */
+/****************************************************************************************************/
+//
+// /proc/net/snmp only carries the IPv4 MIB counters (with TcpExt from /proc/net/netstat)
+// - each entry maps a MIB field to the WMI counter name ctsPerf.cpp reports
+//
+struct ProtocolCounterEntry {
+    const char* prefix;
+    const char* field;
+    const char* class_name;
+    const char* counter_name;
+    ctsPerfCounterType type;
+    // rates are reported per second from the cumulative MIB value
+    bool per_second;
+};
+
+static const ProtocolCounterEntry SnmpCounterEntries[] = {
+    { "Ip", "OutDiscards", "TCPIP - IPv4", "DatagramsOutboundDiscarded", ctsPerfCounterType::Difference, false },
+    { "Ip", "OutNoRoutes", "TCPIP - IPv4", "DatagramsOutboundNoRoute", ctsPerfCounterType::Difference, false },
+    { "Ip", "InAddrErrors", "TCPIP - IPv4", "DatagramsReceivedAddressErrors", ctsPerfCounterType::Difference, false },
+    { "Ip", "InDiscards", "TCPIP - IPv4", "DatagramsReceivedDiscarded", ctsPerfCounterType::Difference, false },
+    { "Ip", "InHdrErrors", "TCPIP - IPv4", "DatagramsReceivedHeaderErrors", ctsPerfCounterType::Difference, false },
+    { "Ip", "InUnknownProtos", "TCPIP - IPv4", "DatagramsReceivedUnknownProtocol", ctsPerfCounterType::Difference, false },
+    { "Ip", "ReasmFails", "TCPIP - IPv4", "FragmentReassemblyFailures", ctsPerfCounterType::Difference, false },
+    { "Ip", "FragFails", "TCPIP - IPv4", "FragmentationFailures", ctsPerfCounterType::Difference, false },
+    { "Tcp", "CurrEstab", "TCPIP - TCPv4", "ConnectionsEstablished", ctsPerfCounterType::Detailed, false },
+    { "Tcp", "AttemptFails", "TCPIP - TCPv4", "ConnectionFailures", ctsPerfCounterType::Difference, false },
+    { "Tcp", "EstabResets", "TCPIP - TCPv4", "ConnectionsReset", ctsPerfCounterType::Difference, false },
+    { "Tcp", "RetransSegs", "TCPIP - TCPv4", "SegmentsRetransmitted", ctsPerfCounterType::Difference, false },
+    { "Udp", "NoPorts", "TCPIP - UDPv4", "DatagramsNoPortPersec", ctsPerfCounterType::Detailed, true },
+    { "Udp", "InDatagrams", "TCPIP - UDPv4", "DatagramsReceivedPersec", ctsPerfCounterType::Detailed, true },
+    { "Udp", "OutDatagrams", "TCPIP - UDPv4", "DatagramsSentPersec", ctsPerfCounterType::Detailed, true },
+    { "Udp", "InErrors", "TCPIP - UDPv4", "DatagramsReceivedErrors", ctsPerfCounterType::Difference, false },
+    { "Udp", "RcvbufErrors", "TCPIP - UDPv4", "DroppedDatagrams", ctsPerfCounterType::Difference, false }
+};
+
+// listen queue drops are the equivalent of the Winsock RejectedConnections counters
+static const ProtocolCounterEntry NetstatCounterEntries[] = {
+    { "TcpExt", "ListenOverflows", "TcpExt", "ListenOverflows", ctsPerfCounterType::Difference, false },
+    { "TcpExt", "ListenDrops", "TcpExt", "RejectedConnections", ctsPerfCounterType::Difference, false }
+};
+
+class ProtocolCounters {
+public:
+    template <size_t N>
+    ProtocolCounters(const char* _path, const ProtocolCounterEntry (&_entries)[N]) :
+        table(_path, Fields(_entries, N))
+    {
+        this->table.sample(this->previous);
+        for (size_t index = 0; index < N; ++index) {
+            this->entries.push_back(&_entries[index]);
+            this->counters.emplace_back(
+                _entries[index].class_name,
+                _entries[index].counter_name,
+                _entries[index].type,
+                g_MeanOnly,
+                ctsPerfCounterType::Detailed == _entries[index].type ? g_ExpectedSamples : 0);
+        }
+    }
+
+    void sample(double _elapsed_seconds)
+    {
+        this->table.sample(this->current);
+        for (size_t index = 0; index < this->counters.size(); ++index) {
+            if (this->entries[index]->per_second) {
+                this->counters[index].add(RatePerSecond(this->previous[index], this->current[index], _elapsed_seconds));
+            } else {
+                this->counters[index].add(this->current[index]);
+            }
+        }
+        swap(this->previous, this->current);
+    }
+
+    void process(ctsWriteDetails& _writer)
+    {
+        const char* current_class = nullptr;
+        for (size_t index = 0; index < this->counters.size(); ++index) {
+            if (nullptr == current_class || 0 != ::strcmp(current_class, this->entries[index]->class_name)) {
+                if (current_class != nullptr) {
+                    _writer.write_empty_row();
+                }
+                current_class = this->entries[index]->class_name;
+                _writer.write_row(current_class);
+            }
+            this->counters[index].write(_writer);
+        }
+        _writer.write_empty_row();
+    }
+
+private:
+    ctsProcNetTable table;
+    vector<const ProtocolCounterEntry*> entries;
+    vector<ctsPerfCounter> counters;
+    vector<unsigned long long> previous;
+    vector<unsigned long long> current;
+
+    static vector<pair<string, string>> Fields(const ProtocolCounterEntry* _entries, size_t _count)
+    {
+        vector<pair<string, string>> fields;
+        for (size_t index = 0; index < _count; ++index) {
+            fields.emplace_back(_entries[index].prefix, _entries[index].field);
+        }
+        return fields;
+    }
+};
+
+/****************************************************************************************************/
+/*                                          Per-Process                                             */
+/****************************************************************************************************/
+class PerProcessCounters {
+public:
+    PerProcessCounters(const string& _track_process, long _process_id) :
+        process_id(ResolveProcessId(_track_process, _process_id)),
+        stat_file("/proc/" + to_string(this->process_id) + "/stat", 1024),
+        class_name(_track_process.empty() ? "Process (pid " + to_string(this->process_id) + ")" : "Process (" + _track_process + ")"),
+        percent_privileged_time(class_name, "PercentPrivilegedTime", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+        percent_processor_time(class_name, "PercentProcessorTime", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+        percent_user_time(class_name, "PercentUserTime", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+        virtual_bytes(class_name, "VirtualBytes", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+        working_set(class_name, "WorkingSet", ctsPerfCounterType::Detailed, g_MeanOnly, g_ExpectedSamples),
+        ticks_per_second(static_cast<unsigned long long>(::sysconf(_SC_CLK_TCK))),
+        page_size(static_cast<unsigned long long>(::sysconf(_SC_PAGESIZE)))
+    {
+        unsigned long long virtual_size;
+        unsigned long long resident_pages;
+        this->read_stat(&this->previous_user, &this->previous_system, &virtual_size, &resident_pages);
+    }
+
+    void sample(double _elapsed_seconds)
+    {
+        unsigned long long user;
+        unsigned long long system;
+        unsigned long long virtual_size;
+        unsigned long long resident_pages;
+        if (!this->read_stat(&user, &system, &virtual_size, &resident_pages)) {
+            // the process has exited: stop adding samples
+            return;
+        }
+
+        // Percent*Time is of a single processor, matching the Windows Process counters
+        const double elapsed_ticks = _elapsed_seconds * static_cast<double>(this->ticks_per_second);
+        auto percent_of_elapsed = [elapsed_ticks] (unsigned long long _ticks) -> unsigned long long {
+            return (elapsed_ticks <= 0.0) ? 0ULL : static_cast<unsigned long long>(static_cast<double>(_ticks) * 100.0 / elapsed_ticks);
+        };
+        this->percent_privileged_time.add(percent_of_elapsed(system - this->previous_system));
+        this->percent_user_time.add(percent_of_elapsed(user - this->previous_user));
+        this->percent_processor_time.add(percent_of_elapsed((user + system) - (this->previous_user + this->previous_system)));
+        this->virtual_bytes.add(virtual_size);
+        this->working_set.add(resident_pages * this->page_size);
+
+        this->previous_user = user;
+        this->previous_system = system;
+    }
+
+    void process(ctsWriteDetails& _writer)
+    {
+        this->percent_privileged_time.write(_writer);
+        this->percent_processor_time.write(_writer);
+        this->percent_user_time.write(_writer);
+        this->virtual_bytes.write(_writer);
+        this->working_set.write(_writer);
+    }
+
+private:
+    long process_id;
+    ctsProcFile stat_file;
+    string class_name;
+    ctsPerfCounter percent_privileged_time;
+    ctsPerfCounter percent_processor_time;
+    ctsPerfCounter percent_user_time;
+    ctsPerfCounter virtual_bytes;
+    ctsPerfCounter working_set;
+    unsigned long long ticks_per_second;
+    unsigned long long page_size;
+    unsigned long long previous_user = 0ULL;
+    unsigned long long previous_system = 0ULL;
+
+    // the first process whose comm matches _track_process, if a name was given
+    static long ResolveProcessId(const string& _track_process, long _process_id)
+    {
+        if (_track_process.empty()) {
+            return _process_id;
+        }
+
+        DIR* proc_directory = ::opendir("/proc");
+        if (nullptr == proc_directory) {
+            throw system_error(errno, generic_category(), "opendir(/proc)");
+        }
+        long found_process_id = UninitializedProcessId;
+        while (const dirent* entry = ::readdir(proc_directory)) {
+            char* end_of_pid = nullptr;
+            const long pid = ::strtol(entry->d_name, &end_of_pid, 10);
+            if (end_of_pid == entry->d_name || *end_of_pid != '\0') {
+                continue;
+            }
+            FILE* comm_file = ::fopen(("/proc/" + string(entry->d_name) + "/comm").c_str(), "r");
+            if (nullptr == comm_file) {
+                continue;
+            }
+            char comm[64] = {};
+            if (::fgets(comm, sizeof comm, comm_file) != nullptr) {
+                comm[::strcspn(comm, "\n")] = '\0';
+                if (_track_process == comm) {
+                    found_process_id = pid;
+                }
+            }
+            ::fclose(comm_file);
+            if (found_process_id != UninitializedProcessId) {
+                break;
+            }
+        }
+        ::closedir(proc_directory);
+
+        if (UninitializedProcessId == found_process_id) {
+            throw runtime_error("Unable to find a process named " + _track_process);
+        }
+        return found_process_id;
+    }
+
+    bool read_stat(unsigned long long* _user, unsigned long long* _system, unsigned long long* _virtual_size, unsigned long long* _resident_pages)
+    {
+        const char* contents;
+        try {
+            contents = this->stat_file.read();
+        }
+        catch (const system_error&) {
+            return false;
+        }
+        // comm is in parentheses and can contain spaces: fields are counted from the last ')'
+        const char* field = ::strrchr(contents, ')');
+        if (nullptr == field) {
+            return false;
+        }
+        ++field;
+        // field 3 (state) follows the ')', utime and stime are fields 14 and 15, vsize and rss are 23 and 24
+        unsigned long long ignored;
+        for (int field_number = 3; field_number < 14; ++field_number) {
+            field = details::SkipToken(field);
+        }
+        field = details::ParseValue(field, _user);
+        field = details::ParseValue(field, _system);
+        for (int field_number = 16; field_number < 23; ++field_number) {
+            field = details::ParseValue(field, &ignored);
+        }
+        field = details::ParseValue(field, _virtual_size);
+        details::ParseValue(field, _resident_pages);
+        return true;
+    }
+};
+
+/****************************************************************************************************/
+/*                                            Sampler                                               */
+/****************************************************************************************************/
+static mutex g_SamplerLock;
+static condition_variable g_SamplerExit;
+static bool g_SamplerExiting = false;
+
+int main(int argc, const char** argv)
+{
+    bool trackNetworking = false;
+    string trackInterfaceDescription;
+    string trackProcess;
+    long processId = UninitializedProcessId;
+    unsigned long timeToRunMs = 60000; // default to 60 seconds
+
+    for (int arg_count = argc; arg_count > 1; --arg_count) {
+        const string argument(argv[arg_count - 1]);
+        auto istarts_with = [&argument] (const char* _prefix) {
+            return 0 == ::strncasecmp(argument.c_str(), _prefix, ::strlen(_prefix));
+        };
+
+        if (istarts_with("-process:")) {
+            trackProcess = argument.substr(argument.find(':') + 1);
+            if (trackProcess.empty()) {
+                ::printf("Incorrect option: %s\n%s", argument.c_str(), UsageStatement);
+                return 1;
+            }
+
+        } else if (istarts_with("-pid:")) {
+            char* end_of_pid = nullptr;
+            const char* pid_string = argument.c_str() + argument.find(':') + 1;
+            processId = ::strtol(pid_string, &end_of_pid, 10);
+            if (end_of_pid == pid_string || *end_of_pid != '\0' || processId < 0) {
+                ::printf("Incorrect option: %s\n%s", argument.c_str(), UsageStatement);
+                return 1;
+            }
+
+        } else if (istarts_with("-estats")) {
+            ::printf("ESTATS is only available on Windows\n");
+            return 1;
+
+        } else if (istarts_with("-Networking")) {
+            trackNetworking = true;
+
+        } else if (istarts_with("-InterfaceDescription:")) {
+            trackInterfaceDescription = argument.substr(argument.find(':') + 1);
+
+        } else if (istarts_with("-MeanOnly")) {
+            g_MeanOnly = true;
+
+        } else {
+            char* end_of_number = nullptr;
+            const unsigned long timeToRun = ::strtoul(argument.c_str(), &end_of_number, 10);
+            if (timeToRun == 0 || *end_of_number != '\0' || timeToRun > 0xffffffffUL / 1000UL) {
+                ::printf("Incorrect option: %s\n%s", argument.c_str(), UsageStatement);
+                return 1;
+            }
+            timeToRunMs = timeToRun * 1000UL;
+        }
+    }
+
+    const bool trackPerProcess = !trackProcess.empty() || processId != UninitializedProcessId;
+
+    if (timeToRunMs <= 5000) {
+        ::printf("ERROR: Must run over 5 seconds to have enough samples for analysis\n%s", UsageStatement);
+        return 1;
+    }
+    g_ExpectedSamples = timeToRunMs / SampleIntervalMs + 1;
+
+    // the break signals are only ever received by sigtimedwait on this thread
+    sigset_t break_signals;
+    ::sigemptyset(&break_signals);
+    ::sigaddset(&break_signals, SIGINT);
+    ::sigaddset(&break_signals, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &break_signals, nullptr);
+
+    try {
+        // every file is opened (and its layout resolved) here, before sampling starts
+        // - this also finds the requested interface and process: an invalid one fails before any csv file is created
+        ProcessorCounters processor_counters;
+        MemoryCounters memory_counters;
+        unique_ptr<NetworkInterfaceCounters> network_interface_counters;
+        unique_ptr<ProtocolCounters> snmp_counters;
+        unique_ptr<ProtocolCounters> netstat_counters;
+        if (trackNetworking) {
+            network_interface_counters.reset(new NetworkInterfaceCounters(trackInterfaceDescription));
+            snmp_counters.reset(new ProtocolCounters("/proc/net/snmp", SnmpCounterEntries));
+            netstat_counters.reset(new ProtocolCounters("/proc/net/netstat", NetstatCounterEntries));
+        }
+        unique_ptr<PerProcessCounters> per_process_counters;
+        if (trackPerProcess) {
+            per_process_counters.reset(new PerProcessCounters(trackProcess, processId));
+        }
+
+        ctsWriteDetails cpuwriter(g_FileName);
+        cpuwriter.create_file(g_MeanOnly);
+
+        ctsWriteDetails networkWriter(g_NetworkingFilename);
+        if (trackNetworking) {
+            networkWriter.create_file(g_MeanOnly);
+        }
+
+        ctsWriteDetails processWriter(g_ProcessFilename);
+        if (trackPerProcess) {
+            processWriter.create_file(g_MeanOnly);
+        }
+
+        ::printf("Starting counters : will run for %lu seconds\n (hit ctrl-c to exit early) ...\n\n", timeToRunMs / 1000UL);
+
+        exception_ptr sampler_exception;
+        double sampler_cpu_seconds = 0.0;
+        double sampler_elapsed_seconds = 0.0;
+        thread sampler([&] () {
+            try {
+                const auto start_time = chrono::steady_clock::now();
+                auto previous_time = start_time;
+                auto next_sample = start_time + chrono::milliseconds(SampleIntervalMs);
+                unique_lock<mutex> lock(g_SamplerLock);
+                // absolute deadlines so the interval doesn't drift with the cost of each sample
+                while (!g_SamplerExit.wait_until(lock, next_sample, [] { return g_SamplerExiting; })) {
+                    const auto now = chrono::steady_clock::now();
+                    const double elapsed_seconds = chrono::duration<double>(now - previous_time).count();
+                    previous_time = now;
+                    next_sample += chrono::milliseconds(SampleIntervalMs);
+
+                    processor_counters.sample();
+                    memory_counters.sample();
+                    if (network_interface_counters) {
+                        network_interface_counters->sample(elapsed_seconds);
+                        snmp_counters->sample(elapsed_seconds);
+                        netstat_counters->sample(elapsed_seconds);
+                    }
+                    if (per_process_counters) {
+                        per_process_counters->sample(elapsed_seconds);
+                    }
+                }
+
+                rusage thread_usage;
+                if (0 == ::getrusage(RUSAGE_THREAD, &thread_usage)) {
+                    sampler_cpu_seconds =
+                        static_cast<double>(thread_usage.ru_utime.tv_sec + thread_usage.ru_stime.tv_sec) +
+                        static_cast<double>(thread_usage.ru_utime.tv_usec + thread_usage.ru_stime.tv_usec) / 1000000.0;
+                }
+                sampler_elapsed_seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+            }
+            catch (...) {
+                sampler_exception = current_exception();
+            }
+        });
+
+        const timespec time_to_run = { static_cast<time_t>(timeToRunMs / 1000UL), static_cast<long>(timeToRunMs % 1000UL) * 1000000L };
+        while (::sigtimedwait(&break_signals, nullptr, &time_to_run) == -1 && EINTR == errno) {
+        }
+
+        ::printf("Stopping counters ....\n\n");
+        {
+            lock_guard<mutex> lock(g_SamplerLock);
+            g_SamplerExiting = true;
+        }
+        g_SamplerExit.notify_all();
+        sampler.join();
+        if (sampler_exception) {
+            rethrow_exception(sampler_exception);
+        }
+
+        processor_counters.process(cpuwriter);
+        memory_counters.process(cpuwriter);
+
+        if (trackNetworking) {
+            network_interface_counters->process(networkWriter);
+            snmp_counters->process(networkWriter);
+            netstat_counters->process(networkWriter);
+        }
+
+        if (trackPerProcess) {
+            per_process_counters->process(processWriter);
+        }
+
+        if (sampler_elapsed_seconds > 0.0) {
+            ::printf("Sampler thread used %.4f%% CPU\n", sampler_cpu_seconds * 100.0 / sampler_elapsed_seconds);
+        }
+    }
+    catch (const exception& e) {
+        ::printf("ctsPerf exception: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif // defined(__linux__)
@@ -0,0 +1,200 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// cpp headers
+#include <utility>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+#include <ctException.hpp>
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// A page-aligned buffer for the long-lived IO buffers
+    /// - backed by large pages when given a large page size and the OS can provide them
+    /// - falls back to regular pages when large pages are not available
+    /// - the physical pages are preferred from the given NUMA node
+    ///
+    /// Large pages require SeLockMemoryPrivilege: EnableLargePages() returns the large page size to pass
+    /// - or zero if the process cannot use them
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsBufferAllocation {
+    public:
+        static const unsigned long AnyNumaNode = NUMA_NO_PREFERRED_NODE;
+
+        static size_t EnableLargePages() NOEXCEPT
+        {
+            const size_t large_page_size = ::GetLargePageMinimum();
+            if (0 == large_page_size) {
+                return 0;
+            }
+
+            HANDLE token = nullptr;
+            if (!::OpenProcessToken(::GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+                return 0;
+            }
+
+            bool enabled = false;
+            TOKEN_PRIVILEGES privileges;
+            privileges.PrivilegeCount = 1;
+            privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+            if (::LookupPrivilegeValueW(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)) {
+                // AdjustTokenPrivileges succeeds even when the account doesn't hold the privilege
+                // - it then sets ERROR_NOT_ALL_ASSIGNED
+                if (::AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+                    ERROR_SUCCESS == ::GetLastError()) {
+                    enabled = true;
+                }
+            }
+            ::CloseHandle(token);
+
+            return enabled ? large_page_size : 0;
+        }
+
+        static unsigned long NumaNodeCount() NOEXCEPT
+        {
+            ULONG highest_node = 0;
+            if (!::GetNumaHighestNodeNumber(&highest_node)) {
+                return 1;
+            }
+            return highest_node + 1;
+        }
+
+        static unsigned long CurrentNumaNode() NOEXCEPT
+        {
+            PROCESSOR_NUMBER processor;
+            ::GetCurrentProcessorNumberEx(&processor);
+            USHORT node = 0;
+            if (!::GetNumaProcessorNodeEx(&processor, &node)) {
+                return 0;
+            }
+            return node;
+        }
+
+        ctsBufferAllocation() NOEXCEPT :
+            buffer(nullptr),
+            buffer_size(0),
+            numa_node(AnyNumaNode),
+            large_pages(false)
+        {
+        }
+
+        //
+        // _large_page_size == 0 allocates regular pages only
+        // - can throw ctl::ctException if regular pages cannot be allocated either
+        //
+        ctsBufferAllocation(size_t _size, unsigned long _numa_node, size_t _large_page_size) :
+            buffer(nullptr),
+            buffer_size(_size),
+            numa_node(_numa_node),
+            large_pages(false)
+        {
+            if (_large_page_size > 0) {
+                // large page allocations must be a multiple of the large page size
+                const size_t large_page_bytes = (_size + _large_page_size - 1) / _large_page_size * _large_page_size;
+                buffer = allocate(large_page_bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, _numa_node);
+                large_pages = (buffer != nullptr);
+            }
+            if (!buffer) {
+                buffer = allocate(_size, MEM_RESERVE | MEM_COMMIT, _numa_node);
+                if (!buffer) {
+                    throw ctl::ctException(::GetLastError(), L"VirtualAllocExNuma", L"ctsBufferAllocation", false);
+                }
+            }
+        }
+
+        ~ctsBufferAllocation() NOEXCEPT
+        {
+            if (buffer) {
+                ::VirtualFree(buffer, 0, MEM_RELEASE);
+            }
+        }
+
+        ctsBufferAllocation(ctsBufferAllocation&& _other) NOEXCEPT :
+            ctsBufferAllocation()
+        {
+            this->swap(_other);
+        }
+        ctsBufferAllocation& operator=(ctsBufferAllocation&& _other) NOEXCEPT
+        {
+            ctsBufferAllocation(std::move(_other)).swap(*this);
+            return *this;
+        }
+
+        // the caller takes ownership: the pages are never freed
+        char* release() NOEXCEPT
+        {
+            char* released_buffer = this->buffer;
+            this->buffer = nullptr;
+            this->buffer_size = 0;
+            return released_buffer;
+        }
+
+        void swap(ctsBufferAllocation& _other) NOEXCEPT
+        {
+            using std::swap;
+            swap(this->buffer, _other.buffer);
+            swap(this->buffer_size, _other.buffer_size);
+            swap(this->numa_node, _other.numa_node);
+            swap(this->large_pages, _other.large_pages);
+        }
+
+        char* get() const NOEXCEPT
+        {
+            return buffer;
+        }
+        size_t size() const NOEXCEPT
+        {
+            return buffer_size;
+        }
+        bool empty() const NOEXCEPT
+        {
+            return nullptr == buffer;
+        }
+        unsigned long preferred_numa_node() const NOEXCEPT
+        {
+            return numa_node;
+        }
+        bool uses_large_pages() const NOEXCEPT
+        {
+            return large_pages;
+        }
+
+        // not copyable
+        ctsBufferAllocation(const ctsBufferAllocation&) = delete;
+        ctsBufferAllocation& operator=(const ctsBufferAllocation&) = delete;
+
+    private:
+        char* buffer;
+        size_t buffer_size;
+        unsigned long numa_node;
+        bool large_pages;
+
+        static char* allocate(size_t _bytes, DWORD _allocation_type, unsigned long _numa_node) NOEXCEPT
+        {
+            if (AnyNumaNode == _numa_node) {
+                return static_cast<char*>(::VirtualAlloc(nullptr, _bytes, _allocation_type, PAGE_READWRITE));
+            }
+            return static_cast<char*>(::VirtualAllocExNuma(::GetCurrentProcess(), nullptr, _bytes, _allocation_type, PAGE_READWRITE, _numa_node));
+        }
+    };
+
+} // namespace
@@ -12,6 +12,8 @@ See the Apache Version 2.0 License for specific language governing permissions a
 */
 
 // cpp headers
+#include <cerrno>
+#include <cstdlib>
 #include <vector>
 #include <string>
 #include <algorithm>
@@ -43,6 +45,8 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsTCPFunctions.h"
 #include "ctsMediaStreamClient.h"
 #include "ctsMediaStreamServer.h"
+#include "ctsMediaStreamProtocol.hpp"
+#include "ctsTrace.h"
 
 
 using namespace std;
@@ -101,6 +105,8 @@ namespace ctsTraffic {
 
         static const unsigned long s_DefaultPushBytes = 0x100000;
         static const unsigned long s_DefaultPullBytes = 0x100000;
+        // an I frame is typically several times the size of the P frames which follow it
+        static const unsigned long s_DefaultIFrameRatio = 8;
 
         static ctsUnsignedLong s_TimePeriodRefCount = 0;
 
@@ -115,11 +121,15 @@ namespace ctsTraffic {
 
         // default to 5 seconds
         static const unsigned long s_DefaultStatusUpdateFrequency = 5000;
+        // time-series defaults to 100 ms samples, bounded to 64 MB across all connections
+        static const unsigned long s_DefaultTimeSeriesInterval = 100;
+        static const long long s_DefaultTimeSeriesMaxMemoryMB = 64LL;
         static shared_ptr<ctsStatusInformation> s_PrintStatusInformation;
         static shared_ptr<ctsLogger> s_ConnectionLogger;
         static shared_ptr<ctsLogger> s_StatusLogger;
         static shared_ptr<ctsLogger> s_ErrorLogger;
         static shared_ptr<ctsLogger> s_JitterLogger;
+        static shared_ptr<ctsLogger> s_TimeSeriesLogger;
 
         static bool s_BreakOnError = false;
         static bool s_ShutdownCalled = false;
@@ -503,6 +513,7 @@ namespace ctsTraffic {
                 if (ctString::iordinal_equals(L"iocp", value)) {
                     Settings->IoFunction = ctsSendRecvIocp;
                     Settings->Options |= OptionType::HANDLE_INLINE_IOCP;
+                    Settings->MaxIoSegments = ctsIOTask::MaxSegments;
                     s_IoFunctionName = L"Iocp (WSASend/WSARecv using IOCP)";
 
                 } else if (ctString::iordinal_equals(L"readwritefile", value)) {
@@ -525,6 +536,7 @@ namespace ctsTraffic {
                     // Default for TCP is WSASend/WSARecv using IOCP
                     Settings->IoFunction = ctsSendRecvIocp;
                     Settings->Options |= OptionType::HANDLE_INLINE_IOCP;
+                    Settings->MaxIoSegments = ctsIOTask::MaxSegments;
                     s_IoFunctionName = L"Iocp (WSASend/WSARecv using IOCP)";
 
                 } else {
@@ -623,6 +635,65 @@ namespace ctsTraffic {
             }
         }
 
+        //////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Reads the relative frame sizes for -FrameSizeFile
+        /// - one frame size per line: only the relative sizes are used, so any unit works
+        ///   (e.g. the frame sizes in bytes logged by an encoder)
+        /// - blank lines are skipped
+        ///
+        //////////////////////////////////////////////////////////////////////////////////////////
+        static
+        vector<unsigned long> read_frame_size_file(_In_ LPCWSTR _file_name)
+        {
+            static const long long MaximumFrameSizeFileBytes = 64LL * 1024LL * 1024LL;
+
+            HANDLE frame_size_file = ::CreateFileW(_file_name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (INVALID_HANDLE_VALUE == frame_size_file) {
+                throw ctException(::GetLastError(), L"CreateFile", L"-FrameSizeFile", false);
+            }
+            ctlScopeGuard(closeFileOnExit, { ::CloseHandle(frame_size_file); });
+
+            LARGE_INTEGER file_size;
+            if (!::GetFileSizeEx(frame_size_file, &file_size)) {
+                throw ctException(::GetLastError(), L"GetFileSizeEx", L"-FrameSizeFile", false);
+            }
+            if (file_size.QuadPart > MaximumFrameSizeFileBytes) {
+                throw invalid_argument("-FrameSizeFile cannot be larger than 64MB");
+            }
+
+            string contents(static_cast<size_t>(file_size.QuadPart), '\0');
+            DWORD bytes_read = 0;
+            if (!contents.empty() && !::ReadFile(frame_size_file, &contents[0], static_cast<DWORD>(contents.length()), &bytes_read, nullptr)) {
+                throw ctException(::GetLastError(), L"ReadFile", L"-FrameSizeFile", false);
+            }
+            contents.resize(bytes_read);
+
+            vector<unsigned long> frame_sizes;
+            const char* next_size = contents.c_str();
+            for (;;) {
+                while (' ' == *next_size || '\t' == *next_size || '\r' == *next_size || '\n' == *next_size) {
+                    ++next_size;
+                }
+                if ('\0' == *next_size) {
+                    break;
+                }
+
+                char* end_size = nullptr;
+                errno = 0;
+                const unsigned long frame_size = ::strtoul(next_size, &end_size, 10);
+                if (end_size == next_size || ERANGE == errno || 0 == frame_size) {
+                    throw invalid_argument("-FrameSizeFile must contain one non-zero frame size per line");
+                }
+                frame_sizes.push_back(frame_size);
+                next_size = end_size;
+            }
+            if (frame_sizes.empty()) {
+                throw invalid_argument("-FrameSizeFile must contain at least one frame size");
+            }
+            return frame_sizes;
+        }
+
         //////////////////////////////////////////////////////////////////////////////////////////
         ///
         /// Parses for the wire-Protocol to use
@@ -767,6 +838,166 @@ namespace ctsTraffic {
                 _args.erase(found_arg);
             }
 
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-PlayoutBuffer");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (Settings->Protocol != ProtocolType::UDP) {
+                    throw invalid_argument("-PlayoutBuffer requires -Protocol:UDP");
+                }
+                const wchar_t* value = ParseArgument(*found_arg, L"-PlayoutBuffer");
+                if (ctString::iordinal_equals(L"fixed", value)) {
+                    s_MediaStreamSettings.AdaptivePlayout = false;
+                } else if (ctString::iordinal_equals(L"adaptive", value)) {
+                    s_MediaStreamSettings.AdaptivePlayout = true;
+                } else {
+                    throw invalid_argument("-PlayoutBuffer");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-FecFrames");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (Settings->Protocol != ProtocolType::UDP) {
+                    throw invalid_argument("-FecFrames requires -Protocol:UDP");
+                }
+                s_MediaStreamSettings.FecDataFrames = as_integral<unsigned long>(ParseArgument(*found_arg, L"-FecFrames"));
+                if (0 == s_MediaStreamSettings.FecDataFrames) {
+                    throw invalid_argument("-FecFrames");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-FecParity");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (0 == s_MediaStreamSettings.FecDataFrames) {
+                    throw invalid_argument("-FecParity requires -FecFrames");
+                }
+                s_MediaStreamSettings.FecParityFrames = as_integral<unsigned long>(ParseArgument(*found_arg, L"-FecParity"));
+                if (0 == s_MediaStreamSettings.FecParityFrames || s_MediaStreamSettings.FecParityFrames > s_MediaStreamSettings.FecDataFrames) {
+                    throw invalid_argument("-FecParity must be between 1 and -FecFrames");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            } else if (s_MediaStreamSettings.FecDataFrames > 0) {
+                s_MediaStreamSettings.FecParityFrames = 1;
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-DatagramPacing");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (Settings->Protocol != ProtocolType::UDP) {
+                    throw invalid_argument("-DatagramPacing requires -Protocol:UDP");
+                }
+                const wchar_t* value = ParseArgument(*found_arg, L"-DatagramPacing");
+                if (ctString::iordinal_equals(L"burst", value)) {
+                    s_MediaStreamSettings.SpreadDatagrams = false;
+                } else if (ctString::iordinal_equals(L"spread", value)) {
+                    s_MediaStreamSettings.SpreadDatagrams = true;
+                } else {
+                    throw invalid_argument("-DatagramPacing");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-ClockProbeInterval");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (Settings->Protocol != ProtocolType::UDP) {
+                    throw invalid_argument("-ClockProbeInterval requires -Protocol:UDP");
+                }
+                s_MediaStreamSettings.ClockProbeIntervalMilliseconds = as_integral<unsigned long>(ParseArgument(*found_arg, L"-ClockProbeInterval"));
+                if (0 == s_MediaStreamSettings.ClockProbeIntervalMilliseconds) {
+                    throw invalid_argument("-ClockProbeInterval");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-DatagramHeader");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (Settings->Protocol != ProtocolType::UDP) {
+                    throw invalid_argument("-DatagramHeader requires -Protocol:UDP");
+                }
+                const wchar_t* value = ParseArgument(*found_arg, L"-DatagramHeader");
+                if (ctString::iordinal_equals(L"legacy", value)) {
+                    s_MediaStreamSettings.CompactHeader = false;
+                } else if (ctString::iordinal_equals(L"compact", value)) {
+                    s_MediaStreamSettings.CompactHeader = true;
+                } else {
+                    throw invalid_argument("-DatagramHeader");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-GopFrames");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (Settings->Protocol != ProtocolType::UDP) {
+                    throw invalid_argument("-GopFrames requires -Protocol:UDP");
+                }
+                s_MediaStreamSettings.GopFrames = as_integral<unsigned long>(ParseArgument(*found_arg, L"-GopFrames"));
+                if (0 == s_MediaStreamSettings.GopFrames) {
+                    throw invalid_argument("-GopFrames");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-IFrameRatio");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (0 == s_MediaStreamSettings.GopFrames) {
+                    throw invalid_argument("-IFrameRatio requires -GopFrames");
+                }
+                s_MediaStreamSettings.IFrameRatio = as_integral<unsigned long>(ParseArgument(*found_arg, L"-IFrameRatio"));
+                if (0 == s_MediaStreamSettings.IFrameRatio) {
+                    throw invalid_argument("-IFrameRatio");
+                }
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            } else if (s_MediaStreamSettings.GopFrames > 0) {
+                s_MediaStreamSettings.IFrameRatio = s_DefaultIFrameRatio;
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-FrameSizeFile");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (Settings->Protocol != ProtocolType::UDP) {
+                    throw invalid_argument("-FrameSizeFile requires -Protocol:UDP");
+                }
+                if (s_MediaStreamSettings.GopFrames > 0) {
+                    throw invalid_argument("-FrameSizeFile cannot be used with -GopFrames");
+                }
+                s_MediaStreamSettings.FrameSizeTrace = read_frame_size_file(ParseArgument(*found_arg, L"-FrameSizeFile"));
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
             // validate and resolve the UDP protocol options
             if (ProtocolType::UDP == Settings->Protocol) {
                 if (0 == s_MediaStreamSettings.BitsPerSecond) {
@@ -779,12 +1010,29 @@ namespace ctsTraffic {
                 if (!IsListening() && 0 == s_MediaStreamSettings.BufferDepthSeconds) {
                     throw invalid_argument("-BufferDepth is required");
                 }
+                if (IsListening() && s_MediaStreamSettings.AdaptivePlayout) {
+                    throw invalid_argument("-PlayoutBuffer is a client-only option");
+                }
+                if (!IsListening() && s_MediaStreamSettings.SpreadDatagrams) {
+                    throw invalid_argument("-DatagramPacing is a server-only option");
+                }
+                if (IsListening() && s_MediaStreamSettings.ClockProbeIntervalMilliseconds > 0) {
+                    throw invalid_argument("-ClockProbeInterval is a client-only option");
+                }
+                if (IsListening() && s_MediaStreamSettings.CompactHeader) {
+                    throw invalid_argument("-DatagramHeader is a client-only option");
+                }
                 if (0 == s_MediaStreamSettings.StreamLengthSeconds) {
                     throw invalid_argument("-StreamLength is required");
                 }
 
                 // finally calculate the total stream length after all settings are captured from the user
                 s_TransferSizeLow = s_MediaStreamSettings.CalculateTransferSize();
+
+                // parity is calculated across whole datagrams: every frame must fit in a single datagram
+                if (s_MediaStreamSettings.FecDataFrames > 0 && s_MediaStreamSettings.MaximumFrameSizeBytes > UdpDatagramMaximumSizeBytes) {
+                    throw invalid_argument("-FecFrames requires frames no larger than 64000 bytes : review -BitsPerSecond, -FrameRate and the frame size profile");
+                }
             }
         }
 
@@ -1345,6 +1593,10 @@ namespace ctsTraffic {
         ///
         /// -ConsoleVerbosity:## <0-6>
         /// -StatusUpdate:####
+        /// -MetricsPort:####
+        /// -TimeSeriesInterval:####
+        /// -TimeSeriesMaxMemory:####
+        /// -TcpInfoInterval:####
         ///
         //////////////////////////////////////////////////////////////////////////////////////////
         static
@@ -1378,10 +1630,70 @@ namespace ctsTraffic {
                 _args.erase(found_status_update);
             }
 
+            auto found_metrics_port = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-MetricsPort");
+                return (value != nullptr);
+            });
+            if (found_metrics_port != end(_args)) {
+                Settings->MetricsPort = as_integral<unsigned short>(ParseArgument(*found_metrics_port, L"-MetricsPort"));
+                if (0 == Settings->MetricsPort) {
+                    throw invalid_argument("-MetricsPort");
+                }
+
+                // always remove the arg from our vector
+                _args.erase(found_metrics_port);
+            }
+
+            auto found_tcp_info_interval = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-TcpInfoInterval");
+                return (value != nullptr);
+            });
+            if (found_tcp_info_interval != end(_args)) {
+                Settings->TcpInfoIntervalMilliseconds = as_integral<unsigned long>(ParseArgument(*found_tcp_info_interval, L"-TcpInfoInterval"));
+                if (0 == Settings->TcpInfoIntervalMilliseconds) {
+                    throw invalid_argument("-TcpInfoInterval");
+                }
+
+                // always remove the arg from our vector
+                _args.erase(found_tcp_info_interval);
+            }
+
+            unsigned long timeSeriesInterval = 0;
+            auto found_time_series_interval = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-TimeSeriesInterval");
+                return (value != nullptr);
+            });
+            if (found_time_series_interval != end(_args)) {
+                timeSeriesInterval = as_integral<unsigned long>(ParseArgument(*found_time_series_interval, L"-TimeSeriesInterval"));
+                if (0 == timeSeriesInterval) {
+                    throw invalid_argument("-TimeSeriesInterval");
+                }
+
+                // always remove the arg from our vector
+                _args.erase(found_time_series_interval);
+            }
+
+            long long timeSeriesMaxMemoryMB = 0LL;
+            auto found_time_series_memory = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-TimeSeriesMaxMemory");
+                return (value != nullptr);
+            });
+            if (found_time_series_memory != end(_args)) {
+                timeSeriesMaxMemoryMB = as_integral<long long>(ParseArgument(*found_time_series_memory, L"-TimeSeriesMaxMemory"));
+                // capping at 1 TB to avoid overflowing the byte count
+                if (timeSeriesMaxMemoryMB <= 0LL || timeSeriesMaxMemoryMB > 1024LL * 1024LL) {
+                    throw invalid_argument("-TimeSeriesMaxMemory");
+                }
+
+                // always remove the arg from our vector
+                _args.erase(found_time_series_memory);
+            }
+
             wstring connectionFilename;
             wstring errorFilename;
             wstring statusFilename;
             wstring jitterFilename;
+            wstring timeSeriesFilename;
 
             auto found_connection_filename = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
                 const wchar_t* value = ParseArgument(parameter, L"-ConnectionFilename");
@@ -1423,6 +1735,16 @@ namespace ctsTraffic {
                 _args.erase(found_jitter_filename);
             }
 
+            auto found_time_series_filename = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-TimeSeriesFilename");
+                return (value != nullptr);
+            });
+            if (found_time_series_filename != end(_args)) {
+                timeSeriesFilename = ParseArgument(*found_time_series_filename, L"-TimeSeriesFilename");
+                // always remove the arg from our vector
+                _args.erase(found_time_series_filename);
+            }
+
             // since CSV files each have their own header, we cannot allow the same CSV filename to be used
             // for different loggers, as opposed to txt files, which can be shared across different loggers
 
@@ -1481,6 +1803,29 @@ namespace ctsTraffic {
                     throw invalid_argument("Jitter can only be logged using a csv format");
                 }
             }
+
+            if (!timeSeriesFilename.empty()) {
+                // the time-series is written per-connection as each connection closes:
+                // sharing a file would interleave its samples with other data
+                if (ctString::iordinal_equals(connectionFilename, timeSeriesFilename) ||
+                    ctString::iordinal_equals(errorFilename, timeSeriesFilename) ||
+                    ctString::iordinal_equals(statusFilename, timeSeriesFilename) ||
+                    ctString::iordinal_equals(jitterFilename, timeSeriesFilename)) {
+                    throw invalid_argument("The time-series filename cannot be used for other loggers");
+                }
+                if (ctString::iends_with(timeSeriesFilename, L".csv")) {
+                    s_TimeSeriesLogger = make_shared<ctsTextLogger>(timeSeriesFilename.c_str(), StatusFormatting::Csv);
+                } else {
+                    s_TimeSeriesLogger = make_shared<ctsTextLogger>(timeSeriesFilename.c_str(), StatusFormatting::ClearText);
+                }
+
+                Settings->TimeSeriesIntervalMilliseconds = (timeSeriesInterval != 0) ? timeSeriesInterval : s_DefaultTimeSeriesInterval;
+                Settings->TimeSeriesMemoryRemaining.set(
+                    ((timeSeriesMaxMemoryMB != 0LL) ? timeSeriesMaxMemoryMB : s_DefaultTimeSeriesMaxMemoryMB) * 1024LL * 1024LL);
+
+            } else if (timeSeriesInterval != 0 || timeSeriesMaxMemoryMB != 0LL) {
+                throw invalid_argument("-TimeSeriesInterval and -TimeSeriesMaxMemory require -TimeSeriesFilename");
+            }
         }
 
         //////////////////////////////////////////////////////////////////////////////////////////
@@ -1567,6 +1912,47 @@ namespace ctsTraffic {
             }
         }
 
+        //////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Sets how the send backlog is sized when following the ideal send backlog (-PrePostSends:0)
+        ///
+        /// -SendBacklog:<isb,tcpinfo>
+        ///
+        /// tcpinfo sizes the backlog from the congestion and send windows of each -TcpInfoInterval sample
+        /// - for stacks and providers which do not deliver SIO_IDEAL_SEND_BACKLOG_CHANGE notifications
+        ///
+        //////////////////////////////////////////////////////////////////////////////////////////
+        static
+        void set_sendbacklog(vector<const wchar_t*>& _args)
+        {
+            auto found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-SendBacklog");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                const wchar_t* value = ParseArgument(*found_arg, L"-SendBacklog");
+                if (ctString::iordinal_equals(L"isb", value)) {
+                    Settings->SendBacklogFromTcpInfo = false;
+                } else if (ctString::iordinal_equals(L"tcpinfo", value)) {
+                    Settings->SendBacklogFromTcpInfo = true;
+                } else {
+                    throw invalid_argument("-SendBacklog");
+                }
+
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            if (Settings->SendBacklogFromTcpInfo) {
+                if (Settings->Protocol != ProtocolType::TCP || Settings->PrePostSends != 0) {
+                    throw invalid_argument("-SendBacklog:tcpinfo is only supported with TCP and -PrePostSends:0");
+                }
+                if (0 == Settings->TcpInfoIntervalMilliseconds) {
+                    throw invalid_argument("-SendBacklog:tcpinfo requires -TcpInfoInterval");
+                }
+            }
+        }
+
         //////////////////////////////////////////////////////////////////////////////////////////
         ///
         /// Sets optional SO_RCVBUF value
@@ -1716,6 +2102,88 @@ namespace ctsTraffic {
             }
         }
 
+        //////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Parses for the data sent over TCP connections
+        ///
+        /// -Payload:<pattern,random>
+        /// -PayloadSeed:####
+        ///
+        /// random payloads are regenerated by the receiver to verify them:
+        /// - both sides must specify the same -PayloadSeed
+        ///
+        //////////////////////////////////////////////////////////////////////////////////////////
+        static
+        void set_payload(vector<const wchar_t*>& _args)
+        {
+            auto found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-Payload");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                const wchar_t* value = ParseArgument(*found_arg, L"-Payload");
+                if (ctString::iordinal_equals(L"pattern", value)) {
+                    Settings->RandomPayload = false;
+                } else if (ctString::iordinal_equals(L"random", value)) {
+                    Settings->RandomPayload = true;
+                } else {
+                    throw invalid_argument("-Payload");
+                }
+
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-PayloadSeed");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                if (!Settings->RandomPayload) {
+                    throw invalid_argument("-PayloadSeed requires -Payload:random");
+                }
+                Settings->PayloadSeed = as_integral<unsigned long long>(ParseArgument(*found_arg, L"-PayloadSeed"));
+
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+
+            if (Settings->RandomPayload) {
+                if (Settings->Protocol != ProtocolType::TCP || IoPatternType::MediaStream == Settings->IoPattern) {
+                    throw invalid_argument("-Payload:random is only supported with TCP patterns");
+                }
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Parses for whether to back IO buffers with large pages
+        ///
+        /// -LargePages:<on,off>
+        ///
+        //////////////////////////////////////////////////////////////////////////////////////////
+        static
+        void set_largePages(vector<const wchar_t*>& _args)
+        {
+            auto found_arg = find_if(begin(_args), end(_args), [] (const wchar_t* parameter) -> bool {
+                const wchar_t* value = ParseArgument(parameter, L"-LargePages");
+                return (value != nullptr);
+            });
+            if (found_arg != end(_args)) {
+                const wchar_t* value = ParseArgument(*found_arg, L"-LargePages");
+                if (ctString::iordinal_equals(L"on", value)) {
+                    Settings->UseLargePages = true;
+                } else if (ctString::iordinal_equals(L"off", value)) {
+                    Settings->UseLargePages = false;
+                } else {
+                    throw invalid_argument("-LargePages");
+                }
+
+                // always remove the arg from our vector
+                _args.erase(found_arg);
+            }
+        }
+
         //////////////////////////////////////////////////////////////////////////////////////////
         ///
         /// Parses for how the client should close the connection with the server
@@ -1822,6 +2290,7 @@ namespace ctsTraffic {
                                  L"\t-BitsPerSecond (on UDP)\n"
                                  L"\t-FrameRate (on UDP)\n"
                                  L"\t-StreamLength (on UDP)\n"
+                                 L"\t-FecFrames, -FecParity (on UDP)\n"
                                  L"\n\n"
                                  L"----------------------------------------------------------------------\n"
                                  L"                    Common Server-side options                        \n"
@@ -1887,7 +2356,7 @@ namespace ctsTraffic {
                                  L"                    TCP-specific usage options                        \n"
                                  L"                                                                      \n"
                                  L"  -Buffer, -IO, -Pattern, -PullBytes, -PushBytes, -RateLimit,         \n"
-                                 L"  -Transfer                                                           \n"
+                                 L"  -TcpInfoInterval, -Transfer                                         \n"
                                  L"                                                                      \n"
                                  L"----------------------------------------------------------------------\n"
                                  L"-Buffer:#####\n"
@@ -1920,6 +2389,13 @@ namespace ctsTraffic {
                                  L"   - rate limits the number of bytes/sec being *sent* on each individual connection\n"
                                  L"\t- <default> == 0 (no rate limits)\n"
                                  L"\t- supports range : [low,high]  (each connection will randomly choose a rate limit setting from within this range)\n"
+                                 L"-TcpInfoInterval:####\n"
+                                 L"   - the millisecond frequency at which TCP details are read from the TCP stack for every connection\n"
+                                 L"\t- <default> == 0 (not sampled)\n"
+                                 L"\t- the RTT (min/avg/max), congestion window, retransmissions and delivery rate\n"
+                                 L"\t  are added to the results of each connection\n"
+                                 L"\t  note : the interval is lengthened when needed to keep sampling under 1% of the interval\n"
+                                 L"\t  note : requires Windows 10 version 1703 or later\n"
                                  L"-Transfer:#####\n"
                                  L"   - the total bytes to transfer per TCP connection\n"
                                  L"\t- <default> == 1073741824  (each connection will transfer a sum total of 1GB)\n"
@@ -1946,6 +2422,9 @@ namespace ctsTraffic {
                                  L"    at a fixed bit-rate and frame-size                                \n"
                                  L"                                                                      \n"
                                  L"  -BitsPerSecond, -FrameRate, -BufferDepth, -StreamLength,            \n"
+                                 L"  -PlayoutBuffer, -FecFrames, -FecParity, -DatagramPacing,            \n"
+                                 L"  -ClockProbeInterval, -DatagramHeader, -GopFrames, -IFrameRatio,     \n"
+                                 L"  -FrameSizeFile                                                      \n"
                                  L"                                                                      \n"
                                  L"----------------------------------------------------------------------\n"
                                  L"-BitsPerSecond:####\n"
@@ -1965,6 +2444,57 @@ namespace ctsTraffic {
                                  L"-StreamLength:####\n"
                                  L"   - the total number of seconds to run the entire stream\n"
                                  L"\t- <required>\n"
+                                 L"-PlayoutBuffer:<fixed,adaptive>\n"
+                                 L"   - how the client-side sizes the buffer of frames waiting to be processed\n"
+                                 L"\t- <default> == fixed\n"
+                                 L"\t- fixed : always processes frames -BufferDepth seconds behind the first frame\n"
+                                 L"\t- adaptive : starts at -BufferDepth, then grows or shrinks the buffer to track the measured jitter\n"
+                                 L"\t  note : the buffer can shrink to 2 frames and grow to twice -BufferDepth\n"
+                                 L"\t       : when the buffer runs dry the client stops processing (rebuffers) until it refills\n"
+                                 L"-FecFrames:####\n"
+                                 L"   - enables forward error correction: the number of frames in each group protected by parity datagrams\n"
+                                 L"\t- <default> == 0 (no parity datagrams are sent)\n"
+                                 L"\t  note : each frame must fit in a single datagram (up to 64000 bytes)\n"
+                                 L"\t       : the client rebuilds a lost frame from the parity and the other frames in its group\n"
+                                 L"-FecParity:####\n"
+                                 L"   - the number of parity datagrams sent after each group of -FecFrames frames\n"
+                                 L"\t- <default> == 1 (when -FecFrames is specified)\n"
+                                 L"\t  note : parity datagrams are interleaved across the group: each covers every -FecParity'th frame\n"
+                                 L"\t       : any burst of up to -FecParity consecutive lost frames in a group can be rebuilt\n"
+                                 L"-DatagramPacing:<burst,spread>\n"
+                                 L"   - how the server-side sends the datagrams of each frame\n"
+                                 L"\t- <default> == burst\n"
+                                 L"\t- burst : sends all datagrams of a frame back-to-back when the frame is due\n"
+                                 L"\t- spread : spaces the datagrams of each frame evenly across the frame interval\n"
+                                 L"\t  note : spread waits out sub-millisecond gaps by spinning, dedicating a thread to sending\n"
+                                 L"\t       : the achieved gaps between datagrams are reported in the summary\n"
+                                 L"-ClockProbeInterval:####\n"
+                                 L"   - the client-side measures the one-way delay of each datagram, sending a clock probe every #### milliseconds\n"
+                                 L"\t- <default> == 0 (one-way delay is not measured)\n"
+                                 L"\t  note : the server echoes each probe with its own timestamps to estimate the offset and drift between the clocks\n"
+                                 L"\t       : datagrams received before the first probe is answered are not measured\n"
+                                 L"\t       : the delay percentiles and the drift-corrected jitter are reported with each connection\n"
+                                 L"-DatagramHeader:<legacy,compact>\n"
+                                 L"   - the header the client-side requests the server to put in front of each datagram\n"
+                                 L"\t- <default> == legacy\n"
+                                 L"\t- legacy : 26 bytes - the 64-bit sequence number, QPC and QPF of the sender\n"
+                                 L"\t- compact : 7 to 16 bytes - the sequence number as a varint and a 32-bit microsecond timestamp\n"
+                                 L"\t  note : the client falls back to legacy if the server doesn't answer the compact request\n"
+                                 L"\t       : servers always accept both: the connection ID is sent as a 16-byte binary UUID with compact\n"
+                                 L"-GopFrames:####\n"
+                                 L"   - streams groups of pictures of #### frames: one large I frame followed by smaller P frames\n"
+                                 L"\t- <default> == 0 (every frame is the same size)\n"
+                                 L"\t  note : each group averages the frame size from -BitsPerSecond and -FrameRate\n"
+                                 L"\t       : the client and the server must both be given the same frame size profile\n"
+                                 L"-IFrameRatio:####\n"
+                                 L"   - the size of the I frame as a multiple of the size of a P frame\n"
+                                 L"\t- <default> == 8 (when -GopFrames is specified)\n"
+                                 L"-FrameSizeFile:<file name>\n"
+                                 L"   - sizes the frames from a trace: a text file of frame sizes, one per line\n"
+                                 L"\t- <default> == not set (every frame is the same size)\n"
+                                 L"\t  note : the sizes are scaled to average the frame size from -BitsPerSecond and -FrameRate\n"
+                                 L"\t       : the trace repeats for streams longer than the number of frames in the file\n"
+                                 L"\t       : the client and the server must both be given the same file\n"
                                  L"\n");
                     break;
 
@@ -1976,7 +2506,8 @@ namespace ctsTraffic {
                                  L"  -ConsoleVerbosity,                                                  \n"
                                  L"                                                                      \n"
                                  L"  -ConnectionFilename, -ErrorFilename, -JitterFilename                \n"
-                                 L"  -StatusFilename, -StatusUpdate                                      \n"
+                                 L"  -MetricsPort, -StatusFilename, -StatusUpdate                        \n"
+                                 L"  -TimeSeriesFilename, -TimeSeriesInterval, -TimeSeriesMaxMemory      \n"
                                  L"                                                                      \n"
                                  L"----------------------------------------------------------------------\n"
                                  L"Logging in ctsTraffic:\n"
@@ -2043,6 +2574,28 @@ namespace ctsTraffic {
                                  L"-StatusUpdate:####\n"
                                  L"\t - the millisecond frequency which real-time status updates are written\n"
                                  L"\t   <default> == 5000 (milliseconds)\n"
+                                 L"-MetricsPort:####\n"
+                                 L"\t - the TCP port on which to serve live status counters over HTTP\n"
+                                 L"\t   in the OpenMetrics text format (e.g. http://<host>:<port>/metrics)\n"
+                                 L"\t   <default> == (not enabled)\n"
+                                 L"\t   note : counters are aggregate values from all connections since the start\n"
+                                 L"\t          and are not reset by -StatusUpdate time slices\n"
+                                 L"-TimeSeriesFilename:<filename with/without path>\n"
+                                 L"\t - samples the counters of every connection over its lifetime, written as each connection closes\n"
+                                 L"\t   TCP: bytes sent and bytes received; UDP: bits received, completed frames and dropped frames\n"
+                                 L"\t   <default> == (not written to a log file)\n"
+                                 L"\t   note : this file cannot be shared with the other logging options\n"
+                                 L"-TimeSeriesInterval:####\n"
+                                 L"\t - the millisecond frequency at which each connection's counters are sampled\n"
+                                 L"\t   samples are taken on a timer, so stalled connections are still sampled\n"
+                                 L"\t   <default> == 100 (milliseconds)\n"
+                                 L"-TimeSeriesMaxMemory:####\n"
+                                 L"\t - the megabytes reserved for samples across all connections open at the same time\n"
+                                 L"\t   each connection reserves up to 1024 samples when it starts; once these fill up\n"
+                                 L"\t   its older samples are thinned out, so long connections have coarser history\n"
+                                 L"\t   once this limit is reached, new connections still reserve 8 samples: the connections\n"
+                                 L"\t   holding more give back half their samples (doubling their interval) to cover them\n"
+                                 L"\t   <default> == 64 (megabytes)\n"
                                  L"\n");
                     break;
 
@@ -2053,10 +2606,10 @@ namespace ctsTraffic {
                                  L"                                                                      \n"
                                  L"  * these options target specific scenario requirements               \n"
                                  L"                                                                      \n"
-                                 L" -Acc, -Bind, -Compartment, -Conn, -IO, -LocalPort,                   \n"
-                                 L" -OnError, -Options, -Pattern, -PrePostRecvs, -PrePostSends,          \n"
-                                 L" -RateLimitPeriod, -RecvBufValue, -SendBufValue,                      \n"
-                                 L" -ThrottleConnections, -TimeLimit                                     \n"
+                                 L" -Acc, -Bind, -Compartment, -Conn, -IO, -LargePages, -LocalPort,      \n"
+                                 L" -OnError, -Options, -Pattern, -Payload, -PrePostRecvs,               \n"
+                                 L" -PrePostSends, -RateLimitPeriod, -RecvBufValue, -SendBacklog,        \n"
+                                 L" -SendBufValue, -ThrottleConnections, -TimeLimit                      \n"
                                  L"                                                                      \n"
                                  L"----------------------------------------------------------------------\n"
                                  L"-Acc:<accept,AcceptEx>\n"
@@ -2093,6 +2646,13 @@ namespace ctsTraffic {
                                  L"-IO:<readwritefile>\n"
                                  L"   - an additional IO option beyond iocp and rioiocp\n"
                                  L"\t- readwritefile : leverages ReadFile/WriteFile using IOCP for async completions\n"
+                                 L"-LargePages:<on,off>\n"
+                                 L"   - backs the shared send/recv pattern buffers, and recv buffers of at least one large page,\n"
+                                 L"     with large pages to reduce TLB misses at high throughput\n"
+                                 L"\t- <default> == off\n"
+                                 L"\t  note : requires the 'Lock pages in memory' privilege (SeLockMemoryPrivilege)\n"
+                                 L"\t         buffers fall back to regular pages when large pages cannot be allocated\n"
+                                 L"\t  note : the shared send buffer is always replicated on each NUMA node, independent of this option\n"
                                  L"-LocalPort:####\n"
                                  L"   - the local port to bind to when initiating a connection\n"
                                  L"\t- <default> == 0  (an ephemeral port will be chosen when making a connection)\n"
@@ -2114,6 +2674,16 @@ namespace ctsTraffic {
                                  L"\t            : ctsTraffic servers have this enabled by default\n"
                                  L"\t- tcpfastpath : a new option for Windows 8, only for TCP sockets over loopback\n"
                                  L"\t              : the firewall must be disabled for the option to take effect\n"
+                                 L"-Payload:<pattern,random>\n"
+                                 L"   - the data sent over TCP connections\n"
+                                 L"\t- <default> == pattern\n"
+                                 L"\t- pattern : a repeating pattern of 16-bit values, sent from one buffer shared by all connections\n"
+                                 L"\t- random : incompressible pseudo-random bytes, generated for each connection from its connection id\n"
+                                 L"\t           the receiver regenerates the same bytes to verify them (with -verify:data)\n"
+                                 L"\t  note : is not supported with -Pattern:MediaStream\n"
+                                 L"-PayloadSeed:####\n"
+                                 L"   - the seed to generate -Payload:random from: the client and server must specify the same seed\n"
+                                 L"\t- <default> == 0\n"
                                  L"-PrePostRecvs:#####\n"
                                  L"   - specifies the number of recv requests to issue concurrently within an IO Pattern\n"
                                  L"   - for example, with the default -pattern:pull, the client will post recv calls \n"
@@ -2147,6 +2717,13 @@ namespace ctsTraffic {
                                  L"\t     Note: this is only necessary to specify in carefully considered scenarios\n"
                                  L"\t     the default receive buffering is optimal for the majority of scenarios\n"
                                  L"\t- <default> == <not set>\n"
+                                 L"-SendBacklog:<isb,tcpinfo>\n"
+                                 L"   - with -PrePostSends:0, specifies how the number of bytes kept in-flight in sends is sized\n"
+                                 L"\t- isb : follows the Ideal Send Backlog (ISB) notifications from TCP\n"
+                                 L"\t- tcpinfo : sizes the send backlog from the congestion and send windows in each\n"
+                                 L"\t     -TcpInfoInterval sample (for when ISB notifications are not delivered)\n"
+                                 L"\t- <default> == isb\n"
+                                 L"\t  note : tcpinfo requires -TcpInfoInterval (SIO_TCP_INFO requires Windows 10 1703 or later)\n"
                                  L"-SendBufValue:#####\n"
                                  L"   - specifies the value to pass to the SO_SNDBUF socket option\n"
                                  L"\t     Note: this is only necessary to specify in carefully considered scenarios\n"
@@ -2324,11 +2901,15 @@ namespace ctsTraffic {
             if (s_JitterLogger && Settings->ConnectionLimit != 1) {
                 throw invalid_argument("Jitter can only be logged for a single UDP connection");
             }
+            if (Settings->TcpInfoIntervalMilliseconds != 0 && Settings->Protocol != ctsConfig::ProtocolType::TCP) {
+                throw invalid_argument("-TcpInfoInterval is only supported with TCP");
+            }
 
             if (s_MediaStreamSettings.FrameSizeBytes > 0) {
                 // the buffersize is now effectively the frame size
+                // - buffers are allocated once for the largest frame in the profile
                 s_BufferSizeHigh = 0;
-                s_BufferSizeLow = s_MediaStreamSettings.FrameSizeBytes;
+                s_BufferSizeLow = s_MediaStreamSettings.MaximumFrameSizeBytes;
                 if (s_BufferSizeLow < 20) {
                     throw invalid_argument("The media stream frame size (buffer) must be at least 20 bytes");
                 }
@@ -2353,6 +2934,8 @@ namespace ctsTraffic {
             Settings->ShouldVerifyBuffers = true;
             Settings->UseSharedBuffer = false;
             set_shouldVerifyBuffers(args);
+            set_payload(args);
+            set_largePages(args);
             if (ProtocolType::UDP == Settings->Protocol) {
                 // UDP clients can never recv into the same shared buffer since it uses it for seq. numbers, etc
                 if (!IsListening()) {
@@ -2383,6 +2966,7 @@ namespace ctsTraffic {
                 throw invalid_argument("-PrePostRecvs > 1 requires -Verify:connection when using TCP");
             }
             set_prepostsends(args);
+            set_sendbacklog(args);
             set_recvbufvalue(args);
             set_sendbufvalue(args);
 
@@ -2470,15 +3054,39 @@ namespace ctsTraffic {
 
             if (s_ConnectionLogger && s_ConnectionLogger->IsCsvFormat()) {
                 if (ProtocolType::UDP == Settings->Protocol) {
-                    s_ConnectionLogger->LogMessage(L"TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId\r\n");
+                    wstring csv_header(L"TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId");
+                    if (s_MediaStreamSettings.AdaptivePlayout) {
+                        csv_header.append(L",Rebuffers,BufferingMs,PlayoutDelayMs");
+                    }
+                    // the server only tracks the parity sent across all connections
+                    if (s_MediaStreamSettings.FecDataFrames > 0 && !IsListening()) {
+                        csv_header.append(L",Recovered,Unrecoverable,ParityBits");
+                    }
+                    if (s_MediaStreamSettings.ClockProbeIntervalMilliseconds > 0) {
+                        csv_header.append(L",DelayP50Us,DelayP95Us,DelayP99Us,DelayJitterUs,ClockSkewPpb");
+                    }
+                    csv_header.append(L"\r\n");
+                    s_ConnectionLogger->LogMessage(csv_header.c_str());
                 } else { // TCP
-                    s_ConnectionLogger->LogMessage(L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId\r\n");
+                    if (Settings->TcpInfoIntervalMilliseconds != 0) {
+                        s_ConnectionLogger->LogMessage(L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId,RttMinUs,RttAvgUs,RttMaxUs,CwndBytes,RetransBytes,Retransmits,DeliveryBps\r\n");
+                    } else {
+                        s_ConnectionLogger->LogMessage(L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId\r\n");
+                    }
                 }
             }
 
             if (s_JitterLogger && s_JitterLogger->IsCsvFormat()) {
                 s_JitterLogger->LogMessage(L"SequenceNumber,SenderQpc,SenderQpf,ReceiverQpc,ReceiverQpf,PriorReceiveDelta,EstReceivedDgramInFlight\r\n");
             }
+
+            if (s_TimeSeriesLogger && s_TimeSeriesLogger->IsCsvFormat()) {
+                if (ProtocolType::UDP == Settings->Protocol) {
+                    s_TimeSeriesLogger->LogMessage(L"ConnectionId,TimeMs,BitsReceived,Completed,Dropped\r\n");
+                } else { // TCP
+                    s_TimeSeriesLogger->LogMessage(L"ConnectionId,TimeMs,SendBytes,RecvBytes\r\n");
+                }
+            }
         }
 
         // Always print to console if override
@@ -2677,6 +3285,7 @@ namespace ctsTraffic {
         }
         void PrintStatusUpdate() NOEXCEPT
         {
+            ctsTracePoint("ctsConfig::PrintStatusUpdate", nullptr, "active", Settings->ConnectionStatusDetails.active_connection_count.get(), nullptr, 0);
             if (!s_ShutdownCalled) {
                 if (s_PrintStatusInformation) {
                     bool write_to_console = false;
@@ -2794,6 +3403,41 @@ namespace ctsTraffic {
             }
         }
 
+        void PrintTimeSeries(_In_z_ const char* _connection_id, const ctsTimeSeries& _time_series) NOEXCEPT
+        {
+            // written even after shutdown so the connections completing with the final summaries are captured
+            if (!s_TimeSeriesLogger || 0 == _time_series.size()) {
+                return;
+            }
+
+            try {
+                const bool is_csv = s_TimeSeriesLogger->IsCsvFormat();
+                const bool is_udp = (ProtocolType::UDP == Settings->Protocol);
+                // formatting all samples for this connection into a single write keeps them contiguous in the file
+                wstring time_series_text;
+                for (size_t index = 0; index < _time_series.size(); ++index) {
+                    const ctsTimeSeries::Sample& sample = _time_series[index];
+                    if (is_udp) {
+                        time_series_text.append(ctString::format_string(
+                            is_csv ?
+                                L"%hs,%lld,%lld,%lld,%lld\r\n" :
+                                L"[%hs] TimeMs: %lld, BitsReceived: %lld, Completed: %lld, Dropped: %lld\r\n",
+                            _connection_id, sample.time_offset, sample.counters[0], sample.counters[1], sample.counters[2]));
+                    } else {
+                        time_series_text.append(ctString::format_string(
+                            is_csv ?
+                                L"%hs,%lld,%lld,%lld\r\n" :
+                                L"[%hs] TimeMs: %lld, SendBytes: %lld, RecvBytes: %lld\r\n",
+                            _connection_id, sample.time_offset, sample.counters[0], sample.counters[1]));
+                    }
+                }
+                s_TimeSeriesLogger->LogMessage(time_series_text.c_str());
+            }
+            catch (const exception& e) {
+                PrintException(e);
+            }
+        }
+
         void PrintNewConnection(const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _remote_addr) NOEXCEPT
         {
             ctsConfigInitOnce();
@@ -2878,7 +3522,12 @@ namespace ctsTraffic {
             static LPCWSTR TCPProtocolFailureResultTextFormat = L"[%.3f] TCP connection failed with the protocol error %ws : [%ws - %ws] [%hs] : SendBytes[%lld]  SendBps[%lld]  RecvBytes[%lld]  RecvBps[%lld]  Time[%lld ms]";
 
             // csv format : L"TimeSlice,LocalAddress,RemoteAddress,SendBytes,SendBps,RecvBytes,RecvBps,TimeMs,Result,ConnectionId"
-            static LPCWSTR TCPResultCsvFormat = L"%.3f,%ws,%ws,%lld,%lld,%lld,%lld,%lld,%ws,%hs\r\n";
+            static LPCWSTR TCPResultCsvFormat = L"%.3f,%ws,%ws,%lld,%lld,%lld,%lld,%lld,%ws,%hs";
+
+            // appended when -TcpInfoInterval is specified
+            static LPCWSTR TCPInfoTextFormat = L"  Rtt[%lld/%lld/%lld us]  Cwnd[%lld]  RetransBytes[%lld]  Retransmits[%lld]  DeliveryBps[%lld]";
+            // csv format : L",RttMinUs,RttAvgUs,RttMaxUs,CwndBytes,RetransBytes,Retransmits,DeliveryBps"
+            static LPCWSTR TCPInfoCsvFormat = L",%lld,%lld,%lld,%lld,%lld,%lld,%lld";
 
             long long total_time = (_stats.end_time.get() - _stats.start_time.get());
             ctl::ctFatalCondition(
@@ -2918,6 +3567,18 @@ namespace ctsTraffic {
                             ctsIOPattern::BuildProtocolErrorString(_error) :
                             error_string.c_str(),
                         _stats.connection_identifier);
+                    if (Settings->TcpInfoIntervalMilliseconds != 0) {
+                        csv_string.append(ctString::format_string(
+                            TCPInfoCsvFormat,
+                            _stats.tcp_info.rtt_min_us.get(),
+                            _stats.tcp_info.rtt_avg_us(),
+                            _stats.tcp_info.rtt_max_us.get(),
+                            _stats.tcp_info.cwnd_bytes.get(),
+                            _stats.tcp_info.bytes_retransmitted.get(),
+                            _stats.tcp_info.retransmits.get(),
+                            _stats.tcp_info.delivery_rate.get()));
+                    }
+                    csv_string.append(L"\r\n");
                 }
                 // we'll never write csv format to the console so we'll need a text string in that case
                 // - and/or in the case the s_ConnectionLogger isn't writing to csv
@@ -2948,6 +3609,18 @@ namespace ctsTraffic {
                             (total_time > 0LL) ? static_cast<long long>(_stats.bytes_recv.get() * 1000LL / total_time) : 0LL,
                             total_time);
                     }
+                    // only connections which lived long enough to be sampled have these details
+                    if (_stats.tcp_info.sample_count.get() > 0LL) {
+                        text_string.append(ctString::format_string(
+                            TCPInfoTextFormat,
+                            _stats.tcp_info.rtt_min_us.get(),
+                            _stats.tcp_info.rtt_avg_us(),
+                            _stats.tcp_info.rtt_max_us.get(),
+                            _stats.tcp_info.cwnd_bytes.get(),
+                            _stats.tcp_info.bytes_retransmitted.get(),
+                            _stats.tcp_info.retransmits.get(),
+                            _stats.tcp_info.delivery_rate.get()));
+                    }
                 }
 
                 if (write_to_console) {
@@ -3006,7 +3679,22 @@ namespace ctsTraffic {
             static LPCWSTR UDPProtocolFailureResultTextFormat = L"[%.3f] UDP connection failed with the protocol error %ws : [%ws - %ws] [%hs] : BitsPerSecond [%llu]  Completed [%llu]  Dropped [%llu]  Repeated [%llu]  Errors [%llu]";
 
             // csv format : "TimeSlice,LocalAddress,RemoteAddress,Bits/Sec,Completed,Dropped,Repeated,Errors,Result,ConnectionId"
-            static LPCWSTR UDPResultCsvFormat = L"%.3f,%ws,%ws,%llu,%llu,%llu,%llu,%llu,%ws,%hs\r\n";
+            static LPCWSTR UDPResultCsvFormat = L"%.3f,%ws,%ws,%llu,%llu,%llu,%llu,%llu,%ws,%hs";
+
+            // appended when -PlayoutBuffer:adaptive is specified
+            static LPCWSTR UDPPlayoutTextFormat = L"  Rebuffers [%llu]  Buffering [%llu ms]  PlayoutDelay [%llu ms]";
+            // csv format : L",Rebuffers,BufferingMs,PlayoutDelayMs"
+            static LPCWSTR UDPPlayoutCsvFormat = L",%llu,%llu,%llu";
+
+            // appended when -FecFrames is specified
+            static LPCWSTR UDPParityTextFormat = L"  Recovered [%llu]  Unrecoverable [%llu]  ParityBits [%llu]";
+            // csv format : L",Recovered,Unrecoverable,ParityBits"
+            static LPCWSTR UDPParityCsvFormat = L",%llu,%llu,%llu";
+
+            // appended when -ClockProbeInterval is specified
+            static LPCWSTR UDPDelayTextFormat = L"  OneWayDelay p50/p95/p99 [%lld/%lld/%lld us]  DelayJitter [%lld us]  ClockSkew [%lld ppb]";
+            // csv format : L",DelayP50Us,DelayP95Us,DelayP99Us,DelayJitterUs,ClockSkewPpb"
+            static LPCWSTR UDPDelayCsvFormat = L",%lld,%lld,%lld,%lld,%lld";
 
             float current_time = ctsConfig::GetStatusTimeStamp();
             long long elapsed_time(_stats.end_time.get() - _stats.start_time.get());
@@ -3044,6 +3732,30 @@ namespace ctsTraffic {
                             ctsIOPattern::BuildProtocolErrorString(_error) :
                             error_string.c_str(),
                         _stats.connection_identifier);
+                    if (s_MediaStreamSettings.AdaptivePlayout) {
+                        csv_string.append(ctString::format_string(
+                            UDPPlayoutCsvFormat,
+                            _stats.rebuffer_count.get(),
+                            _stats.buffering_milliseconds.get(),
+                            _stats.playout_delay_milliseconds()));
+                    }
+                    if (s_MediaStreamSettings.FecDataFrames > 0 && !IsListening()) {
+                        csv_string.append(ctString::format_string(
+                            UDPParityCsvFormat,
+                            _stats.recovered_frames.get(),
+                            _stats.unrecoverable_frames.get(),
+                            _stats.parity_bits.get()));
+                    }
+                    if (s_MediaStreamSettings.ClockProbeIntervalMilliseconds > 0) {
+                        csv_string.append(ctString::format_string(
+                            UDPDelayCsvFormat,
+                            _stats.delay_p50_microseconds.get(),
+                            _stats.delay_p95_microseconds.get(),
+                            _stats.delay_p99_microseconds.get(),
+                            _stats.delay_jitter_microseconds.get(),
+                            _stats.clock_skew_ppb.get()));
+                    }
+                    csv_string.append(L"\r\n");
                 }
                 // we'll never write csv format to the console so we'll need a text string in that case
                 // - and/or in the case the s_ConnectionLogger isn't writing to csv
@@ -3076,6 +3788,29 @@ namespace ctsTraffic {
                             _stats.duplicate_frames.get(),
                             _stats.error_frames.get());
                     }
+                    if (s_MediaStreamSettings.AdaptivePlayout) {
+                        text_string.append(ctString::format_string(
+                            UDPPlayoutTextFormat,
+                            _stats.rebuffer_count.get(),
+                            _stats.buffering_milliseconds.get(),
+                            _stats.playout_delay_milliseconds()));
+                    }
+                    if (s_MediaStreamSettings.FecDataFrames > 0 && !IsListening()) {
+                        text_string.append(ctString::format_string(
+                            UDPParityTextFormat,
+                            _stats.recovered_frames.get(),
+                            _stats.unrecoverable_frames.get(),
+                            _stats.parity_bits.get()));
+                    }
+                    if (s_MediaStreamSettings.ClockProbeIntervalMilliseconds > 0) {
+                        text_string.append(ctString::format_string(
+                            UDPDelayTextFormat,
+                            _stats.delay_p50_microseconds.get(),
+                            _stats.delay_p95_microseconds.get(),
+                            _stats.delay_p99_microseconds.get(),
+                            _stats.delay_jitter_microseconds.get(),
+                            _stats.clock_skew_ppb.get()));
+                    }
                 }
 
                 if (write_to_console) {
@@ -3504,6 +4239,9 @@ namespace ctsTraffic {
             setting_string.append(L"\n");
 
             setting_string.append(ctString::format_string(L"\tIO function: %ws\n", s_IoFunctionName));
+            if (Settings->MaxIoSegments > 1) {
+                setting_string.append(ctString::format_string(L"\tIO segments: up to %lu buffers per call\n", Settings->MaxIoSegments));
+            }
 
             setting_string.append(L"\tIoPattern: ");
             switch (Settings->IoPattern) {
@@ -3535,15 +4273,33 @@ namespace ctsTraffic {
             if (Settings->PrePostSends > 0) {
                 setting_string.append(ctString::format_string(L"\tPrePostSends: %u\n", static_cast<unsigned long>(Settings->PrePostSends)));
             } else {
-                setting_string.append(ctString::format_string(L"\tPrePostSends: Following Ideal Send Backlog\n"));
+                setting_string.append(ctString::format_string(
+                    L"\tPrePostSends: Following Ideal Send Backlog%ws\n",
+                    Settings->SendBacklogFromTcpInfo ? L" (sized from TCP info)" : L""));
             }
 
             setting_string.append(
                 ctString::format_string(
                     L"\tLevel of verification: %ws\n",
                     Settings->ShouldVerifyBuffers ? L"Connections & Data" : L"Connections"));
+            if (Settings->RandomPayload) {
+                setting_string.append(ctString::format_string(L"\tPayload: random (seed %llu)\n", Settings->PayloadSeed));
+            }
 
             setting_string.append(ctString::format_string(L"\tPort: %u\n", Settings->Port));
+            if (Settings->MetricsPort != 0) {
+                setting_string.append(ctString::format_string(L"\tMetrics Port: %u\n", Settings->MetricsPort));
+            }
+            if (Settings->TcpInfoIntervalMilliseconds != 0) {
+                setting_string.append(ctString::format_string(L"\tTCP Info sampled every: %u milliseconds\n", Settings->TcpInfoIntervalMilliseconds));
+            }
+            if (Settings->TimeSeriesIntervalMilliseconds != 0) {
+                setting_string.append(
+                    ctString::format_string(
+                        L"\tTime-Series: sampled every %u milliseconds, %lld MB limit\n",
+                        Settings->TimeSeriesIntervalMilliseconds,
+                        Settings->TimeSeriesMemoryRemaining.get() / (1024LL * 1024LL)));
+            }
 
             if (0 == s_BufferSizeHigh) {
                 setting_string.append(
@@ -3583,6 +4339,10 @@ namespace ctsTraffic {
                         ctString::format_string(
                             L"\t\tUDP Stream BufferDepth: %lu seconds\n",
                             static_cast<unsigned long>(s_MediaStreamSettings.BufferDepthSeconds)));
+                    setting_string.append(
+                        ctString::format_string(
+                            L"\t\tUDP Stream PlayoutBuffer: %ws\n",
+                            s_MediaStreamSettings.AdaptivePlayout ? L"adaptive" : L"fixed"));
                 }
                 setting_string.append(
                     ctString::format_string(
@@ -3593,6 +4353,45 @@ namespace ctsTraffic {
                     ctString::format_string(
                         L"\t\tUDP Stream FrameSize: %lu bytes\n",
                         static_cast<unsigned long>(s_MediaStreamSettings.FrameSizeBytes)));
+                if (!s_MediaStreamSettings.FrameSizeTrace.empty()) {
+                    setting_string.append(
+                        ctString::format_string(
+                            L"\t\tUDP Stream FrameProfile: trace of %lu frames (largest frame %lu bytes)\n",
+                            s_MediaStreamSettings.FrameProfile.cycle_length(),
+                            static_cast<unsigned long>(s_MediaStreamSettings.MaximumFrameSizeBytes)));
+                } else if (s_MediaStreamSettings.GopFrames > 0) {
+                    setting_string.append(
+                        ctString::format_string(
+                            L"\t\tUDP Stream FrameProfile: GOP of %lu frames, I frame %lu bytes, P frame %lu bytes\n",
+                            static_cast<unsigned long>(s_MediaStreamSettings.GopFrames),
+                            s_MediaStreamSettings.FrameProfile.frame_size(1LL),
+                            s_MediaStreamSettings.FrameProfile.frame_size(2LL)));
+                }
+                if (s_MediaStreamSettings.FecDataFrames > 0) {
+                    setting_string.append(
+                        ctString::format_string(
+                            L"\t\tUDP Stream FEC: %lu parity datagrams per %lu frames\n",
+                            static_cast<unsigned long>(s_MediaStreamSettings.FecParityFrames),
+                            static_cast<unsigned long>(s_MediaStreamSettings.FecDataFrames)));
+                }
+                if (IsListening()) {
+                    setting_string.append(
+                        ctString::format_string(
+                            L"\t\tUDP Stream DatagramPacing: %ws\n",
+                            s_MediaStreamSettings.SpreadDatagrams ? L"spread" : L"burst"));
+                }
+                if (s_MediaStreamSettings.ClockProbeIntervalMilliseconds > 0) {
+                    setting_string.append(
+                        ctString::format_string(
+                            L"\t\tUDP Stream ClockProbeInterval: %lu milliseconds\n",
+                            static_cast<unsigned long>(s_MediaStreamSettings.ClockProbeIntervalMilliseconds)));
+                }
+                if (!IsListening()) {
+                    setting_string.append(
+                        ctString::format_string(
+                            L"\t\tUDP Stream DatagramHeader: %ws\n",
+                            s_MediaStreamSettings.CompactHeader ? L"compact" : L"legacy"));
+                }
             }
 
             if (ProtocolType::TCP == Settings->Protocol && s_RateLimitLow > 0) {
@@ -3712,6 +4511,9 @@ namespace ctsTraffic {
                 }
             }
 
+            // creates the shared buffers now so their placement is reported before any connection starts
+            setting_string.append(ctsIOPattern::DescribeSharedBuffers());
+
             setting_string.append(L"\n");
 
             // immediately print the legend once we know the status info object
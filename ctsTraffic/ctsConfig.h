@@ -27,9 +27,11 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // - with the below exceptions : these do not include any cts* headers
 //   -- ctsSafeInt.hpp
 //   -- ctsStatistics.hpp
+//   -- ctsMediaStreamFrameProfile.hpp
 //
 #include "ctsSafeInt.hpp"
 #include "ctsStatistics.hpp"
+#include "ctsMediaStreamFrameProfile.hpp"
 
 
 namespace ctsTraffic {
@@ -171,6 +173,7 @@ namespace ctsTraffic {
             unsigned long received = 0UL;
         };
         void PrintJitterUpdate(const JitterFrameEntry& current_frame, const JitterFrameEntry& previous_frame, const JitterFrameEntry& first_frame) NOEXCEPT;
+        void PrintTimeSeries(_In_z_ const char* _connection_id, const ctsTimeSeries& _time_series) NOEXCEPT;
 
         void PrintStatusUpdate() NOEXCEPT;
         void __cdecl PrintSummary(_In_z_ _Printf_format_string_ LPCWSTR text, ...) NOEXCEPT;
@@ -223,8 +226,27 @@ namespace ctsTraffic {
 			ctsUnsignedLong FramesPerSecond = 0;
 			ctsUnsignedLong BufferDepthSeconds = 0;
 			ctsUnsignedLong StreamLengthSeconds = 0;
+			// client-only: resize the playout buffer from the measured jitter (-PlayoutBuffer:adaptive)
+			bool AdaptivePlayout = false;
+			// forward error correction: FecParityFrames parity datagrams per FecDataFrames frames (0 == not enabled)
+			ctsUnsignedLong FecDataFrames = 0;
+			ctsUnsignedLong FecParityFrames = 0;
+			// server-only: space the datagrams of each frame across the frame interval (-DatagramPacing:spread)
+			bool SpreadDatagrams = false;
+			// client-only: milliseconds between clock probes to measure one-way delay (0 == not enabled)
+			ctsUnsignedLong ClockProbeIntervalMilliseconds = 0;
+			// client-only: request the compact datagram headers from the server (-DatagramHeader:compact)
+			bool CompactHeader = false;
+			// frame size profile: -GopFrames with -IFrameRatio, or the relative frame sizes read from -FrameSizeFile
+			// - both the client and the server must be given the same profile
+			ctsUnsignedLong GopFrames = 0;
+			ctsUnsignedLong IFrameRatio = 0;
+			std::vector<unsigned long> FrameSizeTrace;
 			// internally calculated
+			// - FrameSizeBytes is the average frame size: individual frames are sized from FrameProfile
 			ctsUnsignedLong FrameSizeBytes = 0;
+			ctsUnsignedLong MaximumFrameSizeBytes = 0;
+			ctsMediaStreamFrameProfile FrameProfile;
 			ctsUnsignedLong StreamLengthFrames = 0;
 			ctsUnsignedLong BufferedFrames = 0;
 
@@ -273,7 +295,7 @@ namespace ctsTraffic {
                 }
 
                 FrameSizeBytes = static_cast<unsigned long>(total_frame_size_bytes);
-                if (FrameSizeBytes < 40) {
+                if (FrameSizeBytes < ctsMediaStreamFrameProfile::MinimumFrameSizeBytes) {
                     throw std::invalid_argument("The frame size is too small - it must be at least 40 bytes");
                 }
                 StreamLengthFrames = static_cast<unsigned long>(total_stream_length_frames);
@@ -284,7 +306,18 @@ namespace ctsTraffic {
                     L"FrameSizeBytes (%u) * StreamLengthFrames (%u) != TotalStreamLength (%llx)",
                     static_cast<unsigned long>(FrameSizeBytes), static_cast<unsigned long>(StreamLengthFrames), static_cast<unsigned long long>(total_stream_length_bytes));
 
-                return total_stream_length_bytes;
+                // the profile keeps the average frame size over each cycle of frame sizes
+                // - the stream length is the sum of the individual frames: a partial final cycle is not an exact average
+                if (!FrameSizeTrace.empty()) {
+                    FrameProfile = ctsMediaStreamFrameProfile::FromTrace(FrameSizeTrace, FrameSizeBytes);
+                } else if (GopFrames > 0) {
+                    FrameProfile = ctsMediaStreamFrameProfile::GroupOfPictures(FrameSizeBytes, GopFrames, IFrameRatio);
+                } else {
+                    FrameProfile = ctsMediaStreamFrameProfile::Constant(FrameSizeBytes);
+                }
+                MaximumFrameSizeBytes = FrameProfile.maximum_frame_size();
+
+                return FrameProfile.total_bytes(StreamLengthFrames);
             }
         };
         const MediaStreamSettings& GetMediaStream() NOEXCEPT;
@@ -331,8 +364,25 @@ namespace ctsTraffic {
             ctsConnectionStatistics ConnectionStatusDetails;
             ctsTcpStatistics TcpStatusDetails;
             ctsUdpStatistics UdpStatusDetails;
+            // distribution of connection lifetimes (milliseconds) across all connections
+            ctsHistogramStatistics ConnectionTimeHistogram;
+            // how late (microseconds) the MediaStream server sent each frame past its scheduled time
+            // - with -DatagramPacing:spread each paced datagram is also scheduled
+            ctsHistogramStatistics FrameSchedulingLatenessHistogram;
+            // the gap (microseconds) between consecutive datagrams of each MediaStream server stream
+            ctsHistogramStatistics DatagramGapHistogram;
+            // the one-way delay (microseconds) of every datagram received by MediaStream clients (-ClockProbeInterval)
+            ctsHistogramStatistics OneWayDelayHistogram;
 
             unsigned long StatusUpdateFrequencyMilliseconds = 0;
+            // optional port to serve OpenMetrics status (0 == not enabled)
+            unsigned short MetricsPort = 0;
+            // optional per-connection time-series sampling interval (0 == not enabled)
+            unsigned long TimeSeriesIntervalMilliseconds = 0;
+            // bytes still available to reserve for time-series samples across all connections
+            ctStatsTracking TimeSeriesMemoryRemaining;
+            // optional interval to sample TCP transport details for each connection (0 == not enabled)
+            unsigned long TcpInfoIntervalMilliseconds = 0;
 
             long long TcpBytesPerSecondPeriod = 100LL;
             long long StartTimeMilliseconds = 0;
@@ -340,11 +390,21 @@ namespace ctsTraffic {
             unsigned long TimeLimit = 0;
             unsigned long PrePostRecvs = 0;
             unsigned long PrePostSends = 0;
+            // with PrePostSends == 0, size the send backlog from TCP info samples instead of ISB notifications
+            bool SendBacklogFromTcpInfo = false;
+            // the most buffers the IO function posts in a single call (WSASend / WSARecv take several WSABUFs)
+            unsigned long MaxIoSegments = 1;
             unsigned long RecvBufValue = 0;
             unsigned long SendBufValue = 0;
 
             bool UseSharedBuffer = false;
             bool ShouldVerifyBuffers = false;
+            // send data generated from a stream keyed by PayloadSeed and each connection's id (-Payload:random)
+            // - instead of the repeating buffer pattern
+            bool RandomPayload = false;
+            unsigned long long PayloadSeed = 0ULL;
+            // back the shared pattern buffers and recv buffers with large pages when available (-LargePages)
+            bool UseLargePages = false;
 
             unsigned long PushBytes = 0;
             unsigned long PullBytes = 0;
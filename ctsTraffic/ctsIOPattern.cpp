@@ -15,17 +15,19 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsIOPattern.h"
 
 // cpp headers
+#include <exception>
 #include <vector>
 
 // ctl headers
 #include <ctSocketExtensions.hpp>
-#include <ctScopeGuard.hpp>
 #include <ctLocks.hpp>
 #include <ctTimer.hpp>
 
 // project headers
 #include "ctsMediaStreamProtocol.hpp"
 #include "ctsIOBuffers.hpp"
+#include "ctsRecvBufferArena.hpp"
+#include "ctsTrace.h"
 
 
 namespace ctsTraffic {
@@ -47,72 +49,114 @@ namespace ctsTraffic {
     static char* s_WriteableSharedBuffer = nullptr;
     static char* s_ProtectedSharedBuffer = nullptr;
     static unsigned long s_SharedBufferSize = 0;
+    /// the most bytes a single buffer (or segment) of an IO spans: IO larger than this is split into segments
+    /// - GetMaxBufferSize() unless the IO function posts vectored IO, when it only needs to be large enough
+    ///   for GetMaxBufferSize() to fit in MaxIoSegments segments
+    static unsigned long s_SharedBufferWindow = 0;
     static RIO_BUFFERID s_SharedBufferId = RIO_INVALID_BUFFERID;
 
+    /// The shared buffers come from ctsBufferAllocation and live for the lifetime of the process
+    /// - s_ProtectedSharedBuffers has one replica of the send pattern on each NUMA node
+    /// - s_ProtectedSharedBuffer is the node 0 replica, used where the node doesn't matter (verifying buffers, the DONE message)
+    static size_t s_LargePageSize = 0;
+    static vector<char*> s_ProtectedSharedBuffers;
+    static unsigned long s_LargePageSharedBuffers = 0;
+    static bool s_ProtectedSharedBuffersReadOnly = true;
+
     static const char* s_CompletionMessage = "DONE";
     static const unsigned long s_CompletionMessageSize = 4;
     static const unsigned long s_FinBufferSize = 4; // just 4 bytes for the FIN
     static char s_FinBuffer[s_FinBufferSize];
 
-    BOOL CALLBACK InitOnceIOPatternCallback(PINIT_ONCE, PVOID, PVOID *) NOEXCEPT
-    {
-        // first create the buffer pattern
-        for (unsigned long fill_slot = 0; fill_slot < BufferPatternSize; ++fill_slot)
-        {
-            *reinterpret_cast<unsigned short*>(&BufferPattern[fill_slot * 2]) = static_cast<unsigned short>(fill_slot);
-        }
-
-        s_SharedBufferSize = BufferPatternSize + ctsConfig::GetMaxBufferSize() + s_CompletionMessageSize;
-
-        s_ProtectedSharedBuffer = reinterpret_cast<char*>(::VirtualAlloc(nullptr, s_SharedBufferSize, MEM_COMMIT, PAGE_READWRITE));
-        if (!s_ProtectedSharedBuffer) {
-            ctAlwaysFatalCondition(L"VirtualAlloc alloc failed: %u", ::GetLastError());
-        }
-
-        s_WriteableSharedBuffer = reinterpret_cast<char*>(::VirtualAlloc(nullptr, s_SharedBufferSize, MEM_COMMIT, PAGE_READWRITE));
-        if (!s_WriteableSharedBuffer) {
-            ctAlwaysFatalCondition(L"VirtualAlloc alloc failed: %u", ::GetLastError());
-        }
+    /// recv buffers are chunks of s_SharedBufferWindow bytes checked out of one arena shared by all connections
+    /// - the arena grows in regions of about RecvBufferRegionBytes (or one large page when larger)
+    /// - with -Payload:random, sends check out chunks to hold their generated payload as well
+    static const size_t RecvBufferRegionBytes = 1024 * 1024;
+    static ctsRecvBufferArena* s_RecvBufferArena = nullptr;
 
-        // fill in this allocated buffer while we can write to it
-        char* protected_destination = s_ProtectedSharedBuffer;
-        char* writeable_destination = s_WriteableSharedBuffer;
+    static void FillSharedBuffer(_Out_writes_(s_SharedBufferSize) char* _shared_buffer) NOEXCEPT
+    {
+        char* destination = _shared_buffer;
         unsigned long write_size_remaining = s_SharedBufferSize;
         while (write_size_remaining > 0) {
             unsigned long bytes_to_write = (write_size_remaining > BufferPatternSize) ? BufferPatternSize : write_size_remaining;
 
-            auto memerror = ::memcpy_s(protected_destination, write_size_remaining, BufferPattern, bytes_to_write);
+            auto memerror = ::memcpy_s(destination, write_size_remaining, BufferPattern, bytes_to_write);
             ctFatalCondition(
                 memerror != 0,
                 L"memcpy_s(%p, %lu, %p, %lu) failed : %d",
-                protected_destination, write_size_remaining, BufferPattern, bytes_to_write, memerror);
+                destination, write_size_remaining, BufferPattern, bytes_to_write, memerror);
 
-            memerror = ::memcpy_s(writeable_destination, write_size_remaining, BufferPattern, bytes_to_write);
-            ctFatalCondition(
-                memerror != 0,
-                L"memcpy_s(%p, %lu, %p, %lu) failed : %d",
-                writeable_destination, write_size_remaining, BufferPattern, bytes_to_write, memerror);
-
-            protected_destination += bytes_to_write;
-            writeable_destination += bytes_to_write;
+            destination += bytes_to_write;
             write_size_remaining -= bytes_to_write;
         }
         // set the final 4 bytes to the DONE message for the send buffer
         ::memcpy_s(
-            s_ProtectedSharedBuffer + s_SharedBufferSize - s_CompletionMessageSize,
-            s_CompletionMessageSize,
-            s_CompletionMessage,
-            s_CompletionMessageSize);
-        ::memcpy_s(
-            s_WriteableSharedBuffer + s_SharedBufferSize - s_CompletionMessageSize,
+            _shared_buffer + s_SharedBufferSize - s_CompletionMessageSize,
             s_CompletionMessageSize,
             s_CompletionMessage,
             s_CompletionMessageSize);
+    }
 
-        // guarantee noone will write to our s_ProtectedSharedBuffer
-        DWORD old_setting;
-        if (!::VirtualProtect(s_ProtectedSharedBuffer, s_SharedBufferSize, PAGE_READONLY, &old_setting)) {
-            ctAlwaysFatalCondition(L"VirtualProtect failed: %u", ::GetLastError());
+    BOOL CALLBACK InitOnceIOPatternCallback(PINIT_ONCE, PVOID, PVOID *) NOEXCEPT
+    {
+        // first create the buffer pattern
+        for (unsigned long fill_slot = 0; fill_slot < BufferPatternSize; ++fill_slot)
+        {
+            *reinterpret_cast<unsigned short*>(&BufferPattern[fill_slot * 2]) = static_cast<unsigned short>(fill_slot);
+        }
+
+        // a window which is a multiple of BufferPatternSize ends on the same pattern offset it started at
+        // - so every segment of a send can reuse the same window of the shared buffer
+        const unsigned long max_buffer_size = ctsConfig::GetMaxBufferSize();
+        s_SharedBufferWindow = max_buffer_size;
+        if (ctsConfig::Settings->MaxIoSegments > 1) {
+            const unsigned long segment_size = (max_buffer_size + ctsConfig::Settings->MaxIoSegments - 1) / ctsConfig::Settings->MaxIoSegments;
+            const unsigned long window = (segment_size + BufferPatternSize - 1) / BufferPatternSize * BufferPatternSize;
+            if (window < max_buffer_size) {
+                s_SharedBufferWindow = window;
+            }
+        }
+        s_SharedBufferSize = BufferPatternSize + s_SharedBufferWindow + s_CompletionMessageSize;
+
+        if (ctsConfig::Settings->UseLargePages) {
+            s_LargePageSize = ctsBufferAllocation::EnableLargePages();
+        }
+
+        try {
+            // one replica of the send pattern on each NUMA node, so connections send from local memory
+            const unsigned long numa_node_count = ctsBufferAllocation::NumaNodeCount();
+            s_ProtectedSharedBuffers.reserve(numa_node_count);
+            for (unsigned long numa_node = 0; numa_node < numa_node_count; ++numa_node) {
+                ctsBufferAllocation replica(s_SharedBufferSize, numa_node, s_LargePageSize);
+                if (replica.uses_large_pages()) {
+                    ++s_LargePageSharedBuffers;
+                }
+                // fill in this allocated buffer while we can write to it
+                FillSharedBuffer(replica.get());
+
+                // guarantee noone will write to the replica
+                // - the protection of large pages cannot be changed: those replicas stay writeable
+                DWORD old_setting;
+                if (!::VirtualProtect(replica.get(), s_SharedBufferSize, PAGE_READONLY, &old_setting)) {
+                    if (!replica.uses_large_pages()) {
+                        ctAlwaysFatalCondition(L"VirtualProtect failed: %u", ::GetLastError());
+                    }
+                    s_ProtectedSharedBuffersReadOnly = false;
+                }
+                s_ProtectedSharedBuffers.push_back(replica.release());
+            }
+            s_ProtectedSharedBuffer = s_ProtectedSharedBuffers[0];
+
+            ctsBufferAllocation writeable(s_SharedBufferSize, ctsBufferAllocation::AnyNumaNode, s_LargePageSize);
+            if (writeable.uses_large_pages()) {
+                ++s_LargePageSharedBuffers;
+            }
+            FillSharedBuffer(writeable.get());
+            s_WriteableSharedBuffer = writeable.release();
+        }
+        catch (const exception& e) {
+            ctAlwaysFatalCondition(L"Failed to allocate the shared buffers: %ws", ctString::format_exception(e).c_str());
         }
 
         // establish a RIO ID for the writable shared buffer if we're using RIO APIs
@@ -123,6 +167,21 @@ namespace ctsTraffic {
             }
         }
 
+        // no recv buffers are allocated until the first recv is posted
+        try {
+            const unsigned long chunk_size = s_SharedBufferWindow;
+            const size_t region_bytes = (s_LargePageSize > RecvBufferRegionBytes) ? s_LargePageSize : RecvBufferRegionBytes;
+            const unsigned long chunks_per_region = (chunk_size < region_bytes) ? static_cast<unsigned long>(region_bytes / chunk_size) : 1UL;
+            s_RecvBufferArena = new ctsRecvBufferArena(
+                chunk_size,
+                chunks_per_region,
+                s_LargePageSize,
+                (ctsConfig::Settings->SocketFlags & WSA_FLAG_REGISTERED_IO) != 0);
+        }
+        catch (const exception& e) {
+            ctAlwaysFatalCondition(L"Failed to create the recv buffer arena: %ws", ctString::format_exception(e).c_str());
+        }
+
         return TRUE;
     }
 
@@ -166,20 +225,61 @@ namespace ctsTraffic {
         return s_ProtectedSharedBuffer;
     }
 
+    wstring ctsIOPattern::DescribeSharedBuffers()
+    {
+        // this init-once call is no-fail
+        (void) ::InitOnceExecuteOnce(&s_IOPatternInitializer, InitOnceIOPatternCallback, nullptr, nullptr);
+
+        // the send buffer replicas plus the writeable buffer
+        const unsigned long shared_buffer_count = static_cast<unsigned long>(s_ProtectedSharedBuffers.size()) + 1;
+        wstring description(
+            ctString::format_string(
+                L"\tShared buffers: %lu bytes, send buffer replicated on %lu NUMA node(s)\n",
+                s_SharedBufferSize, static_cast<unsigned long>(s_ProtectedSharedBuffers.size())));
+
+        if (!ctsConfig::Settings->UseLargePages) {
+            description.append(L"\tLarge pages: not requested (-LargePages:on)\n");
+        } else if (0 == s_LargePageSize) {
+            description.append(L"\tLarge pages: unavailable - requires SeLockMemoryPrivilege, using regular pages\n");
+        } else {
+            description.append(
+                ctString::format_string(
+                    L"\tLarge pages: %Iu bytes, %lu of %lu shared buffers (%lu fell back to regular pages)\n",
+                    s_LargePageSize, s_LargePageSharedBuffers, shared_buffer_count, shared_buffer_count - s_LargePageSharedBuffers));
+            if (!s_ProtectedSharedBuffersReadOnly) {
+                description.append(L"\t\tnote: send buffers on large pages cannot be made read-only\n");
+            }
+        }
+        return description;
+    }
+
+    unsigned long ctsIOPattern::RecvBufferChunkCount() NOEXCEPT
+    {
+        // this init-once call is no-fail
+        (void) ::InitOnceExecuteOnce(&s_IOPatternInitializer, InitOnceIOPatternCallback, nullptr, nullptr);
+        return s_RecvBufferArena->chunk_count();
+    }
+
     ctsIOPattern::ctsIOPattern(unsigned long _recv_count) :
-        cs(),
-        recv_buffer_free_list(),
-        recv_buffer_container(),
-        callback(nullptr),
         pattern_state(),
         send_pattern_offset(0),
         recv_pattern_offset(0),
-        recv_rio_bufferid(RIO_INVALID_BUFFERID),
+        send_payload_offset(0ULL),
+        recv_payload_offset(0ULL),
+        shared_send_buffer(nullptr),
+        recv_buffers_available(0),
+        recv_buffers_from_arena(false),
+        last_error(ctsStatusIORunning),
         // (bytes/sec) * (1 sec/1000 ms) * (x ms/Quantum) == (bytes/quantum)
         bytes_sending_per_quantum(ctsConfig::GetTcpBytesPerSecond() * static_cast<unsigned long long>(ctsConfig::Settings->TcpBytesPerSecondPeriod) / 1000LL),
         bytes_sending_this_quantum(0LL),
         quantum_start_time_ms(ctTimer::snap_qpc_as_msec()),
-        last_error(ctsStatusIORunning)
+        cs(),
+        recv_rio_bufferid(RIO_INVALID_BUFFERID),
+        payload_stream(),
+        callback(nullptr),
+        segment_lists(),
+        segment_list_free_list()
     {
         ctFatalCondition(
             ctsConfig::Settings->UseSharedBuffer && ctsConfig::Settings->ShouldVerifyBuffers,
@@ -188,62 +288,33 @@ namespace ctsTraffic {
         // this init-once call is no-fail
         (void) ::InitOnceExecuteOnce(&s_IOPatternInitializer, InitOnceIOPatternCallback, nullptr, nullptr);
 
-        if (!::InitializeCriticalSectionEx(&cs, 4000, 0)) {
-            throw ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsIOPattern", false);
-        }
-        ctlScopeGuard(deleteCSonError, { ::DeleteCriticalSection(&cs); });
+        // sends use the replica on the NUMA node creating this connection
+        const unsigned long numa_node = ctsBufferAllocation::CurrentNumaNode();
+        shared_send_buffer = (numa_node < s_ProtectedSharedBuffers.size()) ? s_ProtectedSharedBuffers[numa_node] : s_ProtectedSharedBuffer;
 
         // if TCP, will always need a recv buffer for the final FIN 
         if ((_recv_count > 0) || (ctsConfig::Settings->Protocol == ctsConfig::ProtocolType::TCP)) {
             // recv will only use the same shared buffer when the user specified to do so on the cmdline
-            if (ctsConfig::Settings->UseSharedBuffer) {
-                if (_recv_count > 0) {
-                    for (unsigned long free_list = 0; free_list < _recv_count; ++free_list) {
-                        recv_buffer_free_list.push_back(s_WriteableSharedBuffer);
-                    }
-                    // if using RIO, can share the same BufferId when not needing to validate the buffer
-                    recv_rio_bufferid = s_SharedBufferId;
-                } else {
-                    // just use the shared buffer to capture the ACK's since recv_count == 0
-                    recv_buffer_free_list.push_back(s_WriteableSharedBuffer);
-                    recv_rio_bufferid = s_SharedBufferId;
-                }
+            // - otherwise each recv checks out its own chunk from the recv buffer arena when it's posted
+            // if using RIO, can share the same BufferId when not needing to validate the buffer
+            recv_rio_bufferid = s_SharedBufferId;
+            if (_recv_count > 0) {
+                recv_buffers_available = _recv_count;
+                recv_buffers_from_arena = !ctsConfig::Settings->UseSharedBuffer;
             } else {
-                if (_recv_count > 0) {
-                    recv_buffer_container.resize(ctsConfig::GetMaxBufferSize() * _recv_count);
-                    char* raw_recv_buffer = &recv_buffer_container[0];
-                    for (unsigned long free_list = 0; free_list < _recv_count; ++free_list) {
-                        recv_buffer_free_list.push_back(raw_recv_buffer + static_cast<size_t>(free_list * ctsConfig::GetMaxBufferSize()));
-                    }
-                } else {
-                    // just use the shared buffer to capture the FIN since recv_count == 0
-                    recv_buffer_free_list.push_back(s_WriteableSharedBuffer);
-                    recv_rio_bufferid = s_SharedBufferId;
-                }
+                // just use the shared buffer to capture the FIN since recv_count == 0
+                recv_buffers_available = 1;
             }
 
-            if (ctsConfig::Settings->SocketFlags & WSA_FLAG_REGISTERED_IO &&
-                recv_rio_bufferid != s_SharedBufferId) {
-                ctFatalCondition(_recv_count > 1, L"Current not supporting >1 concurrent IO requests with RIO");
-                recv_rio_bufferid = ctRIORegisterBuffer(recv_buffer_free_list[0], static_cast<DWORD>(ctsConfig::GetMaxBufferSize()));
-                if (RIO_INVALID_BUFFERID == recv_rio_bufferid) {
-                    throw ctException(::WSAGetLastError(), L"RIORegisterBuffer", L"ctsIOPattern", false);
-                }
-            }
+            ctFatalCondition(
+                (ctsConfig::Settings->SocketFlags & WSA_FLAG_REGISTERED_IO) && recv_buffers_from_arena && _recv_count > 1,
+                L"Current not supporting >1 concurrent IO requests with RIO");
         }
-
-        // init was successful - don't delete
-        deleteCSonError.dismiss();
     }
 
 
     ctsIOPattern::~ctsIOPattern() NOEXCEPT
     {
-        if (recv_rio_bufferid != RIO_INVALID_BUFFERID && recv_rio_bufferid != s_SharedBufferId) {
-            ctRIODeregisterBuffer(recv_rio_bufferid);
-        }
-
-        ::DeleteCriticalSection(&cs);
     }
 
     ctsIOTask ctsIOPattern::initiate_io() NOEXCEPT
@@ -251,7 +322,7 @@ namespace ctsTraffic {
         // make sure stats starts tracking IO at the first IO request
         this->start_stats();
 
-        ctAutoReleaseCriticalSection local_cs(&this->cs);
+        ctsAutoReleaseConnectionLock local_cs(this->cs);
         ctsIOTask return_task;
         switch (this->pattern_state.get_next_task()) {
         case ctsIOPatternProtocolTask::MoreIo:
@@ -331,25 +402,18 @@ namespace ctsTraffic {
             // end-stats as early as possible after the actual IO finished
             this->end_stats();
 
-            ctFatalCondition(
-                this->recv_buffer_free_list.empty(),
-                L"ctsIOPattern::initiate_io : (%p) recv_buffer_free_list is empty", this);
-
-            if (this->recv_rio_bufferid != RIO_INVALID_BUFFERID) {
-                // RIO must always use the allocated buffers which were registered
-                return_task.buffer = *this->recv_buffer_free_list.rbegin();
-                this->recv_buffer_free_list.pop_back();
-                return_task.rio_bufferid = this->recv_rio_bufferid;
-                return_task.buffer_type = ctsIOTask::BufferType::Tracked;
-            } else {
-                return_task.buffer = s_FinBuffer;
-                return_task.buffer_type = ctsIOTask::BufferType::Static;
-            }
-
             return_task.ioAction = IOTaskAction::Recv;
             return_task.buffer_length = s_FinBufferSize;
             return_task.buffer_offset = 0;
             return_task.track_io = false;
+
+            if (ctsConfig::Settings->SocketFlags & WSA_FLAG_REGISTERED_IO) {
+                // RIO must always use buffers which were registered
+                this->take_recv_buffer(return_task);
+            } else {
+                return_task.buffer = s_FinBuffer;
+                return_task.buffer_type = ctsIOTask::BufferType::Static;
+            }
             break;
 
         default:
@@ -357,6 +421,7 @@ namespace ctsTraffic {
         }
 
         this->pattern_state.notify_next_task(return_task);
+        ctsTracePoint("ctsIOPattern::initiate_io", this, "action", return_task.ioAction, "bytes", return_task.buffer_length);
         return return_task;
     }
 
@@ -376,15 +441,12 @@ namespace ctsTraffic {
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     ctsIOStatus ctsIOPattern::complete_io(const ctsIOTask& _original_task, unsigned long _current_transfer, unsigned long _status_code) NOEXCEPT
     {
+        ctsTracePoint("ctsIOPattern::complete_io", this, "bytes", _current_transfer, "status", _status_code);
+
         //
         // Take the object lock before touching internal values
         //
-        ctAutoReleaseCriticalSection local_cs(&this->cs);
-
-        // Only add the recv buffer back if it was one of our listed recv buffers
-        if (ctsIOTask::BufferType::Tracked == _original_task.buffer_type) {
-            this->recv_buffer_free_list.push_back(_original_task.buffer);
-        }
+        ctsAutoReleaseConnectionLock local_cs(this->cs);
 
         // preserve the previous task
         bool task_was_more_io = this->pattern_state.is_current_task_more_io();
@@ -431,6 +493,13 @@ namespace ctsTraffic {
                             this->update_last_error(ctsStatusErrorDataDidNotMatchBitPattern);
                         }
                     }
+                    // both sides now hold the same connection id: key the payload stream from it
+                    if (ctsConfig::Settings->RandomPayload) {
+                        this->payload_stream = ctRandomStream(
+                            ctsConfig::Settings->PayloadSeed,
+                            this->connection_id(),
+                            ctsStatistics::ConnectionIdLength - 1);
+                    }
 
                     // process the TCP protocol state machine in pattern_state after receiving the connection id
                     this->update_last_protocol_error(this->pattern_state.completed_task(_original_task, _current_transfer));
@@ -489,6 +558,7 @@ namespace ctsTraffic {
 
                     this->recv_pattern_offset += _current_transfer;
                     this->recv_pattern_offset %= BufferPatternSize;
+                    this->recv_payload_offset += _current_transfer;
                 }
             }
             break;
@@ -524,12 +594,26 @@ namespace ctsTraffic {
             this->end_stats();
         }
 
+        // Only return the recv buffer if it was one we handed out
+        // - not until the received bytes were verified: arena chunks are immediately reused by other connections
+        // - Tracked send buffers hold generated payload (-Payload:random)
+        if (ctsIOTask::BufferType::Tracked == _original_task.buffer_type) {
+            if (IOTaskAction::Send == _original_task.ioAction) {
+                this->return_payload_buffer(_original_task);
+            } else {
+                this->return_recv_buffer(_original_task);
+            }
+        }
+        if (_original_task.segment_count > 0) {
+            this->return_segment_list(_original_task.segments);
+        }
+
         return this->current_status();
     }
 
     ctsIOTask ctsIOPattern::tracked_task(IOTaskAction _action, unsigned long _max_transfer) NOEXCEPT
     {
-        ctAutoReleaseCriticalSection local_cs(&this->cs);
+        ctsAutoReleaseConnectionLock local_cs(this->cs);
         ctsIOTask return_task(this->new_task(_action, _max_transfer));
         return_task.track_io = true;
         return return_task;
@@ -537,7 +621,7 @@ namespace ctsTraffic {
 
     ctsIOTask ctsIOPattern::untracked_task(IOTaskAction _action, unsigned long _max_transfer) NOEXCEPT
     {
-        ctAutoReleaseCriticalSection local_cs(&this->cs);
+        ctsAutoReleaseConnectionLock local_cs(this->cs);
         ctsIOTask return_task(this->new_task(_action, _max_transfer));
         return_task.track_io = false;
         return return_task;
@@ -637,12 +721,30 @@ namespace ctsTraffic {
             }
 
             return_task.ioAction = IOTaskAction::Send;
-            return_task.buffer = s_ProtectedSharedBuffer;
-            return_task.rio_bufferid = s_SharedBufferId;
             return_task.buffer_length = static_cast<unsigned long>(new_buffer_size);
-            return_task.buffer_offset = static_cast<unsigned long>(this->send_pattern_offset);
             return_task.expected_pattern_offset = 0; // The sender shouldn't be validating this
+            if (ctsConfig::Settings->RandomPayload) {
+                // generated payload is written into buffers checked out for just the lifetime of this send
+                this->take_payload_buffer(return_task);
+                this->send_payload_offset += new_buffer_size;
+                return return_task;
+            }
+
+            return_task.buffer = this->shared_send_buffer;
+            return_task.rio_bufferid = s_SharedBufferId;
+            return_task.buffer_offset = static_cast<unsigned long>(this->send_pattern_offset);
             return_task.buffer_type = ctsIOTask::BufferType::Static;
+            if (return_task.buffer_length > s_SharedBufferWindow) {
+                // each full window ends back at send_pattern_offset: every segment sends the same window
+                return_task.segments = this->take_segment_list();
+                unsigned long bytes_remaining = return_task.buffer_length;
+                while (bytes_remaining > 0) {
+                    ctsIOTask::Segment& segment = return_task.segments[return_task.segment_count++];
+                    segment.buffer = return_task.buffer + return_task.buffer_offset;
+                    segment.length = (bytes_remaining > s_SharedBufferWindow) ? s_SharedBufferWindow : bytes_remaining;
+                    bytes_remaining -= segment.length;
+                }
+            }
 
             // now that we are indicating this buffer to send, increment the offset for the next send request
             this->send_pattern_offset += new_buffer_size;
@@ -653,64 +755,250 @@ namespace ctsTraffic {
                 L"this->pattern_offset being too large (larger than BufferPatternSize %lu) means we might walk off the end of our shared buffer (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)",
                 BufferPatternSize, this);
             ctFatalCondition(
-                return_task.buffer_length + return_task.buffer_offset > s_SharedBufferSize,
+                (return_task.segment_count > 0 ? s_SharedBufferWindow : return_task.buffer_length) + return_task.buffer_offset > s_SharedBufferSize,
                 L"return_task (%p) for a Send request is specifying a buffer that is larger than the static SharedBufferSize (%lu) (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)",
                 &return_task, s_SharedBufferSize, this);
 
         } else {
-            ctFatalCondition(
-                this->recv_buffer_free_list.empty(),
-                L"recv_buffer_free_list is empty for a new Recv task  (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
-
             return_task.ioAction = IOTaskAction::Recv;
-            return_task.buffer = *this->recv_buffer_free_list.rbegin();
-            this->recv_buffer_free_list.pop_back();
-            return_task.buffer_type = ctsIOTask::BufferType::Tracked;
-
-            return_task.rio_bufferid = this->recv_rio_bufferid;
             return_task.buffer_length = static_cast<unsigned long>(new_buffer_size);
-            return_task.buffer_offset = 0; // always recv to the beginning of the buffer
             return_task.expected_pattern_offset = static_cast<unsigned long>(this->recv_pattern_offset);
+            // always recv to the beginning of the buffer (with RIO, buffer_offset locates the chunk in its registered region)
+            this->take_recv_buffer(return_task);
 
             ctFatalCondition(
                 this->recv_pattern_offset >= BufferPatternSize,
                 L"pattern_offset being too large means we might walk off the end of our shared buffer (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
             ctFatalCondition(
-                return_task.buffer_length + return_task.buffer_offset > new_buffer_size,
+                return_task.buffer_length > new_buffer_size,
                 L"return_task (%p) for a Recv request is specifying a buffer that is larger than buffer_size (%lu) (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)",
                 &return_task, static_cast<unsigned long>(new_buffer_size), this);
         }
 
         return return_task;
     }
+
+    void ctsIOPattern::take_recv_buffer(ctsIOTask& _task) NOEXCEPT
+    {
+        ctFatalCondition(
+            0 == this->recv_buffers_available,
+            L"No recv buffers are available for a new Recv task  (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", this);
+        --this->recv_buffers_available;
+
+        if (this->recv_buffers_from_arena) {
+            const ctsRecvBufferArena::Chunk chunk(s_RecvBufferArena->check_out());
+            _task.buffer = chunk.buffer;
+            _task.buffer_offset = chunk.buffer_offset;
+            _task.rio_bufferid = chunk.rio_bufferid;
+        } else {
+            _task.buffer = s_WriteableSharedBuffer;
+            _task.buffer_offset = 0;
+            _task.rio_bufferid = this->recv_rio_bufferid;
+        }
+        _task.buffer_type = ctsIOTask::BufferType::Tracked;
+
+        if (_task.buffer_length > s_SharedBufferWindow) {
+            // only IO functions posting vectored IO are given recvs larger than one window
+            // - each further segment is another arena chunk (or the same shared buffer)
+            _task.segments = this->take_segment_list();
+            unsigned long bytes_remaining = _task.buffer_length;
+            while (bytes_remaining > 0) {
+                ctsIOTask::Segment& segment = _task.segments[_task.segment_count];
+                if (0 == _task.segment_count) {
+                    segment.buffer = _task.buffer + _task.buffer_offset;
+                } else if (this->recv_buffers_from_arena) {
+                    segment.buffer = ctsRecvBufferArena::chunk_address(s_RecvBufferArena->check_out());
+                } else {
+                    segment.buffer = s_WriteableSharedBuffer;
+                }
+                segment.length = (bytes_remaining > s_SharedBufferWindow) ? s_SharedBufferWindow : bytes_remaining;
+                bytes_remaining -= segment.length;
+                ++_task.segment_count;
+            }
+        }
+    }
+
+    void ctsIOPattern::return_recv_buffer(const ctsIOTask& _task) NOEXCEPT
+    {
+        ++this->recv_buffers_available;
+
+        if (this->recv_buffers_from_arena) {
+            // the task still describes the chunk exactly as it was checked out
+            ctsRecvBufferArena::Chunk chunk;
+            chunk.buffer = _task.buffer;
+            chunk.buffer_offset = _task.buffer_offset;
+            chunk.rio_bufferid = _task.rio_bufferid;
+            s_RecvBufferArena->check_in(chunk);
+
+            // segmented recvs are never posted with RIO: further chunks are addressed directly
+            for (unsigned long segment = 1; segment < _task.segment_count; ++segment) {
+                chunk.buffer = _task.segments[segment].buffer;
+                chunk.buffer_offset = 0;
+                chunk.rio_bufferid = RIO_INVALID_BUFFERID;
+                s_RecvBufferArena->check_in(chunk);
+            }
+        }
+    }
+
+    void ctsIOPattern::take_payload_buffer(ctsIOTask& _task) NOEXCEPT
+    {
+        // send buffers are never shared: each send checks out as many arena chunks as it spans
+        const ctsRecvBufferArena::Chunk chunk(s_RecvBufferArena->check_out());
+        _task.buffer = chunk.buffer;
+        _task.buffer_offset = chunk.buffer_offset;
+        _task.rio_bufferid = chunk.rio_bufferid;
+        _task.buffer_type = ctsIOTask::BufferType::Tracked;
+
+        if (_task.buffer_length <= s_SharedBufferWindow) {
+            this->payload_stream.fill(ctsRecvBufferArena::chunk_address(chunk), _task.buffer_length, this->send_payload_offset);
+            return;
+        }
+
+        // only IO functions posting vectored IO are given sends larger than one window
+        _task.segments = this->take_segment_list();
+        unsigned long bytes_remaining = _task.buffer_length;
+        while (bytes_remaining > 0) {
+            ctsIOTask::Segment& segment = _task.segments[_task.segment_count];
+            segment.buffer = (0 == _task.segment_count) ?
+                ctsRecvBufferArena::chunk_address(chunk) :
+                ctsRecvBufferArena::chunk_address(s_RecvBufferArena->check_out());
+            segment.length = (bytes_remaining > s_SharedBufferWindow) ? s_SharedBufferWindow : bytes_remaining;
+            this->payload_stream.fill(segment.buffer, segment.length, this->send_payload_offset + (_task.buffer_length - bytes_remaining));
+            bytes_remaining -= segment.length;
+            ++_task.segment_count;
+        }
+    }
+
+    void ctsIOPattern::return_payload_buffer(const ctsIOTask& _task) NOEXCEPT
+    {
+        ctsRecvBufferArena::Chunk chunk;
+        chunk.buffer = _task.buffer;
+        chunk.buffer_offset = _task.buffer_offset;
+        chunk.rio_bufferid = _task.rio_bufferid;
+        s_RecvBufferArena->check_in(chunk);
+
+        for (unsigned long segment = 1; segment < _task.segment_count; ++segment) {
+            chunk.buffer = _task.segments[segment].buffer;
+            chunk.buffer_offset = 0;
+            chunk.rio_bufferid = RIO_INVALID_BUFFERID;
+            s_RecvBufferArena->check_in(chunk);
+        }
+    }
+
+    ctsIOTask::Segment* ctsIOPattern::take_segment_list() NOEXCEPT
+    {
+        if (this->segment_list_free_list.empty()) {
+            try {
+                // the free list always has room for every segment list: returning one never allocates
+                this->segment_list_free_list.reserve(this->segment_lists.size() + 1);
+                this->segment_lists.push_back(make_unique<ctsIOTask::Segment[]>(ctsIOTask::MaxSegments));
+                this->segment_list_free_list.push_back(this->segment_lists.back().get());
+            }
+            catch (const exception& e) {
+                ctAlwaysFatalCondition(L"ctsIOPattern failed to allocate a segment list: %ws (dt ctsTraffic!ctsTraffic::ctsIOPattern %p)", ctString::format_exception(e).c_str(), this);
+            }
+        }
+
+        ctsIOTask::Segment* segment_list = this->segment_list_free_list.back();
+        this->segment_list_free_list.pop_back();
+        return segment_list;
+    }
+
+    void ctsIOPattern::return_segment_list(_In_ ctsIOTask::Segment* _segment_list) NOEXCEPT
+    {
+        this->segment_list_free_list.push_back(_segment_list);
+    }
+
     bool ctsIOPattern::verify_buffer(const ctsIOTask& _original_task, unsigned long _transferred_bytes) NOEXCEPT
     {
         // only doing deep verification if the user asked us to
         if (!ctsConfig::Settings->ShouldVerifyBuffers) {
             return true;
         }
-        //
-        // We're using RtlCompareMemory instead of memcmp because it returns the first offset at which the buffers differ,
-        // which is more useful than memcmp's "sign of the difference between the first two differing elements"
-        //
-        auto pattern_buffer = s_ProtectedSharedBuffer + _original_task.expected_pattern_offset;
-        size_t length_matched = ::RtlCompareMemory(
-            pattern_buffer,
-            _original_task.buffer + _original_task.buffer_offset,
-            _transferred_bytes);
-        if (length_matched != _transferred_bytes) {
-            ctsConfig::PrintErrorInfo(
-                L"ctsIOPattern found data corruption: detected an invalid byte pattern in the returned buffer (length %u): "
-                L"buffer received (%p), expected buffer pattern (%p) - mismatch from expected pattern at offset (%Iu) [expected 32-bit value '0x%x' didn't match '0x%x']",
-                _transferred_bytes,
-                _original_task.buffer + _original_task.buffer_offset,
+        // with -Payload:random, received bytes are regenerated from payload_stream at the offset this recv started at
+        // - TCP verification keeps a single recv in flight, so that's the payload received so far
+        const bool random_payload = ctsConfig::Settings->RandomPayload;
+        // segmented IO is verified one segment at a time, continuing the pattern across segments
+        if (0 == _original_task.segment_count) {
+            const char* received_buffer = _original_task.buffer + _original_task.buffer_offset;
+            return random_payload ?
+                verify_payload(received_buffer, _transferred_bytes, this->recv_payload_offset) :
+                verify_pattern(received_buffer, _transferred_bytes, _original_task.expected_pattern_offset);
+        }
+
+        unsigned long bytes_verified = 0;
+        for (unsigned long segment = 0; segment < _original_task.segment_count && bytes_verified < _transferred_bytes; ++segment) {
+            const unsigned long bytes_remaining = _transferred_bytes - bytes_verified;
+            const unsigned long segment_bytes = (_original_task.segments[segment].length < bytes_remaining) ? _original_task.segments[segment].length : bytes_remaining;
+            const bool verified = random_payload ?
+                verify_payload(
+                    _original_task.segments[segment].buffer,
+                    segment_bytes,
+                    this->recv_payload_offset + bytes_verified) :
+                verify_pattern(
+                    _original_task.segments[segment].buffer,
+                    segment_bytes,
+                    (_original_task.expected_pattern_offset + bytes_verified) % BufferPatternSize);
+            if (!verified) {
+                return false;
+            }
+            bytes_verified += segment_bytes;
+        }
+        return true;
+    }
+
+    bool ctsIOPattern::verify_pattern(_In_reads_(_length) const char* _buffer, unsigned long _length, unsigned long _pattern_offset) NOEXCEPT
+    {
+        // the shared buffer only holds one window past the pattern offset: longer buffers are compared a window at a time
+        unsigned long bytes_compared = 0;
+        while (bytes_compared < _length) {
+            const unsigned long bytes_remaining = _length - bytes_compared;
+            const unsigned long compare_bytes = (bytes_remaining > s_SharedBufferWindow) ? s_SharedBufferWindow : bytes_remaining;
+            const char* received_buffer = _buffer + bytes_compared;
+            //
+            // We're using RtlCompareMemory instead of memcmp because it returns the first offset at which the buffers differ,
+            // which is more useful than memcmp's "sign of the difference between the first two differing elements"
+            //
+            auto pattern_buffer = s_ProtectedSharedBuffer + (_pattern_offset + bytes_compared) % BufferPatternSize;
+            size_t length_matched = ::RtlCompareMemory(
                 pattern_buffer,
-                length_matched,
-                pattern_buffer[length_matched],
-                *(_original_task.buffer + _original_task.buffer_offset + length_matched));
+                received_buffer,
+                compare_bytes);
+            if (length_matched != compare_bytes) {
+                ctsConfig::PrintErrorInfo(
+                    L"ctsIOPattern found data corruption: detected an invalid byte pattern in the returned buffer (length %u): "
+                    L"buffer received (%p), expected buffer pattern (%p) - mismatch from expected pattern at offset (%Iu) [expected 32-bit value '0x%x' didn't match '0x%x']",
+                    _length,
+                    _buffer,
+                    pattern_buffer,
+                    bytes_compared + length_matched,
+                    pattern_buffer[length_matched],
+                    received_buffer[length_matched]);
+                return false;
+            }
+            bytes_compared += compare_bytes;
         }
+        return true;
+    }
 
-        return (length_matched == _transferred_bytes);
+    bool ctsIOPattern::verify_payload(_In_reads_(_length) const char* _buffer, unsigned long _length, unsigned long long _stream_offset) NOEXCEPT
+    {
+        const size_t length_matched = this->payload_stream.compare(_buffer, _length, _stream_offset);
+        if (length_matched != _length) {
+            unsigned char expected_byte = 0;
+            this->payload_stream.fill(&expected_byte, 1, _stream_offset + length_matched);
+            ctsConfig::PrintErrorInfo(
+                L"ctsIOPattern found data corruption: detected an invalid byte in the returned buffer (length %u): "
+                L"buffer received (%p), payload stream offset (%llu) - mismatch from expected payload at offset (%Iu) [expected byte '0x%x' didn't match '0x%x']",
+                _length,
+                _buffer,
+                _stream_offset,
+                length_matched,
+                expected_byte,
+                static_cast<unsigned char>(_buffer[length_matched]));
+            return false;
+        }
+        return true;
     }
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1042,16 +1330,18 @@ namespace ctsTraffic {
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     ctsIOPatternMediaStreamServer::ctsIOPatternMediaStreamServer() :
-        ctsIOPatternStatistics(1), // the pattern will use the recv writeable-buffer for sending a connection ID
-        frame_size_bytes(ctsConfig::GetMediaStream().FrameSizeBytes),
+        ctsIOPatternStatistics(0), // the server only sends: the connection ID is sent from connection_id_buffer
+        frame_profile(ctsConfig::GetMediaStream().FrameProfile),
+        frame_size_bytes(frame_profile.frame_size(1LL)),
         current_frame_requested(0UL),
         current_frame_completed(0UL),
         frame_rate_fps(ctsConfig::GetMediaStream().FramesPerSecond),
         current_frame(1UL),
-        base_time_milliseconds(0LL),
+        base_time_microseconds(0LL),
         state(ServerState::NotStarted)
     {
-        PrintDebugInfo(L"\t\tctsIOPatternMediaStreamServer - frame rate in milliseconds per frame : %lld\n", static_cast<long long>(1000UL / this->frame_rate_fps));
+        ::ZeroMemory(this->connection_id_buffer, sizeof this->connection_id_buffer);
+        PrintDebugInfo(L"\t\tctsIOPatternMediaStreamServer - frame rate in microseconds per frame : %lld\n", 1000000LL / static_cast<long long>(this->frame_rate_fps));
     }
     ctsIOPatternMediaStreamServer::~ctsIOPatternMediaStreamServer()
     {
@@ -1062,15 +1352,19 @@ namespace ctsTraffic {
         ctsIOTask return_task;
         switch (this->state) {
         case ServerState::NotStarted:
-            // get a writable buffer (ie. Recv), then update the fields in the task for the connection_id
-            return_task = ctsMediaStreamMessage::MakeConnectionIdTask(
-                this->untracked_task(IOTaskAction::Recv, UdpDatagramConnectionIdHeaderLength),
-                this->connection_id());
+        {
+            // the connection ID datagram is written into this pattern's own buffer
+            // - not a recv buffer: a UdpConnectionId task is never returned to the recv buffer arena
+            ctsIOTask id_task;
+            id_task.buffer = this->connection_id_buffer;
+            id_task.buffer_length = UdpDatagramConnectionIdHeaderLength;
+            return_task = ctsMediaStreamMessage::MakeConnectionIdTask(id_task, this->connection_id());
             this->state = ServerState::IdSent;
             break;
+        }
 
         case ServerState::IdSent:
-            this->base_time_milliseconds = ctTimer::snap_qpc_as_msec();
+            this->base_time_microseconds = ctTimer::snap_qpc_as_usec();
             this->state = ServerState::IoStarted;
             // fall-through
         case ServerState::IoStarted:
@@ -1078,10 +1372,11 @@ namespace ctsTraffic {
                 return_task = this->tracked_task(IOTaskAction::Send, frame_size_bytes);
                 // calculate the future time to initiate the IO
                 // - then subtract the start time to give the difference
-                return_task.time_offset_milliseconds =
-                    this->base_time_milliseconds
-                    + static_cast<long long>(this->current_frame) * 1000LL / static_cast<long long>(this->frame_rate_fps)
-                    - ctTimer::snap_qpc_as_msec();
+                return_task.time_offset_microseconds =
+                    this->base_time_microseconds
+                    + static_cast<long long>(this->current_frame) * 1000000LL / static_cast<long long>(this->frame_rate_fps)
+                    - ctTimer::snap_qpc_as_usec();
+                return_task.time_offset_milliseconds = return_task.time_offset_microseconds / 1000LL;
 
                 current_frame_requested += return_task.buffer_length;
             }
@@ -1100,6 +1395,7 @@ namespace ctsTraffic {
             this->current_frame_completed += _current_transfer;
             if (this->current_frame_completed == frame_size_bytes) {
                 ++this->current_frame;
+                this->frame_size_bytes = this->frame_profile.frame_size(this->current_frame);
                 this->current_frame_requested = 0UL;
                 this->current_frame_completed = 0UL;
             }
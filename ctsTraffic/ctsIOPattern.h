@@ -16,18 +16,28 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // cpp headers
 #include <memory>
 #include <algorithm>
+#include <string>
+#include <vector>
+#include <functional>
 // os headers
 #include <windows.h>
 // ctl header
 #include <ctVersionConversion.hpp>
 #include <ctLocks.hpp>
 #include <ctString.hpp>
+#include <ctRandomStream.hpp>
 // project headers
 #include "ctsConfig.h"
 #include "ctsIOTask.hpp"
+#include "ctsLockPolicy.hpp"
 #include "ctsSafeInt.hpp"
 #include "ctsIOPatternState.hpp"
 #include "ctsStatistics.hpp"
+#include "ctsMediaStreamParity.hpp"
+#include "ctsMediaStreamFrameWindow.hpp"
+#include "ctsMediaStreamFrameProfile.hpp"
+#include "ctsMediaStreamOneWayDelay.hpp"
+#include "ctsMediaStreamProtocol.hpp"
 
 namespace ctsTraffic {
 
@@ -85,6 +95,15 @@ namespace ctsTraffic {
         ///
         static char* AccessSharedBuffer() NOEXCEPT;
         ///
+        /// Describes where the shared buffers were placed: large pages, NUMA replicas, and any fallback
+        /// - creates the shared buffers if not yet created
+        ///
+        static std::wstring DescribeSharedBuffers();
+        ///
+        /// The number of chunks the recv buffer arena has allocated for all connections
+        ///
+        static unsigned long RecvBufferChunkCount() NOEXCEPT;
+        ///
         /// d'tor must be virtual as this is a base pure virtual class
         ///
         virtual ~ctsIOPattern();
@@ -100,24 +119,40 @@ namespace ctsTraffic {
         ///
         virtual void register_callback(std::function<void(const ctsIOTask&)> _callback)
         {
-            ctl::ctAutoReleaseCriticalSection local_cs(&cs);
+            ctsAutoReleaseConnectionLock local_cs(this->cs);
             this->callback = std::move(_callback);
         }
 
         virtual unsigned long get_last_error() const NOEXCEPT
         {
-            ctl::ctAutoReleaseCriticalSection auto_lock(&this->cs);
+            ctsAutoReleaseConnectionLock auto_lock(this->cs);
             return this->last_error;
         }
 
+        ///
+        /// Records transport details sampled from the TCP stack for this connection
+        /// - called outside of the pattern lock: the statistics are only updated through interlocked operations
+        ///
+        virtual void record_tcp_info(const ctsTcpInfoSample& _sample) NOEXCEPT = 0;
+
+        ///
+        /// Records the current stats into the optional time-series once its interval has elapsed
+        /// - called from the time-series sampler's timer: connections are sampled even while no IO completes
+        ///
+        void sample_time_series() NOEXCEPT
+        {
+            ctsAutoReleaseConnectionLock auto_lock(this->cs);
+            this->sample_stats();
+        }
+
         ctsUnsignedLong get_ideal_send_backlog() const NOEXCEPT
         {
-            ctl::ctAutoReleaseCriticalSection auto_lock(&this->cs);
+            ctsAutoReleaseConnectionLock auto_lock(this->cs);
             return this->pattern_state.get_ideal_send_backlog();
         }
         void set_ideal_send_backlog(const ctsUnsignedLong& _new_isb) NOEXCEPT
         {
-            ctl::ctAutoReleaseCriticalSection auto_lock(&this->cs);
+            ctsAutoReleaseConnectionLock auto_lock(this->cs);
             this->pattern_state.set_ideal_send_backlog(_new_isb);
         }
 
@@ -170,6 +205,32 @@ namespace ctsTraffic {
         ///////////////////////////////////////////////////////////////////////////////////////////////////
         ctsIOTask new_task(IOTaskAction _action, unsigned long _max_transfer) NOEXCEPT;
 
+        ///////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Private methods to hand out and take back the buffer of a Recv task
+        /// - sets buffer, buffer_offset, rio_bufferid and buffer_type on the task
+        /// - must be called with the object lock held
+        ///
+        ///////////////////////////////////////////////////////////////////////////////////////////////////
+        void take_recv_buffer(ctsIOTask& _task) NOEXCEPT;
+        void return_recv_buffer(const ctsIOTask& _task) NOEXCEPT;
+        ///////////////////////////////////////////////////////////////////////////////////////////////////
+        ///
+        /// Private methods to hand out and take back the buffer of a Send task with -Payload:random
+        /// - the buffer is checked out of the recv buffer arena and filled from payload_stream
+        /// - must be called with the object lock held
+        ///
+        ///////////////////////////////////////////////////////////////////////////////////////////////////
+        void take_payload_buffer(ctsIOTask& _task) NOEXCEPT;
+        void return_payload_buffer(const ctsIOTask& _task) NOEXCEPT;
+        ctsIOTask::Segment* take_segment_list() NOEXCEPT;
+        void return_segment_list(_In_ ctsIOTask::Segment* _segment_list) NOEXCEPT;
+
+        // compares one contiguous received buffer against the pattern starting at _pattern_offset
+        bool verify_pattern(_In_reads_(_length) const char* _buffer, unsigned long _length, unsigned long _pattern_offset) NOEXCEPT;
+        // compares one contiguous received buffer against payload_stream starting at _stream_offset
+        bool verify_payload(_In_reads_(_length) const char* _buffer, unsigned long _length, unsigned long long _stream_offset) NOEXCEPT;
+
         ///////////////////////////////////////////////////////////////////////////////////////////////////
         ///
         /// Private method which must be implemented by the derived interface
@@ -188,20 +249,10 @@ namespace ctsTraffic {
         virtual ctsIOTask next_task() = 0;
         virtual ctsIOPatternProtocolError completed_task(const ctsIOTask&, unsigned long _current_transfer) NOEXCEPT = 0;
 
-        // CS memory guard for data within this object
-        // - it's mutable to allow us to take the CS in const methods
-        mutable CRITICAL_SECTION cs;
-
-        // recv buffers to return to the caller
-        // - tracking sending buffers separate from receiving buffers
-        //   since sending buffers will have a test pattern written to it (thus send buffers can be static)
-        // For supporting multiple recv calls, allocating a larger buffer to contain all recv requests
-        // - as well as a vector to contain the multiple ptrs to each buffer
-        // When needing to dynamically allocate, containing a vector to hold the bytes
-        std::vector<char*> recv_buffer_free_list;
-        std::vector<char> recv_buffer_container;
-        // optional callback for protocols which need to communicate OOB to the IO function
-        std::function<void(const ctsIOTask&)> callback;
+        //
+        // hot state: read and written under cs by every initiate_io and complete_io
+        // - kept together so each IO touches as few cache lines as possible
+        //
 
         // track the state of the L4 protocol (TCP or UDP)
         ctsIOPatternState pattern_state;
@@ -210,15 +261,51 @@ namespace ctsTraffic {
         // these are separate as we could have both sends and receive operations on the same connection
         ctsSizeT send_pattern_offset;
         ctsSizeT recv_pattern_offset;
+        // with -Payload:random, the offset into payload_stream of the next byte sent and received
+        unsigned long long send_payload_offset;
+        unsigned long long recv_payload_offset;
+
+        // the replica of the shared send buffer on the NUMA node this pattern was created on
+        char* shared_send_buffer;
+
+        // recv buffers to return to the caller
+        // - tracking sending buffers separate from receiving buffers
+        //   since sending buffers will have a test pattern written to it (thus send buffers can be static)
+        // Recvs either all share the writeable shared buffer, or each checks out a chunk
+        // - from the process-wide recv buffer arena for just the lifetime of that IO
+        // recv_buffers_available is the number of recvs which can still be handed out
+        unsigned long recv_buffers_available;
+        bool recv_buffers_from_arena;
+
+        unsigned long last_error;
 
-        // RIO buffer Id
-        RIO_BUFFERID recv_rio_bufferid;
         // tracking time information for scheduling IO at time offsets
         const ctsSignedLongLong bytes_sending_per_quantum;
         ctsSignedLongLong bytes_sending_this_quantum;
         ctsSignedLongLong quantum_start_time_ms;
 
-        unsigned long last_error;
+        // CS memory guard for data within this object
+        // - ctsConnectionLock can be taken in const methods
+        // - padded on both sides: threads spinning on the lock don't contend for the lines holding the hot state
+        char cs_leading_padding[SYSTEM_CACHE_ALIGNMENT_SIZE];
+        ctsConnectionLock cs;
+        char cs_trailing_padding[SYSTEM_CACHE_ALIGNMENT_SIZE];
+
+        //
+        // cold state: set in the c'tor, or only used by uncommon IO
+        //
+
+        // RIO buffer Id when recv'ing into the shared buffer (arena chunks carry their own)
+        RIO_BUFFERID recv_rio_bufferid;
+        // with -Payload:random, the data sent on this connection is the stream keyed by -PayloadSeed and the connection id
+        // - keyed once the connection id is exchanged, so the sender and receiver generate the same stream
+        ctl::ctRandomStream payload_stream;
+        // optional callback for protocols which need to communicate OOB to the IO function
+        std::function<void(const ctsIOTask&)> callback;
+        // segment lists held by segmented tasks from initiate_io until complete_io
+        // - only as many are ever created as segmented IO was in flight at one time
+        std::vector<std::unique_ptr<ctsIOTask::Segment[]>> segment_lists;
+        std::vector<ctsIOTask::Segment*> segment_list_free_list;
 
     protected:
         ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -236,6 +323,7 @@ namespace ctsTraffic {
         ///////////////////////////////////////////////////////////////////////////////////////////////////
         virtual void start_stats() NOEXCEPT = 0;
         virtual void end_stats() NOEXCEPT = 0;
+        virtual void sample_stats() NOEXCEPT = 0;
         virtual char* connection_id() NOEXCEPT = 0;
 
         ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -301,7 +389,7 @@ namespace ctsTraffic {
         ///////////////////////////////////////////////////////////////////////////////////////////////////
         unsigned long update_last_error(DWORD _error) NOEXCEPT
         {
-            ctl::ctAutoReleaseCriticalSection auto_lock(&this->cs);
+            ctsAutoReleaseConnectionLock auto_lock(this->cs);
             if (ctsStatusIORunning == this->last_error) {
                 auto status_error = this->pattern_state.update_error(_error);
                 if (NO_ERROR == _error) {
@@ -352,12 +440,12 @@ namespace ctsTraffic {
         _Acquires_lock_(cs)
         void base_lock() NOEXCEPT
         {
-            ::EnterCriticalSection(&this->cs);
+            this->cs.lock();
         }
         _Releases_lock_(cs)
         void base_unlock() NOEXCEPT
         {
-            ::LeaveCriticalSection(&this->cs);
+            this->cs.unlock();
         }
     };
     ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -379,6 +467,16 @@ namespace ctsTraffic {
             if (ctsConfig::IsListening()) {
                 ctsStatistics::GenerateConnectionId(this->stats);
             }
+            // the optional time-series reserves all its storage now, bounded by the shared memory cap
+            if (ctsConfig::Settings->TimeSeriesIntervalMilliseconds > 0) {
+                this->time_series.reset(new ctsTimeSeries(
+                    ctsConfig::Settings->TimeSeriesIntervalMilliseconds,
+                    ctsTimeSeries::DefaultCapacity,
+                    ctsConfig::Settings->TimeSeriesMemoryRemaining));
+                if (0 == this->time_series->capacity()) {
+                    PrintDebugInfo(L"\t\tctsIOPattern : the time-series memory limit has been reached - not sampling this connection\n");
+                }
+            }
         }
         virtual ~ctsIOPatternStatistics() NOEXCEPT
         {
@@ -396,11 +494,29 @@ namespace ctsTraffic {
                 this->update_last_protocol_error(ctsIOPatternProtocolError::TooFewBytes);
             }
 
+            // track the lifetime of every connection which started IO
+            long long start_time = stats.start_time.get();
+            long long end_time = stats.end_time.get();
+            if (start_time != 0LL && end_time >= start_time) {
+                ctsConfig::Settings->ConnectionTimeHistogram.add_value(end_time - start_time);
+            }
+
             ctsConfig::PrintConnectionResults(
                 _local_addr,
                 _remote_addr,
                 this->get_last_error(),
                 stats);
+
+            if (this->time_series) {
+                this->base_lock();
+                // always capture the final values
+                long long counters[ctsTimeSeries::CounterCount];
+                ctsTimeSeries::SnapCounters(this->stats, counters);
+                long long final_time = (end_time != 0LL) ? end_time : ctl::ctTimer::snap_qpc_as_msec();
+                this->time_series->add_sample(final_time, (start_time != 0LL) ? final_time - start_time : 0LL, counters);
+                ctsConfig::PrintTimeSeries(this->stats.connection_identifier, *this->time_series);
+                this->base_unlock();
+            }
         }
         ///
         /// ensures that the pattern has started
@@ -424,6 +540,30 @@ namespace ctsTraffic {
             stats.end_time.set_conditionally(ctl::ctTimer::snap_qpc_as_msec(), 0LL);
         }
         ///
+        /// Records the current stats into the optional time-series once the interval has elapsed
+        /// - called by the base class with its lock held
+        /// - nothing is recorded once the connection has ended: print_stats records the final values
+        ///
+        void sample_stats() NOEXCEPT override
+        {
+            if (this->time_series && 0LL == stats.end_time.get()) {
+                long long current_time = ctl::ctTimer::snap_qpc_as_msec();
+                if (this->time_series->sample_due(current_time)) {
+                    long long start_time = stats.start_time.get();
+                    long long counters[ctsTimeSeries::CounterCount];
+                    ctsTimeSeries::SnapCounters(this->stats, counters);
+                    this->time_series->add_sample(current_time, (start_time != 0LL) ? current_time - start_time : 0LL, counters);
+                }
+            }
+        }
+        ///
+        /// Forwards the sampled TCP details to the statistics type (which may not track them)
+        ///
+        void record_tcp_info(const ctsTcpInfoSample& _sample) NOEXCEPT override
+        {
+            this->stats.record_tcp_info(_sample);
+        }
+        ///
         /// Access the ConnectionId stored in the Stats object
         ///
         char* connection_id() NOEXCEPT override
@@ -435,6 +575,10 @@ namespace ctsTraffic {
         /// - the type is controlled by the caller as the class template type
         ///
         S stats;
+
+    private:
+        // optional: only created when -TimeSeriesFilename is specified
+        std::unique_ptr<ctsTimeSeries> time_series;
     };
 
 
@@ -558,18 +702,23 @@ namespace ctsTraffic {
         ctsIOPatternProtocolError completed_task(const ctsIOTask& _task, unsigned long _current_transfer) NOEXCEPT override;
 
     private:
+        // the size of each frame: refreshed from the profile as each frame completes
+        const ctsMediaStreamFrameProfile& frame_profile;
         ctsUnsignedLong frame_size_bytes;
         ctsUnsignedLong current_frame_requested;
         ctsUnsignedLong current_frame_completed;
         ctsUnsignedLong frame_rate_fps;
         ctsUnsignedLong current_frame;
-        ctsSignedLongLong base_time_milliseconds;
+        // frame deadlines are kept in microseconds: whole milliseconds bunch frames together above 1000 fps
+        ctsSignedLongLong base_time_microseconds;
         enum class ServerState
         {
             NotStarted,
             IdSent,
             IoStarted
         } state;
+        // the connection ID datagram sent before the first frame
+        char connection_id_buffer[UdpDatagramConnectionIdHeaderLength];
     };
 
 
@@ -592,15 +741,21 @@ namespace ctsTraffic {
         // required virtual functions
         ctsIOTask next_task() NOEXCEPT override;
         ctsIOPatternProtocolError completed_task(const ctsIOTask& _task, unsigned long _current_transfer) NOEXCEPT override;
+        // adds the one-way delay details to the stats before printing them
+        void print_stats(const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _remote_addr) NOEXCEPT override;
 
     private:
         // private member variables
         PTP_TIMER renderer_timer;
         PTP_TIMER start_timer;
+        // sends clock probes every -ClockProbeInterval milliseconds: nullptr when not enabled
+        PTP_TIMER probe_timer;
 
         long long base_time_milliseconds;
         const double frame_rate_ms_per_frame;
-        const unsigned long frame_size_bytes;
+        // frames are complete once the number of bytes from the profile are received
+        const ctsMediaStreamFrameProfile& frame_profile;
+        const unsigned long maximum_frame_size_bytes;
         const unsigned long final_frame;
 
         unsigned long initial_buffer_frames;
@@ -613,10 +768,7 @@ namespace ctsTraffic {
 
         // member variables that require the base lock
         _Requires_lock_held_(cs)
-        std::vector<ctsConfig::JitterFrameEntry> frame_entries;
-
-        _Requires_lock_held_(cs)
-        std::vector<ctsConfig::JitterFrameEntry>::iterator head_entry;
+        ctsMediaStreamFrameWindow frame_window;
 
         // tracking for jitter information
         ctsConfig::JitterFrameEntry first_frame;
@@ -624,9 +776,43 @@ namespace ctsTraffic {
 
         bool finished_stream;
 
+        // adaptive playout (-PlayoutBuffer:adaptive)
+        // - the buffer depth tracks the measured jitter within [MinimumBufferFrames, maximum_buffer_frames]
+        const bool adaptive_playout;
+        unsigned long target_buffer_frames;
+        unsigned long maximum_buffer_frames;
+        // RFC 3550 interarrival jitter estimate
+        double jitter_milliseconds;
+        double previous_transit_milliseconds;
+        bool transit_sampled;
+        // non-zero while rebuffering: the time (from ctTimer::snap_qpc_as_msec) the buffer ran dry
+        long long buffering_start_milliseconds;
+
+        // forward error correction (-FecFrames): nullptr when not enabled
+        std::unique_ptr<ctsMediaStreamParityDecoder> parity_decoder;
+
+        // compact datagram headers (-DatagramHeader:compact)
+        // - START is requested again every frame interval until frames are buffered
+        // - after MaximumCompactStartRequests the legacy START is requested instead
+        const bool compact_header_requested;
+        unsigned long start_requests;
+        // the latest sender time extended from the low 32 bits in compact headers
+        long long compact_sender_time;
+        bool compact_timestamps;
+
+        // one-way delay (-ClockProbeInterval)
+        // - the probe is sent from this buffer: only the most recent probe's reply is expected
+        char probe_buffer[UdpDatagramTimeProbeLength];
+        ctsMediaStreamClockEstimator clock_estimator;
+        ctsMediaStreamDelayDistribution delay_distribution;
+        // RFC 3550 interarrival jitter of the drift-corrected one-way delays
+        double delay_jitter_microseconds;
+        long long previous_delay_microseconds;
+        bool delay_sampled;
+
         // member functions - all require the base lock
         _Requires_lock_held_(cs)
-        std::vector<ctsConfig::JitterFrameEntry>::iterator find_sequence_number(long long _seq_number) NOEXCEPT;
+        ctsConfig::JitterFrameEntry jitter_entry(long long _seq_number) NOEXCEPT;
 
         _Requires_lock_held_(cs)
         bool received_buffered_frames() NOEXCEPT;
@@ -640,12 +826,45 @@ namespace ctsTraffic {
         _Requires_lock_held_(cs)
         void render_frame() NOEXCEPT;
 
+        _Requires_lock_held_(cs)
+        void update_jitter(const ctsMediaStreamFrameWindow::FrameTimestamps& _timestamps) NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        void read_sender_timestamp(const ctsIOTask& _task, _Out_ long long* _sender_qpc, _Out_ long long* _sender_qpf) NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        bool received_frames_from_head(unsigned long _frame_count) NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        bool received_frames_after_head() NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        void render_adaptive_frames() NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        ctsIOPatternProtocolError process_parity(const ctsIOTask& _task, unsigned long _completed_bytes) NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        ctsIOPatternProtocolError recover_frame(const ctsIOTask& _task, long long _seq_number) NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        void set_next_probe_timer() NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        void process_time_reply(const ctsIOTask& _task, long long _receiver_qpc) NOEXCEPT;
+
+        _Requires_lock_held_(cs)
+        void update_one_way_delay(const ctsMediaStreamFrameWindow::FrameTimestamps& _timestamps) NOEXCEPT;
+
         /// The "Renderer" processes frames at the specified frame rate
         static
         VOID CALLBACK TimerCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER);
         /// Callback to track when the server has actually started sending
         static
         VOID CALLBACK StartCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER);
+        /// Callback to send the next clock probe
+        static
+        VOID CALLBACK ProbeCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER);
     };
 
 } //namespace
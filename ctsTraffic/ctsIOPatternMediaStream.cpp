@@ -13,6 +13,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 
 // cpp headers
+#include <cmath>
 #include <vector>
 // os headers
 #include <Windows.h>
@@ -28,6 +29,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsIOTask.hpp"
 #include "ctsSafeInt.hpp"
 #include "ctsMediaStreamProtocol.hpp"
+#include "ctsTrace.h"
 
 using namespace ctl;
 using std::vector;
@@ -50,6 +52,15 @@ namespace ctsTraffic {
     ///      - after the initial BufferDepth is received, 
     ///        it will start its timer to access the next frame's data
     ///
+    ///   -- With -PlayoutBuffer:adaptive the buffer depth follows the measured jitter
+    ///      - the depth grows by skipping a timer tick and shrinks by processing 2 frames in one tick
+    ///      - when the buffer runs dry the client stops processing (rebuffers) until it refills
+    ///      - the vector is sized AdaptiveBufferDepthFactor * the buffer depth requested to allow it to grow
+    ///
+    ///   -- With -ClockProbeInterval the client measures the one-way delay of every datagram
+    ///      - periodic probes echoed by the server estimate the offset and skew between the clocks
+    ///      - the sender QPC of each datagram is then corrected to the client clock
+    ///
     ///   -- The client is only using untracked_task requests from the base
     ///      since the correctness and lifetime of the session is only known from this instance
     ///
@@ -59,16 +70,35 @@ namespace ctsTraffic {
         ctsIOPatternStatistics(ctsConfig::Settings->PrePostRecvs),
         renderer_timer(nullptr),
         start_timer(nullptr),
-        frame_size_bytes(ctsConfig::GetMediaStream().FrameSizeBytes),
+        probe_timer(nullptr),
+        frame_profile(ctsConfig::GetMediaStream().FrameProfile),
+        maximum_frame_size_bytes(ctsConfig::GetMediaStream().MaximumFrameSizeBytes),
         final_frame(ctsConfig::GetMediaStream().StreamLengthFrames),
         initial_buffer_frames(ctsConfig::GetMediaStream().BufferedFrames),
         timer_wheel_offset_frames(0UL),
         recv_needed(ctsConfig::Settings->PrePostRecvs),
         base_time_milliseconds(0LL),
         frame_rate_ms_per_frame(1000.0 / static_cast<unsigned long>(ctsConfig::GetMediaStream().FramesPerSecond)),
-        frame_entries(),
-        head_entry(),
-        finished_stream(false)
+        frame_window(),
+        finished_stream(false),
+        adaptive_playout(ctsConfig::GetMediaStream().AdaptivePlayout),
+        target_buffer_frames(0UL),
+        maximum_buffer_frames(0UL),
+        jitter_milliseconds(0.0),
+        previous_transit_milliseconds(0.0),
+        transit_sampled(false),
+        buffering_start_milliseconds(0LL),
+        parity_decoder(),
+        compact_header_requested(ctsConfig::GetMediaStream().CompactHeader),
+        start_requests(0UL),
+        compact_sender_time(0LL),
+        compact_timestamps(false),
+        probe_buffer(),
+        clock_estimator(),
+        delay_distribution(),
+        delay_jitter_microseconds(0.0),
+        previous_delay_microseconds(0LL),
+        delay_sampled(false)
     {
         // if the entire session fits in the inital buffer, update accordingly
         if (final_frame < initial_buffer_frames) {
@@ -77,9 +107,12 @@ namespace ctsTraffic {
         timer_wheel_offset_frames = initial_buffer_frames;
 
         const static long ExtraBufferDepthFactor = 2;
+        // adaptive playout can grow to twice the initial buffer: keep the same headroom beyond that
+        const static long AdaptiveBufferDepthFactor = 4;
+        const long buffer_depth_factor = this->adaptive_playout ? AdaptiveBufferDepthFactor : ExtraBufferDepthFactor;
         // queue_size is intentionally a signed long: will catch overflows
-        ctsSignedLong queue_size = ExtraBufferDepthFactor * initial_buffer_frames;
-        if (queue_size < ExtraBufferDepthFactor) {
+        ctsSignedLong queue_size = buffer_depth_factor * initial_buffer_frames;
+        if (queue_size < buffer_depth_factor) {
             throw ctException(
                 ERROR_INVALID_DATA,
                 L"BufferDepth & FrameSize don't allow for enough buffered stream",
@@ -87,17 +120,24 @@ namespace ctsTraffic {
                 false);
         }
 
-        PrintDebugInfo(L"\t\tctsIOPatternMediaStreamClient - queue size for this new connection is %d\n", static_cast<long>(queue_size));
-        PrintDebugInfo(L"\t\tctsIOPatternMediaStreamClient - frame rate in milliseconds per frame : %f\n", frame_rate_ms_per_frame);
+        // the window rounds the queue up to a power of two so a sequence number maps directly to its slot
+        frame_window.resize(static_cast<unsigned long>(queue_size));
 
-        frame_entries.resize(queue_size);
-        head_entry = frame_entries.begin();
+        PrintDebugInfo(L"\t\tctsIOPatternMediaStreamClient - queue size for this new connection is %lu\n", frame_window.size());
+        PrintDebugInfo(L"\t\tctsIOPatternMediaStreamClient - frame rate in milliseconds per frame : %f\n", frame_rate_ms_per_frame);
 
-        // pre-populate the queue of frames with the initial seq numbers
-        ctsSignedLong last_used_sequence_number = 1;
-        for (auto& entry : frame_entries) {
-            entry.sequence_number = last_used_sequence_number;
-            ++last_used_sequence_number;
+        target_buffer_frames = initial_buffer_frames;
+        maximum_buffer_frames = static_cast<unsigned long>(queue_size) / 2;
+
+        const ctsConfig::MediaStreamSettings& media_stream(ctsConfig::GetMediaStream());
+        if (media_stream.FecDataFrames > 0) {
+            // track the parity of every group which can have frames in the queue
+            // - leaving room for the longest payload: after the shortest compact header if requested
+            const unsigned long minimum_header_length = compact_header_requested ? UdpDatagramCompactDataHeaderMinimumLength : UdpDatagramDataHeaderLength;
+            parity_decoder.reset(new ctsMediaStreamParityDecoder(
+                ctsMediaStreamParity(media_stream.FecDataFrames, media_stream.FecParityFrames, maximum_frame_size_bytes - minimum_header_length),
+                frame_window.size(),
+                final_frame));
         }
 
         // after creating, refer to the timers under the lock
@@ -115,8 +155,20 @@ namespace ctsTraffic {
         if (NULL == start_timer) {
             throw ctException(::GetLastError(), L"CreateThreadpoolTimer", L"ctsIOPatternMediaStreamClient", false);
         }
-        // no errors, dismiss the scope guard
+        // the start timer isn't set until next_task
+        ctlScopeGuard(deleteStartTimerOnError, {
+            ::CloseThreadpoolTimer(start_timer);
+        });
+
+        if (media_stream.ClockProbeIntervalMilliseconds > 0) {
+            probe_timer = ::CreateThreadpoolTimer(ProbeCallback, this, nullptr);
+            if (NULL == probe_timer) {
+                throw ctException(::GetLastError(), L"CreateThreadpoolTimer", L"ctsIOPatternMediaStreamClient", false);
+            }
+        }
+        // no errors, dismiss the scope guards
         deleteTimerCallbackOnError.dismiss();
+        deleteStartTimerOnError.dismiss();
     }
     
     ctsIOPatternMediaStreamClient::~ctsIOPatternMediaStreamClient()
@@ -140,6 +192,12 @@ namespace ctsTraffic {
         ::SetThreadpoolTimer(original_timer, nullptr, 0, 0);
         ::WaitForThreadpoolTimerCallbacks(original_timer, FALSE);
         ::CloseThreadpoolTimer(original_timer);
+
+        if (this->probe_timer != nullptr) {
+            ::SetThreadpoolTimer(this->probe_timer, nullptr, 0, 0);
+            ::WaitForThreadpoolTimerCallbacks(this->probe_timer, FALSE);
+            ::CloseThreadpoolTimer(this->probe_timer);
+        }
     }
 
     ctsIOTask ctsIOPatternMediaStreamClient::next_task() NOEXCEPT
@@ -149,22 +207,24 @@ namespace ctsTraffic {
             this->base_time_milliseconds = ctTimer::snap_qpc_as_msec();
             this->set_next_start_timer();
             this->set_next_timer(true);
+            this->set_next_probe_timer();
         }
 
         // defaulting to an empty task (do nothing)
         ctsIOTask return_task;
         if (this->recv_needed > 0) {
             // don't try posting more than UdpDatagramMaximumSizeBytes at a time
+            // - buffers are sized for the largest frame: any frame in the profile can be received in any buffer
             unsigned long max_size_buffer = 0;
-            if (this->frame_size_bytes > UdpDatagramMaximumSizeBytes) {
+            if (this->maximum_frame_size_bytes > UdpDatagramMaximumSizeBytes) {
                 max_size_buffer = UdpDatagramMaximumSizeBytes;
             } else {
-                max_size_buffer = this->frame_size_bytes;
+                max_size_buffer = this->maximum_frame_size_bytes;
             }
 
             return_task = this->untracked_task(IOTaskAction::Recv, max_size_buffer);
             // always write in a zero for the seq number to initialize the buffer
-            *(reinterpret_cast<long long*>(return_task.buffer)) = 0LL;
+            *(reinterpret_cast<long long*>(return_task.buffer + return_task.buffer_offset)) = 0LL;
             --this->recv_needed;
         }
         return return_task;
@@ -200,7 +260,9 @@ namespace ctsTraffic {
                 return ctsIOPatternProtocolError::TooFewBytes;
             }
 
-            if (ctsMediaStreamMessage::GetProtocolHeaderFromTask(_task) == UdpDatagramProtocolHeaderFlagId) {
+            // compact datagrams carry the same frame types with UdpDatagramProtocolHeaderFlagCompact set
+            const unsigned short frame_type = static_cast<unsigned short>(ctsMediaStreamMessage::GetProtocolHeaderFromTask(_task) & ~UdpDatagramProtocolHeaderFlagCompact);
+            if (UdpDatagramProtocolHeaderFlagId == frame_type) {
                 // save off the connection ID when we receive it
                 ctsMediaStreamMessage::SetConnectionIdFromTask(this->connection_id(), _task);
                 // since a recv completed, will need to request another
@@ -208,11 +270,25 @@ namespace ctsTraffic {
                 return ctsIOPatternProtocolError::NoError;
             }
 
+            if (UdpDatagramProtocolHeaderFlagParity == frame_type) {
+                // since a recv completed, will need to request another
+                ++this->recv_needed;
+                return this->process_parity(_task, _completed_bytes);
+            }
+
+            if (UdpDatagramProtocolHeaderFlagTimeProbe == frame_type) {
+                this->process_time_reply(_task, qpc.QuadPart);
+                // since a recv completed, will need to request another
+                ++this->recv_needed;
+                return ctsIOPatternProtocolError::NoError;
+            }
+
             // validate the buffer contents
+            const unsigned long header_length = ctsMediaStreamMessage::GetDataHeaderLengthFromTask(_task, _completed_bytes);
             ctsIOTask validation_task(_task);
-            validation_task.buffer_offset = UdpDatagramDataHeaderLength; // skip the UdpDatagramDataHeaderLength since we use them for our own stuff
-            validation_task.buffer_length -= UdpDatagramDataHeaderLength;
-            if (!this->verify_buffer(validation_task, _completed_bytes - UdpDatagramDataHeaderLength)) {
+            validation_task.buffer_offset = header_length; // skip the header since we use it for our own stuff
+            validation_task.buffer_length -= header_length;
+            if (!this->verify_buffer(validation_task, _completed_bytes - header_length)) {
                 // exit early if the buffers don't match
                 return ctsIOPatternProtocolError::CorruptedBytes;
             }
@@ -232,26 +308,53 @@ namespace ctsTraffic {
                     this->final_frame);
             } else {
                 //
-                // search our circular queue (starting at the head_entry)
-                // for the seq number we just received, and if found, tag as received
+                // if the seq number we just received is within our window, tag it as received
                 //
-                auto found_slot = this->find_sequence_number(received_seq_number);
-                if (found_slot != this->frame_entries.end()) {
-                    if (found_slot->received != this->frame_size_bytes) {
-                        long long buffered_qpc = *reinterpret_cast<long long*>(_task.buffer + 8);
-                        long long buffered_qpf = *reinterpret_cast<long long*>(_task.buffer + 16);
+                if (this->frame_window.contains(received_seq_number)) {
+                    unsigned long& received_bytes = this->frame_window.received(received_seq_number);
+                    const unsigned long expected_bytes = this->frame_profile.frame_size(received_seq_number);
+                    if (received_bytes != expected_bytes && received_bytes + _completed_bytes > expected_bytes) {
+                        // more bytes than this frame holds: the server is streaming a different frame size profile
+                        ctsConfig::Settings->UdpStatusDetails.error_frames.increment();
+                        this->stats.error_frames.increment();
+
+                        PrintDebugInfo(
+                            L"\t\tctsIOPatternMediaStreamClient received **too many bytes** for seq number (%lld) (%lu bytes, expected %lu bytes)\n",
+                            received_seq_number,
+                            received_bytes + _completed_bytes,
+                            expected_bytes);
 
+                    } else if (received_bytes != expected_bytes) {
                         // always overwrite qpc & qpf values with the latest datagram details
-                        found_slot->sender_qpc = buffered_qpc;
-                        found_slot->sender_qpf = buffered_qpf;
-                        found_slot->receiver_qpc = qpc.QuadPart;
-                        found_slot->receiver_qpf = ctTimer::snap_qpf();
-                        found_slot->received += _completed_bytes;
+                        ctsMediaStreamFrameWindow::FrameTimestamps& timestamps = this->frame_window.timestamps(received_seq_number);
+                        this->read_sender_timestamp(_task, &timestamps.sender_qpc, &timestamps.sender_qpf);
+                        timestamps.receiver_qpc = qpc.QuadPart;
+                        timestamps.receiver_qpf = ctTimer::snap_qpf();
+                        received_bytes += _completed_bytes;
+
+                        if (this->adaptive_playout) {
+                            this->update_jitter(timestamps);
+                        }
+                        if (this->probe_timer != nullptr) {
+                            this->update_one_way_delay(timestamps);
+                        }
+
+                        if (this->parity_decoder) {
+                            this->parity_decoder->add_frame(
+                                received_seq_number,
+                                _task.buffer + _task.buffer_offset + header_length,
+                                _completed_bytes - header_length);
+                            // this frame might be the last one needed to rebuild a lost frame in its group
+                            auto recovery_error = this->recover_frame(_task, received_seq_number);
+                            if (recovery_error != ctsIOPatternProtocolError::NoError) {
+                                return recovery_error;
+                            }
+                        }
 
                         PrintDebugInfo(
                             L"\t\tctsIOPatternMediaStreamClient received seq number %lld (%lu bytes)\n",
-                            static_cast<long long>(found_slot->sequence_number),
-                            static_cast<unsigned long>(found_slot->received));
+                            received_seq_number,
+                            received_bytes);
 
                         // stop the timer once we receive the last frame
                         // - it's not perfect (e.g. might have received them out of order)
@@ -274,17 +377,17 @@ namespace ctsTraffic {
                     ctsConfig::Settings->UdpStatusDetails.error_frames.increment();
                     this->stats.error_frames.increment();
 
-                    if (received_seq_number < this->head_entry->sequence_number) {
+                    if (received_seq_number < this->frame_window.head_sequence()) {
                         PrintDebugInfo(
                             L"\t\tctsIOPatternMediaStreamClient received **a stale** seq number (%lld) - current seq number (%lld)\n",
                             received_seq_number,
-                            static_cast<long long>(this->head_entry->sequence_number));
+                            this->frame_window.head_sequence());
                     } else {
                         PrintDebugInfo(
                             L"\t\tctsIOPatternMediaStreamClient recevieved **a future** seq number (%lld) - head of queue (%lld) tail of queue (%lld)\n",
                             received_seq_number,
-                            static_cast<long long>(this->head_entry->sequence_number),
-                            static_cast<long long>(this->head_entry->sequence_number + this->frame_entries.size() - 1));
+                            this->frame_window.head_sequence(),
+                            this->frame_window.tail_sequence());
                     }
                 }
             }
@@ -297,53 +400,50 @@ namespace ctsTraffic {
         return ctsIOPatternProtocolError::NoError;
     }
 
+    void ctsIOPatternMediaStreamClient::print_stats(const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _remote_addr) NOEXCEPT
+    {
+        if (this->probe_timer != nullptr) {
+            this->base_lock();
+            this->stats.delay_p50_microseconds.set(this->delay_distribution.percentile(50));
+            this->stats.delay_p95_microseconds.set(this->delay_distribution.percentile(95));
+            this->stats.delay_p99_microseconds.set(this->delay_distribution.percentile(99));
+            this->stats.delay_jitter_microseconds.set(static_cast<long long>(this->delay_jitter_microseconds));
+            // parts per billion keeps the precision of the skew in an integer
+            this->stats.clock_skew_ppb.set(static_cast<long long>(this->clock_estimator.skew() * 1000000000.0));
+            this->base_unlock();
+        }
+        ctsIOPatternStatistics<ctsUdpStatistics>::print_stats(_local_addr, _remote_addr);
+    }
+
     ///
-    /// Returns an iterator within frame_entries pointing to the FrameEntry
-    ///   matching the specified sequence number.
-    /// If the sequence number was not found, will return end(frame_entries)
+    /// Returns the jitter details for the specified sequence number, which must be within the frame window
+    /// - only built when rendering a frame, so the window itself can keep the timestamps apart from the byte counts
     ///
     _Requires_lock_held_(cs)
-    vector<ctsConfig::JitterFrameEntry>::iterator ctsIOPatternMediaStreamClient::find_sequence_number(long long _seq_number) NOEXCEPT
+    ctsConfig::JitterFrameEntry ctsIOPatternMediaStreamClient::jitter_entry(long long _seq_number) NOEXCEPT
     {
-        ctsSignedLongLong head_sequence_number = this->head_entry->sequence_number;
-        ctsSignedLongLong tail_sequence_number = head_sequence_number + this->frame_entries.size() - 1;
-        ctsSignedLongLong vector_end_sequence_number = this->frame_entries.rbegin()->sequence_number;
-
-        if (_seq_number > tail_sequence_number || _seq_number < head_sequence_number) {
-            // sequence number was out of range of our circular queue
-            // - return end(frame_entries) to indicate it could not be found
-            return end(this->frame_entries);
-        }
-
-        if (_seq_number <= vector_end_sequence_number) {
-            // offset just from the head since it hasn't wrapped around the end
-            size_t offset = static_cast<size_t>(_seq_number - head_sequence_number);
-            return this->head_entry + offset;
-        } else {
-            // offset from the beginning since it wrapped around from the end
-            size_t offset = static_cast<size_t>(_seq_number - vector_end_sequence_number - 1LL);
-            return this->frame_entries.begin() + offset;
-        }
+        const ctsMediaStreamFrameWindow::FrameTimestamps& timestamps = this->frame_window.timestamps(_seq_number);
+
+        ctsConfig::JitterFrameEntry frame_entry;
+        frame_entry.sequence_number = _seq_number;
+        frame_entry.sender_qpc = timestamps.sender_qpc;
+        frame_entry.sender_qpf = timestamps.sender_qpf;
+        frame_entry.receiver_qpc = timestamps.receiver_qpc;
+        frame_entry.receiver_qpf = timestamps.receiver_qpf;
+        frame_entry.received = this->frame_window.received(_seq_number);
+        return frame_entry;
     }
 
     _Requires_lock_held_(cs)
     bool ctsIOPatternMediaStreamClient::received_buffered_frames() NOEXCEPT
     {
-        if (this->frame_entries[0].sequence_number > 1) {
-            // we've already received enough datagrams to fill one buffer
-            return true;
-        }
-        if (this->head_entry != this->frame_entries.begin()) {
+        if (this->frame_window.head_sequence() > 1) {
             // we've already moved the head entry after processing a frame
             return true;
         }
 
-        for (const auto& udp_frame : this->frame_entries) {
-            if (udp_frame.received > 0UL) {
-                return true;
-            }
-        }
-        return false;
+        return this->frame_window.received(this->frame_window.head_sequence()) > 0UL ||
+               this->frame_window.received_after_head();
     }
 
     _Requires_lock_held_(cs)
@@ -374,6 +474,15 @@ namespace ctsTraffic {
         return timer_scheduled;
     }
 
+    _Requires_lock_held_(cs)
+    void ctsIOPatternMediaStreamClient::set_next_probe_timer() NOEXCEPT
+    {
+        if (this->probe_timer != nullptr) {
+            FILETIME file_time(ctTimer::convert_msec_relative_filetime(ctsConfig::GetMediaStream().ClockProbeIntervalMilliseconds));
+            ::SetThreadpoolTimer(this->probe_timer, &file_time, 0, 0);
+        }
+    }
+
     _Requires_lock_held_(cs)
     void ctsIOPatternMediaStreamClient::set_next_start_timer() NOEXCEPT
     {
@@ -391,53 +500,383 @@ namespace ctsTraffic {
     _Requires_lock_held_(cs)
     void ctsIOPatternMediaStreamClient::render_frame() NOEXCEPT
     {
-        if (this->head_entry->received == this->frame_size_bytes) {
+        // the playout delay is the number of frame intervals between when the frame was sent and now
+        const long long head_sequence_number = this->frame_window.head_sequence();
+        const long long playout_delay_frames = static_cast<long long>(this->timer_wheel_offset_frames) - head_sequence_number;
+        if (playout_delay_frames > 0LL) {
+            const long long playout_delay_ms = static_cast<long long>(static_cast<double>(playout_delay_frames) * this->frame_rate_ms_per_frame);
+            ctsConfig::Settings->UdpStatusDetails.playout_delay_total.add(playout_delay_ms);
+            this->stats.playout_delay_total.add(playout_delay_ms);
+        }
+
+        if (this->frame_window.received(head_sequence_number) == this->frame_profile.frame_size(head_sequence_number)) {
             ctsConfig::Settings->UdpStatusDetails.successful_frames.increment();
             this->stats.successful_frames.increment();
 
             PrintDebugInfo(
                 L"\t\tctsIOPatternMediaStreamClient rendered frame %lld\n",
-                static_cast<long long>(this->head_entry->sequence_number));
+                head_sequence_number);
 
             // Directly write this status update if jitter is enabled
-            ctsConfig::PrintJitterUpdate(*this->head_entry, this->previous_frame, this->first_frame);
+            const ctsConfig::JitterFrameEntry head_frame(this->jitter_entry(head_sequence_number));
+            ctsConfig::PrintJitterUpdate(head_frame, this->previous_frame, this->first_frame);
 
             // if this is the first frame, capture it
             if (this->first_frame.receiver_qpc == 0) {
-                this->first_frame = *this->head_entry;
+                this->first_frame = head_frame;
             }
             // always keep the most recently received frame for jitter
-            this->previous_frame = *this->head_entry;
+            this->previous_frame = head_frame;
 
         } else {
             ctsConfig::Settings->UdpStatusDetails.dropped_frames.increment();
             this->stats.dropped_frames.increment();
+            if (this->parity_decoder) {
+                // the parity couldn't rebuild this frame before it was due
+                ctsConfig::Settings->UdpStatusDetails.unrecoverable_frames.increment();
+                this->stats.unrecoverable_frames.increment();
+            }
 
             PrintDebugInfo(
                 L"\t\tctsIOPatternMediaStreamClient **dropped** frame %lld\n",
-                static_cast<long long>(this->head_entry->sequence_number));
+                head_sequence_number);
 
             // track the dropped frame
             // indicate zero's for the other values so we won't calculate jitter for a dropped datagram
             ctsConfig::JitterFrameEntry droppedFrame;
-            droppedFrame.sequence_number = this->head_entry->sequence_number;
+            droppedFrame.sequence_number = head_sequence_number;
             ctsConfig::PrintJitterUpdate(droppedFrame, ctsConfig::JitterFrameEntry(), ctsConfig::JitterFrameEntry());
         }
 
-        // update the current sequence number so it's now the "end" sequence number of the queue (the new max value)
-        this->head_entry->sequence_number = this->head_entry->sequence_number + this->frame_entries.size();
-        this->head_entry->received = 0;
+        // move the head to the next sequence number: its slot is reused for the new "end" sequence number of the queue
+        this->frame_window.advance();
+    }
+
+    // incrementally updates the interarrival jitter (RFC 3550 section 6.4.1) from each received datagram
+    // - then resizes the target buffer depth to cover JitterMultiplier times that jitter
+    _Requires_lock_held_(cs)
+    void ctsIOPatternMediaStreamClient::update_jitter(const ctsMediaStreamFrameWindow::FrameTimestamps& _timestamps) NOEXCEPT
+    {
+        static const double JitterMultiplier = 4.0;
+        static const unsigned long MinimumBufferFrames = 2;
+
+        if (0 == _timestamps.sender_qpf || 0 == _timestamps.receiver_qpf) {
+            return;
+        }
+
+        // the sender and receiver clocks are not synchronized: only the change in transit time is meaningful
+        const double transit_ms =
+            static_cast<double>(_timestamps.receiver_qpc) * 1000.0 / static_cast<double>(_timestamps.receiver_qpf) -
+            static_cast<double>(_timestamps.sender_qpc) * 1000.0 / static_cast<double>(_timestamps.sender_qpf);
+        if (this->transit_sampled) {
+            double transit_delta_ms = transit_ms - this->previous_transit_milliseconds;
+            if (transit_delta_ms < 0.0) {
+                transit_delta_ms = -transit_delta_ms;
+            }
+            this->jitter_milliseconds += (transit_delta_ms - this->jitter_milliseconds) / 16.0;
+        }
+        this->previous_transit_milliseconds = transit_ms;
+        this->transit_sampled = true;
+
+        // one frame for the frame being processed plus enough frames to absorb the jitter
+        unsigned long target_frames = 1UL + static_cast<unsigned long>(::ceil(JitterMultiplier * this->jitter_milliseconds / this->frame_rate_ms_per_frame));
+        if (target_frames < MinimumBufferFrames) {
+            target_frames = MinimumBufferFrames;
+        }
+        if (target_frames > this->maximum_buffer_frames) {
+            target_frames = this->maximum_buffer_frames;
+        }
+        if (target_frames != this->target_buffer_frames) {
+            PrintDebugInfo(
+                L"\t\tctsIOPatternMediaStreamClient jitter %f ms - target buffer depth is now %lu frames\n",
+                this->jitter_milliseconds,
+                target_frames);
+            this->target_buffer_frames = target_frames;
+        }
+    }
+
+    // the one-way delay of each datagram once the clock offset is known: the transit time corrected to the client clock
+    // - the interarrival jitter (RFC 3550 section 6.4.1) of these delays no longer includes the drift between the clocks
+    _Requires_lock_held_(cs)
+    void ctsIOPatternMediaStreamClient::update_one_way_delay(const ctsMediaStreamFrameWindow::FrameTimestamps& _timestamps) NOEXCEPT
+    {
+        if (!this->clock_estimator.synchronized() || 0 == _timestamps.sender_qpf || 0 == _timestamps.receiver_qpf) {
+            return;
+        }
+
+        const long long receive_time = ctTimer::convert_qpc_usec(_timestamps.receiver_qpc, _timestamps.receiver_qpf);
+        long long send_time = ctTimer::convert_qpc_usec(_timestamps.sender_qpc, _timestamps.sender_qpf);
+        if (this->compact_timestamps) {
+            // compact timestamps were only extended relative to each other:
+            // the send time is the one nearest to the estimate of the server's clock when this datagram arrived
+            send_time = ctsMediaStreamMessage::ExtendCompactTimestamp(
+                static_cast<unsigned long>(send_time),
+                receive_time + this->clock_estimator.offset_at(receive_time));
+        }
+        long long delay = receive_time - send_time + this->clock_estimator.offset_at(receive_time);
+        if (delay < 0LL) {
+            // within the error of the offset estimate
+            delay = 0LL;
+        }
+        this->delay_distribution.add_value(delay);
+        ctsConfig::Settings->OneWayDelayHistogram.add_value(delay);
+
+        if (this->delay_sampled) {
+            long long delay_delta = delay - this->previous_delay_microseconds;
+            if (delay_delta < 0LL) {
+                delay_delta = -delay_delta;
+            }
+            this->delay_jitter_microseconds += (static_cast<double>(delay_delta) - this->delay_jitter_microseconds) / 16.0;
+        }
+        this->previous_delay_microseconds = delay;
+        this->delay_sampled = true;
+    }
+
+    // the sender's timestamp of a data or parity datagram
+    // - compact headers only carry the low 32 bits in microseconds: extended from the latest one received
+    _Requires_lock_held_(cs)
+    void ctsIOPatternMediaStreamClient::read_sender_timestamp(const ctsIOTask& _task, _Out_ long long* _sender_qpc, _Out_ long long* _sender_qpf) NOEXCEPT
+    {
+        if (!ctsMediaStreamMessage::IsCompactHeaderFromTask(_task)) {
+            *_sender_qpc = ctsMediaStreamMessage::GetQueryPerfCounterFromTask(_task);
+            *_sender_qpf = ctsMediaStreamMessage::GetQueryPerfFrequencyFromTask(_task);
+            return;
+        }
+
+        const unsigned long compact_timestamp = ctsMediaStreamMessage::GetCompactTimestampFromTask(_task);
+        if (this->compact_timestamps) {
+            this->compact_sender_time = ctsMediaStreamMessage::ExtendCompactTimestamp(compact_timestamp, this->compact_sender_time);
+        } else {
+            this->compact_sender_time = compact_timestamp;
+            this->compact_timestamps = true;
+        }
+        *_sender_qpc = this->compact_sender_time;
+        *_sender_qpf = UdpDatagramCompactTimestampFrequency;
+    }
+
+    // a reply to a clock probe: the 4th timestamp is when the reply was received
+    _Requires_lock_held_(cs)
+    void ctsIOPatternMediaStreamClient::process_time_reply(const ctsIOTask& _task, long long _receiver_qpc) NOEXCEPT
+    {
+        long long originate_time;
+        long long receive_time;
+        long long transmit_time;
+        ctsMediaStreamMessage::GetTimeReplyFromTask(_task, &originate_time, &receive_time, &transmit_time);
+        const long long destination_time = ctTimer::convert_qpc_usec(_receiver_qpc, ctTimer::snap_qpf());
+        if (originate_time <= 0LL || originate_time > destination_time) {
+            PrintDebugInfo(
+                L"\t\tctsIOPatternMediaStreamClient received **an unexpected** clock probe reply (sent at %lld us)\n",
+                originate_time);
+            return;
+        }
+
+        if (this->clock_estimator.add_probe(originate_time, receive_time, transmit_time, destination_time)) {
+            PrintDebugInfo(
+                L"\t\tctsIOPatternMediaStreamClient clock offset %lld us (round trip %lld us, skew %f ppm)\n",
+                this->clock_estimator.offset_at(destination_time),
+                this->clock_estimator.round_trip_microseconds(),
+                this->clock_estimator.skew() * 1000000.0);
+        }
+    }
+
+    // returns true if the next _frame_count frames starting at the head have all been received
+    // - frames past the end of the stream are not waited for
+    _Requires_lock_held_(cs)
+    bool ctsIOPatternMediaStreamClient::received_frames_from_head(unsigned long _frame_count) NOEXCEPT
+    {
+        long long sequence_number = this->frame_window.head_sequence();
+        for (unsigned long count = 0; count < _frame_count && sequence_number <= this->final_frame; ++count, ++sequence_number) {
+            if (!this->frame_window.contains(sequence_number) || this->frame_window.received(sequence_number) != this->frame_profile.frame_size(sequence_number)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // returns true if any frame after the head has received data
+    // - if so the head frame was lost, rather than the buffer having run dry
+    _Requires_lock_held_(cs)
+    bool ctsIOPatternMediaStreamClient::received_frames_after_head() NOEXCEPT
+    {
+        return this->frame_window.received_after_head();
+    }
+
+    // a parity datagram is tracked in the parity bandwidth, not the bits received for frames
+    _Requires_lock_held_(cs)
+    ctsIOPatternProtocolError ctsIOPatternMediaStreamClient::process_parity(const ctsIOTask& _task, unsigned long _completed_bytes) NOEXCEPT
+    {
+        ctsConfig::Settings->UdpStatusDetails.parity_bits.add(_completed_bytes * 8);
+        this->stats.parity_bits.add(_completed_bytes * 8);
+
+        const long long parity_seq_number = ctsMediaStreamMessage::GetSequenceNumberFromTask(_task);
+        // parity is only as long as the longest frame it covers: the decoder rejects parity longer than the largest frame
+        if (!this->parity_decoder || _completed_bytes > this->maximum_frame_size_bytes) {
+            ctsConfig::Settings->UdpStatusDetails.error_frames.increment();
+            this->stats.error_frames.increment();
+
+            PrintDebugInfo(
+                L"\t\tctsIOPatternMediaStreamClient received **an unexpected** parity datagram for seq number (%lld) (%lu bytes)\n",
+                parity_seq_number,
+                _completed_bytes);
+            return ctsIOPatternProtocolError::NoError;
+        }
+
+        const ctsMediaStreamParity& parity = this->parity_decoder->get_parity();
+        const long long head_sequence_number = this->frame_window.head_sequence();
+        const long long tail_sequence_number = this->frame_window.tail_sequence();
+        if (parity_seq_number > this->final_frame ||
+            parity_seq_number > tail_sequence_number ||
+            parity.group_first_sequence(parity_seq_number) + parity.get_data_frames() - 1 < head_sequence_number) {
+            // every frame it covers was already processed, or is too far ahead to be tracked
+            PrintDebugInfo(
+                L"\t\tctsIOPatternMediaStreamClient ignoring parity for seq number (%lld) - head of queue (%lld)\n",
+                parity_seq_number,
+                head_sequence_number);
+            return ctsIOPatternProtocolError::NoError;
+        }
 
-        // move the head entry to the next sequence number
-        ++this->head_entry;
-        if (this->head_entry == this->frame_entries.end()) {
-            this->head_entry = this->frame_entries.begin();
+        const unsigned long header_length = ctsMediaStreamMessage::GetDataHeaderLengthFromTask(_task, _completed_bytes);
+        long long sender_qpc;
+        long long sender_qpf;
+        this->read_sender_timestamp(_task, &sender_qpc, &sender_qpf);
+        if (this->parity_decoder->add_parity(
+            parity_seq_number,
+            _task.buffer + _task.buffer_offset + header_length,
+            _completed_bytes - header_length,
+            sender_qpc,
+            sender_qpf)) {
+            return this->recover_frame(_task, parity_seq_number);
+        }
+        return ctsIOPatternProtocolError::NoError;
+    }
+
+    // rebuilds the one missing frame covered by the same parity datagram as _seq_number, if possible
+    // - the rebuilt payload is verified just as a received payload
+    _Requires_lock_held_(cs)
+    ctsIOPatternProtocolError ctsIOPatternMediaStreamClient::recover_frame(const ctsIOTask& _task, long long _seq_number) NOEXCEPT
+    {
+        if (!this->parity_decoder->can_recover(_seq_number)) {
+            return ctsIOPatternProtocolError::NoError;
+        }
+
+        const ctsMediaStreamParity& parity = this->parity_decoder->get_parity();
+        const long long group_last_sequence = parity.group_first_sequence(_seq_number) + parity.get_data_frames() - 1;
+        long long missing_seq_number = 0LL;
+        for (long long covered_seq_number = parity.parity_sequence(_seq_number);
+             covered_seq_number <= group_last_sequence && covered_seq_number <= this->final_frame;
+             covered_seq_number += parity.get_parity_frames()) {
+            // frames no longer in the queue were already processed
+            if (this->frame_window.contains(covered_seq_number) && this->frame_window.received(covered_seq_number) != this->frame_profile.frame_size(covered_seq_number)) {
+                missing_seq_number = covered_seq_number;
+            }
+        }
+        if (0LL == missing_seq_number) {
+            return ctsIOPatternProtocolError::NoError;
+        }
+
+        long long sender_qpc;
+        long long sender_qpf;
+        const char* recovered_payload = this->parity_decoder->recovered_payload(_seq_number, &sender_qpc, &sender_qpf);
+
+        ctsIOTask validation_task(_task);
+        validation_task.buffer = const_cast<char*>(recovered_payload);
+        validation_task.buffer_offset = 0;
+        // the rebuilt frame was sent with the same header layout as the datagram just received
+        validation_task.buffer_length = this->frame_profile.frame_size(missing_seq_number) - ctsMediaStreamSendRequests::HeaderLength(
+            missing_seq_number,
+            ctsMediaStreamMessage::IsCompactHeaderFromTask(_task));
+        if (!this->verify_buffer(validation_task, validation_task.buffer_length)) {
+            return ctsIOPatternProtocolError::CorruptedBytes;
+        }
+
+        LARGE_INTEGER qpc;
+        ::QueryPerformanceCounter(&qpc);
+        // the frame was available once the parity arrived
+        ctsMediaStreamFrameWindow::FrameTimestamps& timestamps = this->frame_window.timestamps(missing_seq_number);
+        timestamps.sender_qpc = sender_qpc;
+        timestamps.sender_qpf = sender_qpf;
+        timestamps.receiver_qpc = qpc.QuadPart;
+        timestamps.receiver_qpf = ctTimer::snap_qpf();
+        this->frame_window.received(missing_seq_number) = this->frame_profile.frame_size(missing_seq_number);
+
+        ctsConfig::Settings->UdpStatusDetails.recovered_frames.increment();
+        this->stats.recovered_frames.increment();
+
+        PrintDebugInfo(
+            L"\t\tctsIOPatternMediaStreamClient recovered seq number %lld from parity\n",
+            missing_seq_number);
+
+        if (static_cast<unsigned long>(missing_seq_number) == this->final_frame) {
+            this->end_stats();
+        }
+        return ctsIOPatternProtocolError::NoError;
+    }
+
+    // called once per timer tick in place of render_frame with -PlayoutBuffer:adaptive
+    // - the playout delay grows by one frame for each tick without rendering
+    // - and shrinks by one frame for each tick that renders 2 frames
+    _Requires_lock_held_(cs)
+    void ctsIOPatternMediaStreamClient::render_adaptive_frames() NOEXCEPT
+    {
+        const long long playout_delay_frames = static_cast<long long>(this->timer_wheel_offset_frames) - this->frame_window.head_sequence();
+        const bool at_maximum_depth = playout_delay_frames >= static_cast<long long>(this->maximum_buffer_frames);
+
+        if (this->buffering_start_milliseconds != 0LL) {
+            // rebuffering: resume once the target depth is buffered, or once the buffer can't grow any further
+            if (!at_maximum_depth && !this->received_frames_from_head(this->target_buffer_frames)) {
+                return;
+            }
+
+            const long long buffering_ms = ctTimer::snap_qpc_as_msec() - this->buffering_start_milliseconds;
+            ctsConfig::Settings->UdpStatusDetails.buffering_milliseconds.add(buffering_ms);
+            this->stats.buffering_milliseconds.add(buffering_ms);
+            this->buffering_start_milliseconds = 0LL;
+
+            PrintDebugInfo(
+                L"\t\tctsIOPatternMediaStreamClient resuming at frame %lld after rebuffering for %lld ms\n",
+                this->frame_window.head_sequence(),
+                buffering_ms);
+
+            this->render_frame();
+            return;
+        }
+
+        if (this->frame_window.received(this->frame_window.head_sequence()) != this->frame_profile.frame_size(this->frame_window.head_sequence())) {
+            if (!at_maximum_depth && !this->received_frames_after_head()) {
+                // nothing is left to render: stop until the buffer refills
+                ctsConfig::Settings->UdpStatusDetails.rebuffer_count.increment();
+                this->stats.rebuffer_count.increment();
+                this->buffering_start_milliseconds = ctTimer::snap_qpc_as_msec();
+
+                PrintDebugInfo(
+                    L"\t\tctsIOPatternMediaStreamClient **rebuffering** at frame %lld\n",
+                    this->frame_window.head_sequence());
+                return;
+            }
+            // the head frame was lost - render_frame will count it as dropped
+            this->render_frame();
+            return;
+        }
+
+        if (!at_maximum_depth && playout_delay_frames < static_cast<long long>(this->target_buffer_frames)) {
+            // grow the buffer by holding this frame for another tick
+            return;
+        }
+
+        this->render_frame();
+
+        // shrink the buffer only when more than a frame over the target, to not oscillate around it
+        if (playout_delay_frames > static_cast<long long>(this->target_buffer_frames) + 1LL &&
+            this->frame_window.head_sequence() <= this->final_frame &&
+            this->frame_window.received(this->frame_window.head_sequence()) == this->frame_profile.frame_size(this->frame_window.head_sequence())) {
+            this->render_frame();
         }
     }
 
     VOID CALLBACK ctsIOPatternMediaStreamClient::StartCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER)
     {
-        static const char StartBuffer[] = "START";
+        // servers which don't support the compact headers ignore START_COMPACT
+        static const unsigned long MaximumCompactStartRequests = 3;
 
         ctsIOPatternMediaStreamClient* this_ptr = reinterpret_cast<ctsIOPatternMediaStreamClient*>(_context);
         // take the base lock before touching any internal members
@@ -453,13 +892,11 @@ namespace ctsTraffic {
             // send another start message
             PrintDebugInfo(L"\t\tctsIOPatternMediaStreamClient re-requesting START\n");
 
-            ctsIOTask resend_task;
-            resend_task.ioAction = IOTaskAction::Send;
-            resend_task.track_io = false;
-            resend_task.buffer = const_cast<char*>(StartBuffer);
-            resend_task.buffer_offset = 0;
-            resend_task.buffer_length = static_cast<unsigned long>(::strlen(StartBuffer));
-            resend_task.buffer_type = ctsIOTask::BufferType::Static; // this is our own buffer: the base class should not mess with it
+            // the initial START_COMPACT was sent when connecting
+            ++this_ptr->start_requests;
+            const bool request_compact = this_ptr->compact_header_requested && this_ptr->start_requests < MaximumCompactStartRequests;
+            // Construct returns a static buffer: the base class should not mess with it
+            ctsIOTask resend_task(ctsMediaStreamMessage::Construct(request_compact ? MediaStreamAction::START_COMPACT : MediaStreamAction::START));
 
             this_ptr->set_next_start_timer();
             this_ptr->send_callback(resend_task);
@@ -467,9 +904,37 @@ namespace ctsTraffic {
         // else, don't schedule this timer anymore
     }
 
+    VOID CALLBACK ctsIOPatternMediaStreamClient::ProbeCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER)
+    {
+        ctsIOPatternMediaStreamClient* this_ptr = reinterpret_cast<ctsIOPatternMediaStreamClient*>(_context);
+        // take the base lock before touching any internal members
+        this_ptr->base_lock();
+        // guarantee the lock is released on exit
+        ctlScopeGuard(unlockBaseLockOnExit, {this_ptr->base_unlock();});
+
+        if (this_ptr->finished_stream) {
+            return;
+        }
+
+        this_ptr->set_next_probe_timer();
+
+        // the send time is written as late as possible
+        ctsMediaStreamMessage::MakeTimeProbe(this_ptr->probe_buffer, ctTimer::snap_qpc_as_usec());
+
+        ctsIOTask probe_task;
+        probe_task.ioAction = IOTaskAction::Send;
+        probe_task.track_io = false;
+        probe_task.buffer = this_ptr->probe_buffer;
+        probe_task.buffer_offset = 0;
+        probe_task.buffer_length = UdpDatagramTimeProbeLength;
+        probe_task.buffer_type = ctsIOTask::BufferType::Static; // this is our own buffer: the base class should not mess with it
+        this_ptr->send_callback(probe_task);
+    }
+
     VOID CALLBACK ctsIOPatternMediaStreamClient::TimerCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER)
     {
         ctsIOPatternMediaStreamClient* this_ptr = reinterpret_cast<ctsIOPatternMediaStreamClient*>(_context);
+        ctsTracePoint("ctsIOPatternMediaStreamClient::TimerCallback", this_ptr, nullptr, 0, nullptr, 0);
 
         // process frames until the timer is scheduled in the future to process more frames
         bool timer_scheduled = false;
@@ -487,7 +952,7 @@ namespace ctsTraffic {
 
             bool fatal_aborted = false;
             if (this_ptr->timer_wheel_offset_frames >= this_ptr->initial_buffer_frames &&
-                this_ptr->head_entry->sequence_number <= this_ptr->final_frame) {
+                this_ptr->frame_window.head_sequence() <= this_ptr->final_frame) {
                 // if we haven't yet received *anything* from the server, abort this connection
                 if (!this_ptr->received_buffered_frames()) {
                     ctsConfig::PrintErrorInfo(L"ctsIOPatternMediaStreamClient - issuing a FATALABORT to close the connection - have received nothing from the server");
@@ -502,6 +967,9 @@ namespace ctsTraffic {
                     this_ptr->send_callback(abort_task);
                     fatal_aborted = true;
 
+                } else if (this_ptr->adaptive_playout) {
+                    this_ptr->render_adaptive_frames();
+
                 } else {
                     // if the initial buffer has already been filled, "render" the frame
                     this_ptr->render_frame();
@@ -510,7 +978,7 @@ namespace ctsTraffic {
 
             if (!fatal_aborted) {
                 // wait for the precise number of milliseconds for the next frame
-                if (this_ptr->head_entry->sequence_number <= this_ptr->final_frame) {
+                if (this_ptr->frame_window.head_sequence() <= this_ptr->final_frame) {
                     timer_scheduled = this_ptr->set_next_timer(false);
 
                 } else {
@@ -22,6 +22,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsSafeInt.hpp"
 #include "ctsIOTask.hpp"
 #include "ctsConfig.h"
+#include "ctsTrace.h"
 
 
 namespace ctsTraffic {
@@ -80,6 +81,9 @@ namespace ctsTraffic {
         // track if waiting for the prior state to complete
         bool pended_state = false;
 
+        // all transitions after construction go through set_state so they can be traced
+        void set_state(InternalPatternState _new_state) NOEXCEPT;
+
     public:
         ctsIOPatternState() NOEXCEPT;
 
@@ -107,6 +111,12 @@ namespace ctsTraffic {
         }
     }
 
+    inline void ctsIOPatternState::set_state(InternalPatternState _new_state) NOEXCEPT
+    {
+        ctsTracePoint("ctsIOPatternState::set_state", this, "from", this->internal_state, "to", _new_state);
+        this->internal_state = _new_state;
+    }
+
     inline ctsUnsignedLongLong ctsIOPatternState::get_remaining_transfer() const NOEXCEPT
     {
         //
@@ -169,19 +179,19 @@ namespace ctsTraffic {
                 if (ctsConfig::IsListening()) {
                     PrintDebugInfo(L"\t\tctsIOPatternState::get_next_task : ServerSendConnectionId\n");
                     this->pended_state = true;
-                    this->internal_state = InternalPatternState::ServerSendConnectionId;
+                    this->set_state(InternalPatternState::ServerSendConnectionId);
                     return ctsIOPatternProtocolTask::SendConnectionId;
                 } else {
                     PrintDebugInfo(L"\t\tctsIOPatternState::get_next_task : RecvConnectionId\n");
                     this->pended_state = true;
-                    this->internal_state = InternalPatternState::ClientRecvConnectionId;
+                    this->set_state(InternalPatternState::ClientRecvConnectionId);
                     return ctsIOPatternProtocolTask::RecvConnectionId;
                 }
 
             case InternalPatternState::ServerSendConnectionId: // both client and server start IO after the connection ID is shared
             case InternalPatternState::ClientRecvConnectionId:
                 PrintDebugInfo(L"\t\tctsIOPatternState::get_next_task : MoreIo\n");
-                this->internal_state = InternalPatternState::MoreIo;
+                this->set_state(InternalPatternState::MoreIo);
                 return ctsIOPatternProtocolTask::MoreIo;
 
             case InternalPatternState::MoreIo:
@@ -241,7 +251,7 @@ namespace ctsTraffic {
         if (ctsConfig::ProtocolType::UDP == ctsConfig::Settings->Protocol) {
             if (_error_code != 0) {
                 PrintDebugInfo(L"\t\tctsIOPatternState::update_error : ErrorIOFailed\n");
-                this->internal_state = InternalPatternState::ErrorIOFailed;
+                this->set_state(InternalPatternState::ErrorIOFailed);
                 return ctsIOPatternProtocolError::ErrorIOFailed;
             }
 
@@ -255,7 +265,7 @@ namespace ctsTraffic {
                     return ctsIOPatternProtocolError::NoError;
                 } else {
                     PrintDebugInfo(L"\t\tctsIOPatternState::update_error : ErrorIOFailed\n");
-                    this->internal_state = InternalPatternState::ErrorIOFailed;
+                    this->set_state(InternalPatternState::ErrorIOFailed);
                     return ctsIOPatternProtocolError::ErrorIOFailed;
                 }
             }
@@ -284,7 +294,7 @@ namespace ctsTraffic {
                     L"\t\tctsIOPatternState::completed_task : ErrorIOFailed (TooFewBytes) [transfered %llu, Expected ConnectionID (%u)]\n",
                     static_cast<unsigned long long>(_completed_transfer_bytes),
                     ctsStatistics::ConnectionIdLength);
-                this->internal_state = InternalPatternState::ErrorIOFailed;
+                this->set_state(InternalPatternState::ErrorIOFailed);
                 return ctsIOPatternProtocolError::TooFewBytes;
             }
 
@@ -340,7 +350,7 @@ namespace ctsTraffic {
                     L"\t\tctsIOPatternState::completed_task : ErrorIOFailed (TooFewBytes) [transferred %llu, expected transfer %llu]\n",
                     static_cast<unsigned long long>(already_transferred),
                     static_cast<unsigned long long>(this->max_transfer));
-                this->internal_state = InternalPatternState::ErrorIOFailed;
+                this->set_state(InternalPatternState::ErrorIOFailed);
                 return ctsIOPatternProtocolError::TooFewBytes;
             }
         }
@@ -357,24 +367,24 @@ namespace ctsTraffic {
                     switch (this->internal_state) {
                         case InternalPatternState::MoreIo:
                             PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (MoreIo) : ServerSendCompletion\n");
-                            this->internal_state = InternalPatternState::ServerSendCompletion;
+                            this->set_state(InternalPatternState::ServerSendCompletion);
                             this->pended_state = false;
                             break;
 
                         case InternalPatternState::ServerSendCompletion:
                             PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (ServerSendCompletion) : RequestFIN\n");
-                            this->internal_state = InternalPatternState::RequestFIN;
+                            this->set_state(InternalPatternState::RequestFIN);
                             this->pended_state = false;
                             break;
 
                         case InternalPatternState::RequestFIN:
                             if (_completed_transfer_bytes != 0) {
                                 PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (RequestFIN) : ErrorIOFailed (TooManyBytes)\n");
-                                this->internal_state = InternalPatternState::ErrorIOFailed;
+                                this->set_state(InternalPatternState::ErrorIOFailed);
                                 return ctsIOPatternProtocolError::TooManyBytes;
                             } else {
                                 PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (RequestFIN) : CompletedTransfer\n");
-                                this->internal_state = InternalPatternState::CompletedTransfer;
+                                this->set_state(InternalPatternState::CompletedTransfer);
                                 return ctsIOPatternProtocolError::SuccessfullyCompleted;
                             }
 
@@ -388,7 +398,7 @@ namespace ctsTraffic {
                     switch (this->internal_state) {
                         case InternalPatternState::MoreIo:
                             PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (MoreIo) : ClientRecvCompletion\n");
-                            this->internal_state = InternalPatternState::ClientRecvCompletion;
+                            this->set_state(InternalPatternState::ClientRecvCompletion);
                             this->pended_state = false;
                             break;
 
@@ -398,41 +408,41 @@ namespace ctsTraffic {
                                 PrintDebugInfo(
                                     L"\t\tctsIOPatternState::completed_task (ClientRecvCompletion) : ErrorIOFailed (Server didn't return a completion - returned %u bytes)\n",
                                     _completed_transfer_bytes);
-                                this->internal_state = InternalPatternState::ErrorIOFailed;
+                                this->set_state(InternalPatternState::ErrorIOFailed);
                                 return ctsIOPatternProtocolError::TooFewBytes;
                             }
 
                             if (ctsConfig::TcpShutdownType::GracefulShutdown == ctsConfig::Settings->TcpShutdown) {
                                 PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (ClientRecvCompletion) : GracefulShutdown\n");
-                                this->internal_state = InternalPatternState::GracefulShutdown;
+                                this->set_state(InternalPatternState::GracefulShutdown);
                                 this->pended_state = false;
                             } else {
                                 PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (ClientRecvCompletion) : HardShutdown\n");
-                                this->internal_state = InternalPatternState::HardShutdown;
+                                this->set_state(InternalPatternState::HardShutdown);
                                 this->pended_state = false;
                             }
                             break;
 
                         case InternalPatternState::GracefulShutdown:
                             PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (GracefulShutdown) : RequestFIN\n");
-                            this->internal_state = InternalPatternState::RequestFIN;
+                            this->set_state(InternalPatternState::RequestFIN);
                             this->pended_state = false;
                             break;
 
                         case InternalPatternState::RequestFIN:
                             if (_completed_transfer_bytes != 0) {
                                 PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (RequestFIN) : ErrorIOFailed (TooManyBytes)\n");
-                                this->internal_state = InternalPatternState::ErrorIOFailed;
+                                this->set_state(InternalPatternState::ErrorIOFailed);
                                 return ctsIOPatternProtocolError::TooManyBytes;
                             }
 
                             PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (RequestFIN) : CompletedTransfer\n");
-                            this->internal_state = InternalPatternState::CompletedTransfer;
+                            this->set_state(InternalPatternState::CompletedTransfer);
                             return ctsIOPatternProtocolError::SuccessfullyCompleted;
 
                         case InternalPatternState::HardShutdown:
                             PrintDebugInfo(L"\t\tctsIOPatternState::completed_task (HardShutdown) : CompletedTransfer\n");
-                            this->internal_state = InternalPatternState::CompletedTransfer;
+                            this->set_state(InternalPatternState::CompletedTransfer);
                             return ctsIOPatternProtocolError::SuccessfullyCompleted;
 
                         default:
@@ -450,7 +460,7 @@ namespace ctsTraffic {
                 L"\t\tctsIOPatternState::completed_task : ErrorIOFailed (TooManyBytes) [transferred %llu, expected transfer %llu]\n",
                 static_cast<unsigned long long>(already_transferred),
                 static_cast<unsigned long long>(this->max_transfer));
-            this->internal_state = InternalPatternState::ErrorIOFailed;
+            this->set_state(InternalPatternState::ErrorIOFailed);
             return ctsIOPatternProtocolError::TooManyBytes;
         }
 
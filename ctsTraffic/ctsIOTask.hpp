@@ -29,7 +29,7 @@ namespace ctsTraffic {
     /// - and provides it the buffer it should use to send/recv data
     ///
     ///////////////////////////////////////////////////////////////////////////////////////////////////
-    enum class IOTaskAction
+    enum class IOTaskAction : unsigned char
     {
         None,
         Send,
@@ -40,19 +40,37 @@ namespace ctsTraffic {
         FatalAbort
     };
 
+    ///
+    /// ctsIOTask is copied by value from initiate_io, through the IO function's callbacks, back to complete_io
+    /// - kept within one cache line: the fields every IO function reads come first, the (internal) fields last
+    /// - the scatter/gather segments live outside the task, in a list owned by the ctsIOPattern which handed it out
+    ///
     struct ctsIOTask {
-        long long time_offset_milliseconds = 0LL;
-        RIO_BUFFERID rio_bufferid = RIO_INVALID_BUFFERID;
+        // (optional) scatter/gather segments, only handed out to IO functions posting vectored IO (WSASend/WSARecv)
+        // - segment_count == 0: the IO is the single buffer at (buffer + buffer_offset)
+        // - segment_count > 0: the IO is segments[0 .. segment_count) in order
+        //   buffer_length is the total across all segments, and buffer + buffer_offset is the first segment
+        static const unsigned long MaxSegments = 8;
+        struct Segment {
+            char* buffer;
+            unsigned long length;
+        };
 
         _Field_size_full_(buffer_length)
         char* buffer = nullptr;
         unsigned long buffer_length = 0UL;
         unsigned long buffer_offset = 0UL;
-        unsigned long expected_pattern_offset = 0UL;
+        long long time_offset_milliseconds = 0LL;
+        // the same offset at microsecond resolution, for patterns pacing faster than one IO per millisecond
+        // - zero when only time_offset_milliseconds was set
+        long long time_offset_microseconds = 0LL;
+        _Field_size_(segment_count)
+        Segment* segments = nullptr;
         IOTaskAction ioAction = IOTaskAction::None;
+        unsigned char segment_count = 0;
 
         // (internal) flag identifying the type of buffer
-        enum class BufferType
+        enum class BufferType : unsigned char
         {
             Null,
             TcpConnectionId,
@@ -62,6 +80,23 @@ namespace ctsTraffic {
         } buffer_type = BufferType::Null;
         // (internal) flag if this IO request is tracked and verified
         bool track_io = false;
+        unsigned long expected_pattern_offset = 0UL;
+        RIO_BUFFERID rio_bufferid = RIO_INVALID_BUFFERID;
+
+        // returns the number of WSABUFs filled in to post this IO
+        unsigned long fill_wsabufs(_Out_writes_to_(MaxSegments, return) WSABUF* _wsabufs) const NOEXCEPT
+        {
+            if (0 == segment_count) {
+                _wsabufs[0].buf = buffer + buffer_offset;
+                _wsabufs[0].len = buffer_length;
+                return 1;
+            }
+            for (unsigned long segment = 0; segment < segment_count; ++segment) {
+                _wsabufs[segment].buf = segments[segment].buffer;
+                _wsabufs[segment].len = segments[segment].length;
+            }
+            return segment_count;
+        }
 
         static LPCWSTR PrintIOAction(const IOTaskAction& _action) NOEXCEPT
         {
@@ -78,5 +113,6 @@ namespace ctsTraffic {
             return L"Unknown IOAction";
         }
     };
+    static_assert(sizeof(ctsIOTask) <= SYSTEM_CACHE_ALIGNMENT_SIZE, "ctsIOTask must fit within one cache line");
 
 } // namespace
\ No newline at end of file
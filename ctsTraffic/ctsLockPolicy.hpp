@@ -0,0 +1,113 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+#include <ctException.hpp>
+
+
+namespace ctsTraffic {
+
+    typedef struct ctsLockThreadSafe_t ctsLockThreadSafe;
+
+    ///
+    /// The lock guarding an object's state
+    /// - lock() and unlock() are const: objects take their lock in const methods
+    /// - the same thread can take the lock recursively
+    ///
+    template <typename Threading>
+    class ctsLockPolicy {
+    public:
+        void lock() const NOEXCEPT;
+        void unlock() const NOEXCEPT;
+    };
+
+
+    ///
+    /// ctsLockThreadSafe
+    /// - a CRITICAL_SECTION, for objects which any thread can call at any time
+    ///
+    template<>
+    class ctsLockPolicy < ctsLockThreadSafe > {
+    public:
+        ctsLockPolicy()
+        {
+            /// using a common spin count from base OS usage & crt usage
+            if (!::InitializeCriticalSectionEx(&this->cs, 4000, 0)) {
+                throw ctl::ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsLockPolicy", false);
+            }
+        }
+        ~ctsLockPolicy() NOEXCEPT
+        {
+            ::DeleteCriticalSection(&this->cs);
+        }
+
+        _Acquires_lock_(this->cs)
+        void lock() const NOEXCEPT
+        {
+            ::EnterCriticalSection(&this->cs);
+        }
+        _Releases_lock_(this->cs)
+        void unlock() const NOEXCEPT
+        {
+            ::LeaveCriticalSection(&this->cs);
+        }
+
+        /// not copyable
+        ctsLockPolicy(const ctsLockPolicy&) = delete;
+        ctsLockPolicy& operator=(const ctsLockPolicy&) = delete;
+
+    private:
+        mutable CRITICAL_SECTION cs;
+    };
+
+    ///
+    /// Pure RAII holding a ctsLockPolicy for the lifetime of the object
+    ///
+    template <typename Threading>
+    class ctsAutoReleaseLock {
+    public:
+        explicit ctsAutoReleaseLock(const ctsLockPolicy<Threading>& _lock) NOEXCEPT :
+            lock(_lock)
+        {
+            this->lock.lock();
+        }
+        ~ctsAutoReleaseLock() NOEXCEPT
+        {
+            this->lock.unlock();
+        }
+
+        /// no default c'tor
+        ctsAutoReleaseLock() = delete;
+        /// non-copyable
+        ctsAutoReleaseLock(const ctsAutoReleaseLock&) = delete;
+        ctsAutoReleaseLock& operator=(const ctsAutoReleaseLock&) = delete;
+
+    private:
+        const ctsLockPolicy<Threading>& lock;
+    };
+
+
+    ///
+    /// The locks of each connection: ctsSocketState, ctsSocket, and ctsIOPattern
+    /// - the IO functions complete IO on any threadpool thread while the next IO is being posted,
+    ///   and timers, ISB notifications, state changes, and the broker polling the state run alongside them
+    ///
+    typedef ctsLockThreadSafe ctsConnectionThreading;
+    typedef ctsLockPolicy<ctsConnectionThreading> ctsConnectionLock;
+    typedef ctsAutoReleaseLock<ctsConnectionThreading> ctsAutoReleaseConnectionLock;
+}
@@ -158,7 +158,9 @@ namespace ctsTraffic {
         }
 
         ctl::ctSockaddr targetAddress(shared_socket->target_address());
-        ctsIOTask start_task = ctsMediaStreamMessage::Construct(MediaStreamAction::START);
+        // -DatagramHeader:compact asks the server for the compact headers: the pattern falls back to START if unanswered
+        ctsIOTask start_task = ctsMediaStreamMessage::Construct(
+            ctsConfig::GetMediaStream().CompactHeader ? MediaStreamAction::START_COMPACT : MediaStreamAction::START);
 
         // Not add-ref'ing the IO on the socket since this is a single send() simulating connect()
         auto response = ctsWSASendTo(
@@ -0,0 +1,187 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// cpp headers
+#include <vector>
+#include <stdexcept>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// The size of every frame in a MediaStream
+    ///
+    /// Frame sizes repeat in a cycle: sequence number N is sized from cycle slot ((N - 1) % cycle length)
+    /// - Constant: every frame is the average size
+    /// - GroupOfPictures: one I frame followed by (gop_frames - 1) P frames, the I frame i_frame_ratio times a P frame
+    /// - FromTrace: the relative sizes of a captured trace, scaled to the average size
+    ///
+    /// Every cycle averages the requested frame size, so the stream keeps its bit rate over each whole cycle
+    /// - no bytes are lost to rounding: the sizes of a cycle always sum to (cycle length * average size)
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamFrameProfile {
+    public:
+        // frames must have room for the datagram header and for the connection id sent in the same buffer
+        static const unsigned long MinimumFrameSizeBytes = 40UL;
+
+        static ctsMediaStreamFrameProfile Constant(unsigned long _frame_size_bytes)
+        {
+            ctsMediaStreamFrameProfile profile;
+            profile.assign(std::vector<unsigned long long>(1, _frame_size_bytes));
+            return profile;
+        }
+
+        static ctsMediaStreamFrameProfile GroupOfPictures(unsigned long _frame_size_bytes, unsigned long _gop_frames, unsigned long _i_frame_ratio)
+        {
+            if (0 == _gop_frames || 0 == _i_frame_ratio) {
+                throw std::invalid_argument("The group of pictures and the I frame ratio must be at least 1");
+            }
+
+            // G frames of average size F: I + (G - 1) * P == G * F with I == R * P
+            // - P == G * F / (G - 1 + R), the I frame takes the remainder
+            const unsigned long long gop_bytes = static_cast<unsigned long long>(_gop_frames) * _frame_size_bytes;
+            const unsigned long long p_frame_bytes = gop_bytes / (static_cast<unsigned long long>(_gop_frames) - 1ULL + _i_frame_ratio);
+
+            std::vector<unsigned long long> frame_sizes(_gop_frames, p_frame_bytes);
+            frame_sizes[0] = gop_bytes - p_frame_bytes * (static_cast<unsigned long long>(_gop_frames) - 1ULL);
+
+            ctsMediaStreamFrameProfile profile;
+            profile.assign(frame_sizes);
+            return profile;
+        }
+
+        // _relative_sizes can be in any unit: the cycle keeps their proportions at an average of _frame_size_bytes
+        static ctsMediaStreamFrameProfile FromTrace(const std::vector<unsigned long>& _relative_sizes, unsigned long _frame_size_bytes)
+        {
+            if (_relative_sizes.empty()) {
+                throw std::invalid_argument("The frame size trace must contain at least one frame");
+            }
+
+            double trace_bytes = 0.0;
+            for (const auto& relative_size : _relative_sizes) {
+                trace_bytes += static_cast<double>(relative_size);
+            }
+            if (0.0 == trace_bytes) {
+                throw std::invalid_argument("The frame size trace must contain a non-zero frame size");
+            }
+
+            // each frame ends where its share of the running total ends
+            // - frame sizes sum exactly to the cycle total without tracking a separate remainder
+            const unsigned long long cycle_bytes = static_cast<unsigned long long>(_relative_sizes.size()) * _frame_size_bytes;
+            const double scale = static_cast<double>(cycle_bytes) / trace_bytes;
+
+            std::vector<unsigned long long> frame_sizes;
+            frame_sizes.reserve(_relative_sizes.size());
+            double running_trace_bytes = 0.0;
+            unsigned long long previous_boundary = 0ULL;
+            for (size_t index = 0; index < _relative_sizes.size(); ++index) {
+                running_trace_bytes += static_cast<double>(_relative_sizes[index]);
+                unsigned long long boundary = (index + 1 == _relative_sizes.size()) ?
+                    cycle_bytes :
+                    static_cast<unsigned long long>(running_trace_bytes * scale);
+                if (boundary > cycle_bytes) {
+                    boundary = cycle_bytes;
+                }
+                if (boundary < previous_boundary) {
+                    boundary = previous_boundary;
+                }
+                frame_sizes.push_back(boundary - previous_boundary);
+                previous_boundary = boundary;
+            }
+
+            ctsMediaStreamFrameProfile profile;
+            profile.assign(frame_sizes);
+            return profile;
+        }
+
+        ctsMediaStreamFrameProfile() :
+            frame_sizes(),
+            cycle_bytes(0ULL),
+            maximum_frame_bytes(0UL)
+        {
+        }
+
+        // the number of bytes in frame _sequence_number (the first frame is sequence number 1)
+        unsigned long frame_size(long long _sequence_number) const NOEXCEPT
+        {
+            if (frame_sizes.empty() || _sequence_number < 1LL) {
+                return 0UL;
+            }
+            return frame_sizes[static_cast<size_t>((_sequence_number - 1LL) % static_cast<long long>(frame_sizes.size()))];
+        }
+
+        unsigned long maximum_frame_size() const NOEXCEPT
+        {
+            return maximum_frame_bytes;
+        }
+
+        unsigned long cycle_length() const NOEXCEPT
+        {
+            return static_cast<unsigned long>(frame_sizes.size());
+        }
+
+        // the total bytes in frames [1, _frame_count]
+        unsigned long long total_bytes(unsigned long _frame_count) const NOEXCEPT
+        {
+            if (frame_sizes.empty()) {
+                return 0ULL;
+            }
+            const unsigned long long full_cycles = _frame_count / frame_sizes.size();
+            unsigned long long total = full_cycles * cycle_bytes;
+            const size_t remaining_frames = _frame_count % frame_sizes.size();
+            for (size_t index = 0; index < remaining_frames; ++index) {
+                total += frame_sizes[index];
+            }
+            return total;
+        }
+
+    private:
+        std::vector<unsigned long> frame_sizes;
+        unsigned long long cycle_bytes;
+        unsigned long maximum_frame_bytes;
+
+        void assign(const std::vector<unsigned long long>& _frame_sizes)
+        {
+            std::vector<unsigned long> new_frame_sizes;
+            new_frame_sizes.reserve(_frame_sizes.size());
+            unsigned long long new_cycle_bytes = 0ULL;
+            unsigned long new_maximum_frame_bytes = 0UL;
+            for (const auto& frame_size : _frame_sizes) {
+                if (frame_size < MinimumFrameSizeBytes) {
+                    throw std::invalid_argument("The frame size is too small - every frame must be at least 40 bytes");
+                }
+                if (frame_size > MAXULONG32) {
+                    throw std::invalid_argument("The frame size in bytes exceeds the maximum allowed to be streamed (2^32)");
+                }
+                new_frame_sizes.push_back(static_cast<unsigned long>(frame_size));
+                new_cycle_bytes += frame_size;
+                if (frame_size > new_maximum_frame_bytes) {
+                    new_maximum_frame_bytes = static_cast<unsigned long>(frame_size);
+                }
+            }
+
+            frame_sizes.swap(new_frame_sizes);
+            cycle_bytes = new_cycle_bytes;
+            maximum_frame_bytes = new_maximum_frame_bytes;
+        }
+    };
+}
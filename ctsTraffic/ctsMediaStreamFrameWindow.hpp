@@ -0,0 +1,146 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <vector>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// The window of MediaStream frames the client is currently buffering
+    ///
+    /// The window always holds the Size() consecutive sequence numbers starting at head_sequence()
+    /// - Size() is a power of two so sequence number N always lives in slot (N & mask):
+    ///   finding the slot for a received datagram is a range check and a mask, never a search
+    /// - advancing the head reuses its slot for the sequence number just past the tail
+    ///
+    /// The byte counts are kept apart from the timestamps
+    /// - every datagram and every render touches the byte counts, which pack 16 slots to a cache line
+    /// - the timestamps are only read to log jitter and to estimate the adaptive playout depth
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamFrameWindow {
+    public:
+        struct FrameTimestamps {
+            long long sender_qpc = 0LL;
+            long long sender_qpf = 0LL;
+            long long receiver_qpc = 0LL;
+            long long receiver_qpf = 0LL;
+        };
+
+        // returns the smallest power of two holding at least _minimum_frames
+        static unsigned long WindowSize(unsigned long _minimum_frames) NOEXCEPT
+        {
+            unsigned long window_size = 1UL;
+            while (window_size < _minimum_frames) {
+                window_size <<= 1;
+            }
+            return window_size;
+        }
+
+        ctsMediaStreamFrameWindow() NOEXCEPT :
+            head_sequence_number(1LL),
+            sequence_mask(0ULL),
+            received_bytes(),
+            frame_timestamps()
+        {
+        }
+
+        ///
+        /// sizes the window to hold at least _minimum_frames, starting from sequence number 1
+        /// - can throw std::bad_alloc
+        ///
+        void resize(unsigned long _minimum_frames)
+        {
+            const unsigned long window_size = WindowSize(_minimum_frames);
+            this->received_bytes.assign(window_size, 0UL);
+            this->frame_timestamps.assign(window_size, FrameTimestamps());
+            this->sequence_mask = window_size - 1;
+            this->head_sequence_number = 1LL;
+        }
+
+        unsigned long size() const NOEXCEPT
+        {
+            return static_cast<unsigned long>(this->received_bytes.size());
+        }
+
+        long long head_sequence() const NOEXCEPT
+        {
+            return this->head_sequence_number;
+        }
+
+        long long tail_sequence() const NOEXCEPT
+        {
+            return this->head_sequence_number + static_cast<long long>(this->received_bytes.size()) - 1LL;
+        }
+
+        bool contains(long long _seq_number) const NOEXCEPT
+        {
+            return _seq_number >= this->head_sequence_number && _seq_number <= this->tail_sequence();
+        }
+
+        // the caller must have checked contains(_seq_number)
+        unsigned long& received(long long _seq_number) NOEXCEPT
+        {
+            return this->received_bytes[this->slot(_seq_number)];
+        }
+
+        // the caller must have checked contains(_seq_number)
+        FrameTimestamps& timestamps(long long _seq_number) NOEXCEPT
+        {
+            return this->frame_timestamps[this->slot(_seq_number)];
+        }
+
+        // returns true if any frame other than the head has received data
+        bool received_after_head() const NOEXCEPT
+        {
+            const size_t head_slot = this->slot(this->head_sequence_number);
+            for (size_t index = 0; index < this->received_bytes.size(); ++index) {
+                if (index != head_slot && this->received_bytes[index] > 0UL) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // moves the head to the next sequence number: the old head slot now tracks the new tail
+        void advance() NOEXCEPT
+        {
+            const size_t head_slot = this->slot(this->head_sequence_number);
+            this->received_bytes[head_slot] = 0UL;
+            this->frame_timestamps[head_slot] = FrameTimestamps();
+            ++this->head_sequence_number;
+        }
+
+    private:
+        long long head_sequence_number;
+        unsigned long long sequence_mask;
+        // indexed by sequence number & sequence_mask
+        std::vector<unsigned long> received_bytes;
+        std::vector<FrameTimestamps> frame_timestamps;
+
+        size_t slot(long long _seq_number) const NOEXCEPT
+        {
+            return static_cast<size_t>(static_cast<unsigned long long>(_seq_number) & this->sequence_mask);
+        }
+    };
+
+} // namespace
@@ -0,0 +1,265 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Estimates the offset between the MediaStream server clock and the client clock from echo probes
+    ///
+    /// Each probe captures 4 timestamps (microseconds), as NTP does
+    /// - originate : client time the probe was sent
+    /// - receive   : server time the probe was received
+    /// - transmit  : server time the reply was sent
+    /// - destination : client time the reply was received
+    /// giving the round-trip delay ((destination - originate) - (transmit - receive))
+    /// and the offset of the server clock from the client clock ((receive - originate) + (transmit - destination)) / 2
+    ///
+    /// The offset is only as accurate as the probe is symmetric: queuing in either direction skews it
+    /// - only the probe with the lowest round-trip delay among the last ProbeFilterSize probes is trusted
+    /// - the skew between the clocks is the least-squares slope of the trusted offsets over client time
+    ///   kept as running sums so each probe is a constant amount of work
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamClockEstimator {
+    public:
+        static const unsigned long ProbeFilterSize = 8;
+        // clocks drifting further apart than this are assumed to be a bad estimate (as NTP assumes)
+        static const long long MaximumSkewPartsPerMillion = 500LL;
+
+        ctsMediaStreamClockEstimator() NOEXCEPT :
+            filter(),
+            probe_count(0LL),
+            trusted_count(0LL),
+            base_time(0LL),
+            base_offset(0LL),
+            sum_time(0.0),
+            sum_offset(0.0),
+            sum_time_squared(0.0),
+            sum_time_offset(0.0),
+            latest_offset(0LL),
+            latest_round_trip(0LL)
+        {
+        }
+
+        // returns true if the probe was trusted and updated the estimate
+        bool add_probe(long long _originate, long long _receive, long long _transmit, long long _destination) NOEXCEPT
+        {
+            const long long round_trip = (_destination - _originate) - (_transmit - _receive);
+            if (round_trip < 0LL) {
+                // the server held the probe longer than the round trip: the timestamps are not usable
+                return false;
+            }
+
+            ProbeSample& sample = this->filter[this->probe_count % ProbeFilterSize];
+            sample.round_trip = round_trip;
+            sample.offset = ((_receive - _originate) + (_transmit - _destination)) / 2LL;
+            // the offset is measured at the midpoint of the exchange
+            sample.local_time = _originate + (_destination - _originate) / 2LL;
+            ++this->probe_count;
+
+            const unsigned long filled = (this->probe_count < ProbeFilterSize) ? static_cast<unsigned long>(this->probe_count) : ProbeFilterSize;
+            for (unsigned long index = 0; index < filled; ++index) {
+                if (this->filter[index].round_trip < round_trip) {
+                    return false;
+                }
+            }
+
+            // relative to the first trusted probe to keep the sums precise
+            if (0LL == this->trusted_count) {
+                this->base_time = sample.local_time;
+                this->base_offset = sample.offset;
+            }
+            const double time = static_cast<double>(sample.local_time - this->base_time);
+            const double offset = static_cast<double>(sample.offset - this->base_offset);
+            this->sum_time += time;
+            this->sum_offset += offset;
+            this->sum_time_squared += time * time;
+            this->sum_time_offset += time * offset;
+            ++this->trusted_count;
+
+            this->latest_offset = sample.offset;
+            this->latest_round_trip = round_trip;
+            return true;
+        }
+
+        bool synchronized() const NOEXCEPT
+        {
+            return this->trusted_count > 0LL;
+        }
+
+        long long probes() const NOEXCEPT
+        {
+            return this->probe_count;
+        }
+
+        // the round-trip delay of the most recently trusted probe
+        long long round_trip_microseconds() const NOEXCEPT
+        {
+            return this->latest_round_trip;
+        }
+
+        // the rate the server clock gains on the client clock: 0.0 until 2 probes are trusted
+        double skew() const NOEXCEPT
+        {
+            if (this->trusted_count < 2LL) {
+                return 0.0;
+            }
+            const double count = static_cast<double>(this->trusted_count);
+            const double denominator = count * this->sum_time_squared - this->sum_time * this->sum_time;
+            if (denominator <= 0.0) {
+                return 0.0;
+            }
+            const double slope = (count * this->sum_time_offset - this->sum_time * this->sum_offset) / denominator;
+            const double maximum_slope = static_cast<double>(MaximumSkewPartsPerMillion) / 1000000.0;
+            if (slope > maximum_slope || slope < -maximum_slope) {
+                return 0.0;
+            }
+            return slope;
+        }
+
+        // the server clock minus the client clock at the client time _local_time (microseconds)
+        long long offset_at(long long _local_time) const NOEXCEPT
+        {
+            if (this->trusted_count < 2LL) {
+                return this->latest_offset;
+            }
+            const double slope = this->skew();
+            if (0.0 == slope) {
+                return this->latest_offset;
+            }
+            const double count = static_cast<double>(this->trusted_count);
+            const double intercept = (this->sum_offset - slope * this->sum_time) / count;
+            return this->base_offset + static_cast<long long>(intercept + slope * static_cast<double>(_local_time - this->base_time));
+        }
+
+    private:
+        struct ProbeSample {
+            long long round_trip = MAXLONGLONG;
+            long long offset = 0LL;
+            long long local_time = 0LL;
+        };
+        ProbeSample filter[ProbeFilterSize];
+        long long probe_count;
+        long long trusted_count;
+
+        // least-squares sums of the trusted (time, offset) samples
+        long long base_time;
+        long long base_offset;
+        double sum_time;
+        double sum_offset;
+        double sum_time_squared;
+        double sum_time_offset;
+
+        long long latest_offset;
+        long long latest_round_trip;
+    };
+
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// The distribution of one-way delays (microseconds) of a single stream
+    ///
+    /// Recording a delay is a constant amount of work with no allocations, so every datagram can be recorded
+    /// - values below 2 * SubBuckets are counted exactly
+    /// - each power of two above that is split into SubBuckets buckets: percentiles are within 1/SubBuckets
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamDelayDistribution {
+    public:
+        static const unsigned long SubBucketBits = 3;
+        static const unsigned long SubBuckets = 1UL << SubBucketBits;
+        // values up to 2^40 microseconds (~12 days)
+        static const unsigned long MaximumExponent = 40;
+        static const unsigned long BucketCount = 2 * SubBuckets + (MaximumExponent - SubBucketBits) * SubBuckets;
+
+        ctsMediaStreamDelayDistribution() NOEXCEPT :
+            bucket_counts(),
+            value_count(0LL)
+        {
+        }
+
+        static unsigned long BucketIndex(long long _value) NOEXCEPT
+        {
+            if (_value < static_cast<long long>(2 * SubBuckets)) {
+                return (_value < 0LL) ? 0UL : static_cast<unsigned long>(_value);
+            }
+
+            unsigned long exponent = SubBucketBits + 1;
+            while (exponent < MaximumExponent && (_value >> (exponent + 1)) != 0LL) {
+                ++exponent;
+            }
+            if ((_value >> (exponent + 1)) != 0LL) {
+                return BucketCount - 1;
+            }
+            const unsigned long sub_bucket = static_cast<unsigned long>(_value >> (exponent - SubBucketBits)) & (SubBuckets - 1);
+            return 2 * SubBuckets + (exponent - SubBucketBits - 1) * SubBuckets + sub_bucket;
+        }
+
+        // the midpoint of the values counted in the bucket
+        static long long BucketValue(unsigned long _bucket) NOEXCEPT
+        {
+            if (_bucket < 2 * SubBuckets) {
+                return static_cast<long long>(_bucket);
+            }
+            const unsigned long exponent = (_bucket - 2 * SubBuckets) / SubBuckets + SubBucketBits + 1;
+            const unsigned long sub_bucket = (_bucket - 2 * SubBuckets) % SubBuckets;
+            const long long width = 1LL << (exponent - SubBucketBits);
+            return static_cast<long long>(SubBuckets + sub_bucket) * width + width / 2LL;
+        }
+
+        void add_value(long long _value) NOEXCEPT
+        {
+            ++this->bucket_counts[BucketIndex(_value)];
+            ++this->value_count;
+        }
+
+        long long count() const NOEXCEPT
+        {
+            return this->value_count;
+        }
+
+        // returns the value at or below which _percent of the values fall (0 with no values)
+        long long percentile(unsigned long _percent) const NOEXCEPT
+        {
+            if (0LL == this->value_count) {
+                return 0LL;
+            }
+            long long rank = (this->value_count * _percent + 99LL) / 100LL;
+            if (rank < 1LL) {
+                rank = 1LL;
+            }
+            long long counted = 0LL;
+            for (unsigned long bucket = 0; bucket < BucketCount; ++bucket) {
+                counted += this->bucket_counts[bucket];
+                if (counted >= rank) {
+                    return BucketValue(bucket);
+                }
+            }
+            return BucketValue(BucketCount - 1);
+        }
+
+    private:
+        unsigned long bucket_counts[BucketCount];
+        long long value_count;
+    };
+
+} // namespace
@@ -0,0 +1,346 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <vector>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+#include <ctException.hpp>
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// Forward error correction for MediaStream frames (-FecFrames and -FecParity)
+    ///
+    /// Sequence numbers (starting at 1) are split into groups of DataFrames frames
+    /// - the server sends ParityFrames parity datagrams after the last frame of each group
+    /// - parity datagram 'j' covers every ParityFrames'th frame of the group, starting at the j'th frame
+    ///   its sequence number is the first frame it covers, its payload is the XOR of the covered payloads
+    /// - interleaving the parity this way recovers any burst of up to ParityFrames consecutive lost frames
+    ///   (at most one lost frame per parity datagram)
+    ///
+    /// Every frame must fit in one datagram so all payloads in a group are the same length
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamParity {
+    public:
+        ///
+        /// _target ^= _source
+        /// - written over 64-bit words in independent lanes so the compiler can vectorize it
+        ///
+        static void XorBuffer(_Inout_updates_bytes_(_length) char* _target, _In_reads_bytes_(_length) const char* _source, size_t _length) NOEXCEPT
+        {
+            typedef unsigned long long UNALIGNED* WordPointer;
+            typedef const unsigned long long UNALIGNED* ConstWordPointer;
+
+            size_t offset = 0;
+            for (; offset + 4 * sizeof(unsigned long long) <= _length; offset += 4 * sizeof(unsigned long long)) {
+                WordPointer target_words = reinterpret_cast<WordPointer>(_target + offset);
+                ConstWordPointer source_words = reinterpret_cast<ConstWordPointer>(_source + offset);
+                target_words[0] ^= source_words[0];
+                target_words[1] ^= source_words[1];
+                target_words[2] ^= source_words[2];
+                target_words[3] ^= source_words[3];
+            }
+            for (; offset + sizeof(unsigned long long) <= _length; offset += sizeof(unsigned long long)) {
+                *reinterpret_cast<WordPointer>(_target + offset) ^= *reinterpret_cast<ConstWordPointer>(_source + offset);
+            }
+            for (; offset < _length; ++offset) {
+                _target[offset] ^= _source[offset];
+            }
+        }
+
+        ctsMediaStreamParity() NOEXCEPT :
+            data_frames(0UL),
+            parity_frames(0UL),
+            payload_length(0UL)
+        {
+        }
+
+        ctsMediaStreamParity(unsigned long _data_frames, unsigned long _parity_frames, unsigned long _payload_length) NOEXCEPT :
+            data_frames(_data_frames),
+            parity_frames(_parity_frames),
+            payload_length(_payload_length)
+        {
+            ctl::ctFatalCondition(
+                0 == _data_frames || 0 == _parity_frames || _parity_frames > _data_frames,
+                L"ctsMediaStreamParity: invalid group of %lu data frames with %lu parity frames", _data_frames, _parity_frames);
+        }
+
+        bool is_enabled() const NOEXCEPT
+        {
+            return this->data_frames != 0;
+        }
+
+        unsigned long get_data_frames() const NOEXCEPT
+        {
+            return this->data_frames;
+        }
+
+        unsigned long get_parity_frames() const NOEXCEPT
+        {
+            return this->parity_frames;
+        }
+
+        unsigned long get_payload_length() const NOEXCEPT
+        {
+            return this->payload_length;
+        }
+
+        long long group_first_sequence(long long _sequence_number) const NOEXCEPT
+        {
+            return ((_sequence_number - 1) / this->data_frames) * this->data_frames + 1;
+        }
+
+        // the index of the parity datagram covering this sequence number
+        unsigned long parity_index(long long _sequence_number) const NOEXCEPT
+        {
+            return static_cast<unsigned long>((_sequence_number - this->group_first_sequence(_sequence_number)) % this->parity_frames);
+        }
+
+        // the sequence number carried by the parity datagram covering this sequence number
+        long long parity_sequence(long long _sequence_number) const NOEXCEPT
+        {
+            return this->group_first_sequence(_sequence_number) + this->parity_index(_sequence_number);
+        }
+
+        // the number of frames covered by the parity datagram covering this sequence number
+        // - the final group is short when the stream length isn't a multiple of the group size
+        unsigned long covered_frames(long long _sequence_number, long long _final_frame) const NOEXCEPT
+        {
+            long long group_end = this->group_first_sequence(_sequence_number) + this->data_frames - 1;
+            if (group_end > _final_frame) {
+                group_end = _final_frame;
+            }
+            const long long first_covered = this->parity_sequence(_sequence_number);
+            if (first_covered > group_end) {
+                return 0;
+            }
+            return static_cast<unsigned long>((group_end - first_covered) / this->parity_frames + 1);
+        }
+
+        bool is_group_end(long long _sequence_number, long long _final_frame) const NOEXCEPT
+        {
+            return (_sequence_number % this->data_frames == 0) || (_sequence_number == _final_frame);
+        }
+
+    private:
+        unsigned long data_frames;
+        unsigned long parity_frames;
+        unsigned long payload_length;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsMediaStreamParityEncoder
+    /// - the server accumulates the parity of each frame as it's sent
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamParityEncoder {
+    public:
+        ctsMediaStreamParityEncoder() NOEXCEPT :
+            parity(),
+            parity_payloads(),
+            payload_lengths()
+        {
+        }
+
+        // can throw std::bad_alloc
+        void initialize(const ctsMediaStreamParity& _parity)
+        {
+            this->parity_payloads.resize(_parity.get_parity_frames());
+            for (auto& payload : this->parity_payloads) {
+                payload.assign(_parity.get_payload_length(), 0);
+            }
+            this->payload_lengths.assign(_parity.get_parity_frames(), 0UL);
+            this->parity = _parity;
+        }
+
+        const ctsMediaStreamParity& get_parity() const NOEXCEPT
+        {
+            return this->parity;
+        }
+
+        void add_frame(long long _sequence_number, _In_reads_bytes_(_length) const char* _payload, unsigned long _length) NOEXCEPT
+        {
+            ctl::ctFatalCondition(
+                _length > this->parity.get_payload_length(),
+                L"ctsMediaStreamParityEncoder: the payload (%lu bytes) is larger than the parity payload (%lu bytes)",
+                _length, this->parity.get_payload_length());
+
+            const unsigned long parity_index = this->parity.parity_index(_sequence_number);
+            std::vector<char>& payload = this->parity_payloads[parity_index];
+            ctsMediaStreamParity::XorBuffer(payload.data(), _payload, _length);
+            if (_length > this->payload_lengths[parity_index]) {
+                this->payload_lengths[parity_index] = _length;
+            }
+        }
+
+        char* parity_payload(unsigned long _parity_index) NOEXCEPT
+        {
+            return this->parity_payloads[_parity_index].data();
+        }
+
+        // the longest payload added to the parity: the bytes past it are all zero
+        // - frames of different sizes only need their parity as long as the longest frame covered
+        unsigned long parity_payload_length(unsigned long _parity_index) const NOEXCEPT
+        {
+            return this->payload_lengths[_parity_index];
+        }
+
+        // resets the parity for the next group
+        void clear() NOEXCEPT
+        {
+            for (auto& payload : this->parity_payloads) {
+                ::ZeroMemory(payload.data(), payload.size());
+            }
+            for (auto& payload_length : this->payload_lengths) {
+                payload_length = 0UL;
+            }
+        }
+
+    private:
+        ctsMediaStreamParity parity;
+        std::vector<std::vector<char>> parity_payloads;
+        std::vector<unsigned long> payload_lengths;
+    };
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsMediaStreamParityDecoder
+    /// - the client XORs every payload received into the parity of its group
+    ///   once the parity datagram has arrived and exactly one covered frame is missing,
+    ///   the accumulated payload is the payload of the missing frame
+    /// - tracks a ring of groups: enough to cover the client's queue of frames
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamParityDecoder {
+    public:
+        // can throw std::bad_alloc
+        ctsMediaStreamParityDecoder(const ctsMediaStreamParity& _parity, unsigned long _queued_frames, long long _final_frame) :
+            parity(_parity),
+            final_frame(_final_frame),
+            groups(_queued_frames / _parity.get_data_frames() + 2)
+        {
+            for (auto& group : this->groups) {
+                group.first_sequence = 0LL;
+                group.covered.resize(_parity.get_parity_frames());
+                for (auto& covered : group.covered) {
+                    covered.payload.assign(_parity.get_payload_length(), 0);
+                }
+            }
+        }
+
+        const ctsMediaStreamParity& get_parity() const NOEXCEPT
+        {
+            return this->parity;
+        }
+
+        ///
+        /// all return false if the sequence number's group is older than the groups being tracked
+        ///
+        bool add_frame(long long _sequence_number, _In_reads_bytes_(_length) const char* _payload, unsigned long _length) NOEXCEPT
+        {
+            Covered* covered = this->find_covered(_sequence_number);
+            if (nullptr == covered || _length > this->parity.get_payload_length()) {
+                return false;
+            }
+            ctsMediaStreamParity::XorBuffer(covered->payload.data(), _payload, _length);
+            ++covered->frames_received;
+            return true;
+        }
+
+        bool add_parity(long long _sequence_number, _In_reads_bytes_(_length) const char* _payload, unsigned long _length, long long _sender_qpc, long long _sender_qpf) NOEXCEPT
+        {
+            Covered* covered = this->find_covered(_sequence_number);
+            if (nullptr == covered || covered->parity_received || _length > this->parity.get_payload_length()) {
+                return false;
+            }
+            ctsMediaStreamParity::XorBuffer(covered->payload.data(), _payload, _length);
+            covered->parity_received = true;
+            covered->sender_qpc = _sender_qpc;
+            covered->sender_qpf = _sender_qpf;
+            return true;
+        }
+
+        // true if the payload of the one missing frame covered with this sequence number can be rebuilt
+        bool can_recover(long long _sequence_number) NOEXCEPT
+        {
+            Covered* covered = this->find_covered(_sequence_number);
+            return (covered != nullptr &&
+                    covered->parity_received &&
+                    covered->frames_received + 1 == this->parity.covered_frames(_sequence_number, this->final_frame));
+        }
+
+        // the rebuilt payload: only valid when can_recover() returned true
+        // - the sender timestamps are from the parity datagram
+        const char* recovered_payload(long long _sequence_number, _Out_ long long* _sender_qpc, _Out_ long long* _sender_qpf) NOEXCEPT
+        {
+            Covered* covered = this->find_covered(_sequence_number);
+            ctl::ctFatalCondition(
+                nullptr == covered,
+                L"ctsMediaStreamParityDecoder: sequence number %lld is no longer tracked", _sequence_number);
+            *_sender_qpc = covered->sender_qpc;
+            *_sender_qpf = covered->sender_qpf;
+            // the missing frame is now accounted for
+            ++covered->frames_received;
+            return covered->payload.data();
+        }
+
+    private:
+        struct Covered {
+            std::vector<char> payload;
+            unsigned long frames_received = 0UL;
+            bool parity_received = false;
+            long long sender_qpc = 0LL;
+            long long sender_qpf = 0LL;
+        };
+        struct Group {
+            long long first_sequence;
+            std::vector<Covered> covered;
+        };
+
+        // returns nullptr for groups older than the one stored in its slot
+        // - a newer group resets the slot
+        Covered* find_covered(long long _sequence_number) NOEXCEPT
+        {
+            const long long first_sequence = this->parity.group_first_sequence(_sequence_number);
+            const size_t group_index = static_cast<size_t>((first_sequence - 1) / this->parity.get_data_frames());
+            Group& group = this->groups[group_index % this->groups.size()];
+            if (group.first_sequence > first_sequence) {
+                return nullptr;
+            }
+            if (group.first_sequence < first_sequence) {
+                group.first_sequence = first_sequence;
+                for (auto& covered : group.covered) {
+                    ::ZeroMemory(covered.payload.data(), covered.payload.size());
+                    covered.frames_received = 0UL;
+                    covered.parity_received = false;
+                    covered.sender_qpc = 0LL;
+                    covered.sender_qpf = 0LL;
+                }
+            }
+            return &group.covered[this->parity.parity_index(_sequence_number)];
+        }
+
+        const ctsMediaStreamParity parity;
+        const long long final_frame;
+        std::vector<Group> groups;
+    };
+}
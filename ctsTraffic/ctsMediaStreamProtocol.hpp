@@ -40,10 +40,16 @@ namespace ctsTraffic {
     ///
     ///   REQUEST_ID
     ///   START
+    ///   START_COMPACT : requests the compact datagram headers described below
+    ///   TIME_PROBE : binary - the protocol header and the client's send time
     ///
 
     static const unsigned short UdpDatagramProtocolHeaderFlagData = 0x0000;
     static const unsigned short UdpDatagramProtocolHeaderFlagId = 0x1000;
+    // parity datagrams use the same layout as data datagrams (see ctsMediaStreamParity.hpp)
+    static const unsigned short UdpDatagramProtocolHeaderFlagParity = 0x2000;
+    // clock probes: the server echoes the client's send time with its own receive and send times (see ctsMediaStreamOneWayDelay.hpp)
+    static const unsigned short UdpDatagramProtocolHeaderFlagTimeProbe = 0x3000;
 
     static const unsigned long UdpDatagramProtocolHeaderFlagLength = 2;
     static const unsigned long UdpDatagramConnectionIdHeaderLength = UdpDatagramProtocolHeaderFlagLength + ctsStatistics::ConnectionIdLength;
@@ -53,14 +59,79 @@ namespace ctsTraffic {
     static const unsigned long UdpDatagramQPFLength = 8; // 64-bit value
     static const unsigned long UdpDatagramDataHeaderLength = UdpDatagramProtocolHeaderFlagLength + UdpDatagramSequenceNumberLength + UdpDatagramQPCLength + UdpDatagramQPFLength;
 
+    static const unsigned long UdpDatagramTimestampLength = 8; // 64-bit value (microseconds)
+    static const unsigned long UdpDatagramTimeProbeLength = UdpDatagramProtocolHeaderFlagLength + UdpDatagramTimestampLength;
+    static const unsigned long UdpDatagramTimeReplyLength = UdpDatagramProtocolHeaderFlagLength + 3 * UdpDatagramTimestampLength;
+
+    // compact datagrams are sent to clients which requested them with START_COMPACT
+    // - the same frame types with UdpDatagramProtocolHeaderFlagCompact set, each with one contiguous header
+    // - data and parity: the sequence number as a varint delta from the first frame, then the low 32 bits of the sender's time in microseconds
+    // - connection id: the binary UUID
+    static const unsigned short UdpDatagramProtocolHeaderFlagCompact = 0x0100;
+    static const unsigned long UdpDatagramVarintMaximumLength = 10; // 64-bit value, 7 bits per byte
+    static const unsigned long UdpDatagramCompactTimestampLength = 4; // 32-bit value (microseconds)
+    static const unsigned long UdpDatagramCompactDataHeaderMinimumLength = UdpDatagramProtocolHeaderFlagLength + 1 + UdpDatagramCompactTimestampLength;
+    static const unsigned long UdpDatagramCompactDataHeaderMaximumLength = UdpDatagramProtocolHeaderFlagLength + UdpDatagramVarintMaximumLength + UdpDatagramCompactTimestampLength;
+    static const unsigned long UdpDatagramCompactConnectionIdLength = 16; // binary UUID
+    static const unsigned long UdpDatagramCompactConnectionIdHeaderLength = UdpDatagramProtocolHeaderFlagLength + UdpDatagramCompactConnectionIdLength;
+    // the receiver extends compact timestamps back to 64-bit values in microseconds
+    static const long long UdpDatagramCompactTimestampFrequency = 1000000LL;
+    static const long long UdpDatagramFirstSequenceNumber = 1LL;
+
     static const unsigned long UdpDatagramMaximumSizeBytes = 64000UL;
 
     static const char* UdpDatagramStartString = "START";
     static const unsigned long UdpDatagramStartStringLength = 5;
+    static const char* UdpDatagramStartCompactString = "START:COMPACT";
+    static const unsigned long UdpDatagramStartCompactStringLength = 13;
 
     enum class MediaStreamAction : char
     {
-        START
+        START,
+        TIME_PROBE,
+        START_COMPACT
+    };
+
+    ///
+    /// ctsMediaStreamVarint encodes unsigned values 7 bits per byte, least significant bits first
+    /// - the high bit of each byte is set when more bytes follow
+    ///
+    struct ctsMediaStreamVarint
+    {
+        static unsigned long Length(unsigned long long _value) NOEXCEPT
+        {
+            unsigned long length = 1;
+            while (_value >= 0x80) {
+                _value >>= 7;
+                ++length;
+            }
+            return length;
+        }
+
+        static unsigned long Write(_Out_writes_to_(UdpDatagramVarintMaximumLength, return) char* _buffer, unsigned long long _value) NOEXCEPT
+        {
+            unsigned long length = 0;
+            while (_value >= 0x80) {
+                _buffer[length++] = static_cast<char>((_value & 0x7f) | 0x80);
+                _value >>= 7;
+            }
+            _buffer[length++] = static_cast<char>(_value);
+            return length;
+        }
+
+        // returns the number of bytes read: 0 if the value doesn't end within the first _length bytes
+        static unsigned long Read(_In_reads_bytes_(_length) const char* _buffer, unsigned long _length, _Out_ unsigned long long* _value) NOEXCEPT
+        {
+            *_value = 0ULL;
+            for (unsigned long offset = 0; offset < _length && offset < UdpDatagramVarintMaximumLength; ++offset) {
+                const unsigned char next_byte = static_cast<unsigned char>(_buffer[offset]);
+                *_value |= static_cast<unsigned long long>(next_byte & 0x7f) << (7 * offset);
+                if (0 == (next_byte & 0x80)) {
+                    return offset + 1;
+                }
+            }
+            return 0;
+        }
     };
 
     class ctsMediaStreamSendRequests
@@ -108,7 +179,7 @@ namespace ctsTraffic {
 
                 // refresh the QPC value at the last possible moment before returning the array to the user
                 _Analysis_assume_(this->qpc_address != nullptr);
-                ::QueryPerformanceCounter(this->qpc_address);
+                this->refresh_timestamp();
                 return &this->wsa_buf_array;
             }
 
@@ -120,10 +191,18 @@ namespace ctsTraffic {
 
                 // refresh the QPC value at the last possible moment before returning the array to the user
                 _Analysis_assume_(this->qpc_address != nullptr);
-                ::QueryPerformanceCounter(this->qpc_address);
+                this->refresh_timestamp();
                 return this->wsa_buf_array;
             }
 
+            ///
+            /// The number of WSABUFs in use in the array: compact datagrams only use the header and the payload
+            ///
+            DWORD buffer_count() const NOEXCEPT
+            {
+                return this->payload_index + 1;
+            }
+
             ///
             /// Equality operators
             ///
@@ -164,8 +243,11 @@ namespace ctsTraffic {
         private:
             // c'tor is only available to the begin() and end() methods of ctsMediaStreamSendRequests
             friend class ctsMediaStreamSendRequests;
-            iterator(_In_opt_ LARGE_INTEGER* _qpc_address, long long _bytes_to_send, const std::array<WSABUF, BufferArraySize>& _wsa_buf_array) NOEXCEPT
+            iterator(_In_opt_ LARGE_INTEGER* _qpc_address, _In_opt_ char* _timestamp_address, unsigned long _header_length, unsigned long _payload_index, long long _bytes_to_send, const std::array<WSABUF, BufferArraySize>& _wsa_buf_array) NOEXCEPT
             : qpc_address(_qpc_address),
+              timestamp_address(_timestamp_address),
+              header_length(_header_length),
+              payload_index(_payload_index),
               bytes_to_send(_bytes_to_send),
               wsa_buf_array(_wsa_buf_array)
             {
@@ -173,29 +255,40 @@ namespace ctsTraffic {
                 this->bytes_to_send -= this->update_buffer_length();
             }
 
+            void refresh_timestamp() NOEXCEPT
+            {
+                ::QueryPerformanceCounter(this->qpc_address);
+                if (this->timestamp_address) {
+                    // compact headers carry the low 32 bits of the time in microseconds
+                    const unsigned long timestamp = static_cast<unsigned long>(ctl::ctTimer::convert_qpc_usec(this->qpc_address->QuadPart, ctl::ctTimer::snap_qpf()));
+                    ::memcpy_s(this->timestamp_address, UdpDatagramCompactTimestampLength, &timestamp, UdpDatagramCompactTimestampLength);
+                }
+            }
+
             unsigned long update_buffer_length() NOEXCEPT
             {
                 ctsUnsignedLong total_bytes_to_send = 0UL;
                 // only update when not the end() iterator
                 if (this->qpc_address) {
+                    WSABUF& payload = this->wsa_buf_array[this->payload_index];
                     if (this->bytes_to_send > UdpDatagramMaximumSizeBytes) {
-                        this->wsa_buf_array[4].len = UdpDatagramMaximumSizeBytes - UdpDatagramDataHeaderLength;
+                        payload.len = UdpDatagramMaximumSizeBytes - this->header_length;
                     } else {
-                        this->wsa_buf_array[4].len = static_cast<unsigned long>(this->bytes_to_send - UdpDatagramDataHeaderLength);
+                        payload.len = static_cast<unsigned long>(this->bytes_to_send - this->header_length);
                     }
 
-                    total_bytes_to_send = this->wsa_buf_array[0].len + this->wsa_buf_array[1].len + this->wsa_buf_array[2].len + this->wsa_buf_array[3].len + this->wsa_buf_array[4].len;
+                    total_bytes_to_send = this->header_length + payload.len;
 
                     // must guarantee that after we send this datagram we have enough bytes for the next send if there are bytes left over
                     ctsSignedLongLong bytes_remaining = this->bytes_to_send - static_cast<long long>(total_bytes_to_send);
 
-                    if (bytes_remaining > 0 && bytes_remaining <= UdpDatagramDataHeaderLength) {
+                    if (bytes_remaining > 0 && bytes_remaining <= this->header_length) {
                         // subtract out enough bytes so the next datagram will be large enough for the header and at least one byte of data
-                        ctsUnsignedLong new_length = this->wsa_buf_array[4].len;
-                        ctsUnsignedLong delta_to_remove = UdpDatagramDataHeaderLength + 1 - static_cast<unsigned long>(bytes_remaining);
+                        ctsUnsignedLong new_length = payload.len;
+                        ctsUnsignedLong delta_to_remove = this->header_length + 1 - static_cast<unsigned long>(bytes_remaining);
                         new_length -= delta_to_remove;
 
-                        this->wsa_buf_array[4].len = new_length;
+                        payload.len = new_length;
                         total_bytes_to_send -= delta_to_remove;
                     }
 
@@ -206,6 +299,10 @@ namespace ctsTraffic {
             }
 
             LARGE_INTEGER* qpc_address;
+            // where the compact header's timestamp is written (nullptr for the original header)
+            char* timestamp_address;
+            unsigned long header_length;
+            unsigned long payload_index;
             ctsSignedLongLong bytes_to_send;
             std::array<WSABUF, BufferArraySize> wsa_buf_array;
         };
@@ -215,20 +312,46 @@ namespace ctsTraffic {
         /// Constructor of the ctsMediaStreamSendRequests captures the properties of the next Send() request
         /// - the total # of bytes to send (across X number of send requests)
         /// - the sequence number to tag in every send request
+        /// - the protocol header: data frames, or the parity datagrams following a group of frames
+        /// - the header layout: the original fixed-size fields, or the compact header negotiated with START_COMPACT
         ///
-        ctsMediaStreamSendRequests(long long _bytes_to_send, long long _sequence_number, _In_ char* _send_buffer) NOEXCEPT 
+        ctsMediaStreamSendRequests(long long _bytes_to_send, long long _sequence_number, _In_ char* _send_buffer, unsigned short _protocol_header = UdpDatagramProtocolHeaderFlagData, bool _compact_header = false) NOEXCEPT 
         : wsabuf(),
           qpc_value(),
           qpf(ctl::ctTimer::snap_qpf()),
           bytes_to_send(_bytes_to_send),
-          sequence_number(_sequence_number)
+          sequence_number(_sequence_number),
+          protocol_header(_protocol_header),
+          compact_header(),
+          timestamp_address(nullptr),
+          header_length(HeaderLength(_sequence_number, _compact_header)),
+          payload_index(4)
         {
             ctl::ctFatalCondition(
-                _bytes_to_send <= UdpDatagramDataHeaderLength,
+                _bytes_to_send <= this->header_length,
                 L"ctsMediaStreamSendRequests requires a buffer size to send larger than the ctsTraffic UDP header");
 
+            if (_compact_header) {
+                // buffer layout: one contiguous header (header#, varint seq. number delta, 32-bit timestamp), then the buffered data
+                const unsigned short compact_protocol_header = static_cast<unsigned short>(_protocol_header | UdpDatagramProtocolHeaderFlagCompact);
+                ::memcpy_s(this->compact_header, UdpDatagramProtocolHeaderFlagLength, &compact_protocol_header, UdpDatagramProtocolHeaderFlagLength);
+                const unsigned long varint_length = ctsMediaStreamVarint::Write(
+                    this->compact_header + UdpDatagramProtocolHeaderFlagLength,
+                    static_cast<unsigned long long>(_sequence_number - UdpDatagramFirstSequenceNumber));
+                // the timestamp is written by the iterator as each datagram is sent
+                this->timestamp_address = this->compact_header + UdpDatagramProtocolHeaderFlagLength + varint_length;
+
+                this->wsabuf[0].buf = this->compact_header;
+                this->wsabuf[0].len = this->header_length;
+
+                this->payload_index = 1;
+                this->wsabuf[1].buf = _send_buffer;
+                // the this->wsabuf[1].len field is dependent on bytes_to_send and can change by iterator()
+                return;
+            }
+
             // buffer layout: header#, seq. number, qpc, qpf, then the buffered data
-            this->wsabuf[0].buf = reinterpret_cast<char*>(const_cast<unsigned short*>(&UdpDatagramProtocolHeaderFlagData));
+            this->wsabuf[0].buf = reinterpret_cast<char*>(&this->protocol_header);
             this->wsabuf[0].len = UdpDatagramProtocolHeaderFlagLength;
 
             this->wsabuf[1].buf = reinterpret_cast<char*>(&this->sequence_number);
@@ -246,13 +369,27 @@ namespace ctsTraffic {
 
         iterator begin() NOEXCEPT
         {
-            return iterator(&this->qpc_value, this->bytes_to_send, this->wsabuf);
+            return iterator(&this->qpc_value, this->timestamp_address, this->header_length, this->payload_index, this->bytes_to_send, this->wsabuf);
         }
 
         iterator end() NOEXCEPT
         {
             // end == null qpc + 0 byte length
-            return iterator(nullptr, 0, this->wsabuf);
+            return iterator(nullptr, nullptr, this->header_length, this->payload_index, 0, this->wsabuf);
+        }
+
+        ///
+        /// The length of the header preceding the payload of each datagram
+        /// - compact headers grow with the varint encoding of the sequence number
+        ///
+        static unsigned long HeaderLength(long long _sequence_number, bool _compact_header) NOEXCEPT
+        {
+            if (!_compact_header) {
+                return UdpDatagramDataHeaderLength;
+            }
+            return UdpDatagramProtocolHeaderFlagLength +
+                   ctsMediaStreamVarint::Length(static_cast<unsigned long long>(_sequence_number - UdpDatagramFirstSequenceNumber)) +
+                   UdpDatagramCompactTimestampLength;
         }
 
 
@@ -262,16 +399,24 @@ namespace ctsTraffic {
         long long qpf;
         long long bytes_to_send;
         long long sequence_number;
+        unsigned short protocol_header;
+        char compact_header[UdpDatagramCompactDataHeaderMaximumLength];
+        char* timestamp_address;
+        unsigned long header_length;
+        unsigned long payload_index;
     };
 
 
     struct ctsMediaStreamMessage
     {
         long long sequence_number;
+        // the client's send time of a TIME_PROBE
+        long long originate_time;
         MediaStreamAction action;
 
-        explicit ctsMediaStreamMessage(MediaStreamAction _action) NOEXCEPT
+        explicit ctsMediaStreamMessage(MediaStreamAction _action, long long _originate_time = 0LL) NOEXCEPT
         : sequence_number(0LL),
+          originate_time(_originate_time),
           action(_action)
         {
         }
@@ -298,6 +443,16 @@ namespace ctsTraffic {
                     }
                     break;
 
+                case UdpDatagramProtocolHeaderFlagParity:
+                    if (_completed_bytes < UdpDatagramDataHeaderLength) {
+                        ctsConfig::PrintErrorInfo(
+                            L"ValidateBufferLengthFromTask rejecting the datagram type UdpDatagramProtocolHeaderFlagParity: the datagram size (%u) is less than UdpDatagramDataHeaderLength (%u)",
+                            _completed_bytes,
+                            UdpDatagramDataHeaderLength);
+                        return false;
+                    }
+                    break;
+
                 case UdpDatagramProtocolHeaderFlagId:
                     if (_completed_bytes < UdpDatagramConnectionIdHeaderLength) {
                         ctsConfig::PrintErrorInfo(
@@ -308,12 +463,45 @@ namespace ctsTraffic {
                     }
                     break;
 
+                case UdpDatagramProtocolHeaderFlagData | UdpDatagramProtocolHeaderFlagCompact:
+                case UdpDatagramProtocolHeaderFlagParity | UdpDatagramProtocolHeaderFlagCompact:
+                    if (0 == GetDataHeaderLengthFromTask(_task, _completed_bytes)) {
+                        ctsConfig::PrintErrorInfo(
+                            L"ValidateBufferLengthFromTask rejecting the compact datagram type (%u): the datagram size (%u) is less than its header",
+                            GetProtocolHeaderFromTask(_task),
+                            _completed_bytes);
+                        return false;
+                    }
+                    break;
+
+                case UdpDatagramProtocolHeaderFlagId | UdpDatagramProtocolHeaderFlagCompact:
+                    if (_completed_bytes < UdpDatagramCompactConnectionIdHeaderLength) {
+                        ctsConfig::PrintErrorInfo(
+                            L"ValidateBufferLengthFromTask rejecting the compact datagram type UdpDatagramProtocolHeaderFlagId: the datagram size (%u) is less than UdpDatagramCompactConnectionIdHeaderLength (%u)",
+                            _completed_bytes,
+                            UdpDatagramCompactConnectionIdHeaderLength);
+                        return false;
+                    }
+                    break;
+
+                case UdpDatagramProtocolHeaderFlagTimeProbe:
+                    if (_completed_bytes < UdpDatagramTimeReplyLength) {
+                        ctsConfig::PrintErrorInfo(
+                            L"ValidateBufferLengthFromTask rejecting the datagram type UdpDatagramProtocolHeaderFlagTimeProbe: the datagram size (%u) is less than UdpDatagramTimeReplyLength (%u)",
+                            _completed_bytes,
+                            UdpDatagramTimeReplyLength);
+                        return false;
+                    }
+                    break;
+
                 default:
                     ctsConfig::PrintErrorInfo(
-                        L"ValidateBufferLengthFromTask rejecting the datagram of unknown frame type (%u) - expecting UdpDatagramProtocolHeaderFlagData (%u) or UdpDatagramProtocolHeaderFlagId (%u)",
+                        L"ValidateBufferLengthFromTask rejecting the datagram of unknown frame type (%u) - expecting UdpDatagramProtocolHeaderFlagData (%u), UdpDatagramProtocolHeaderFlagId (%u), UdpDatagramProtocolHeaderFlagParity (%u) or UdpDatagramProtocolHeaderFlagTimeProbe (%u)",
                         GetProtocolHeaderFromTask(_task),
                         UdpDatagramProtocolHeaderFlagData,
-                        UdpDatagramProtocolHeaderFlagId);
+                        UdpDatagramProtocolHeaderFlagId,
+                        UdpDatagramProtocolHeaderFlagParity,
+                        UdpDatagramProtocolHeaderFlagTimeProbe);
                     return false;
             }
 
@@ -322,11 +510,56 @@ namespace ctsTraffic {
 
         static unsigned short GetProtocolHeaderFromTask(_In_ const ctsIOTask& _task) NOEXCEPT
         {
-            return *reinterpret_cast<unsigned short*>(_task.buffer);
+            return *reinterpret_cast<unsigned short*>(_task.buffer + _task.buffer_offset);
+        }
+
+        static bool IsCompactHeaderFromTask(_In_ const ctsIOTask& _task) NOEXCEPT
+        {
+            return (GetProtocolHeaderFromTask(_task) & UdpDatagramProtocolHeaderFlagCompact) != 0;
+        }
+
+        ///
+        /// The length of the header of a data or parity datagram: the payload follows it
+        /// - returns 0 if the header doesn't fit within the _completed_bytes received
+        ///
+        static unsigned long GetDataHeaderLengthFromTask(_In_ const ctsIOTask& _task, unsigned long _completed_bytes) NOEXCEPT
+        {
+            if (!IsCompactHeaderFromTask(_task)) {
+                return (_completed_bytes < UdpDatagramDataHeaderLength) ? 0 : UdpDatagramDataHeaderLength;
+            }
+            if (_completed_bytes < UdpDatagramCompactDataHeaderMinimumLength) {
+                return 0;
+            }
+
+            unsigned long long sequence_delta;
+            const unsigned long varint_length = ctsMediaStreamVarint::Read(
+                _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength,
+                _completed_bytes - UdpDatagramProtocolHeaderFlagLength,
+                &sequence_delta);
+            const unsigned long header_length = UdpDatagramProtocolHeaderFlagLength + varint_length + UdpDatagramCompactTimestampLength;
+            if (0 == varint_length || header_length > _completed_bytes) {
+                return 0;
+            }
+            return header_length;
         }
 
         static void SetConnectionIdFromTask(_Inout_updates_(ctsStatistics::ConnectionIdLength) char* _connection_id, _In_ const ctsIOTask& _task) NOEXCEPT
         {
+            if (IsCompactHeaderFromTask(_task)) {
+                // convert the binary UUID back to the string form every connection ID is tracked by
+                UUID connection_uuid;
+                ::memcpy_s(&connection_uuid, sizeof(connection_uuid), _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength, UdpDatagramCompactConnectionIdLength);
+                RPC_CSTR connection_id_string = nullptr;
+                const RPC_STATUS status = ::UuidToStringA(&connection_uuid, &connection_id_string);
+                if (status != RPC_S_OK) {
+                    ctsConfig::PrintErrorInfo(L"ctsMediaStreamMessage::SetConnectionIdFromTask : UuidToStringA failed (%d)", status);
+                    return;
+                }
+                ::strncpy_s(_connection_id, ctsStatistics::ConnectionIdLength, reinterpret_cast<LPSTR>(connection_id_string), _TRUNCATE);
+                ::RpcStringFreeA(&connection_id_string);
+                return;
+            }
+
             auto copy_error = ::memcpy_s(
                 _connection_id,
                 ctsStatistics::ConnectionIdLength,
@@ -342,6 +575,16 @@ namespace ctsTraffic {
 
         static long long GetSequenceNumberFromTask(_In_ const ctsIOTask& _task) NOEXCEPT
         {
+            if (IsCompactHeaderFromTask(_task)) {
+                // the header was checked by ValidateBufferLengthFromTask
+                unsigned long long sequence_delta;
+                (void) ctsMediaStreamVarint::Read(
+                    _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength,
+                    UdpDatagramVarintMaximumLength,
+                    &sequence_delta);
+                return static_cast<long long>(sequence_delta) + UdpDatagramFirstSequenceNumber;
+            }
+
             long long return_value;
             auto copy_error = ::memcpy_s(
                 &return_value,
@@ -360,10 +603,14 @@ namespace ctsTraffic {
         static long long GetQueryPerfCounterFromTask(_In_ const ctsIOTask& _task) NOEXCEPT
         {
             long long return_value;
-            auto copy_error = ::memcpy_s(&return_value, UdpDatagramSequenceNumberLength, _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength, UdpDatagramSequenceNumberLength);
+            auto copy_error = ::memcpy_s(
+                &return_value,
+                UdpDatagramQPCLength,
+                _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength + UdpDatagramSequenceNumberLength,
+                UdpDatagramQPCLength);
             ctl::ctFatalCondition(
                 copy_error != 0,
-                L"ctsMediaStreamMessage::GetSequenceNumberFromTask : memcpy_s failed trying to copy the sequence number - ctsIOTask (%p) (error : %d)",
+                L"ctsMediaStreamMessage::GetQueryPerfCounterFromTask : memcpy_s failed trying to copy the QPC value - ctsIOTask (%p) (error : %d)",
                 &_task,
                 copy_error);
 
@@ -373,10 +620,14 @@ namespace ctsTraffic {
         static long long GetQueryPerfFrequencyFromTask(_In_ const ctsIOTask& _task) NOEXCEPT
         {
             long long return_value;
-            auto copy_error = ::memcpy_s(&return_value, UdpDatagramSequenceNumberLength, _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength, UdpDatagramSequenceNumberLength);
+            auto copy_error = ::memcpy_s(
+                &return_value,
+                UdpDatagramQPFLength,
+                _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength + UdpDatagramSequenceNumberLength + UdpDatagramQPCLength,
+                UdpDatagramQPFLength);
             ctl::ctFatalCondition(
                 copy_error != 0,
-                L"ctsMediaStreamMessage::GetSequenceNumberFromTask : memcpy_s failed trying to copy the sequence number - target buffer (%p) ctsIOTask (%p) (error : %d)",
+                L"ctsMediaStreamMessage::GetQueryPerfFrequencyFromTask : memcpy_s failed trying to copy the QPF value - target buffer (%p) ctsIOTask (%p) (error : %d)",
                 &return_value,
                 &_task,
                 copy_error);
@@ -384,6 +635,57 @@ namespace ctsTraffic {
             return return_value;
         }
 
+        ///
+        /// The low 32 bits of the sender's time (microseconds) from a compact data or parity header
+        ///
+        static unsigned long GetCompactTimestampFromTask(_In_ const ctsIOTask& _task) NOEXCEPT
+        {
+            // the header was checked by ValidateBufferLengthFromTask
+            const char* varint = _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength;
+            unsigned long long sequence_delta;
+            const unsigned long varint_length = ctsMediaStreamVarint::Read(varint, UdpDatagramVarintMaximumLength, &sequence_delta);
+
+            unsigned long return_value;
+            ::memcpy_s(&return_value, sizeof(return_value), varint + varint_length, UdpDatagramCompactTimestampLength);
+            return return_value;
+        }
+
+        ///
+        /// Compact timestamps only carry the low 32 bits (~71 minutes of microseconds)
+        /// - returns the full value nearest to _reference with those low 32 bits
+        ///
+        static long long ExtendCompactTimestamp(unsigned long _timestamp, long long _reference) NOEXCEPT
+        {
+            const long long delta = static_cast<int>(_timestamp - static_cast<unsigned long>(_reference));
+            return _reference + delta;
+        }
+
+        ///
+        /// The timestamps of a TIME_PROBE reply: the client's send time, then the server's receive and send times
+        ///
+        static void GetTimeReplyFromTask(_In_ const ctsIOTask& _task, _Out_ long long* _originate_time, _Out_ long long* _receive_time, _Out_ long long* _transmit_time) NOEXCEPT
+        {
+            const char* timestamps = _task.buffer + _task.buffer_offset + UdpDatagramProtocolHeaderFlagLength;
+            ::memcpy_s(_originate_time, UdpDatagramTimestampLength, timestamps, UdpDatagramTimestampLength);
+            ::memcpy_s(_receive_time, UdpDatagramTimestampLength, timestamps + UdpDatagramTimestampLength, UdpDatagramTimestampLength);
+            ::memcpy_s(_transmit_time, UdpDatagramTimestampLength, timestamps + 2 * UdpDatagramTimestampLength, UdpDatagramTimestampLength);
+        }
+
+        static void MakeTimeProbe(_Out_writes_(UdpDatagramTimeProbeLength) char* _buffer, long long _originate_time) NOEXCEPT
+        {
+            ::memcpy_s(_buffer, UdpDatagramProtocolHeaderFlagLength, &UdpDatagramProtocolHeaderFlagTimeProbe, UdpDatagramProtocolHeaderFlagLength);
+            ::memcpy_s(_buffer + UdpDatagramProtocolHeaderFlagLength, UdpDatagramTimestampLength, &_originate_time, UdpDatagramTimestampLength);
+        }
+
+        static void MakeTimeReply(_Out_writes_(UdpDatagramTimeReplyLength) char* _buffer, long long _originate_time, long long _receive_time, long long _transmit_time) NOEXCEPT
+        {
+            char* timestamps = _buffer + UdpDatagramProtocolHeaderFlagLength;
+            ::memcpy_s(_buffer, UdpDatagramProtocolHeaderFlagLength, &UdpDatagramProtocolHeaderFlagTimeProbe, UdpDatagramProtocolHeaderFlagLength);
+            ::memcpy_s(timestamps, UdpDatagramTimestampLength, &_originate_time, UdpDatagramTimestampLength);
+            ::memcpy_s(timestamps + UdpDatagramTimestampLength, UdpDatagramTimestampLength, &_receive_time, UdpDatagramTimestampLength);
+            ::memcpy_s(timestamps + 2 * UdpDatagramTimestampLength, UdpDatagramTimestampLength, &_transmit_time, UdpDatagramTimestampLength);
+        }
+
         static ctsIOTask MakeConnectionIdTask(_In_ const ctsIOTask& _raw_task, _In_reads_(ctsStatistics::ConnectionIdLength) char* _connection_id) NOEXCEPT
         {
             ctl::ctFatalCondition(
@@ -394,8 +696,9 @@ namespace ctsTraffic {
 
             ctsIOTask return_task(_raw_task);
             // populate the buffer with the connection Id and protocol field
-            ::memcpy_s(return_task.buffer, UdpDatagramProtocolHeaderFlagLength, &UdpDatagramProtocolHeaderFlagId, UdpDatagramProtocolHeaderFlagLength);
-            ::memcpy_s(return_task.buffer + UdpDatagramProtocolHeaderFlagLength, ctsStatistics::ConnectionIdLength, _connection_id, ctsStatistics::ConnectionIdLength);
+            char* id_buffer = return_task.buffer + return_task.buffer_offset;
+            ::memcpy_s(id_buffer, UdpDatagramProtocolHeaderFlagLength, &UdpDatagramProtocolHeaderFlagId, UdpDatagramProtocolHeaderFlagLength);
+            ::memcpy_s(id_buffer + UdpDatagramProtocolHeaderFlagLength, ctsStatistics::ConnectionIdLength, _connection_id, ctsStatistics::ConnectionIdLength);
 
             return_task.ioAction = IOTaskAction::Send;
             return_task.buffer_type = ctsIOTask::BufferType::UdpConnectionId;
@@ -403,6 +706,22 @@ namespace ctsTraffic {
             return return_task;
         }
 
+        ///
+        /// The compact form of the connection ID datagram: the binary UUID parsed from the connection ID string
+        ///
+        static bool MakeCompactConnectionId(_Out_writes_(UdpDatagramCompactConnectionIdHeaderLength) char* _buffer, _In_reads_(ctsStatistics::ConnectionIdLength) const char* _connection_id) NOEXCEPT
+        {
+            UUID connection_uuid;
+            if (::UuidFromStringA(reinterpret_cast<RPC_CSTR>(const_cast<char*>(_connection_id)), &connection_uuid) != RPC_S_OK) {
+                return false;
+            }
+
+            const unsigned short protocol_header = UdpDatagramProtocolHeaderFlagId | UdpDatagramProtocolHeaderFlagCompact;
+            ::memcpy_s(_buffer, UdpDatagramProtocolHeaderFlagLength, &protocol_header, UdpDatagramProtocolHeaderFlagLength);
+            ::memcpy_s(_buffer + UdpDatagramProtocolHeaderFlagLength, UdpDatagramCompactConnectionIdLength, &connection_uuid, UdpDatagramCompactConnectionIdLength);
+            return true;
+        }
+
         static ctsIOTask Construct(MediaStreamAction _action) NOEXCEPT
         {
             ctsIOTask return_task;
@@ -417,6 +736,11 @@ namespace ctsTraffic {
                     return_task.buffer_length = UdpDatagramStartStringLength;
                     break;
 
+                case MediaStreamAction::START_COMPACT:
+                    return_task.buffer = const_cast<char*>(UdpDatagramStartCompactString);
+                    return_task.buffer_length = UdpDatagramStartCompactStringLength;
+                    break;
+
                 default:
                     ctl::ctAlwaysFatalCondition(L"Invalid Action specified : %d", _action);
             }
@@ -426,11 +750,22 @@ namespace ctsTraffic {
 
         static ctsMediaStreamMessage Extract(_In_reads_bytes_(_input_length) const char* _input, _In_ unsigned _input_length)
         {
+            // the only binary message: checked before building a string
+            if (UdpDatagramTimeProbeLength == _input_length &&
+                0 == ::memcmp(_input, &UdpDatagramProtocolHeaderFlagTimeProbe, UdpDatagramProtocolHeaderFlagLength)) {
+                long long originate_time;
+                ::memcpy_s(&originate_time, UdpDatagramTimestampLength, _input + UdpDatagramProtocolHeaderFlagLength, UdpDatagramTimestampLength);
+                return ctsMediaStreamMessage(MediaStreamAction::TIME_PROBE, originate_time);
+            }
+
             std::string buffer(_input, _input + _input_length);
 
             if (ctl::ctString::iordinal_equals(UdpDatagramStartString, buffer)) {
                 return ctsMediaStreamMessage(MediaStreamAction::START);
             }
+            if (ctl::ctString::iordinal_equals(UdpDatagramStartCompactString, buffer)) {
+                return ctsMediaStreamMessage(MediaStreamAction::START_COMPACT);
+            }
 
             throw ctl::ctException(
                 ERROR_INVALID_DATA,
@@ -15,6 +15,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <memory>
 #include <vector>
 #include <algorithm>
+#include <iterator>
 // os headers
 #include <Windows.h>
 #include <WinSock2.h>
@@ -24,6 +25,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <ctScopeGuard.hpp>
 #include <ctHandle.hpp>
 #include <ctSockaddr.hpp>
+#include <ctTimer.hpp>
 // project headers
 #include "ctsConfig.h"
 #include "ctsSocket.h"
@@ -33,6 +35,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsMediaStreamServerConnectedSocket.h"
 #include "ctsMediaStreamServerListeningSocket.h"
 #include "ctsMediaStreamProtocol.hpp"
+#include "ctsSockaddrHashTable.hpp"
 
 
 namespace ctsTraffic {
@@ -111,7 +114,7 @@ namespace ctsTraffic {
 
             auto shared_socket(_weak_socket.lock());
             if (shared_socket) {
-                ctsMediaStreamServerImpl::remove_socket(shared_socket->local_address());
+                ctsMediaStreamServerImpl::remove_socket(shared_socket->target_address());
             }
         }
         catch (const std::exception&) {
@@ -124,10 +127,11 @@ namespace ctsTraffic {
         
         // function for doing the actual IO for a UDP media stream datagram connection
         wsIOResult ConnectedSocketIo(_In_ ctsMediaStreamServerConnectedSocket* this_ptr);
+        // sends the parity datagrams after the last frame of each group (-FecFrames)
+        int SendParityDatagrams(_In_ ctsMediaStreamServerConnectedSocket* this_ptr, SOCKET _socket, long long _seq_number, const ctsIOTask& _task) NOEXCEPT;
 
-        CRITICAL_SECTION connected_object_guard;
-        _Guarded_by_(connected_object_guard)
-            std::vector<std::shared_ptr<ctsMediaStreamServerConnectedSocket>> connected_sockets;
+        // keyed by the remote address: looked up for every frame scheduled by every stream
+        ctsSockaddrHashTable<ctsMediaStreamServerConnectedSocket> connected_sockets;
 
         CRITICAL_SECTION awaiting_object_guard;
         // weak_ptr<> to ctsSocket objects ready to accept a connection
@@ -135,8 +139,16 @@ namespace ctsTraffic {
             std::vector<std::weak_ptr<ctsSocket>> accepting_sockets;
 
         // endpoints that have been received from clients not yet matched to ctsSockets
+        struct AwaitingEndpoint {
+            SOCKET socket;
+            ctl::ctSockaddr remote_addr;
+            // scanned on every new START: compared instead of the full remote_addr
+            ctl::ctSockaddrKey remote_key;
+            // the client sent START_COMPACT
+            bool compact_header;
+        };
         _Guarded_by_(awaiting_object_guard)
-            std::vector<std::pair<SOCKET, ctl::ctSockaddr>> awaiting_endpoints;
+            std::vector<AwaitingEndpoint> awaiting_endpoints;
 
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -148,13 +160,6 @@ namespace ctsTraffic {
         static BOOL CALLBACK InitOnceImpl(PINIT_ONCE, PVOID, PVOID *)
         {
             try {
-                if (!::InitializeCriticalSectionEx(&ctsMediaStreamServerImpl::connected_object_guard, 4000, 0)) {
-                    throw ctl::ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsMediaStreamServer", false);
-                }
-                ctlScopeGuard(
-                    deleteConnectedObjectguardOnError,
-                    {::DeleteCriticalSection(&ctsMediaStreamServerImpl::connected_object_guard);});
-
                 if (!::InitializeCriticalSectionEx(&ctsMediaStreamServerImpl::awaiting_object_guard, 4000, 0)) {
                     throw ctl::ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsMediaStreamServer", false);
                 }
@@ -196,7 +201,6 @@ namespace ctsTraffic {
                 }
 
                 // dismiss scope guards as there were no errors
-                deleteConnectedObjectguardOnError.dismiss();
                 deleteAwaitingObjectguardOnError.dismiss();
             }
             catch (const std::exception& e) {
@@ -225,32 +229,17 @@ namespace ctsTraffic {
                 throw ctl::ctException(WSAECONNABORTED, L"ctsSocket already freed", L"ctsMediaStreamServer", false);
             }
 
-            std::shared_ptr<ctsMediaStreamServerConnectedSocket> shared_connected_socket;
-            {
-                // must guard connected_sockets since we need to add it
-                ctl::ctAutoReleaseCriticalSection lock_connected_object(&ctsMediaStreamServerImpl::connected_object_guard);
-
-                // find the matching connected_socket
-                auto found_socket = std::find_if(
-                    std::begin(ctsMediaStreamServerImpl::connected_sockets),
-                    std::end(ctsMediaStreamServerImpl::connected_sockets),
-                    [&shared_socket] (const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& _connected_socket) {
-                        return (shared_socket->target_address() == _connected_socket->get_address());
-                    }
-                );
-
-                if (found_socket == std::end(ctsMediaStreamServerImpl::connected_sockets)) {
-                    PrintDebugInfo(
-                        L"\t\tctsMediaStreamServer - failed to find the socket with remote address %ws in our connected socket list\n",
-                        shared_socket->target_address().writeCompleteAddress().c_str());
-                    throw ctl::ctException(ERROR_INVALID_DATA, L"ctsSocket was not found in the Connected Sockets", L"ctsMediaStreamServer", false);
-                }
-
-                shared_connected_socket = *found_socket;
+            // find the matching connected_socket
+            auto shared_connected_socket(ctsMediaStreamServerImpl::connected_sockets.find(shared_socket->target_address()));
+            if (!shared_connected_socket) {
+                PrintDebugInfo(
+                    L"\t\tctsMediaStreamServer - failed to find the socket with remote address %ws in our connected socket list\n",
+                    shared_socket->target_address().writeCompleteAddress().c_str());
+                throw ctl::ctException(ERROR_INVALID_DATA, L"ctsSocket was not found in the Connected Sockets", L"ctsMediaStreamServer", false);
             }
-            // must call into connected socket without holding a lock
-            // and without maintaining an iterator into the list
-            // since the call to schedule_io could end up asking to remove this object from the list
+
+            // find() returned a reference without holding any lock:
+            // the call to schedule_io could end up asking to remove this object from the table
             shared_connected_socket->schedule_task(_task);
         }
 
@@ -274,34 +263,33 @@ namespace ctsTraffic {
                 } else {
                     auto waiting_endpoint = ctsMediaStreamServerImpl::awaiting_endpoints.rbegin();
 
-                    // must guard connected_sockets since we need to add it to the vector
-                    // - scope to the lock
-                    {
-                        ctl::ctAutoReleaseCriticalSection lock_connected_object(&ctsMediaStreamServerImpl::connected_object_guard);
-                        ctsMediaStreamServerImpl::connected_sockets.emplace_back(
-                            std::make_shared<ctsMediaStreamServerConnectedSocket>(
-                            _weak_socket, 
-                            waiting_endpoint->first, 
-                            waiting_endpoint->second,
-                            ctsMediaStreamServerImpl::ConnectedSocketIo));
-                    }
-
-                    // now complete the ctsSocket 'Create' request
-                    // find the local address
+                    // find the listening socket the START was received on
                     auto found_socket = std::find_if(
                         ctsMediaStreamServerImpl::listening_sockets.begin(),
                         ctsMediaStreamServerImpl::listening_sockets.end(),
                         [&waiting_endpoint] (const std::unique_ptr<ctsMediaStreamServerListeningSocket>& _listener) {
-                        return (_listener->get_socket() == waiting_endpoint->first);
+                        return (_listener->get_socket() == waiting_endpoint->socket);
                     });
 
                     ctl::ctFatalCondition(
                         (found_socket == ctsMediaStreamServerImpl::listening_sockets.end()),
                         L"Could not find the socket (%Iu) in the waiting_endpoint from our listening sockets (%p)\n",
-                        waiting_endpoint->first, &ctsMediaStreamServerImpl::listening_sockets);
+                        waiting_endpoint->socket, &ctsMediaStreamServerImpl::listening_sockets);
+
+                    // a repeated START can queue the same endpoint twice: the first connected socket is kept
+                    ctsMediaStreamServerImpl::connected_sockets.insert(
+                        waiting_endpoint->remote_addr,
+                        std::make_shared<ctsMediaStreamServerConnectedSocket>(
+                        _weak_socket, 
+                        waiting_endpoint->socket, 
+                        waiting_endpoint->remote_addr,
+                        ctsMediaStreamServerImpl::ConnectedSocketIo,
+                        (*found_socket)->get_scheduler(),
+                        waiting_endpoint->compact_header));
 
+                    // now complete the ctsSocket 'Create' request
                     shared_socket->set_local_address((*found_socket)->get_address());
-                    shared_socket->set_target_address(waiting_endpoint->second);
+                    shared_socket->set_target_address(waiting_endpoint->remote_addr);
                     shared_socket->complete_state(NO_ERROR);
 
                     // if added to connected_sockets, can then safely remove it from the waiting endpoint
@@ -319,18 +307,9 @@ namespace ctsTraffic {
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////
         void ctsMediaStreamServerImpl::remove_socket(const ctl::ctSockaddr& _target_addr)
         {
-            ctl::ctAutoReleaseCriticalSection lock_connected_object(&ctsMediaStreamServerImpl::connected_object_guard);
-
-            auto found_socket = std::find_if(
-                std::begin(ctsMediaStreamServerImpl::connected_sockets),
-                std::end(ctsMediaStreamServerImpl::connected_sockets),
-                [&_target_addr] (const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& _connected_socket) {
-                return _target_addr == _connected_socket->get_address();
-            });
-
-            if (found_socket != std::end(ctsMediaStreamServerImpl::connected_sockets)) {
-                ctsMediaStreamServerImpl::connected_sockets.erase(found_socket);
-            }
+            // the removed socket is released here, outside the table's lock:
+            // its d'tor waits for its timer callbacks to complete
+            auto removed_socket(ctsMediaStreamServerImpl::connected_sockets.remove(_target_addr));
         }
 
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -340,33 +319,40 @@ namespace ctsTraffic {
         /// - else we'll queue it to awaiting_endpoints
         ///
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        void ctsMediaStreamServerImpl::start(const ctl::ctScopedSocket& _socket, const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _target_addr)
+        void ctsMediaStreamServerImpl::start(const ctl::ctScopedSocket& _socket, const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _target_addr, bool _compact_header)
         {
             // before starting a socket, verify there is not already a connected socket with this same socket address
-            // scope the lock
-            {
-                ctl::ctAutoReleaseCriticalSection lock_connected_object(&ctsMediaStreamServerImpl::connected_object_guard);
-
-                auto found_socket = std::find_if(
-                    std::begin(ctsMediaStreamServerImpl::connected_sockets),
-                    std::end(ctsMediaStreamServerImpl::connected_sockets),
-                    [&_target_addr] (const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& _connected_socket) {
-                    return _target_addr == _connected_socket->get_address();
-                });
-
-                if (found_socket != std::end(ctsMediaStreamServerImpl::connected_sockets)) {
-                    PrintDebugInfo(
-                        L"\t\tctsMediaStreamServer - socket with remote address %ws asked to be Started but was already established\n",
-                        _target_addr.writeCompleteAddress().c_str());
-                    // return early if this was a duplicate request: this can happen if there is latency or drops
-                    // between the client and server as they attempt to negotiating starting a new stream
-                    return;
-                }
+            if (ctsMediaStreamServerImpl::connected_sockets.find(_target_addr)) {
+                PrintDebugInfo(
+                    L"\t\tctsMediaStreamServer - socket with remote address %ws asked to be Started but was already established\n",
+                    _target_addr.writeCompleteAddress().c_str());
+                // return early if this was a duplicate request: this can happen if there is latency or drops
+                // between the client and server as they attempt to negotiating starting a new stream
+                return;
             }
 
+            // streams are paced by the scheduler of the listening socket they send from
+            auto found_listener = std::find_if(
+                ctsMediaStreamServerImpl::listening_sockets.begin(),
+                ctsMediaStreamServerImpl::listening_sockets.end(),
+                [&_socket] (const std::unique_ptr<ctsMediaStreamServerListeningSocket>& _listener) {
+                return (_listener->get_socket() == _socket.get());
+            });
+            ctl::ctFatalCondition(
+                (found_listener == ctsMediaStreamServerImpl::listening_sockets.end()),
+                L"Could not find the socket (%Iu) from our listening sockets (%p)\n",
+                _socket.get(), &ctsMediaStreamServerImpl::listening_sockets);
+            ctsMediaStreamServerScheduler* scheduler = (*found_listener)->get_scheduler();
+
             // find a ctsSocket waiting to 'accept' a connection and complete it
             ctl::ctAutoReleaseCriticalSection lock_awaiting_object(&ctsMediaStreamServerImpl::awaiting_object_guard);
 
+            // STARTs are processed concurrently across the listener's outstanding recvs:
+            // connected sockets are only added under this lock, so check again now that it's held
+            if (ctsMediaStreamServerImpl::connected_sockets.find(_target_addr)) {
+                return;
+            }
+
             // walk through the list to find a socket that is still alive to take this connection
             bool added_connection = false;
             while (!ctsMediaStreamServerImpl::accepting_sockets.empty()) {
@@ -374,16 +360,15 @@ namespace ctsTraffic {
                 auto shared_instance = weak_instance.lock();
                 if (shared_instance) {
                     // 'move' the accepting socket to connected
-                    // - scope the lock
-                    {
-                        ctl::ctAutoReleaseCriticalSection lock_connected_object(&ctsMediaStreamServerImpl::connected_object_guard);
-                        ctsMediaStreamServerImpl::connected_sockets.emplace_back(
-                            std::make_shared<ctsMediaStreamServerConnectedSocket>(
-                            weak_instance,
-                            _socket.get(),
-                            _target_addr,
-                            ctsMediaStreamServerImpl::ConnectedSocketIo));
-                    }
+                    ctsMediaStreamServerImpl::connected_sockets.insert(
+                        _target_addr,
+                        std::make_shared<ctsMediaStreamServerConnectedSocket>(
+                        weak_instance,
+                        _socket.get(),
+                        _target_addr,
+                        ctsMediaStreamServerImpl::ConnectedSocketIo,
+                        scheduler,
+                        _compact_header));
 
                     // verify is successfully added to connected_sockets before popping off accepting_sockets
                     added_connection = true;
@@ -397,12 +382,24 @@ namespace ctsTraffic {
                     ctsConfig::PrintNewConnection(_local_addr, _target_addr);
                     break;
                 }
+
+                // this ctsSocket has already gone away
+                ctsMediaStreamServerImpl::accepting_sockets.pop_back();
             }
 
             // if we didn't find a waiting connection to accept it, queue it for when one arrives later
             if (!added_connection) {
                 // only queue it if we aren't already waiting on this address
-                ctsMediaStreamServerImpl::awaiting_endpoints.emplace_back(_socket.get(), _target_addr);
+                const ctl::ctSockaddrKey target_key(_target_addr);
+                auto found_endpoint = std::find_if(
+                    ctsMediaStreamServerImpl::awaiting_endpoints.begin(),
+                    ctsMediaStreamServerImpl::awaiting_endpoints.end(),
+                    [&target_key] (const AwaitingEndpoint& _endpoint) {
+                    return (_endpoint.remote_key == target_key);
+                });
+                if (found_endpoint == ctsMediaStreamServerImpl::awaiting_endpoints.end()) {
+                    ctsMediaStreamServerImpl::awaiting_endpoints.push_back(AwaitingEndpoint{ _socket.get(), _target_addr, target_key, _compact_header });
+                }
             }
         }
 
@@ -422,9 +419,19 @@ namespace ctsTraffic {
             if (ctsIOTask::BufferType::UdpConnectionId == next_task.buffer_type) {
                 // making a synchronous call
                 WSABUF wsabuf;
-                wsabuf.buf = next_task.buffer;
+                wsabuf.buf = next_task.buffer + next_task.buffer_offset;
                 wsabuf.len = next_task.buffer_length;
 
+                char compact_connection_id[UdpDatagramCompactConnectionIdHeaderLength];
+                if (this_ptr->uses_compact_header()) {
+                    // the task holds the protocol header followed by the connection ID string
+                    if (!ctsMediaStreamMessage::MakeCompactConnectionId(compact_connection_id, wsabuf.buf + UdpDatagramProtocolHeaderFlagLength)) {
+                        return wsIOResult(ERROR_INVALID_DATA);
+                    }
+                    wsabuf.buf = compact_connection_id;
+                    wsabuf.len = UdpDatagramCompactConnectionIdHeaderLength;
+                }
+
                 auto send_result = ::WSASendTo(
                     socket,
                     &wsabuf,
@@ -452,25 +459,62 @@ namespace ctsTraffic {
                 }
 
             } else {
-                auto seq_number = this_ptr->increment_sequence();
+                // with -DatagramPacing:spread a frame is sent across several calls, one per batch of due datagrams
+                ctsMediaStreamServerConnectedSocket::FramePacing& frame_pacing = this_ptr->get_frame_pacing();
+                if (0UL == frame_pacing.datagrams_sent) {
+                    frame_pacing.sequence_number = this_ptr->increment_sequence();
+                    frame_pacing.start_time = ctl::ctTimer::snap_qpc_as_usec();
+                    frame_pacing.bytes_sent = 0UL;
 
-                PrintDebugInfo(
-                    L"\t\tctsMediaStreamServer sending seq number %lld (%lu bytes)\n",
-                    seq_number,
-                    next_task.buffer_length);
+                    PrintDebugInfo(
+                        L"\t\tctsMediaStreamServer sending seq number %lld (%lu bytes)\n",
+                        frame_pacing.sequence_number,
+                        next_task.buffer_length);
+                }
+                const long long seq_number = frame_pacing.sequence_number;
 
                 ctsMediaStreamSendRequests sending_requests(
                     next_task.buffer_length, // total bytes to send
                     seq_number,
-                    next_task.buffer);
+                    next_task.buffer,
+                    UdpDatagramProtocolHeaderFlagData,
+                    this_ptr->uses_compact_header());
+
+                // the datagrams of a paced frame are spread evenly across the frame interval
+                long long datagram_interval = 0LL;
+                if (this_ptr->paces_datagrams()) {
+                    const long long datagram_count = static_cast<long long>(std::distance(sending_requests.begin(), sending_requests.end()));
+                    datagram_interval = 1000000LL / (static_cast<long long>(ctsConfig::GetMediaStream().FramesPerSecond) * datagram_count);
+                }
+
+                unsigned long datagram_index = 0UL;
+                for (auto send_request = sending_requests.begin(); send_request != sending_requests.end(); ++send_request, ++datagram_index) {
+                    if (datagram_index < frame_pacing.datagrams_sent) {
+                        // already sent by an earlier call for this frame
+                        continue;
+                    }
+                    if (datagram_index > 0UL && datagram_interval > 0LL) {
+                        const long long datagram_due_time = frame_pacing.start_time + static_cast<long long>(datagram_index) * datagram_interval;
+                        if (datagram_due_time > ctl::ctTimer::snap_qpc_as_usec()) {
+                            try {
+                                this_ptr->schedule_datagram(datagram_due_time);
+                            }
+                            catch (const std::exception& e) {
+                                ctsConfig::PrintException(e);
+                                frame_pacing = ctsMediaStreamServerConnectedSocket::FramePacing();
+                                return wsIOResult(WSAENOBUFS);
+                            }
+                            return wsIOResult(WSA_IO_PENDING);
+                        }
+                    }
 
-                for (auto& send_request : sending_requests) {
                     // making a synchronous call
+                    auto& send_buffers = *send_request;
                     DWORD bytes_sent;
                     auto send_result = ::WSASendTo(
                         socket,
-                        send_request.data(),
-                        static_cast<DWORD>(send_request.size()),
+                        send_buffers.data(),
+                        send_request.buffer_count(),
                         &bytes_sent,
                         0,
                         remote_addr.sockaddr(),
@@ -480,11 +524,12 @@ namespace ctsTraffic {
 
                     if (SOCKET_ERROR == send_result) {
                         auto error = ::WSAGetLastError();
+                        frame_pacing = ctsMediaStreamServerConnectedSocket::FramePacing();
                         try {
                             if (WSAEMSGSIZE == error) {
                                 unsigned long bytes_requested = 0;
                                 // iterate across each WSABUF* in the array
-                                for (auto& wasbuf : send_request) {
+                                for (auto& wasbuf : send_buffers) {
                                     bytes_requested += wasbuf.len;
                                 }
                                 ctsConfig::PrintErrorInfo(
@@ -509,11 +554,117 @@ namespace ctsTraffic {
                     }
                     
                     // successfully completed synchronously
-                    return_results.bytes_transferred += bytes_sent;
+                    frame_pacing.bytes_sent += bytes_sent;
+                    ++frame_pacing.datagrams_sent;
+                    this_ptr->record_datagram_sent(ctl::ctTimer::snap_qpc_as_usec());
+                }
+
+                return_results.bytes_transferred = frame_pacing.bytes_sent;
+                // the next call starts the next frame
+                frame_pacing = ctsMediaStreamServerConnectedSocket::FramePacing();
+
+                if (ctsConfig::GetMediaStream().FecDataFrames > 0) {
+                    auto error = SendParityDatagrams(this_ptr, socket, seq_number, next_task);
+                    if (error != NO_ERROR) {
+                        return wsIOResult(error);
+                    }
                 }
             }
 
             return return_results;
         }
+
+        // the caller holds the socket lock, which guards the parity encoder
+        int ctsMediaStreamServerImpl::SendParityDatagrams(_In_ ctsMediaStreamServerConnectedSocket* this_ptr, SOCKET _socket, long long _seq_number, const ctsIOTask& _task) NOEXCEPT
+        {
+            const ctsConfig::MediaStreamSettings& media_stream(ctsConfig::GetMediaStream());
+            const ctl::ctSockaddr& remote_addr(this_ptr->get_address());
+            ctsMediaStreamParityEncoder& parity_encoder = this_ptr->get_parity_encoder();
+            if (!parity_encoder.get_parity().is_enabled()) {
+                try {
+                    // compact headers are as short as UdpDatagramCompactDataHeaderMinimumLength: leaving room for the longest payload
+                    parity_encoder.initialize(ctsMediaStreamParity(
+                        media_stream.FecDataFrames,
+                        media_stream.FecParityFrames,
+                        media_stream.MaximumFrameSizeBytes - (this_ptr->uses_compact_header() ? UdpDatagramCompactDataHeaderMinimumLength : UdpDatagramDataHeaderLength)));
+                }
+                catch (const std::exception& e) {
+                    ctsConfig::PrintException(e);
+                    return WSAENOBUFS;
+                }
+            }
+
+            // the data payload follows the header in the datagram just sent
+            parity_encoder.add_frame(
+                _seq_number,
+                _task.buffer,
+                _task.buffer_length - ctsMediaStreamSendRequests::HeaderLength(_seq_number, this_ptr->uses_compact_header()));
+
+            const ctsMediaStreamParity& parity = parity_encoder.get_parity();
+            if (!parity.is_group_end(_seq_number, media_stream.StreamLengthFrames)) {
+                return NO_ERROR;
+            }
+            ctlScopeGuard(clearParityOnExit, { parity_encoder.clear(); });
+
+            const long long group_first_sequence = parity.group_first_sequence(_seq_number);
+            for (unsigned long parity_index = 0; parity_index < parity.get_parity_frames(); ++parity_index) {
+                const long long parity_seq_number = group_first_sequence + parity_index;
+                if (parity_seq_number > _seq_number) {
+                    // the final group can be shorter than the number of parity datagrams
+                    break;
+                }
+
+                PrintDebugInfo(
+                    L"\t\tctsMediaStreamServer sending parity for seq number %lld\n",
+                    parity_seq_number);
+
+                // a parity sequence number is never after the frames it covers:
+                // its compact header is never longer, so its payload is long enough to cover theirs
+                // - the payload is only as long as the longest frame it covers: frames can vary in size
+                ctsMediaStreamSendRequests parity_requests(
+                    ctsMediaStreamSendRequests::HeaderLength(parity_seq_number, this_ptr->uses_compact_header()) + parity_encoder.parity_payload_length(parity_index),
+                    parity_seq_number,
+                    parity_encoder.parity_payload(parity_index),
+                    UdpDatagramProtocolHeaderFlagParity,
+                    this_ptr->uses_compact_header());
+
+                for (auto send_request = parity_requests.begin(); send_request != parity_requests.end(); ++send_request) {
+                    // making a synchronous call
+                    auto& send_buffers = *send_request;
+                    DWORD bytes_sent;
+                    auto send_result = ::WSASendTo(
+                        _socket,
+                        send_buffers.data(),
+                        send_request.buffer_count(),
+                        &bytes_sent,
+                        0,
+                        remote_addr.sockaddr(),
+                        remote_addr.length(),
+                        nullptr,
+                        nullptr);
+
+                    if (SOCKET_ERROR == send_result) {
+                        auto error = ::WSAGetLastError();
+                        try {
+                            ctsConfig::PrintErrorInfo(
+                                L"WSASendTo(%Iu, parity seq %lld, %ws) failed [%d]",
+                                _socket,
+                                parity_seq_number,
+                                remote_addr.writeCompleteAddress().c_str(),
+                                error);
+                        }
+                        catch (const std::exception&) {
+                            // best effort
+                        }
+                        return error;
+                    }
+
+                    // parity isn't counted in the frame's bytes: only in the parity bandwidth
+                    ctsConfig::Settings->UdpStatusDetails.parity_bits.add(static_cast<long long>(bytes_sent) * 8LL);
+                }
+            }
+
+            return NO_ERROR;
+        }
     }
 }
@@ -69,9 +69,10 @@ namespace ctsTraffic {
         /// Processes the incoming START request from the client
         /// - if we have a waiting ctsSocket to accept it, will add it to connected_sockets
         /// - else we'll queue it to awaiting_endpoints
+        /// - _compact_header is set when the client sent START_COMPACT
         ///
         ////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        void start(const ctl::ctScopedSocket& _socket, const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _target_addr);
+        void start(const ctl::ctScopedSocket& _socket, const ctl::ctSockaddr& _local_addr, const ctl::ctSockaddr& _target_addr, bool _compact_header);
     }
 
 
@@ -26,23 +26,37 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // project headers
 #include "ctsMediaStreamServerConnectedSocket.h"
 #include "ctsWinsockLayer.h"
+#include "ctsTrace.h"
 
 using namespace ctl;
 
 namespace ctsTraffic {
+    // returns the delay before the task should be sent, at the best resolution the pattern gave
+    static long long TaskOffsetMicroseconds(const ctsIOTask& _task) NOEXCEPT
+    {
+        return (_task.time_offset_microseconds != 0LL) ? _task.time_offset_microseconds : _task.time_offset_milliseconds * 1000LL;
+    }
+
     ctsMediaStreamServerConnectedSocket::ctsMediaStreamServerConnectedSocket(
         const std::weak_ptr<ctsSocket>& _weak_socket, 
         SOCKET _sending_socket,
         const ctSockaddr& _remote_addr,
-        ctsMediaStreamConnectedSocketIoFunctor _io_functor)
+        ctsMediaStreamConnectedSocketIoFunctor _io_functor,
+        _In_opt_ ctsMediaStreamServerScheduler* _scheduler,
+        bool _compact_header)
         :
         object_guard(),
+        scheduler(_scheduler),
         task_timer(nullptr),
         weak_socket(_weak_socket),
         io_functor(std::move(_io_functor)),
         socket(_sending_socket),
         next_task(),
+        parity_encoder(),
+        frame_pacing(),
+        last_datagram_time(0LL),
         remote_addr(_remote_addr),
+        compact_header(_compact_header),
         sequence_number(0LL),
         connect_time(ctTimer::snap_qpc_as_msec())
     {
@@ -50,20 +64,25 @@ namespace ctsTraffic {
             throw ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsMediaStreamServer", false);
         }
 
-        task_timer = ::CreateThreadpoolTimer(ctsMediaStreamTimerCallback, this, ctsConfig::Settings->PTPEnvironment);
-        if (nullptr == task_timer) {
-            auto gle = ::GetLastError();
-            ::DeleteCriticalSection(&object_guard);
-            throw ctException(gle, L"CreateThreadpoolTimer", L"ctsMediaStreamServer", false);
+        if (nullptr == scheduler) {
+            task_timer = ::CreateThreadpoolTimer(ctsMediaStreamTimerCallback, this, ctsConfig::Settings->PTPEnvironment);
+            if (nullptr == task_timer) {
+                auto gle = ::GetLastError();
+                ::DeleteCriticalSection(&object_guard);
+                throw ctException(gle, L"CreateThreadpoolTimer", L"ctsMediaStreamServer", false);
+            }
         }
     }
 
     ctsMediaStreamServerConnectedSocket::~ctsMediaStreamServerConnectedSocket() NOEXCEPT
     {
         // stop the TP before deleting the CS
-        ::SetThreadpoolTimer(task_timer, nullptr, 0, 0);
-        ::WaitForThreadpoolTimerCallbacks(task_timer, TRUE);
-        ::CloseThreadpoolTimer(task_timer);
+        // - the scheduler only holds a weak reference, so it can't call back into a deleted object
+        if (task_timer != nullptr) {
+            ::SetThreadpoolTimer(task_timer, nullptr, 0, 0);
+            ::WaitForThreadpoolTimerCallbacks(task_timer, TRUE);
+            ::CloseThreadpoolTimer(task_timer);
+        }
 
         ::DeleteCriticalSection(&object_guard);
     }
@@ -100,17 +119,68 @@ namespace ctsTraffic {
     {
         return ctMemoryGuardIncrement(&sequence_number);
     }
+
+    _Requires_lock_held_(object_guard)
+    ctsMediaStreamParityEncoder& ctsMediaStreamServerConnectedSocket::get_parity_encoder() NOEXCEPT
+    {
+        return parity_encoder;
+    }
+
+    _Requires_lock_held_(object_guard)
+    ctsMediaStreamServerConnectedSocket::FramePacing& ctsMediaStreamServerConnectedSocket::get_frame_pacing() NOEXCEPT
+    {
+        return frame_pacing;
+    }
+
+    bool ctsMediaStreamServerConnectedSocket::paces_datagrams() const NOEXCEPT
+    {
+        return this->scheduler != nullptr && this->scheduler->is_precise();
+    }
+
+    bool ctsMediaStreamServerConnectedSocket::uses_compact_header() const NOEXCEPT
+    {
+        return this->compact_header;
+    }
+
+    void ctsMediaStreamServerConnectedSocket::schedule_datagram(long long _due_time)
+    {
+        this->scheduler->schedule(this->shared_from_this(), _due_time);
+    }
+
+    _Requires_lock_held_(object_guard)
+    void ctsMediaStreamServerConnectedSocket::record_datagram_sent(long long _send_time) NOEXCEPT
+    {
+        if (this->last_datagram_time != 0LL) {
+            ctsConfig::Settings->DatagramGapHistogram.add_value(_send_time - this->last_datagram_time);
+        }
+        this->last_datagram_time = _send_time;
+    }
     
     void ctsMediaStreamServerConnectedSocket::schedule_task(const ctsIOTask& _task) NOEXCEPT
     {
         auto shared_socket(this->weak_socket.lock());
         if (shared_socket) {
-            if (_task.time_offset_milliseconds < 1) {
+            const long long time_offset_microseconds = TaskOffsetMicroseconds(_task);
+            // when pacing precisely, only tasks already due are sent without going through the scheduler
+            const long long immediate_microseconds = this->paces_datagrams() ? 1LL : 1000LL;
+            if (time_offset_microseconds < immediate_microseconds) {
                 // in this case, immediately schedule the WSASendTo
                 ctAutoReleaseCriticalSection lock_object(&this->object_guard);
                 this->next_task = _task;
                 ctsMediaStreamServerConnectedSocket::ctsMediaStreamTimerCallback(nullptr, this, nullptr);
 
+            } else if (this->scheduler != nullptr) {
+                // assign the next task *and* queue it to the scheduler while in *this object lock
+                ctAutoReleaseCriticalSection lock_object(&this->object_guard);
+                this->next_task = _task;
+                try {
+                    this->scheduler->schedule(this->shared_from_this(), ctTimer::snap_qpc_as_usec() + time_offset_microseconds);
+                }
+                catch (const std::exception& e) {
+                    ctsConfig::PrintException(e);
+                    this->complete_state(ERROR_OUTOFMEMORY);
+                }
+
             } else {
                 FILETIME ftDueTime(ctTimer::convert_msec_relative_filetime(_task.time_offset_milliseconds));
                 // assign the next task *and* schedule the timer while in *this object lock
@@ -121,6 +191,11 @@ namespace ctsTraffic {
         }
     }
 
+    void ctsMediaStreamServerConnectedSocket::send_scheduled_task() NOEXCEPT
+    {
+        ctsMediaStreamServerConnectedSocket::ctsMediaStreamTimerCallback(nullptr, this, nullptr);
+    }
+
     void ctsMediaStreamServerConnectedSocket::complete_state(unsigned long _error_code) NOEXCEPT
     {
         std::shared_ptr<ctsSocket> shared_socket(this->weak_socket);
@@ -132,6 +207,7 @@ namespace ctsTraffic {
     VOID CALLBACK ctsMediaStreamServerConnectedSocket::ctsMediaStreamTimerCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER)
     {
         ctsMediaStreamServerConnectedSocket* this_ptr = reinterpret_cast<ctsMediaStreamServerConnectedSocket*>(_context);
+        ctsTracePoint("ctsMediaStreamServerConnectedSocket::TimerCallback", this_ptr, nullptr, 0, nullptr, 0);
 
         // take a lock on the ctsSocket for this 'connection'
         auto shared_socket = this_ptr->weak_socket.lock();
@@ -146,6 +222,10 @@ namespace ctsTraffic {
 
         // post the queued IO, then loop sending/scheduling as necessary
         auto send_results = this_ptr->io_functor(this_ptr);
+        if (WSA_IO_PENDING == send_results.error_code) {
+            // the rest of the frame was queued to the scheduler: it completes when the last datagram is sent
+            return;
+        }
         auto status = shared_pattern->complete_io(
             this_ptr->next_task,
             send_results.bytes_transferred,
@@ -159,8 +239,12 @@ namespace ctsTraffic {
                     this_ptr->next_task = current_task;
                     // if the time is less than two ms., we need to catch up on sends
                     // - post the sendto immediately instead of scheduling for later
-                    if (this_ptr->next_task.time_offset_milliseconds < 2) {
+                    // - when pacing precisely, only catch up on sends already due
+                    if (TaskOffsetMicroseconds(this_ptr->next_task) < (this_ptr->paces_datagrams() ? 1LL : 2000LL)) {
                         send_results = this_ptr->io_functor(this_ptr);
+                        if (WSA_IO_PENDING == send_results.error_code) {
+                            return;
+                        }
                         status = shared_pattern->complete_io(
                             this_ptr->next_task,
                             send_results.bytes_transferred,
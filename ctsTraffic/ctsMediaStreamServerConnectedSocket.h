@@ -25,13 +25,25 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsSocket.h"
 #include "ctsWinsockLayer.h"
 #include "ctsSocketGuard.hpp"
+#include "ctsMediaStreamServerScheduler.h"
+#include "ctsMediaStreamParity.hpp"
 
 
 namespace ctsTraffic {
     class ctsMediaStreamServerConnectedSocket;
     typedef std::function<wsIOResult(ctsMediaStreamServerConnectedSocket*)> ctsMediaStreamConnectedSocketIoFunctor;
 
-    class ctsMediaStreamServerConnectedSocket {
+    class ctsMediaStreamServerConnectedSocket : public std::enable_shared_from_this<ctsMediaStreamServerConnectedSocket> {
+    public:
+        // progress through the datagrams of the frame being sent (-DatagramPacing:spread)
+        struct FramePacing {
+            long long sequence_number = 0LL;
+            // when the first datagram of the frame was sent (QPC microseconds)
+            long long start_time = 0LL;
+            unsigned long datagrams_sent = 0UL;
+            unsigned long bytes_sent = 0UL;
+        };
+
     private:
         //
         // ctsSocketGuard is given friend-access to call lock_socket and unlock_socket
@@ -41,6 +53,9 @@ namespace ctsTraffic {
 
         // the CS is mutable so we can take a lock / release a lock in const methods
         mutable CRITICAL_SECTION object_guard;
+        // tasks are queued to the listening socket's scheduler when one is given
+        // - otherwise each connected socket arms its own timer
+        ctsMediaStreamServerScheduler* scheduler;
         PTP_TIMER task_timer;
 
         // this weak_socket is the weak reference to the ctsSocket tracked by ctsSocketState & ctsSocketBroker
@@ -57,8 +72,18 @@ namespace ctsTraffic {
 
         _Guarded_by_(object_guard) ctsIOTask next_task;
 
+        // parity of the frames sent in the current group (-FecFrames)
+        _Guarded_by_(object_guard) ctsMediaStreamParityEncoder parity_encoder;
+
+        _Guarded_by_(object_guard) FramePacing frame_pacing;
+        // when the last datagram was sent on this stream (QPC microseconds, 0 == none yet)
+        _Guarded_by_(object_guard) long long last_datagram_time;
+
         const ctl::ctSockaddr remote_addr;
 
+        // the client requested the compact datagram headers with START_COMPACT
+        const bool compact_header;
+
         _Interlocked_ long long sequence_number;
 
         const long long connect_time;
@@ -72,7 +97,9 @@ namespace ctsTraffic {
             const std::weak_ptr<ctsSocket>& _weak_socket, 
             SOCKET _sending_socket, 
             const ctl::ctSockaddr& _remote_addr, 
-            ctsMediaStreamConnectedSocketIoFunctor _io_functor);
+            ctsMediaStreamConnectedSocketIoFunctor _io_functor,
+            _In_opt_ ctsMediaStreamServerScheduler* _scheduler = nullptr,
+            bool _compact_header = false);
 
         ~ctsMediaStreamServerConnectedSocket() NOEXCEPT;
 
@@ -84,8 +111,31 @@ namespace ctsTraffic {
 
         long long increment_sequence() NOEXCEPT;
 
+        // the caller must hold the socket lock (ctsGuardSocket) while using the encoder
+        ctsMediaStreamParityEncoder& get_parity_encoder() NOEXCEPT;
+
+        // the caller must hold the socket lock (ctsGuardSocket) while using the frame pacing
+        FramePacing& get_frame_pacing() NOEXCEPT;
+
+        // true when the datagrams of each frame are spread across the frame interval by the scheduler
+        bool paces_datagrams() const NOEXCEPT;
+
+        // true when datagrams are sent with the compact header (see ctsMediaStreamProtocol.hpp)
+        bool uses_compact_header() const NOEXCEPT;
+
+        // queues the rest of the current frame to be sent at _due_time (QPC microseconds)
+        // - can throw std::bad_alloc
+        void schedule_datagram(long long _due_time);
+
+        // tracks the gap since the prior datagram sent on this stream
+        // - the caller must hold the socket lock (ctsGuardSocket)
+        void record_datagram_sent(long long _send_time) NOEXCEPT;
+
         void schedule_task(const ctsIOTask& _task) NOEXCEPT;
 
+        // invoked by the scheduler once the scheduled task is due
+        void send_scheduled_task() NOEXCEPT;
+
         void complete_state(unsigned long _error_code) NOEXCEPT;
 
         // non-copyable
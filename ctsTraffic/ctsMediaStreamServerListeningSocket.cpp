@@ -24,6 +24,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <ctSockaddr.hpp>
 #include <ctException.hpp>
 #include <ctHandle.hpp>
+#include <ctTimer.hpp>
 
 // project headers
 #include "ctsMediaStreamServerListeningSocket.h"
@@ -36,13 +37,11 @@ namespace ctsTraffic {
 
     ctsMediaStreamServerListeningSocket::ctsMediaStreamServerListeningSocket(ctl::ctScopedSocket&& _listening_socket, const ctl::ctSockaddr& _listening_addr) :
         object_guard(),
+        recv_contexts(),
         thread_iocp(std::make_shared<ctl::ctThreadIocp>(_listening_socket.get(), ctsConfig::Settings->PTPEnvironment)),
-        recv_buffer(),
         socket(std::move(_listening_socket)),
         listening_addr(_listening_addr),
-        remote_addr(),
-        remote_addr_len(0),
-        recv_flags(0)
+        scheduler(ctsConfig::GetMediaStream().SpreadDatagrams)
     {
         ctl::ctFatalCondition(
             !!(ctsConfig::Settings->Options & ctsConfig::OptionType::HANDLE_INLINE_IOCP),
@@ -73,6 +72,11 @@ namespace ctsTraffic {
         return this->listening_addr;
     }
 
+    ctsMediaStreamServerScheduler* ctsMediaStreamServerListeningSocket::get_scheduler() NOEXCEPT
+    {
+        return &this->scheduler;
+    }
+
     void ctsMediaStreamServerListeningSocket::reset() NOEXCEPT
     {
         ctl::ctAutoReleaseCriticalSection object_lock(&this->object_guard);
@@ -80,6 +84,13 @@ namespace ctsTraffic {
     }
 
     void ctsMediaStreamServerListeningSocket::initiate_recv() NOEXCEPT
+    {
+        for (auto& recv_context : this->recv_contexts) {
+            this->initiate_recv(recv_context);
+        }
+    }
+
+    void ctsMediaStreamServerListeningSocket::initiate_recv(RecvContext& _recv_context) NOEXCEPT
     {
         // continue to try to post a recv if the call fails
         int error = SOCKET_ERROR;
@@ -88,26 +99,26 @@ namespace ctsTraffic {
             try {
                 ctl::ctAutoReleaseCriticalSection lock_socket(&this->object_guard);
                 if (this->socket.get() != INVALID_SOCKET) {
+                    // the buffer is not cleared: only the bytes received are ever parsed
                     WSABUF wsabuf;
-                    wsabuf.buf = this->recv_buffer.data();
-                    wsabuf.len = static_cast<ULONG>(this->recv_buffer.size());
-                    ::ZeroMemory(this->recv_buffer.data(), this->recv_buffer.size());
+                    wsabuf.buf = _recv_context.buffer.data();
+                    wsabuf.len = static_cast<ULONG>(_recv_context.buffer.size());
 
-                    this->recv_flags = 0;
-                    this->remote_addr.reset();
-                    this->remote_addr_len = this->remote_addr.length();
+                    _recv_context.recv_flags = 0;
+                    _recv_context.remote_addr.reset();
+                    _recv_context.remote_addr_len = _recv_context.remote_addr.length();
                     OVERLAPPED* pov = this->thread_iocp->new_request(
-                        [this] (OVERLAPPED* _ov) {
-                        this->recv_completion(_ov); });
+                        [this, &_recv_context] (OVERLAPPED* _ov) {
+                        this->recv_completion(_ov, _recv_context); });
 
                     error = ::WSARecvFrom(
                         this->socket.get(), 
                         &wsabuf, 
                         1, 
                         nullptr, 
-                        &this->recv_flags, 
-                        this->remote_addr.sockaddr(), 
-                        &this->remote_addr_len,
+                        &_recv_context.recv_flags, 
+                        _recv_context.remote_addr.sockaddr(), 
+                        &_recv_context.remote_addr_len,
                         pov,
                         nullptr);
 
@@ -157,7 +168,7 @@ namespace ctsTraffic {
         }
     }
 
-    void ctsMediaStreamServerListeningSocket::recv_completion(OVERLAPPED* _ov) NOEXCEPT
+    void ctsMediaStreamServerListeningSocket::recv_completion(OVERLAPPED* _ov, RecvContext& _recv_context) NOEXCEPT
     {
         // Cannot be holding the object_guard when calling into any pimpl-> methods
         // - will risk deadlocking the server
@@ -176,14 +187,17 @@ namespace ctsTraffic {
                 }
 
                 DWORD bytes_received;
-                if (!::WSAGetOverlappedResult(this->socket.get(), _ov, &bytes_received, FALSE, &this->recv_flags)) {
+                const BOOL recv_succeeded = ::WSAGetOverlappedResult(this->socket.get(), _ov, &bytes_received, FALSE, &_recv_context.recv_flags);
+                // a clock probe needs the time it was received, before any parsing
+                const long long receive_time = ctl::ctTimer::snap_qpc_as_usec();
+                if (!recv_succeeded) {
                     // recvfrom failed
                     try {
                         auto gle = ::WSAGetLastError();
                         if (WSAECONNRESET == gle) {
                             ctsConfig::PrintErrorInfo(
                                 L"ctsMediaStreamServer - WSARecvFrom failed as the prior WSASendTo(%ws) failed with port unreachable",
-                                this->remote_addr.writeCompleteAddress().c_str());
+                                _recv_context.remote_addr.writeCompleteAddress().c_str());
                         } else {
                             ctsConfig::PrintErrorInfo(
                                 L"ctsMediaStreamServer - WSARecvFrom failed [%d]",
@@ -198,22 +212,31 @@ namespace ctsTraffic {
                     // - just attempt to post another recv at the end of this function
 
                 } else {
-                    ctsMediaStreamMessage message(ctsMediaStreamMessage::Extract(this->recv_buffer.data(), bytes_received));
+                    ctsMediaStreamMessage message(ctsMediaStreamMessage::Extract(_recv_context.buffer.data(), bytes_received));
                     switch (message.action) {
                         case MediaStreamAction::START:
+                        case MediaStreamAction::START_COMPACT:
                             PrintDebugInfo(
-                                L"\t\tctsMediaStreamServer - processing START from %ws\n",
-                                this->remote_addr.writeCompleteAddress().c_str());
+                                L"\t\tctsMediaStreamServer - processing %ws from %ws\n",
+                                (MediaStreamAction::START_COMPACT == message.action) ? L"START_COMPACT" : L"START",
+                                _recv_context.remote_addr.writeCompleteAddress().c_str());
 #ifndef TESTING_IGNORE_START
                             // Cannot be holding the object_guard when calling into any pimpl-> methods
-                            pimpl_operation = [this] () {
-                                ctsMediaStreamServerImpl::start(this->socket, this->listening_addr, this->remote_addr);
+                            // - start() drops repeated STARTs from established streams with a single table lookup
+                            //   before contending on the lock for new streams
+                            pimpl_operation = [this, &_recv_context, compact_header = (MediaStreamAction::START_COMPACT == message.action)] () {
+                                ctsMediaStreamServerImpl::start(this->socket, this->listening_addr, _recv_context.remote_addr, compact_header);
                             };
 #endif
                             break;
 
+                        case MediaStreamAction::TIME_PROBE:
+                            // echoed immediately and statelessly: no stream needs to be looked up
+                            this->reply_time_probe(message.originate_time, receive_time, _recv_context.remote_addr);
+                            break;
+
                         default:
-                            ctl::ctAlwaysFatalCondition(L"ctsMediaStreamServer - received an unexpected Action: %d (%p)\n", message.action, this->recv_buffer.data());
+                            ctl::ctAlwaysFatalCondition(L"ctsMediaStreamServer - received an unexpected Action: %d (%p)\n", message.action, _recv_context.buffer.data());
                     }
                 }
             }
@@ -227,8 +250,23 @@ namespace ctsTraffic {
             ctsConfig::PrintException(e);
         }
 
-        // finally post another recv
-        this->initiate_recv();
+        // finally post another recv with this same context
+        this->initiate_recv(_recv_context);
+    }
+
+    _Requires_lock_held_(object_guard)
+    void ctsMediaStreamServerListeningSocket::reply_time_probe(long long _originate_time, long long _receive_time, const ctl::ctSockaddr& _remote_addr) NOEXCEPT
+    {
+        char reply[UdpDatagramTimeReplyLength];
+        // the transmit time is taken as late as possible: the client subtracts the time held here from the round trip
+        ctsMediaStreamMessage::MakeTimeReply(reply, _originate_time, _receive_time, ctl::ctTimer::snap_qpc_as_usec());
+
+        // a synchronous send: the reply is too small to be worth tracking an overlapped send for
+        if (SOCKET_ERROR == ::sendto(this->socket.get(), reply, UdpDatagramTimeReplyLength, 0, _remote_addr.sockaddr(), _remote_addr.length())) {
+            ctsConfig::PrintErrorInfo(
+                L"ctsMediaStreamServer - sendto failed replying to a clock probe [%d]",
+                ::WSAGetLastError());
+        }
     }
 
 } // namespace
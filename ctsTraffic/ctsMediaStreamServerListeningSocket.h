@@ -22,31 +22,41 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctThreadIocp.hpp"
 #include "ctHandle.hpp"
 
+#include "ctsMediaStreamServerScheduler.h"
+
 namespace ctsTraffic {
     class ctsMediaStreamServerListeningSocket {
     private:
         static const size_t RecvBufferSize = 1024;
+        // keeping several recvs posted so datagrams are still received while START requests are processed
+        static const size_t OutstandingRecvCount = 4;
         mutable CRITICAL_SECTION object_guard;
 
+        // each outstanding recvfrom() has its own buffer and remote address
+        // - only touched by the thread posting or completing that one recv, so not guarded by object_guard
+        struct RecvContext {
+            std::array<char, RecvBufferSize> buffer;
+            ctl::ctSockaddr remote_addr;
+            int remote_addr_len;
+            DWORD recv_flags;
+        };
+        std::array<RecvContext, OutstandingRecvCount> recv_contexts;
+
         /// members must have access protected
         _Guarded_by_(object_guard)
         std::shared_ptr<ctl::ctThreadIocp> thread_iocp;
         _Guarded_by_(object_guard)
-        std::array<char, RecvBufferSize> recv_buffer;
-        _Guarded_by_(object_guard)
         ctl::ctScopedSocket socket;
         _Guarded_by_(object_guard)
         ctl::ctSockaddr listening_addr;
 
-        // remote addr, length, and flags are updated on each recvfrom()
-        _Guarded_by_(object_guard)
-        ctl::ctSockaddr remote_addr;
-        _Guarded_by_(object_guard)
-        int remote_addr_len;
-        _Guarded_by_(object_guard)
-        DWORD recv_flags;
+        // paces the frames of every stream sending from this socket: synchronized internally
+        ctsMediaStreamServerScheduler scheduler;
 
-        void recv_completion(OVERLAPPED* _ov) NOEXCEPT;
+        void initiate_recv(RecvContext& _recv_context) NOEXCEPT;
+        void recv_completion(OVERLAPPED* _ov, RecvContext& _recv_context) NOEXCEPT;
+        _Requires_lock_held_(object_guard)
+        void reply_time_probe(long long _originate_time, long long _receive_time, const ctl::ctSockaddr& _remote_addr) NOEXCEPT;
 
     public:
         ctsMediaStreamServerListeningSocket(
@@ -59,8 +69,11 @@ namespace ctsTraffic {
 
         ctl::ctSockaddr get_address() const NOEXCEPT;
 
+        ctsMediaStreamServerScheduler* get_scheduler() NOEXCEPT;
+
         void reset() NOEXCEPT;
 
+        // posts every outstanding recv: each is reposted as it completes
         void initiate_recv() NOEXCEPT;
 
         // non-copyable
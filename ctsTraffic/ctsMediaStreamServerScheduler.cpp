@@ -0,0 +1,164 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// parent header
+#include "ctsMediaStreamServerScheduler.h"
+
+// cpp headers
+#include <algorithm>
+#include <memory>
+#include <vector>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctException.hpp>
+#include <ctLocks.hpp>
+#include <ctTimer.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsMediaStreamServerConnectedSocket.h"
+#include "ctsTrace.h"
+
+
+namespace ctsTraffic {
+
+    using namespace ctl;
+    using namespace std;
+
+    // when the batch can't be allocated, try again after this delay rather than dropping the sends
+    static const long long SchedulerRetryMicroseconds = 1000LL;
+    // with precise pacing, deadlines closer than one timer tick are waited for within the callback
+    static const long long PreciseWaitMicroseconds = 1000LL;
+
+    ctsMediaStreamServerScheduler::ctsMediaStreamServerScheduler(bool _precise_pacing) :
+        object_guard(),
+        deadline_timer(nullptr),
+        precise_pacing(_precise_pacing),
+        deadline_queue(),
+        next_schedule_order(0ULL),
+        timer_due_time(0LL)
+    {
+        if (!::InitializeCriticalSectionEx(&this->object_guard, 4000, 0)) {
+            throw ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsMediaStreamServerScheduler", false);
+        }
+
+        this->deadline_timer = ::CreateThreadpoolTimer(DeadlineTimerCallback, this, ctsConfig::Settings->PTPEnvironment);
+        if (nullptr == this->deadline_timer) {
+            auto gle = ::GetLastError();
+            ::DeleteCriticalSection(&this->object_guard);
+            throw ctException(gle, L"CreateThreadpoolTimer", L"ctsMediaStreamServerScheduler", false);
+        }
+    }
+
+    ctsMediaStreamServerScheduler::~ctsMediaStreamServerScheduler() NOEXCEPT
+    {
+        // stop the TP before deleting the CS
+        ::SetThreadpoolTimer(this->deadline_timer, nullptr, 0, 0);
+        ::WaitForThreadpoolTimerCallbacks(this->deadline_timer, TRUE);
+        ::CloseThreadpoolTimer(this->deadline_timer);
+
+        ::DeleteCriticalSection(&this->object_guard);
+    }
+
+    void ctsMediaStreamServerScheduler::schedule(const shared_ptr<ctsMediaStreamServerConnectedSocket>& _connected_socket, long long _due_time)
+    {
+        ScheduledSend scheduled_send;
+        scheduled_send.due_time = _due_time;
+        scheduled_send.connected_socket = _connected_socket;
+
+        ctAutoReleaseCriticalSection lock_scheduler(&this->object_guard);
+        scheduled_send.schedule_order = this->next_schedule_order++;
+        this->deadline_queue.push_back(move(scheduled_send));
+        push_heap(this->deadline_queue.begin(), this->deadline_queue.end(), LaterDeadline());
+
+        // only need to touch the timer if this is now the earliest deadline
+        if (0LL == this->timer_due_time || _due_time < this->timer_due_time) {
+            this->set_timer(_due_time, ctTimer::snap_qpc_as_usec());
+        }
+    }
+
+    _Requires_lock_held_(object_guard)
+    void ctsMediaStreamServerScheduler::set_timer(long long _due_time, long long _current_time) NOEXCEPT
+    {
+        this->timer_due_time = _due_time;
+        // deadlines already passed are set to fire immediately
+        const long long time_until_due = (_due_time > _current_time) ? _due_time - _current_time : 0LL;
+        FILETIME relative_due_time(ctTimer::convert_usec_relative_filetime(time_until_due));
+        ::SetThreadpoolTimer(this->deadline_timer, &relative_due_time, 0, 0);
+    }
+
+    VOID CALLBACK ctsMediaStreamServerScheduler::DeadlineTimerCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER) NOEXCEPT
+    {
+        ctsMediaStreamServerScheduler* this_ptr = reinterpret_cast<ctsMediaStreamServerScheduler*>(_context);
+
+        // pull every send that is due while holding the lock, but send them after the lock is released:
+        // sending will schedule each stream's next frame back into this queue
+        vector<weak_ptr<ctsMediaStreamServerConnectedSocket>> due_sends;
+        for (;;) {
+            // non-zero when this callback waits for the next deadline itself instead of arming the timer
+            long long wait_due_time = 0LL;
+            {
+                ctAutoReleaseCriticalSection lock_scheduler(&this_ptr->object_guard);
+                const long long current_time = ctTimer::snap_qpc_as_usec();
+                this_ptr->timer_due_time = 0LL;
+
+                due_sends.clear();
+                try {
+                    due_sends.reserve(this_ptr->deadline_queue.size());
+                }
+                catch (const exception& e) {
+                    ctsConfig::PrintException(e);
+                    this_ptr->set_timer(current_time + SchedulerRetryMicroseconds, current_time);
+                    return;
+                }
+
+                while (!this_ptr->deadline_queue.empty() && this_ptr->deadline_queue.front().due_time <= current_time) {
+                    pop_heap(this_ptr->deadline_queue.begin(), this_ptr->deadline_queue.end(), LaterDeadline());
+                    ScheduledSend& due_send = this_ptr->deadline_queue.back();
+                    ctsConfig::Settings->FrameSchedulingLatenessHistogram.add_value(current_time - due_send.due_time);
+                    due_sends.push_back(move(due_send.connected_socket));
+                    this_ptr->deadline_queue.pop_back();
+                }
+
+                if (!this_ptr->deadline_queue.empty()) {
+                    const long long next_due_time = this_ptr->deadline_queue.front().due_time;
+                    if (this_ptr->precise_pacing && next_due_time - current_time < PreciseWaitMicroseconds) {
+                        // schedule() will only arm the timer for a deadline earlier than the one being waited for
+                        this_ptr->timer_due_time = next_due_time;
+                        wait_due_time = next_due_time;
+                    } else {
+                        this_ptr->set_timer(next_due_time, current_time);
+                    }
+                }
+                ctsTraceCounter("ctsMediaStreamServerScheduler", "sending", due_sends.size(), "queued", this_ptr->deadline_queue.size());
+            }
+
+            for (auto& due_send : due_sends) {
+                auto shared_connected_socket(due_send.lock());
+                // streams removed since they were scheduled are skipped
+                if (shared_connected_socket) {
+                    shared_connected_socket->send_scheduled_task();
+                }
+            }
+
+            if (0LL == wait_due_time) {
+                return;
+            }
+            // the timer can't be set precisely enough for the next deadline: spin until it's due
+            while (ctTimer::snap_qpc_as_usec() < wait_due_time) {
+                ::YieldProcessor();
+            }
+        }
+    }
+
+} // namespace
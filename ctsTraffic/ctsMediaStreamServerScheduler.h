@@ -0,0 +1,94 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <memory>
+#include <vector>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+
+
+namespace ctsTraffic {
+    class ctsMediaStreamServerConnectedSocket;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsMediaStreamServerScheduler
+    /// - one per listening socket: every stream sending from that socket queues its next frame here
+    ///   instead of arming its own threadpool timer
+    /// - frames are kept in a deadline-ordered queue; a single timer is armed for the earliest deadline
+    ///   and each timer callback sends every frame that is due as one batch
+    /// - deadlines are QPC microseconds
+    /// - how late each frame was sent is tracked in ctsConfig::Settings->FrameSchedulingLatenessHistogram
+    ///
+    /// With precise pacing (-DatagramPacing:spread) the scheduler also paces the datagrams within each frame
+    /// - threadpool timers can't fire more precisely than a millisecond, so deadlines closer than
+    ///   that are waited out by spinning on QPC within the timer callback
+    /// - this dedicates a threadpool thread to sending while streams are running above ~1000 datagrams per second
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsMediaStreamServerScheduler {
+    public:
+        explicit ctsMediaStreamServerScheduler(bool _precise_pacing = false);
+        ~ctsMediaStreamServerScheduler() NOEXCEPT;
+
+        ///
+        /// queues the connected socket to send its next task at _due_time (QPC microseconds)
+        ///
+        void schedule(const std::shared_ptr<ctsMediaStreamServerConnectedSocket>& _connected_socket, long long _due_time);
+
+        bool is_precise() const NOEXCEPT
+        {
+            return this->precise_pacing;
+        }
+
+        // non-copyable
+        ctsMediaStreamServerScheduler(const ctsMediaStreamServerScheduler&) = delete;
+        ctsMediaStreamServerScheduler& operator=(const ctsMediaStreamServerScheduler&) = delete;
+
+    private:
+        struct ScheduledSend {
+            long long due_time;
+            // streams due at the same time are sent in the order they were scheduled
+            unsigned long long schedule_order;
+            std::weak_ptr<ctsMediaStreamServerConnectedSocket> connected_socket;
+        };
+        // std heap algorithms keep the 'largest' at the front: order so the earliest deadline is the largest
+        struct LaterDeadline {
+            bool operator()(const ScheduledSend& _left, const ScheduledSend& _right) const NOEXCEPT
+            {
+                if (_left.due_time != _right.due_time) {
+                    return _left.due_time > _right.due_time;
+                }
+                return _left.schedule_order > _right.schedule_order;
+            }
+        };
+
+        mutable CRITICAL_SECTION object_guard;
+        PTP_TIMER deadline_timer;
+        const bool precise_pacing;
+
+        _Guarded_by_(object_guard) std::vector<ScheduledSend> deadline_queue;
+        _Guarded_by_(object_guard) unsigned long long next_schedule_order;
+        // the deadline the timer is currently set for, or being waited for by a callback (0 == not set)
+        _Guarded_by_(object_guard) long long timer_due_time;
+
+        _Requires_lock_held_(object_guard) void set_timer(long long _due_time, long long _current_time) NOEXCEPT;
+
+        static VOID CALLBACK DeadlineTimerCallback(PTP_CALLBACK_INSTANCE, _In_ PVOID _context, PTP_TIMER) NOEXCEPT;
+    };
+}
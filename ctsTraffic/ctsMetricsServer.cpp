@@ -0,0 +1,241 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// parent header
+#include "ctsMetricsServer.h"
+
+// cpp headers
+#include <string>
+#include <exception>
+// os headers
+#include <windows.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+// ctl headers
+#include <ctException.hpp>
+#include <ctScopeGuard.hpp>
+#include <ctSockaddr.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsStatistics.hpp"
+
+
+namespace ctsTraffic {
+
+    using namespace ctl;
+    using namespace std;
+
+    // blocking calls from a scraper are bounded so a stalled client can't hold the worker indefinitely
+    static const DWORD MetricsSocketTimeoutMilliseconds = 5000;
+    static const int MetricsMaxRequestBytes = 4096;
+
+    static void AppendMetric(string& _output, _In_z_ LPCSTR _name, _In_z_ LPCSTR _type, _In_z_ LPCSTR _help, long long _value)
+    {
+        _output.append("# TYPE ").append(_name).append(" ").append(_type).append("\n");
+        _output.append("# HELP ").append(_name).append(" ").append(_help).append("\n");
+        _output.append(_name);
+        if (0 == ::strcmp(_type, "counter")) {
+            _output.append("_total");
+        }
+        _output.append(" ").append(to_string(_value)).append("\n");
+    }
+
+    static void AppendHistogram(string& _output, _In_z_ LPCSTR _name, _In_z_ LPCSTR _help, const ctsHistogramStatistics& _histogram)
+    {
+        _output.append("# TYPE ").append(_name).append(" histogram\n");
+        _output.append("# HELP ").append(_name).append(" ").append(_help).append("\n");
+
+        // OpenMetrics buckets are cumulative
+        long long cumulative_count = 0LL;
+        for (unsigned long bucket = 0; bucket < ctsHistogramStatistics::BucketCount; ++bucket) {
+            cumulative_count += _histogram.bucket_value(bucket);
+            _output.append(_name).append("_bucket{le=\"");
+            if (bucket == ctsHistogramStatistics::BucketCount - 1) {
+                _output.append("+Inf");
+            } else {
+                _output.append(to_string(ctsHistogramStatistics::bucket_bound(bucket)));
+            }
+            _output.append("\"} ").append(to_string(cumulative_count)).append("\n");
+        }
+        _output.append(_name).append("_sum ").append(to_string(_histogram.sum())).append("\n");
+        // _count must match the +Inf bucket even if an update raced this read
+        _output.append(_name).append("_count ").append(to_string(cumulative_count)).append("\n");
+    }
+
+    ctsMetricsServer::ctsMetricsServer(unsigned short _port) :
+        thread_pool_environment(),
+        thread_pool_worker(nullptr),
+        listening_socket(INVALID_SOCKET)
+    {
+        // listen dual-mode across IPv4 and IPv6
+        this->listening_socket = ctsConfig::CreateSocket(AF_INET6, SOCK_STREAM, IPPROTO_TCP, WSA_FLAG_NO_HANDLE_INHERIT);
+        ctlScopeGuard(closeSocketOnError, { ::closesocket(this->listening_socket); });
+
+        DWORD v6only = 0;
+        if (SOCKET_ERROR == ::setsockopt(this->listening_socket, IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&v6only), static_cast<int>(sizeof v6only))) {
+            throw ctException(::WSAGetLastError(), L"setsockopt(IPV6_V6ONLY)", L"ctsMetricsServer", false);
+        }
+
+        ctSockaddr listen_address(AF_INET6);
+        listen_address.setAddressAny();
+        listen_address.setPort(_port);
+        if (SOCKET_ERROR == ::bind(this->listening_socket, listen_address.sockaddr(), listen_address.length())) {
+            throw ctException(::WSAGetLastError(), L"bind", L"ctsMetricsServer", false);
+        }
+        if (SOCKET_ERROR == ::listen(this->listening_socket, SOMAXCONN)) {
+            throw ctException(::WSAGetLastError(), L"listen", L"ctsMetricsServer", false);
+        }
+
+        // using the default process threadpool (not the IO threadpool), marking the work-item as running long
+        ::InitializeThreadpoolEnvironment(&this->thread_pool_environment);
+        ::SetThreadpoolCallbackRunsLong(&this->thread_pool_environment);
+
+        this->thread_pool_worker = ::CreateThreadpoolWork(ThreadPoolWorker, this, &this->thread_pool_environment);
+        if (nullptr == this->thread_pool_worker) {
+            auto gle = ::GetLastError();
+            ::DestroyThreadpoolEnvironment(&this->thread_pool_environment);
+            throw ctException(gle, L"CreateThreadpoolWork", L"ctsMetricsServer", false);
+        }
+
+        closeSocketOnError.dismiss();
+        ::SubmitThreadpoolWork(this->thread_pool_worker);
+
+        PrintDebugInfo(L"\t\tctsMetricsServer listening on %ws\n", listen_address.writeCompleteAddress().c_str());
+    }
+
+    ctsMetricsServer::~ctsMetricsServer() NOEXCEPT
+    {
+        // closing the listening socket will fail the blocking accept() in the worker
+        ::closesocket(this->listening_socket);
+
+        ::WaitForThreadpoolWorkCallbacks(this->thread_pool_worker, FALSE);
+        ::CloseThreadpoolWork(this->thread_pool_worker);
+        ::DestroyThreadpoolEnvironment(&this->thread_pool_environment);
+    }
+
+    string ctsMetricsServer::FormatMetrics()
+    {
+        string output;
+        output.reserve(4096);
+
+        // every counter is read with a single interlocked read - no locks are taken
+        const ctsConnectionStatistics& connection_details = ctsConfig::Settings->ConnectionStatusDetails;
+        AppendMetric(output, "ctstraffic_connections_active", "gauge", "Connections currently processing IO", connection_details.active_connection_count.get());
+        AppendMetric(output, "ctstraffic_connections_successful", "counter", "Connections which completed successfully", connection_details.successful_completion_count.get());
+        AppendMetric(output, "ctstraffic_connections_network_errors", "counter", "Connections which failed with a network error", connection_details.connection_error_count.get());
+        AppendMetric(output, "ctstraffic_connections_protocol_errors", "counter", "Connections which failed with a protocol error", connection_details.protocol_error_count.get());
+        AppendMetric(output, "ctstraffic_connection_objects_allocated", "counter", "Per-connection objects newly allocated", connection_details.allocated_object_count.get());
+        AppendMetric(output, "ctstraffic_connection_objects_recycled", "counter", "Per-connection objects reused from closed connections", connection_details.recycled_object_count.get());
+
+        if (ctsConfig::ProtocolType::TCP == ctsConfig::Settings->Protocol) {
+            const ctsTcpStatistics& tcp_details = ctsConfig::Settings->TcpStatusDetails;
+            AppendMetric(output, "ctstraffic_tcp_sent_bytes", "counter", "Bytes sent across all TCP connections", tcp_details.bytes_sent.get());
+            AppendMetric(output, "ctstraffic_tcp_received_bytes", "counter", "Bytes received across all TCP connections", tcp_details.bytes_recv.get());
+        } else {
+            const ctsUdpStatistics& udp_details = ctsConfig::Settings->UdpStatusDetails;
+            AppendMetric(output, "ctstraffic_udp_received_bits", "counter", "Bits received across all UDP streams", udp_details.bits_received.get());
+            AppendMetric(output, "ctstraffic_udp_successful_frames", "counter", "Frames successfully received", udp_details.successful_frames.get());
+            AppendMetric(output, "ctstraffic_udp_dropped_frames", "counter", "Frames never received", udp_details.dropped_frames.get());
+            AppendMetric(output, "ctstraffic_udp_duplicate_frames", "counter", "Frames received more than once", udp_details.duplicate_frames.get());
+            AppendMetric(output, "ctstraffic_udp_error_frames", "counter", "Frames received with invalid data", udp_details.error_frames.get());
+            if (ctsConfig::IsListening()) {
+                AppendHistogram(output, "ctstraffic_udp_frame_scheduling_lateness_microseconds", "Delay past each frame's scheduled send time", ctsConfig::Settings->FrameSchedulingLatenessHistogram);
+                AppendHistogram(output, "ctstraffic_udp_datagram_gap_microseconds", "Gap between consecutive datagrams of each stream", ctsConfig::Settings->DatagramGapHistogram);
+            } else if (ctsConfig::GetMediaStream().ClockProbeIntervalMilliseconds > 0) {
+                AppendHistogram(output, "ctstraffic_udp_one_way_delay_microseconds", "Clock-corrected one-way delay of each datagram", ctsConfig::Settings->OneWayDelayHistogram);
+            }
+        }
+
+        AppendHistogram(output, "ctstraffic_connection_duration_milliseconds", "Lifetime of completed connections", ctsConfig::Settings->ConnectionTimeHistogram);
+
+        output.append("# EOF\n");
+        return output;
+    }
+
+    VOID NTAPI ctsMetricsServer::ThreadPoolWorker(PTP_CALLBACK_INSTANCE, PVOID _context, PTP_WORK) NOEXCEPT
+    {
+        ctsMetricsServer* this_ptr = reinterpret_cast<ctsMetricsServer*>(_context);
+        for (;;) {
+            SOCKET accepted_socket = ::accept(this_ptr->listening_socket, nullptr, nullptr);
+            if (INVALID_SOCKET == accepted_socket) {
+                auto gle = ::WSAGetLastError();
+                if (WSAECONNRESET == gle) {
+                    // the scraper went away before we accepted - keep listening
+                    continue;
+                }
+                // any other failure is expected to be from the d'tor closing the listener
+                if (!ctsConfig::ShutdownCalled() && gle != WSAENOTSOCK && gle != WSAEINTR) {
+                    ctsConfig::PrintErrorIfFailed(L"accept (ctsMetricsServer)", gle);
+                }
+                return;
+            }
+
+            ProcessRequest(accepted_socket);
+        }
+    }
+
+    void ctsMetricsServer::ProcessRequest(SOCKET _accepted_socket) NOEXCEPT
+    {
+        ctlScopeGuard(closeSocketOnExit, { ::closesocket(_accepted_socket); });
+
+        DWORD timeout = MetricsSocketTimeoutMilliseconds;
+        ::setsockopt(_accepted_socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), static_cast<int>(sizeof timeout));
+        ::setsockopt(_accepted_socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeout), static_cast<int>(sizeof timeout));
+
+        // only need the request line: read until the end of the headers or the buffer is full
+        char request[MetricsMaxRequestBytes + 1];
+        int request_length = 0;
+        while (request_length < MetricsMaxRequestBytes) {
+            int received = ::recv(_accepted_socket, request + request_length, MetricsMaxRequestBytes - request_length, 0);
+            if (received <= 0) {
+                break;
+            }
+            request_length += received;
+            request[request_length] = '\0';
+            if (::strstr(request, "\r\n\r\n") != nullptr) {
+                break;
+            }
+        }
+        request[request_length] = '\0';
+
+        try {
+            string response;
+            if (0 == ::strncmp(request, "GET / ", 6) || 0 == ::strncmp(request, "GET /metrics", 12)) {
+                string body(FormatMetrics());
+                response.append("HTTP/1.1 200 OK\r\n");
+                response.append("Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n");
+                response.append("Content-Length: ").append(to_string(body.length())).append("\r\n");
+                response.append("Connection: close\r\n\r\n");
+                response.append(body);
+            } else {
+                response.append("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            }
+
+            const char* send_buffer = response.c_str();
+            int bytes_remaining = static_cast<int>(response.length());
+            while (bytes_remaining > 0) {
+                int sent = ::send(_accepted_socket, send_buffer, bytes_remaining, 0);
+                if (sent <= 0) {
+                    break;
+                }
+                send_buffer += sent;
+                bytes_remaining -= sent;
+            }
+            ::shutdown(_accepted_socket, SD_SEND);
+        }
+        catch (const exception& e) {
+            ctsConfig::PrintException(e);
+        }
+    }
+
+} // namespace
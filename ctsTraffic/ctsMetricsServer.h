@@ -0,0 +1,61 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <string>
+// os headers
+#include <windows.h>
+#include <winsock2.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+
+
+namespace ctsTraffic {
+    //
+    // ctsMetricsServer
+    //
+    // Serves the live status counters as OpenMetrics text over HTTP (-MetricsPort)
+    // - all requests are processed on a long-running work item outside of the IO threadpool
+    //   so a slow (or stuck) scraper can never block IO
+    // - counters are only ever read through their interlocked accessors
+    //   (never snap_view), so scraping does not alter the time-slice status output
+    //
+    class ctsMetricsServer {
+    public:
+        // only the c'tor can throw
+        explicit ctsMetricsServer(unsigned short _port);
+        ~ctsMetricsServer() NOEXCEPT;
+
+        //
+        // Formats the current counters in the OpenMetrics text exposition format
+        // - exposed to enable validating the output without a socket
+        //
+        static std::string FormatMetrics();
+
+        // not copyable
+        ctsMetricsServer(const ctsMetricsServer&) = delete;
+        ctsMetricsServer& operator=(const ctsMetricsServer&) = delete;
+
+    private:
+        TP_CALLBACK_ENVIRON thread_pool_environment;
+        PTP_WORK thread_pool_worker;
+        // listening_socket is only closed from the d'tor to break the worker out of accept()
+        SOCKET listening_socket;
+
+        static VOID NTAPI ThreadPoolWorker(PTP_CALLBACK_INSTANCE, PVOID _context, PTP_WORK) NOEXCEPT;
+        static void ProcessRequest(SOCKET _accepted_socket) NOEXCEPT;
+    };
+
+} // namespace
@@ -386,6 +386,8 @@ namespace ctsTraffic {
                     L"* Dropped Frames - count of frames that were never seen within the TimeSlice\n"
                     L"* Repeated Frames - count of frames received multiple times within the TimeSlice\n"
                     L"* Stream Errors - count of invalid frames or buffers within the TimeSlice\n"
+                    L"* Allocated - cumulative count of per-connection objects newly allocated\n"
+                    L"* Recycled - cumulative count of per-connection objects reused from closed connections\n"
                     L"\n";
             } else {
                 return
@@ -397,6 +399,8 @@ namespace ctsTraffic {
                     L"* Dropped Frames - count of frames that were never seen within the TimeSlice\r\n"
                     L"* Repeated Frames - count of frames received multiple times within the TimeSlice\r\n"
                     L"* Stream Errors - count of invalid frames or buffers within the TimeSlice\r\n"
+                    L"* Allocated - cumulative count of per-connection objects newly allocated\r\n"
+                    L"* Recycled - cumulative count of per-connection objects reused from closed connections\r\n"
                     L"\r\n";
             }
         }
@@ -405,18 +409,18 @@ namespace ctsTraffic {
         {
             if (ctsConfig::StatusFormatting::Csv == _format) {
                 return
-                    L"TimeSlice,Streams,Bits/Sec,Completed,Dropped,Repeated,Errors\r\n";
+                    L"TimeSlice,Streams,Bits/Sec,Completed,Dropped,Repeated,Errors,Allocated,Recycled\r\n";
 
             } else if (ctsConfig::StatusFormatting::ConsoleOutput == _format) {
-                // Formatted to fit on an 80-column command shell
+                // The stream columns fit on an 80-column command shell: the connection object counts follow them
                 return
-                    L" TimeSlice       Bits/Sec    Streams   Completed   Dropped   Repeated    Errors \n";
-                   // 00000000.0...000000000000...00000000...000000000...0000000...00000000...0000000.        
-                   // 1   5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0 
-                   //         10        20        30        40        50        60        70        80
+                    L" TimeSlice       Bits/Sec    Streams   Completed   Dropped   Repeated    Errors  Allocated   Recycled \n";
+                   // 00000000.0...000000000000...00000000...000000000...0000000...00000000...0000000..000000000..000000000.
+                   // 1   5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0
+                   //         10        20        30        40        50        60        70        80        90       100
             } else {
                 return
-                    L" TimeSlice       Bits/Sec    Streams   Completed   Dropped   Repeated    Errors \r\n";
+                    L" TimeSlice       Bits/Sec    Streams   Completed   Dropped   Repeated    Errors  Allocated   Recycled \r\n";
             }
         }
 
@@ -440,7 +444,9 @@ namespace ctsTraffic {
                 characters_written += this->append_csvoutput(characters_written, CompetedFramesLength, udp_data.successful_frames.get());
                 characters_written += this->append_csvoutput(characters_written, DroppedFramesLength, udp_data.dropped_frames.get());
                 characters_written += this->append_csvoutput(characters_written, DuplicatedFramesLength, udp_data.duplicate_frames.get());
-                characters_written += this->append_csvoutput(characters_written, ErrorFramesLength, udp_data.error_frames.get(), false); // no comma at the end
+                characters_written += this->append_csvoutput(characters_written, ErrorFramesLength, udp_data.error_frames.get());
+                characters_written += this->append_csvoutput(characters_written, AllocatedObjectsLength, connection_data.allocated_object_count.get());
+                characters_written += this->append_csvoutput(characters_written, RecycledObjectsLength, connection_data.recycled_object_count.get(), false); // no comma at the end
                 this->terminate_file_string(characters_written);
 
             } else {
@@ -458,10 +464,12 @@ namespace ctsTraffic {
                 this->right_justify_output(DroppedFramesOffset, DroppedFramesLength, udp_data.dropped_frames.get());
                 this->right_justify_output(DuplicatedFramesOffset, DuplicatedFramesLength, udp_data.duplicate_frames.get());
                 this->right_justify_output(ErrorFramesOffset, ErrorFramesLength, udp_data.error_frames.get());
+                this->right_justify_output(AllocatedObjectsOffset, AllocatedObjectsLength, connection_data.allocated_object_count.get());
+                this->right_justify_output(RecycledObjectsOffset, RecycledObjectsLength, connection_data.recycled_object_count.get());
                 if (_format == ctsConfig::StatusFormatting::ConsoleOutput) {
-                    this->terminate_string(ErrorFramesOffset);
+                    this->terminate_string(RecycledObjectsOffset);
                 } else {
-                    this->terminate_file_string(ErrorFramesOffset);
+                    this->terminate_file_string(RecycledObjectsOffset);
                 }
             }
             return PrintingStatus::PrintComplete;
@@ -490,6 +498,12 @@ namespace ctsTraffic {
 
         static const unsigned long ErrorFramesOffset = 79;
         static const unsigned long ErrorFramesLength = 7;
+
+        static const unsigned long AllocatedObjectsOffset = 90;
+        static const unsigned long AllocatedObjectsLength = 9;
+
+        static const unsigned long RecycledObjectsOffset = 101;
+        static const unsigned long RecycledObjectsLength = 9;
     };
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -535,7 +549,9 @@ namespace ctsTraffic {
                 characters_written += this->append_csvoutput(characters_written, CurrentTransactionsLength, connection_data.active_connection_count.get());
                 characters_written += this->append_csvoutput(characters_written, CompletedTransactionsLength, connection_data.successful_completion_count.get());
                 characters_written += this->append_csvoutput(characters_written, ConnectionErrorsLength, connection_data.connection_error_count.get());
-                characters_written += this->append_csvoutput(characters_written, ProtocolErrorsLength, connection_data.protocol_error_count.get(), false); // no comma at the end
+                characters_written += this->append_csvoutput(characters_written, ProtocolErrorsLength, connection_data.protocol_error_count.get());
+                characters_written += this->append_csvoutput(characters_written, AllocatedObjectsLength, connection_data.allocated_object_count.get());
+                characters_written += this->append_csvoutput(characters_written, RecycledObjectsLength, connection_data.recycled_object_count.get(), false); // no comma at the end
                 this->terminate_file_string(characters_written);
 
             } else {
@@ -557,10 +573,12 @@ namespace ctsTraffic {
                 this->right_justify_output(CompletedTransactionsOffset, CompletedTransactionsLength, connection_data.successful_completion_count.get());
                 this->right_justify_output(ConnectionErrorsOffset, ConnectionErrorsLength, connection_data.connection_error_count.get());
                 this->right_justify_output(ProtocolErrorsOffset, ProtocolErrorsLength, connection_data.protocol_error_count.get());
+                this->right_justify_output(AllocatedObjectsOffset, AllocatedObjectsLength, connection_data.allocated_object_count.get());
+                this->right_justify_output(RecycledObjectsOffset, RecycledObjectsLength, connection_data.recycled_object_count.get());
                 if (_format == ctsConfig::StatusFormatting::ConsoleOutput) {
-                    this->terminate_string(ProtocolErrorsOffset);
+                    this->terminate_string(RecycledObjectsOffset);
                 } else {
-                    this->terminate_file_string(ProtocolErrorsOffset);
+                    this->terminate_file_string(RecycledObjectsOffset);
                 }
             }
 
@@ -578,6 +596,8 @@ namespace ctsTraffic {
                     L"* Completed - cumulative count of successfully completed IO patterns\n"
                     L"* Network Errors - cumulative count of failed IO patterns due to Winsock errors\n"
                     L"* Data Errors - cumulative count of failed IO patterns due to data errors\n"
+                    L"* Allocated - cumulative count of per-connection objects newly allocated\n"
+                    L"* Recycled - cumulative count of per-connection objects reused from closed connections\n"
                     L"\n";
             } else {
                 return
@@ -588,6 +608,8 @@ namespace ctsTraffic {
                     L"* Completed - cumulative count of successfully completed IO patterns\r\n"
                     L"* Network Errors - cumulative count of failed IO patterns due to Winsock errors\r\n"
                     L"* Data Errors - cumulative count of failed IO patterns due to data errors\r\n"
+                    L"* Allocated - cumulative count of per-connection objects newly allocated\r\n"
+                    L"* Recycled - cumulative count of per-connection objects reused from closed connections\r\n"
                     L"\r\n";
             }
         }
@@ -596,17 +618,17 @@ namespace ctsTraffic {
         {
             if (_format == ctsConfig::StatusFormatting::Csv) {
                 return
-                    L"TimeSlice,SendBps,RecvBps,In-Flight,Completed,NetError,DataError\r\n";
+                    L"TimeSlice,SendBps,RecvBps,In-Flight,Completed,NetError,DataError,Allocated,Recycled\r\n";
 
             } else if (_format == ctsConfig::StatusFormatting::ConsoleOutput) {
                 return
-                    L" TimeSlice      SendBps      RecvBps  In-Flight  Completed  NetError  DataError \n";
-                //    00000000.0..00000000000..00000000000....0000000....0000000...0000000....0000000.        
-                //    1   5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0 
-                //            10        20        30        40        50        60        70        80
+                    L" TimeSlice      SendBps      RecvBps  In-Flight  Completed  NetError  DataError  Allocated   Recycled \n";
+                //    00000000.0..00000000000..00000000000....0000000....0000000...0000000....0000000..000000000..000000000.
+                //    1   5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0    5    0
+                //            10        20        30        40        50        60        70        80        90       100
             } else {
                 return
-                    L" TimeSlice      SendBps      RecvBps  In-Flight  Completed  NetError  DataError \r\n";
+                    L" TimeSlice      SendBps      RecvBps  In-Flight  Completed  NetError  DataError  Allocated   Recycled \r\n";
             }
         }
 
@@ -633,6 +655,12 @@ namespace ctsTraffic {
         static const unsigned long ProtocolErrorsOffset = 79;
         static const unsigned long ProtocolErrorsLength = 7;
 
+        static const unsigned long AllocatedObjectsOffset = 90;
+        static const unsigned long AllocatedObjectsLength = 9;
+
+        static const unsigned long RecycledObjectsOffset = 101;
+        static const unsigned long RecycledObjectsLength = 9;
+
         static const unsigned long DetailedSentOffset = 23;
         static const unsigned long DetailedSentLength = 10;
 
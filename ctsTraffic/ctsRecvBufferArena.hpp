@@ -0,0 +1,273 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <vector>
+#include <exception>
+#include <utility>
+// os headers
+#include <Windows.h>
+#include <WinSock2.h>
+#include <MSWSock.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+#include <ctException.hpp>
+#include <ctLocks.hpp>
+#include <ctSocketExtensions.hpp>
+#include <ctString.hpp>
+// project headers
+#include "ctsBufferAllocation.hpp"
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// A process-wide arena of fixed-size receive buffers ("chunks") shared by all connections
+    /// - chunks are carved from a few large regions: with RIO each region is registered once, not each buffer
+    /// - a region is only added when no chunk is free anywhere in the arena
+    ///   so memory follows the peak number of receives in flight, not the number of connections
+    /// - each processor keeps a small cache of free chunks so check_out / check_in rarely take the arena lock
+    ///
+    /// Regions are never released while the arena exists: chunks from a region can be in flight on any connection
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsRecvBufferArena {
+    public:
+        // a chunk is described the same way an ctsIOTask describes its buffer
+        // - with RIO, buffer is the base of the registered region and buffer_offset locates the chunk within it
+        // - without RIO, buffer is the chunk itself and buffer_offset is zero
+        struct Chunk {
+            char* buffer;
+            unsigned long buffer_offset;
+            RIO_BUFFERID rio_bufferid;
+        };
+
+        static const unsigned long ProcessorCacheCapacity = 32;
+
+        //
+        // no regions are allocated until the first check_out
+        // - _large_page_size == 0 backs regions with regular pages
+        // - can throw std::bad_alloc
+        //
+        ctsRecvBufferArena(unsigned long _chunk_size, unsigned long _chunks_per_region, size_t _large_page_size, bool _register_rio) :
+            cs(),
+            processor_caches(ProcessorCacheCount()),
+            regions(),
+            region_ids(),
+            free_chunks(),
+            chunk_size(_chunk_size),
+            chunks_per_region(_chunks_per_region > 0 ? _chunks_per_region : 1),
+            large_page_size(_large_page_size),
+            register_rio(_register_rio),
+            total_chunks(0)
+        {
+            for (auto& cache : processor_caches) {
+                ::InitializeSRWLock(&cache.lock);
+                cache.count = 0;
+            }
+            if (!::InitializeCriticalSectionEx(&cs, 4000, 0)) {
+                throw ctl::ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsRecvBufferArena", false);
+            }
+        }
+
+        ~ctsRecvBufferArena() NOEXCEPT
+        {
+            for (const auto& region_id : region_ids) {
+                if (region_id != RIO_INVALID_BUFFERID) {
+                    ctl::ctRIODeregisterBuffer(region_id);
+                }
+            }
+            ::DeleteCriticalSection(&cs);
+        }
+
+        //
+        // fails fast if the arena must grow and a new region cannot be allocated (or registered with RIO)
+        // - the same as running out of memory for any other IO buffer in flight
+        //
+        Chunk check_out() NOEXCEPT
+        {
+            ProcessorCache& cache = this->current_cache();
+            ::AcquireSRWLockExclusive(&cache.lock);
+            if (0 == cache.count) {
+                this->refill(cache);
+            }
+            const Chunk chunk(cache.chunks[--cache.count]);
+            ::ReleaseSRWLockExclusive(&cache.lock);
+            return chunk;
+        }
+
+        void check_in(const Chunk& _chunk) NOEXCEPT
+        {
+            ProcessorCache& cache = this->current_cache();
+            ::AcquireSRWLockExclusive(&cache.lock);
+            if (ProcessorCacheCapacity == cache.count) {
+                this->flush(cache);
+            }
+            cache.chunks[cache.count++] = _chunk;
+            ::ReleaseSRWLockExclusive(&cache.lock);
+        }
+
+        // the address of the bytes described by _chunk
+        static char* chunk_address(const Chunk& _chunk) NOEXCEPT
+        {
+            return _chunk.buffer + _chunk.buffer_offset;
+        }
+
+        unsigned long chunk_bytes() const NOEXCEPT
+        {
+            return chunk_size;
+        }
+
+        unsigned long region_count() const NOEXCEPT
+        {
+            ctl::ctAutoReleaseCriticalSection lock(&this->cs);
+            return static_cast<unsigned long>(regions.size());
+        }
+
+        unsigned long chunk_count() const NOEXCEPT
+        {
+            ctl::ctAutoReleaseCriticalSection lock(&this->cs);
+            return total_chunks;
+        }
+
+        // not copyable
+        ctsRecvBufferArena(const ctsRecvBufferArena&) = delete;
+        ctsRecvBufferArena& operator=(const ctsRecvBufferArena&) = delete;
+
+    private:
+        struct ProcessorCache {
+            SRWLOCK lock;
+            unsigned long count;
+            Chunk chunks[ProcessorCacheCapacity];
+            // keep the next processor's lock off the cache line holding the tail of this cache
+            char padding[SYSTEM_CACHE_ALIGNMENT_SIZE];
+        };
+
+        mutable CRITICAL_SECTION cs;
+        std::vector<ProcessorCache> processor_caches;
+        _Guarded_by_(cs) std::vector<ctsBufferAllocation> regions;
+        _Guarded_by_(cs) std::vector<RIO_BUFFERID> region_ids;
+        // reserved to hold every chunk in the arena: pushing back a chunk never allocates
+        _Guarded_by_(cs) std::vector<Chunk> free_chunks;
+        const unsigned long chunk_size;
+        const unsigned long chunks_per_region;
+        const size_t large_page_size;
+        const bool register_rio;
+        _Guarded_by_(cs) unsigned long total_chunks;
+
+        static size_t ProcessorCacheCount() NOEXCEPT
+        {
+            const DWORD processor_count = ::GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+            return (processor_count > 0) ? processor_count : 1;
+        }
+
+        ProcessorCache& current_cache() NOEXCEPT
+        {
+            PROCESSOR_NUMBER processor;
+            ::GetCurrentProcessorNumberEx(&processor);
+            // processor groups hold at most 64 processors
+            const size_t processor_index = static_cast<size_t>(processor.Group) * 64 + processor.Number;
+            return processor_caches[processor_index % processor_caches.size()];
+        }
+
+        // moves half a cache worth of chunks into the empty _cache
+        void refill(ProcessorCache& _cache) NOEXCEPT
+        {
+            ctl::ctAutoReleaseCriticalSection lock(&this->cs);
+            if (free_chunks.empty()) {
+                this->reclaim_cached_chunks(_cache);
+            }
+            if (free_chunks.empty()) {
+                try {
+                    this->add_region();
+                }
+                catch (const std::exception& e) {
+                    ctl::ctAlwaysFatalCondition(L"ctsRecvBufferArena failed to add a region of receive buffers: %ws", ctl::ctString::format_exception(e).c_str());
+                }
+            }
+
+            while (_cache.count < ProcessorCacheCapacity / 2 && !free_chunks.empty()) {
+                _cache.chunks[_cache.count++] = free_chunks.back();
+                free_chunks.pop_back();
+            }
+        }
+
+        // moves half of the full _cache back to the arena
+        void flush(ProcessorCache& _cache) NOEXCEPT
+        {
+            ctl::ctAutoReleaseCriticalSection lock(&this->cs);
+            while (_cache.count > ProcessorCacheCapacity / 2) {
+                free_chunks.push_back(_cache.chunks[--_cache.count]);
+            }
+        }
+
+        // before growing, take back the chunks sitting idle in other processors' caches
+        // - only trying their locks: the caller holds _cache's lock and another processor may be waiting on the arena lock
+        _Requires_lock_held_(cs)
+        void reclaim_cached_chunks(const ProcessorCache& _cache) NOEXCEPT
+        {
+            for (auto& cache : processor_caches) {
+                if (&cache == &_cache) {
+                    continue;
+                }
+                if (::TryAcquireSRWLockExclusive(&cache.lock)) {
+                    while (cache.count > 0) {
+                        free_chunks.push_back(cache.chunks[--cache.count]);
+                    }
+                    ::ReleaseSRWLockExclusive(&cache.lock);
+                }
+            }
+        }
+
+        // can throw ctException or std::bad_alloc
+        _Requires_lock_held_(cs)
+        void add_region()
+        {
+            // reserve everything first: once the region is registered nothing below can fail
+            regions.reserve(regions.size() + 1);
+            region_ids.reserve(region_ids.size() + 1);
+            free_chunks.reserve(static_cast<size_t>(total_chunks) + chunks_per_region);
+
+            const size_t region_bytes = static_cast<size_t>(chunk_size) * chunks_per_region;
+            ctsBufferAllocation region(region_bytes, ctsBufferAllocation::CurrentNumaNode(), (region_bytes >= large_page_size) ? large_page_size : 0);
+
+            RIO_BUFFERID region_id = RIO_INVALID_BUFFERID;
+            if (register_rio) {
+                region_id = ctl::ctRIORegisterBuffer(region.get(), static_cast<DWORD>(region_bytes));
+                if (RIO_INVALID_BUFFERID == region_id) {
+                    throw ctl::ctException(::WSAGetLastError(), L"RIORegisterBuffer", L"ctsRecvBufferArena", false);
+                }
+            }
+
+            for (unsigned long chunk_index = 0; chunk_index < chunks_per_region; ++chunk_index) {
+                Chunk chunk;
+                if (register_rio) {
+                    chunk.buffer = region.get();
+                    chunk.buffer_offset = chunk_index * chunk_size;
+                } else {
+                    chunk.buffer = region.get() + static_cast<size_t>(chunk_index) * chunk_size;
+                    chunk.buffer_offset = 0;
+                }
+                chunk.rio_bufferid = region_id;
+                free_chunks.push_back(chunk);
+            }
+            total_chunks += chunks_per_region;
+            region_ids.push_back(region_id);
+            regions.push_back(std::move(region));
+        }
+    };
+
+} // namespace
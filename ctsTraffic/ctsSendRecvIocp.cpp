@@ -152,20 +152,20 @@ namespace ctsTraffic {
                     [weak_reference = std::weak_ptr<ctsSocket>(_shared_socket), next_io](OVERLAPPED* _ov)
                 { ctsIoCompletionCallback(_ov, weak_reference, next_io); });
 
-                WSABUF wsabuf;
-                wsabuf.buf = next_io.buffer + next_io.buffer_offset;
-                wsabuf.len = next_io.buffer_length;
+                // large transfers can be handed out as several segments, posted as one vectored IO
+                WSABUF wsabufs[ctsIOTask::MaxSegments];
+                const DWORD wsabuf_count = next_io.fill_wsabufs(wsabufs);
 
                 const wchar_t* function_name = nullptr;
                 if (IOTaskAction::Send == next_io.ioAction) {
                     function_name = L"WSASend";
-                    if (::WSASend(_socket, &wsabuf, 1, nullptr, 0, pov, nullptr) != 0) {
+                    if (::WSASend(_socket, wsabufs, wsabuf_count, nullptr, 0, pov, nullptr) != 0) {
                         return_status.io_errorcode = ::WSAGetLastError();
                     }
                 } else {
                     function_name = L"WSARecv";
                     DWORD flags = 0;
-                    if (::WSARecv(_socket, &wsabuf, 1, nullptr, &flags, pov, nullptr) != 0) {
+                    if (::WSARecv(_socket, wsabufs, wsabuf_count, nullptr, &flags, pov, nullptr) != 0) {
                         return_status.io_errorcode = ::WSAGetLastError();
                     }
                 }
@@ -0,0 +1,79 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+
+#pragma once
+
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// The number of bytes to keep posted in sends on a TCP connection, derived from its SIO_TCP_INFO details
+    ///
+    /// Used in place of the Ideal Send Backlog notifications with -PrePostSends:0 -SendBacklog:tcpinfo
+    /// - the stack can put min(cwnd, send window) bytes on the wire each round trip; keeping that many bytes
+    ///   posted means the stack never waits on the application for data to send
+    /// - the backlog is whole send buffers, never less than one, so a send is always outstanding
+    /// - while the congestion window is full it can still grow: one more buffer is kept ready for when it opens
+    /// - growth is taken immediately, shrinking moves half way per sample so one low sample doesn't starve sends
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class ctsSendWindowController {
+    public:
+        static unsigned long NextSendBacklog(
+            unsigned long _current_backlog,
+            unsigned long _buffer_size,
+            unsigned long _cwnd,
+            unsigned long _send_window,
+            unsigned long _mss,
+            unsigned long _bytes_in_flight) NOEXCEPT
+        {
+            if (0 == _buffer_size) {
+                return _current_backlog;
+            }
+
+            // a send window of 0 is not yet known (or the peer is zero-window probing): the cwnd still applies
+            unsigned long long wire_window = _cwnd;
+            if (_send_window != 0 && _send_window < wire_window) {
+                wire_window = _send_window;
+            }
+
+            unsigned long long target = wire_window;
+            if (_cwnd != 0 && static_cast<unsigned long long>(_bytes_in_flight) + _mss >= _cwnd) {
+                target += _buffer_size;
+            }
+
+            // round up to whole buffers
+            target = (target + _buffer_size - 1ULL) / _buffer_size * _buffer_size;
+            if (target < _buffer_size) {
+                target = _buffer_size;
+            }
+
+            if (target < _current_backlog) {
+                // the half way step is rounded down so that shrinking always reaches the target
+                const unsigned long long shrink_bytes = (static_cast<unsigned long long>(_current_backlog) - target) / 2ULL;
+                target += shrink_bytes / _buffer_size * _buffer_size;
+            }
+            if (target > MAXULONG32) {
+                target = static_cast<unsigned long long>(MAXULONG32) / _buffer_size * _buffer_size;
+            }
+            return static_cast<unsigned long>(target);
+        }
+    };
+}
@@ -0,0 +1,130 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <memory>
+#include <unordered_map>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+#include <ctScopeGuard.hpp>
+#include <ctSockaddr.hpp>
+
+
+namespace ctsTraffic {
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    ///
+    /// ctsSockaddrHashTable
+    /// - concurrent map of remote addresses to shared objects, for lookups on every scheduled IO
+    /// - the table is split into StripeCount independent hash tables, each guarded by its own SRWLOCK
+    ///   so lookups from different streams rarely touch the same lock (or cache line)
+    /// - keys are ctl::ctSockaddrKey objects, built once per call with their hash precomputed
+    ///   the high bits select the stripe, the low bits index within the stripe
+    ///
+    /// Objects are always released outside of a stripe lock, as their d'tors may need to wait on callbacks
+    ///
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    template <typename T>
+    class ctsSockaddrHashTable {
+    public:
+        // must be a power of 2
+        static const size_t StripeCount = 64;
+
+        ctsSockaddrHashTable() NOEXCEPT
+        {
+            for (auto& stripe : this->stripes) {
+                ::InitializeSRWLock(&stripe.lock);
+            }
+        }
+
+        ///
+        /// returns false if an object is already stored for this address: the existing object is kept
+        ///
+        bool insert(const ctl::ctSockaddr& _address, const std::shared_ptr<T>& _object)
+        {
+            const ctl::ctSockaddrKey key(_address);
+            Stripe& stripe = this->stripes[StripeIndex(key)];
+
+            ::AcquireSRWLockExclusive(&stripe.lock);
+            ctlScopeGuard(releaseLockOnExit, { ::ReleaseSRWLockExclusive(&stripe.lock); });
+            return stripe.table.emplace(key, _object).second;
+        }
+
+        ///
+        /// returns nullptr if no object is stored for this address
+        ///
+        std::shared_ptr<T> find(const ctl::ctSockaddr& _address) const NOEXCEPT
+        {
+            const ctl::ctSockaddrKey key(_address);
+            const Stripe& stripe = this->stripes[StripeIndex(key)];
+
+            ::AcquireSRWLockShared(&stripe.lock);
+            ctlScopeGuard(releaseLockOnExit, { ::ReleaseSRWLockShared(&stripe.lock); });
+            auto found_object = stripe.table.find(key);
+            return (found_object != stripe.table.end()) ? found_object->second : std::shared_ptr<T>();
+        }
+
+        ///
+        /// returns the removed object (nullptr if not found) so the caller controls where it is released
+        ///
+        std::shared_ptr<T> remove(const ctl::ctSockaddr& _address) NOEXCEPT
+        {
+            const ctl::ctSockaddrKey key(_address);
+            Stripe& stripe = this->stripes[StripeIndex(key)];
+
+            std::shared_ptr<T> removed_object;
+            ::AcquireSRWLockExclusive(&stripe.lock);
+            ctlScopeGuard(releaseLockOnExit, { ::ReleaseSRWLockExclusive(&stripe.lock); });
+            auto found_object = stripe.table.find(key);
+            if (found_object != stripe.table.end()) {
+                removed_object.swap(found_object->second);
+                stripe.table.erase(found_object);
+            }
+            return removed_object;
+        }
+
+        size_t size() const NOEXCEPT
+        {
+            size_t total = 0;
+            for (auto& stripe : this->stripes) {
+                ::AcquireSRWLockShared(&stripe.lock);
+                total += stripe.table.size();
+                ::ReleaseSRWLockShared(&stripe.lock);
+            }
+            return total;
+        }
+
+        /// non-copyable
+        ctsSockaddrHashTable(const ctsSockaddrHashTable&) = delete;
+        ctsSockaddrHashTable& operator=(const ctsSockaddrHashTable&) = delete;
+
+    private:
+        struct DECLSPEC_CACHEALIGN Stripe {
+            mutable SRWLOCK lock;
+            std::unordered_map<ctl::ctSockaddrKey, std::shared_ptr<T>> table;
+        };
+
+        Stripe stripes[StripeCount];
+
+        static size_t StripeIndex(const ctl::ctSockaddrKey& _key) NOEXCEPT
+        {
+            // the top bits: the low bits are consumed by the stripe's own buckets
+            return static_cast<size_t>(_key.hash() >> 58) & (StripeCount - 1);
+        }
+    };
+
+} // namespace
@@ -22,6 +22,9 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include "ctsConfig.h"
 #include "ctsSocketState.h"
 #include "ctsWinsockLayer.h"
+#include "ctsTcpInfoSampler.h"
+#include "ctsTimeSeriesSampler.h"
+#include "ctsTrace.h"
 
 
 namespace ctsTraffic {
@@ -32,10 +35,6 @@ namespace ctsTraffic {
     // default values are assigned in the class declaration
     ctsSocket::ctsSocket(weak_ptr<ctsSocketState> _parent) : parent(move(_parent))
     {
-        /// using a common spin count from base OS usage & crt usage
-        if (!::InitializeCriticalSectionEx(&this->socket_cs, 4000, 0)) {
-            throw ctl::ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsSocket", false);
-        }
     }
 
     _No_competing_thread_
@@ -50,25 +49,23 @@ namespace ctsTraffic {
         //   which causes the potential to AV in the io_pattern
         //   (a race-condition touching the io_pattern with deleting the io_pattern)
         this->pattern.reset();
-
-        ::DeleteCriticalSection(&this->socket_cs);
     }
 
     _Acquires_lock_(socket_cs)
     void ctsSocket::lock_socket() const NOEXCEPT
     {
-        ::EnterCriticalSection(&this->socket_cs);
+        this->socket_cs.lock();
     }
 
     _Releases_lock_(socket_cs)
     void ctsSocket::unlock_socket() const NOEXCEPT
     {
-        ::LeaveCriticalSection(&this->socket_cs);
+        this->socket_cs.unlock();
     }
 
     void ctsSocket::set_socket(SOCKET _socket) NOEXCEPT
     {
-        ctAutoReleaseCriticalSection auto_lock(&this->socket_cs);
+        ctsAutoReleaseConnectionLock auto_lock(this->socket_cs);
 
         ctl::ctFatalCondition(
             (this->socket != INVALID_SOCKET),
@@ -81,7 +78,7 @@ namespace ctsTraffic {
     int ctsSocket::close_socket(int _error_code) NOEXCEPT
     {
         int error = 0;
-        ctAutoReleaseCriticalSection auto_lock(&this->socket_cs);
+        ctsAutoReleaseConnectionLock auto_lock(this->socket_cs);
         if (this->socket != INVALID_SOCKET) {
             if (_error_code != 0) {
                 // always try to RST if we are closing due to an error
@@ -98,7 +95,7 @@ namespace ctsTraffic {
     const shared_ptr<ctThreadIocp>& ctsSocket::thread_pool()
     {
         // use the SOCKET cs to also guard creation of this TP object
-        ctAutoReleaseCriticalSection auto_lock(&this->socket_cs);
+        ctsAutoReleaseConnectionLock auto_lock(this->socket_cs);
 
         // must verify a valid socket first to avoid racing destrying the iocp shared_ptr as we try to create it here
         if ((this->socket != INVALID_SOCKET) && (!this->tp_iocp)) {
@@ -139,7 +136,11 @@ namespace ctsTraffic {
             this->pattern->register_callback(nullptr);
         }
 
-        auto ref_parent(this->parent.lock());
+        shared_ptr<ctsSocketState> ref_parent;
+        {
+            ctsAutoReleaseConnectionLock auto_lock(this->socket_cs);
+            ref_parent = this->parent.lock();
+        }
         if (ref_parent) {
             ref_parent->complete_state(recorded_error);
         }
@@ -173,11 +174,18 @@ namespace ctsTraffic {
     void ctsSocket::set_io_pattern(const std::shared_ptr<ctsIOPattern>& _pattern) NOEXCEPT
     {
         this->pattern = _pattern;
-        if (ctsConfig::Settings->PrePostSends == 0) {
+        if (ctsConfig::Settings->PrePostSends == 0 && !ctsConfig::Settings->SendBacklogFromTcpInfo) {
             // user didn't specify a specific # of sends to pend
             // start ISB notifications (best effort)
+            // - with -SendBacklog:tcpinfo the TCP info sampler sizes the send backlog instead
             this->initiate_isb_notification();
         }
+        if (ctsConfig::Settings->TcpInfoIntervalMilliseconds != 0 && ctsConfig::ProtocolType::TCP == ctsConfig::Settings->Protocol) {
+            ctsTcpInfoSampler::AddSocket(this->shared_from_this());
+        }
+        if (ctsConfig::Settings->TimeSeriesIntervalMilliseconds != 0) {
+            ctsTimeSeriesSampler::AddSocket(this->shared_from_this());
+        }
     }
 
     void ctsSocket::process_isb_notification()
@@ -294,6 +302,12 @@ namespace ctsTraffic {
         this->tp_timer.reset();
     }
 
+    void ctsSocket::detach_parent() NOEXCEPT
+    {
+        ctsAutoReleaseConnectionLock auto_lock(this->socket_cs);
+        this->parent.reset();
+    }
+
     ///
     /// SetTimer schedules the callback function to be invoked with the given ctsSocket and ctsIOTask
     /// - note that the timer 
@@ -301,14 +315,17 @@ namespace ctsTraffic {
     ///
     void ctsSocket::set_timer(const ctsIOTask& _task, function<void(weak_ptr<ctsSocket>, const ctsIOTask&)> _func)
     {
-        ctAutoReleaseCriticalSection auto_lock(&this->socket_cs);
+        ctsAutoReleaseConnectionLock auto_lock(this->socket_cs);
         if (!this->tp_timer) {
             this->tp_timer = make_shared<ctl::ctThreadpoolTimer>(ctsConfig::Settings->PTPEnvironment);
         }
         
         // register a weak pointer after creating a shared_ptr from the 'this' ptry
         this->tp_timer->schedule_singleton(
-            [_func = std::move(_func), weak_reference = this->shared_from_this(), _task] () { _func(weak_reference, _task); },
+            [_func = std::move(_func), weak_reference = this->shared_from_this(), _task] () {
+                ctsTracePoint("ctsSocket::TimerCallback", weak_reference.get(), "action", _task.ioAction, "delay_ms", _task.time_offset_milliseconds);
+                _func(weak_reference, _task);
+            },
             _task.time_offset_milliseconds);
     }
 
@@ -27,6 +27,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // project headers
 #include "ctsIOPattern.h"
 #include "ctsIOTask.hpp"
+#include "ctsLockPolicy.hpp"
 #include "ctsSocketGuard.hpp"
 
 
@@ -140,6 +141,9 @@ namespace ctsTraffic {
         //
         friend class ctsSocketState;
         void shutdown() NOEXCEPT;
+        // ctsSocketState calls detach_parent before it is reused for another connection
+        // - any callers still holding this ctsSocket can no longer complete states on the new connection
+        void detach_parent() NOEXCEPT;
 
         // ctsSocketGuard is given friend-access to call lock & unlock
         friend class ctsSocketGuard <std::shared_ptr<ctsSocket>>;
@@ -150,14 +154,14 @@ namespace ctsTraffic {
         void process_isb_notification();
 
         // private members for this socket instance
-        // mutable is requred to EnterCS/LeaveCS in const methods
+        // ctsConnectionLock can be taken in const methods
 
-        mutable CRITICAL_SECTION socket_cs;
+        ctsConnectionLock socket_cs;
         _Guarded_by_(socket_cs) SOCKET socket = INVALID_SOCKET;
         _Interlocked_ long io_count = 0L;
 
         // maintain a weak-reference to the parent and child
-        std::weak_ptr<ctsSocketState> parent;
+        _Guarded_by_(socket_cs) std::weak_ptr<ctsSocketState> parent;
         // maintain a shared_ptr to the pattern
         std::shared_ptr<ctsIOPattern> pattern;
 
@@ -32,6 +32,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // project headers
 #include "ctsConfig.h"
 #include "ctsSocketState.h"
+#include "ctsTrace.h"
 
 
 
@@ -44,6 +45,7 @@ namespace ctsTraffic {
         cs(),
         done_event(),
         socket_pool(),
+        recycled_socket_states(),
         wakeup_timer(new ctThreadpoolTimer()),
         total_connections_remaining(0),
         pending_limit(0),
@@ -93,6 +95,7 @@ namespace ctsTraffic {
         // - must do this explicitly before deleting the CS
         //   in case they were calling back while we called detach
         socket_pool.clear();
+        recycled_socket_states.clear();
 
         // now can delete the CS
         ::DeleteCriticalSection(&cs);
@@ -117,10 +120,7 @@ namespace ctsTraffic {
                 break;
             }
 
-            socket_pool.push_back(make_shared<ctsSocketState>(shared_from_this()));
-            (*this->socket_pool.rbegin())->start();
-            ++this->pending_sockets;
-            --this->total_connections_remaining;
+            this->start_next_socket();
         }
 
         // intiate the threadpool timer
@@ -129,6 +129,24 @@ namespace ctsTraffic {
             0LL,
             TimerCallbackTimeout);
     }
+
+    _Requires_lock_held_(cs)
+    void ctsSocketBroker::start_next_socket()
+    {
+        if (this->recycled_socket_states.empty()) {
+            this->socket_pool.push_back(make_shared<ctsSocketState>(this->shared_from_this()));
+            ctsConfig::Settings->ConnectionStatusDetails.allocated_object_count.increment();
+        } else {
+            // push_back before pop_back: if push_back throws, the recycled object is still kept
+            this->socket_pool.push_back(this->recycled_socket_states.back());
+            this->recycled_socket_states.pop_back();
+            ctsConfig::Settings->ConnectionStatusDetails.recycled_object_count.increment();
+        }
+        (*this->socket_pool.rbegin())->start();
+        ++this->pending_sockets;
+        --this->total_connections_remaining;
+    }
+
     //
     // SocketState is indicating the socket is now 'connected'
     // - and will be pumping IO
@@ -145,6 +163,7 @@ namespace ctsTraffic {
 
         --this->pending_sockets;
         ++this->active_sockets;
+        ctsTraceCounter("ctsSocketBroker", "pending", this->pending_sockets, "active", this->active_sockets);
     }
     //
     // SocketState is indicating the socket is now 'closed'
@@ -167,6 +186,7 @@ namespace ctsTraffic {
                 this->active_sockets);
             --this->pending_sockets;
         }
+        ctsTraceCounter("ctsSocketBroker", "pending", this->pending_sockets, "active", this->active_sockets);
     }
 
     bool ctsSocketBroker::wait(DWORD _milliseconds) NOEXCEPT
@@ -200,33 +220,61 @@ namespace ctsTraffic {
     //
     void ctsSocketBroker::TimerCallback(_In_ ctsSocketBroker* _broker) NOEXCEPT
     {
-        // removed_objects will delete the closed objects outside of the broker lock
+        // removed_objects will delete the closed objects not recycled outside of the broker lock
         vector<shared_ptr<ctsSocketState>> removed_objects;
         {
             if (!::TryEnterCriticalSection(&_broker->cs)) {
                 return;
             }
+            ctsTracePoint("ctsSocketBroker::TimerCallback", _broker, "pending", _broker->pending_sockets, "active", _broker->active_sockets);
 
-            // refresh our pool of sockets if more sockets should be added
             try {
-                //
-                // Everything must occur under the broker lock
-                // - touching the socket_pool
-                // - touching the socket / connection counters
-                //
                 for (auto& socket_pool_entry : _broker->socket_pool) {
                     if (ctsSocketState::InternalState::Closed == socket_pool_entry->current_state()) {
                         removed_objects.push_back(socket_pool_entry);
                         socket_pool_entry.reset();
                     }
                 }
+            }
+            catch (const exception&) {
+                // closed objects not yet moved out of socket_pool will be scavenged on the next timer
+            }
+
+            _broker->socket_pool.erase(
+                remove(
+                    begin(_broker->socket_pool),
+                    end(_broker->socket_pool),
+                    nullptr),
+                end(_broker->socket_pool));
 
-                _broker->socket_pool.erase(
-                    remove(
-                        begin(_broker->socket_pool),
-                        end(_broker->socket_pool),
-                        nullptr),
-                    end(_broker->socket_pool));
+            ::LeaveCriticalSection(&_broker->cs);
+        }
+
+        // reset must be called outside the broker lock
+        // - it waits for the object's TP callbacks, which call back into the broker
+        for (auto& removed_object : removed_objects) {
+            removed_object->reset();
+        }
+
+        {
+            ::EnterCriticalSection(&_broker->cs);
+
+            // refresh our pool of sockets if more sockets should be added
+            try {
+                //
+                // Everything must occur under the broker lock
+                // - touching the socket_pool
+                // - touching the socket / connection counters
+                //
+                // only keep what can be started again - the rest are deleted with removed_objects
+                ULONGLONG recycle_limit = _broker->pending_limit;
+                if (recycle_limit > _broker->total_connections_remaining) {
+                    recycle_limit = _broker->total_connections_remaining;
+                }
+                while (!removed_objects.empty() && _broker->recycled_socket_states.size() < recycle_limit) {
+                    _broker->recycled_socket_states.push_back(removed_objects.back());
+                    removed_objects.pop_back();
+                }
 
                 if (0 == _broker->total_connections_remaining &&
                     0 == _broker->pending_sockets &&
@@ -251,10 +299,7 @@ namespace ctsTraffic {
                                 }
                             }
 
-                            _broker->socket_pool.push_back(make_shared<ctsSocketState>(_broker->shared_from_this()));
-                            (*_broker->socket_pool.rbegin())->start();
-                            ++_broker->pending_sockets;
-                            --_broker->total_connections_remaining;
+                            _broker->start_next_socket();
                         }
                     }
                 }
@@ -262,6 +307,7 @@ namespace ctsTraffic {
             catch (const exception&) {
                 // if failed to create a socket will eventually reschedule
             }
+            ctsTraceCounter("ctsSocketBroker", "pending", _broker->pending_sockets, "active", _broker->active_sockets);
 
             ::LeaveCriticalSection(&_broker->cs);
         }
@@ -65,6 +65,9 @@ namespace ctsTraffic {
         // must be shared_ptr since ctsSocketState derives from enable_shared_from_this
         // - and thus there must be at least one refcount on that object to call shared_from_this()
         std::vector<std::shared_ptr<ctsSocketState>> socket_pool;
+        // closed ctsSocketState objects which were reset() to be started again for new connections
+        // - never holds more than can still be started: min(pending_limit, total_connections_remaining)
+        std::vector<std::shared_ptr<ctsSocketState>> recycled_socket_states;
         // timer to initiate the savenge routine TimerCallback()
         std::unique_ptr<ctl::ctThreadpoolTimer> wakeup_timer;
         // keep a burn-down count as connections are made to know when to be 'done'
@@ -79,6 +82,13 @@ namespace ctsTraffic {
         // - this allows destroying ctsSockets outside of an inline path from ctsSocket
         //
         static void TimerCallback(_In_ ctsSocketBroker* _broker) NOEXCEPT;
+
+        //
+        // Starts the next connection: reusing a recycled ctsSocketState when one is available
+        // - can throw std::bad_alloc or ctl::ctException when needing to allocate a new one
+        //
+        _Requires_lock_held_(cs)
+        void start_next_socket();
     };
 
 } // namespace
@@ -46,15 +46,9 @@ namespace ctsTraffic {
       state(InternalState::Creating),
       initiated_io(false)
     {
-        if (!::InitializeCriticalSectionEx(&state_guard, 4000, 0)) {
-            throw ctException(::GetLastError(), L"InitializeCriticalSectionEx", L"ctsSocketState", false);
-        }
-
         thread_pool_worker = ::CreateThreadpoolWork(ThreadPoolWorker, this, ctsConfig::Settings->PTPEnvironment);
         if (nullptr == thread_pool_worker) {
-            auto gle = ::GetLastError();
-            ::DeleteCriticalSection(&state_guard);
-            throw ctException(gle, L"CreateThreadpoolWork", L"ctsSocketState", false);
+            throw ctException(::GetLastError(), L"CreateThreadpoolWork", L"ctsSocketState", false);
         }
     }
 
@@ -74,8 +68,6 @@ namespace ctsTraffic {
 
         ::WaitForThreadpoolWorkCallbacks(thread_pool_worker, TRUE);
         ::CloseThreadpoolWork(thread_pool_worker);
-
-        ::DeleteCriticalSection(&state_guard);
     }
 
     void ctsSocketState::start() NOEXCEPT
@@ -86,13 +78,39 @@ namespace ctsTraffic {
         ::SubmitThreadpoolWork(this->thread_pool_worker);
     }
 
+    void ctsSocketState::reset() NOEXCEPT
+    {
+        ctFatalCondition(
+            this->current_state() != InternalState::Closed,
+            L"ctsSocketState::reset must only be called once the object is Closed (this == %p)", this);
+        //
+        // the same teardown as the d'tor, without closing the TP work item
+        // - the prior ctsSocket can outlive this call if a callback still holds a reference
+        //   so it must no longer be able to reach this object once it's reused
+        //
+        if (this->socket) {
+            this->socket->shutdown();
+        }
+        ::WaitForThreadpoolWorkCallbacks(this->thread_pool_worker, TRUE);
+
+        if (this->socket) {
+            this->socket->detach_parent();
+            this->socket.reset();
+        }
+
+        ctsAutoReleaseConnectionLock lock_state(this->state_guard);
+        this->last_error = 0UL;
+        this->state = InternalState::Creating;
+        this->initiated_io = false;
+    }
+
     void ctsSocketState::complete_state(DWORD _error) NOEXCEPT
     {
         bool initiating_io = false;
         //
         // must guard the entire switch statement with a state guard
         //
-        ::EnterCriticalSection(&this->state_guard);
+        this->state_guard.lock();
         if (NO_ERROR == _error) {
             switch (this->state) {
                 case InternalState::Created: {
@@ -152,7 +170,7 @@ namespace ctsTraffic {
         //
         // release the state lock now that transitions were performed
         //
-        ::LeaveCriticalSection(&this->state_guard);
+        this->state_guard.unlock();
         //
         // updates to ctsSocketBroker must be made outside the state_guard
         //
@@ -171,7 +189,7 @@ namespace ctsTraffic {
 
     ctsSocketState::InternalState ctsSocketState::current_state() const NOEXCEPT
     {
-        ctAutoReleaseCriticalSection lock_state(&this->state_guard);
+        ctsAutoReleaseConnectionLock lock_state(this->state_guard);
         return this->state;
     }
 
@@ -201,9 +219,9 @@ namespace ctsTraffic {
                     context->complete_state(error);
 
                 } else {
-                    ::EnterCriticalSection(&context->state_guard);
+                    context->state_guard.lock();
                     context->state = InternalState::Created;
-                    ::LeaveCriticalSection(&context->state_guard);
+                    context->state_guard.unlock();
 
                     ctsConfig::Settings->CreateFunction(context->socket);
                     PrintDebugInfo(L"\t\tctsSocketState Created\n");
@@ -212,9 +230,9 @@ namespace ctsTraffic {
             }
 
             case InternalState::Connecting: {
-                ::EnterCriticalSection(&context->state_guard);
+                context->state_guard.lock();
                 context->state = InternalState::Connected;
-                ::LeaveCriticalSection(&context->state_guard);
+                context->state_guard.unlock();
 
                 ctsConfig::Settings->ConnectFunction(context->socket);
                 PrintDebugInfo(L"\t\tctsSocketState Connected\n");
@@ -235,9 +253,9 @@ namespace ctsTraffic {
                     context->complete_state(error);
 
                 } else {
-                    ::EnterCriticalSection(&context->state_guard);
+                    context->state_guard.lock();
                     context->state = InternalState::InitiatedIO;
-                    ::LeaveCriticalSection(&context->state_guard);
+                    context->state_guard.unlock();
 
                     ctsConfig::Settings->IoFunction(context->socket);
                     PrintDebugInfo(L"\t\tctsSocketState InitiatedIO\n");
@@ -281,9 +299,9 @@ namespace ctsTraffic {
 
                 // update the state last, since ctsBroker looks for this state value
                 // - to know when to delete the ctsSocketState instance
-                ::EnterCriticalSection(&context->state_guard);
+                context->state_guard.lock();
                 context->state = InternalState::Closed;
-                ::LeaveCriticalSection(&context->state_guard);
+                context->state_guard.unlock();
 
                 auto parent = context->broker.lock();
                 if (parent) {
@@ -299,7 +317,7 @@ namespace ctsTraffic {
                 ctAlwaysFatalCondition(
                     L"ctsSocketState::ThreadPoolWorker - invalid socket state [%d]",
                     context->state);
-                ::LeaveCriticalSection(&context->state_guard);
+                context->state_guard.unlock();
                 break;
             }
         }
@@ -19,6 +19,8 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <Windows.h>
 // ctl headers
 #include <ctVersionConversion.hpp>
+// project headers
+#include "ctsLockPolicy.hpp"
 
 namespace ctsTraffic {
     //
@@ -67,6 +69,13 @@ namespace ctsTraffic {
         //
         void start() NOEXCEPT;
 
+        //
+        // Returns a Closed object to the Creating state so it can be start()'d for a new connection
+        // - keeps the threadpool work item and the CS, releasing the ctsSocket of the prior connection
+        // - must not be called from this object's own threadpool callback
+        //
+        void reset() NOEXCEPT;
+
         //
         // Completes the current socket state
         //
@@ -86,10 +95,10 @@ namespace ctsTraffic {
     private:
         //
         // private members of ctsSocketState
-        // - CS's are mutable to allow taking a CS in a const function
+        // - ctsConnectionLock can be taken in a const function
         //
         PTP_WORK                       thread_pool_worker;
-        mutable CRITICAL_SECTION       state_guard;
+        ctsConnectionLock              state_guard;
         std::weak_ptr<ctsSocketBroker> broker;
         std::shared_ptr<ctsSocket>     socket;
         unsigned long                  last_error;
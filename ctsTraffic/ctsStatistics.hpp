@@ -16,6 +16,8 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <wchar.h>
 #include <string.h>
 #include <memory.h>
+#include <vector>
+#include <exception>
 // os headers
 #include <Windows.h>
 #include <rpc.h>
@@ -24,6 +26,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 #include <ctTimer.hpp>
 #include <ctLocks.hpp>
 #include <ctException.hpp>
+#include <ctScopeGuard.hpp>
 
 namespace ctsTraffic
 {
@@ -178,6 +181,159 @@ namespace ctsTraffic
     };
 
 
+    //
+    // ctsHistogramStatistics tracks the distribution of a value across a fixed set of buckets
+    // - each bucket is an interlocked counter so add_value() never takes a lock
+    // - bucket counts are stored per-bucket (not cumulative): consumers accumulate when reporting
+    // - the final bucket has no upper bound
+    //
+    struct ctsHistogramStatistics {
+    private:
+        ctsHistogramStatistics(const ctsHistogramStatistics&) = delete;
+        ctsHistogramStatistics& operator=(const ctsHistogramStatistics&) = delete;
+
+    public:
+        static const unsigned long BucketCount = 12;
+
+        ctsHistogramStatistics() NOEXCEPT :
+            bucket_counts(),
+            sample_sum(0LL),
+            sample_count(0LL)
+        {
+        }
+
+        //
+        // returns the inclusive upper bound of the bucket
+        // - the last bucket returns MAXLONGLONG (+Inf)
+        //
+        static long long bucket_bound(unsigned long _bucket) NOEXCEPT
+        {
+            static const long long BucketBounds[BucketCount] = {
+                1LL, 5LL, 10LL, 50LL, 100LL, 500LL, 1000LL, 5000LL, 10000LL, 60000LL, 300000LL, MAXLONGLONG
+            };
+            return (_bucket < BucketCount) ? BucketBounds[_bucket] : MAXLONGLONG;
+        }
+
+        void add_value(long long _value) NOEXCEPT
+        {
+            unsigned long bucket = 0;
+            while (bucket < BucketCount - 1 && _value > bucket_bound(bucket)) {
+                ++bucket;
+            }
+            ctl::ctMemoryGuardIncrement(&this->bucket_counts[bucket]);
+            ctl::ctMemoryGuardAdd(&this->sample_sum, _value);
+            ctl::ctMemoryGuardIncrement(&this->sample_count);
+        }
+
+        long long bucket_value(unsigned long _bucket) const NOEXCEPT
+        {
+            return (_bucket < BucketCount) ? ctl::ctMemoryGuardRead(&this->bucket_counts[_bucket]) : 0LL;
+        }
+        long long sum() const NOEXCEPT
+        {
+            return ctl::ctMemoryGuardRead(&this->sample_sum);
+        }
+        long long count() const NOEXCEPT
+        {
+            return ctl::ctMemoryGuardRead(&this->sample_count);
+        }
+
+    private:
+        long long bucket_counts[BucketCount];
+        long long sample_sum;
+        long long sample_count;
+    };
+
+
+    //
+    // a single reading of transport details from the TCP stack
+    //
+    struct ctsTcpInfoSample {
+        long long sample_time = 0LL;          // milliseconds (QPC)
+        long long rtt_us = 0LL;               // smoothed RTT
+        long long min_rtt_us = 0LL;           // minimum RTT seen by the stack
+        long long cwnd_bytes = 0LL;
+        long long delivered_bytes = 0LL;      // bytes sent and no longer in flight
+        long long bytes_retransmitted = 0LL;
+        long long retransmits = 0LL;          // fast retransmits + retransmission timeouts
+    };
+
+    //
+    // ctsTcpInfoStatistics tracks the transport details of a single TCP connection
+    // - updated only by the sampler (one writer at a time), read through interlocked reads
+    // - RTT min/avg/max are across all samples; cwnd and retransmits are the latest values
+    // - the delivery rate is measured between the last two samples
+    //
+    struct ctsTcpInfoStatistics {
+    private:
+        ctsTcpInfoStatistics& operator=(const ctsTcpInfoStatistics&) = delete;
+
+    public:
+        ctStatsTracking sample_count;
+        ctStatsTracking rtt_min_us;
+        ctStatsTracking rtt_max_us;
+        ctStatsTracking rtt_sum_us;
+        ctStatsTracking cwnd_bytes;
+        ctStatsTracking bytes_retransmitted;
+        ctStatsTracking retransmits;
+        ctStatsTracking delivery_rate;
+        ctStatsTracking last_sample_time;
+        ctStatsTracking last_delivered_bytes;
+
+        ctsTcpInfoStatistics() NOEXCEPT
+        {
+        }
+        ctsTcpInfoStatistics(const ctsTcpInfoStatistics& _in) NOEXCEPT :
+            sample_count(_in.sample_count),
+            rtt_min_us(_in.rtt_min_us),
+            rtt_max_us(_in.rtt_max_us),
+            rtt_sum_us(_in.rtt_sum_us),
+            cwnd_bytes(_in.cwnd_bytes),
+            bytes_retransmitted(_in.bytes_retransmitted),
+            retransmits(_in.retransmits),
+            delivery_rate(_in.delivery_rate),
+            last_sample_time(_in.last_sample_time),
+            last_delivered_bytes(_in.last_delivered_bytes)
+        {
+        }
+
+        void add_sample(const ctsTcpInfoSample& _sample) NOEXCEPT
+        {
+            if (0LL == this->sample_count.get()) {
+                this->rtt_min_us.set(_sample.min_rtt_us);
+                this->rtt_max_us.set(_sample.rtt_us);
+            } else {
+                if (_sample.min_rtt_us < this->rtt_min_us.get()) {
+                    this->rtt_min_us.set(_sample.min_rtt_us);
+                }
+                if (_sample.rtt_us > this->rtt_max_us.get()) {
+                    this->rtt_max_us.set(_sample.rtt_us);
+                }
+            }
+            this->rtt_sum_us.add(_sample.rtt_us);
+            this->cwnd_bytes.set(_sample.cwnd_bytes);
+            this->bytes_retransmitted.set(_sample.bytes_retransmitted);
+            this->retransmits.set(_sample.retransmits);
+
+            const long long prior_time = this->last_sample_time.get();
+            const long long prior_delivered = this->last_delivered_bytes.get();
+            if (prior_time != 0LL && _sample.sample_time > prior_time && _sample.delivered_bytes >= prior_delivered) {
+                this->delivery_rate.set((_sample.delivered_bytes - prior_delivered) * 1000LL / (_sample.sample_time - prior_time));
+            }
+            this->last_sample_time.set(_sample.sample_time);
+            this->last_delivered_bytes.set(_sample.delivered_bytes);
+
+            // incrementing last so readers never see a count without its values
+            this->sample_count.increment();
+        }
+
+        long long rtt_avg_us() const NOEXCEPT
+        {
+            const long long count = this->sample_count.get();
+            return (count > 0LL) ? this->rtt_sum_us.get() / count : 0LL;
+        }
+    };
+
     struct ctsConnectionStatistics {
     private:
         // not implementing the assignment operator
@@ -191,6 +347,9 @@ namespace ctsTraffic
         ctStatsTracking successful_completion_count;
         ctStatsTracking connection_error_count;
         ctStatsTracking protocol_error_count;
+        // per-connection objects (socket states, recv buffers) newly allocated vs. reused from a closed connection
+        ctStatsTracking allocated_object_count;
+        ctStatsTracking recycled_object_count;
 
         explicit ctsConnectionStatistics(long long _start_time = 0LL) NOEXCEPT :
             start_time(_start_time),
@@ -198,7 +357,9 @@ namespace ctsTraffic
             active_connection_count(0LL),
             successful_completion_count(0LL),
             connection_error_count(0LL),
-            protocol_error_count(0LL)
+            protocol_error_count(0LL),
+            allocated_object_count(0LL),
+            recycled_object_count(0LL)
         {
         }
         //
@@ -210,7 +371,9 @@ namespace ctsTraffic
             active_connection_count(_in.active_connection_count),
             successful_completion_count(_in.successful_completion_count),
             connection_error_count(_in.connection_error_count),
-            protocol_error_count(_in.protocol_error_count)
+            protocol_error_count(_in.protocol_error_count),
+            allocated_object_count(_in.allocated_object_count),
+            recycled_object_count(_in.recycled_object_count)
         {
         }
         //
@@ -234,6 +397,8 @@ namespace ctsTraffic
             return_stats.successful_completion_count.set(this->successful_completion_count.get());
             return_stats.connection_error_count.set(this->connection_error_count.get());
             return_stats.protocol_error_count.set(this->protocol_error_count.get());
+            return_stats.allocated_object_count.set(this->allocated_object_count.get());
+            return_stats.recycled_object_count.set(this->recycled_object_count.get());
 
             return return_stats;
         }
@@ -251,6 +416,21 @@ namespace ctsTraffic
         ctStatsTracking dropped_frames;
         ctStatsTracking duplicate_frames;
         ctStatsTracking error_frames;
+        // playout details (-PlayoutBuffer:adaptive)
+        ctStatsTracking rebuffer_count;
+        ctStatsTracking buffering_milliseconds;
+        // sum of the playout delay of every processed frame: see playout_delay_milliseconds()
+        ctStatsTracking playout_delay_total;
+        // forward error correction details (-FecFrames)
+        ctStatsTracking recovered_frames;
+        ctStatsTracking unrecoverable_frames;
+        ctStatsTracking parity_bits;
+        // one-way delay details (-ClockProbeInterval): microseconds, set once as each stream is printed
+        ctStatsTracking delay_p50_microseconds;
+        ctStatsTracking delay_p95_microseconds;
+        ctStatsTracking delay_p99_microseconds;
+        ctStatsTracking delay_jitter_microseconds;
+        ctStatsTracking clock_skew_ppb;
         // unique connection identifier
         char connection_identifier[ctsStatistics::ConnectionIdLength];
 
@@ -261,7 +441,18 @@ namespace ctsTraffic
             successful_frames(0LL),
             dropped_frames(0LL),
             duplicate_frames(0LL),
-            error_frames(0LL)
+            error_frames(0LL),
+            rebuffer_count(0LL),
+            buffering_milliseconds(0LL),
+            playout_delay_total(0LL),
+            recovered_frames(0LL),
+            unrecoverable_frames(0LL),
+            parity_bits(0LL),
+            delay_p50_microseconds(0LL),
+            delay_p95_microseconds(0LL),
+            delay_p99_microseconds(0LL),
+            delay_jitter_microseconds(0LL),
+            clock_skew_ppb(0LL)
         {
             connection_identifier[0] = '\0';
         }
@@ -275,7 +466,18 @@ namespace ctsTraffic
             successful_frames(_in.successful_frames),
             dropped_frames(_in.dropped_frames),
             duplicate_frames(_in.duplicate_frames),
-            error_frames(_in.error_frames)
+            error_frames(_in.error_frames),
+            rebuffer_count(_in.rebuffer_count),
+            buffering_milliseconds(_in.buffering_milliseconds),
+            playout_delay_total(_in.playout_delay_total),
+            recovered_frames(_in.recovered_frames),
+            unrecoverable_frames(_in.unrecoverable_frames),
+            parity_bits(_in.parity_bits),
+            delay_p50_microseconds(_in.delay_p50_microseconds),
+            delay_p95_microseconds(_in.delay_p95_microseconds),
+            delay_p99_microseconds(_in.delay_p99_microseconds),
+            delay_jitter_microseconds(_in.delay_jitter_microseconds),
+            clock_skew_ppb(_in.clock_skew_ppb)
         {
             // not needing to guard this string: it's created exactly once
             ::memcpy_s(connection_identifier, ctsStatistics::ConnectionIdLength, _in.connection_identifier, ctsStatistics::ConnectionIdLength);
@@ -287,6 +489,22 @@ namespace ctsTraffic
             return this->bits_received.get() / 8;
         }
 
+        //
+        // the average time between a frame's expected arrival and when it was processed
+        //
+        long long playout_delay_milliseconds() const NOEXCEPT
+        {
+            const long long processed_frames = this->successful_frames.get() + this->dropped_frames.get();
+            return (processed_frames > 0LL) ? this->playout_delay_total.get() / processed_frames : 0LL;
+        }
+
+        //
+        // no transport details are tracked for UDP
+        //
+        void record_tcp_info(const ctsTcpInfoSample&) NOEXCEPT
+        {
+        }
+
         //
         // snap-view will set the returned start time == last read time to capture the delta
         //
@@ -305,14 +523,26 @@ namespace ctsTraffic
                 return_stats.successful_frames.set(this->successful_frames.snap_value_difference());
                 return_stats.dropped_frames.set(this->dropped_frames.snap_value_difference());
                 return_stats.duplicate_frames.set(this->duplicate_frames.snap_value_difference());
-                return_stats.error_frames.set(this->duplicate_frames.snap_value_difference());
+                return_stats.error_frames.set(this->error_frames.snap_value_difference());
+                return_stats.rebuffer_count.set(this->rebuffer_count.snap_value_difference());
+                return_stats.buffering_milliseconds.set(this->buffering_milliseconds.snap_value_difference());
+                return_stats.playout_delay_total.set(this->playout_delay_total.snap_value_difference());
+                return_stats.recovered_frames.set(this->recovered_frames.snap_value_difference());
+                return_stats.unrecoverable_frames.set(this->unrecoverable_frames.snap_value_difference());
+                return_stats.parity_bits.set(this->parity_bits.snap_value_difference());
 
             } else {
                 return_stats.bits_received.set(this->bits_received.read_value_difference());
                 return_stats.successful_frames.set(this->successful_frames.read_value_difference());
                 return_stats.dropped_frames.set(this->dropped_frames.read_value_difference());
                 return_stats.duplicate_frames.set(this->duplicate_frames.read_value_difference());
-                return_stats.error_frames.set(this->duplicate_frames.read_value_difference());
+                return_stats.error_frames.set(this->error_frames.read_value_difference());
+                return_stats.rebuffer_count.set(this->rebuffer_count.read_value_difference());
+                return_stats.buffering_milliseconds.set(this->buffering_milliseconds.read_value_difference());
+                return_stats.playout_delay_total.set(this->playout_delay_total.read_value_difference());
+                return_stats.recovered_frames.set(this->recovered_frames.read_value_difference());
+                return_stats.unrecoverable_frames.set(this->unrecoverable_frames.read_value_difference());
+                return_stats.parity_bits.set(this->parity_bits.read_value_difference());
             }
 
             return return_stats;
@@ -328,6 +558,8 @@ namespace ctsTraffic
         ctStatsTracking end_time;
         ctStatsTracking bytes_sent;
         ctStatsTracking bytes_recv;
+        // optional transport details (-TcpInfoInterval)
+        ctsTcpInfoStatistics tcp_info;
         // unique connection identifier
         char connection_identifier[ctsStatistics::ConnectionIdLength];
 
@@ -335,7 +567,8 @@ namespace ctsTraffic
             start_time(_current_time),
             end_time(0LL),
             bytes_sent(0LL),
-            bytes_recv(0LL)
+            bytes_recv(0LL),
+            tcp_info()
         {
             static const char * NULL_GUID_STRING = "00000000-0000-0000-0000-000000000000";
             ::strcpy_s(
@@ -349,7 +582,8 @@ namespace ctsTraffic
             start_time(_in.start_time),
             end_time(_in.end_time),
             bytes_sent(_in.bytes_sent),
-            bytes_recv(_in.bytes_recv)
+            bytes_recv(_in.bytes_recv),
+            tcp_info(_in.tcp_info)
         {
             // not needing to guard this string: it's created exactly once
             ::memcpy_s(connection_identifier, ctsStatistics::ConnectionIdLength, _in.connection_identifier, ctsStatistics::ConnectionIdLength);
@@ -361,6 +595,11 @@ namespace ctsTraffic
             return this->bytes_recv.get() + this->bytes_sent.get();
         }
 
+        void record_tcp_info(const ctsTcpInfoSample& _sample) NOEXCEPT
+        {
+            this->tcp_info.add_sample(_sample);
+        }
+
         //
         // snap-view will set the returned start time == last read time to capture the delta
         // - and end time == current time
@@ -387,4 +626,200 @@ namespace ctsTraffic
             return return_stats;
         }
     };
+
+    //
+    // ctsTimeSeries records a single connection's counters at a fixed interval
+    // - storage is reserved up front, from a byte budget shared by all connections (the global memory cap)
+    // - when full, the older half is downsampled 2:1 to make room for new samples
+    //   since all counters are cumulative, dropping samples loses resolution but never totals
+    // - every connection is given at least MinimumCapacity samples, even once the budget is spent
+    //   the budget then goes negative, and each series which holds more than MinimumCapacity samples
+    //   gives back half its storage at its next sample (halving its samples and doubling its interval)
+    //   until the budget is whole again
+    // - not thread-safe: the owner must serialize all calls
+    //
+    class ctsTimeSeries {
+    public:
+        static const unsigned long CounterCount = 3;
+        static const unsigned long DefaultCapacity = 1024;
+        // every series reserves at least this many samples - and never gives back storage below it
+        static const unsigned long MinimumCapacity = 8;
+
+        struct Sample {
+            // milliseconds since the connection started
+            long long time_offset;
+            long long counters[CounterCount];
+        };
+
+        //
+        // TCP: bytes sent, bytes received
+        // UDP: bits received, successful frames, dropped frames
+        //
+        static void SnapCounters(const ctsTcpStatistics& _stats, long long(&_counters)[CounterCount]) NOEXCEPT
+        {
+            _counters[0] = _stats.bytes_sent.get();
+            _counters[1] = _stats.bytes_recv.get();
+            _counters[2] = 0LL;
+        }
+        static void SnapCounters(const ctsUdpStatistics& _stats, long long(&_counters)[CounterCount]) NOEXCEPT
+        {
+            _counters[0] = _stats.bits_received.get();
+            _counters[1] = _stats.successful_frames.get();
+            _counters[2] = _stats.dropped_frames.get();
+        }
+
+        //
+        // reserves up to _requested_capacity samples from _memory_remaining
+        // - if the budget cannot cover MinimumCapacity samples, MinimumCapacity is reserved regardless
+        //   and the series already holding more give back storage to cover it
+        //
+        ctsTimeSeries(long long _interval, unsigned long _requested_capacity, ctStatsTracking& _memory_remaining) :
+            memory_remaining(_memory_remaining),
+            samples(),
+            sample_count(0),
+            interval(_interval),
+            next_sample_time(0LL)
+        {
+            unsigned long granted = 0;
+            long long remaining = _memory_remaining.get();
+            for (;;) {
+                const long long affordable = (remaining > 0LL) ? remaining / static_cast<long long>(sizeof(Sample)) : 0LL;
+                granted = (affordable < _requested_capacity) ? static_cast<unsigned long>(affordable) : _requested_capacity;
+                if (granted < MinimumCapacity) {
+                    granted = (_requested_capacity < MinimumCapacity) ? _requested_capacity : MinimumCapacity;
+                }
+                const long long reserved_bytes = static_cast<long long>(granted) * static_cast<long long>(sizeof(Sample));
+                const long long prior_remaining = _memory_remaining.set_conditionally(remaining - reserved_bytes, remaining);
+                if (prior_remaining == remaining) {
+                    break;
+                }
+                remaining = prior_remaining;
+            }
+
+            if (granted > 0) {
+                const long long reserved_bytes = static_cast<long long>(granted) * static_cast<long long>(sizeof(Sample));
+                ctlScopeGuard(returnReservationOnError, { _memory_remaining.add(reserved_bytes); });
+                this->samples.resize(granted);
+                returnReservationOnError.dismiss();
+            }
+        }
+        ~ctsTimeSeries() NOEXCEPT
+        {
+            this->memory_remaining.add(static_cast<long long>(this->samples.size()) * static_cast<long long>(sizeof(Sample)));
+        }
+
+        bool sample_due(long long _current_time) const NOEXCEPT
+        {
+            return !this->samples.empty() && _current_time >= this->next_sample_time;
+        }
+
+        void add_sample(long long _current_time, long long _time_offset, const long long(&_counters)[CounterCount]) NOEXCEPT
+        {
+            if (this->samples.empty()) {
+                return;
+            }
+            if (this->memory_remaining.get() < 0LL && this->samples.size() > MinimumCapacity) {
+                this->give_back_storage();
+            }
+            if (this->sample_count == this->samples.size()) {
+                this->downsample();
+            }
+
+            Sample& new_sample = this->samples[this->sample_count];
+            new_sample.time_offset = _time_offset;
+            for (unsigned long counter = 0; counter < CounterCount; ++counter) {
+                new_sample.counters[counter] = _counters[counter];
+            }
+            ++this->sample_count;
+            this->next_sample_time = _current_time + this->interval;
+        }
+
+        size_t size() const NOEXCEPT
+        {
+            return this->sample_count;
+        }
+        size_t capacity() const NOEXCEPT
+        {
+            return this->samples.size();
+        }
+        long long sample_interval() const NOEXCEPT
+        {
+            return this->interval;
+        }
+        const Sample& operator[](size_t _index) const NOEXCEPT
+        {
+            ctl::ctFatalCondition(
+                _index >= this->sample_count,
+                L"ctsTimeSeries: index (%Iu) is beyond the number of samples (%Iu)", _index, this->sample_count);
+            return this->samples[_index];
+        }
+
+        // not copyable
+        ctsTimeSeries(const ctsTimeSeries&) = delete;
+        ctsTimeSeries& operator=(const ctsTimeSeries&) = delete;
+
+    private:
+        ctStatsTracking& memory_remaining;
+        std::vector<Sample> samples;
+        size_t sample_count;
+        long long interval;
+        long long next_sample_time;
+
+        //
+        // keeps the later sample of each pair across the older half (plus an unpaired last one)
+        // - the newer half keeps full resolution
+        // - repeated calls leave the oldest samples progressively more sparse
+        //
+        void downsample() NOEXCEPT
+        {
+            const size_t older_count = this->sample_count / 2;
+            size_t write_index = 0;
+            for (size_t read_index = 1; read_index < older_count; read_index += 2) {
+                this->samples[write_index++] = this->samples[read_index];
+            }
+            if (older_count % 2 != 0) {
+                this->samples[write_index++] = this->samples[older_count - 1];
+            }
+            for (size_t read_index = older_count; read_index < this->sample_count; ++read_index) {
+                this->samples[write_index++] = this->samples[read_index];
+            }
+            this->sample_count = write_index;
+        }
+
+        //
+        // halves the storage held by this series, returning it to the shared budget
+        // - keeps the later sample of each pair (plus an unpaired last one) across all samples
+        //   and doubles the interval, so the series keeps covering the connection's lifetime evenly
+        //
+        void give_back_storage() NOEXCEPT
+        {
+            size_t new_capacity = (this->samples.size() + 1) / 2;
+            if (new_capacity < MinimumCapacity) {
+                new_capacity = MinimumCapacity;
+            }
+
+            std::vector<Sample> new_samples;
+            try {
+                new_samples.resize(new_capacity);
+            }
+            catch (const std::exception&) {
+                // keeping the current storage - tried again with the next sample
+                return;
+            }
+
+            size_t write_index = 0;
+            for (size_t read_index = 1; read_index < this->sample_count; read_index += 2) {
+                new_samples[write_index++] = this->samples[read_index];
+            }
+            if (this->sample_count % 2 != 0) {
+                new_samples[write_index++] = this->samples[this->sample_count - 1];
+            }
+
+            const long long released_bytes = static_cast<long long>(this->samples.size() - new_capacity) * static_cast<long long>(sizeof(Sample));
+            this->samples.swap(new_samples);
+            this->sample_count = write_index;
+            this->interval *= 2;
+            this->memory_remaining.add(released_bytes);
+        }
+    };
 }
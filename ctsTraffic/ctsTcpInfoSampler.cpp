@@ -0,0 +1,224 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// parent header
+#include "ctsTcpInfoSampler.h"
+
+// cpp headers
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <exception>
+// os headers
+#include <windows.h>
+#include <winsock2.h>
+#include <mstcpip.h>
+// ctl headers
+#include <ctTimer.hpp>
+#include <ctThreadPoolTimer.hpp>
+#include <ctScopeGuard.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsSocketGuard.hpp"
+#include "ctsIOPattern.h"
+#include "ctsSendWindowController.hpp"
+#include "ctsStatistics.hpp"
+#include "ctsTrace.h"
+
+
+namespace ctsTraffic {
+
+    using namespace ctl;
+    using namespace std;
+
+    // statically initialized: sockets can be added while the sampler is being created or destroyed
+    static SRWLOCK s_SamplerLock = SRWLOCK_INIT;
+    // sockets added since the last batch - moved into sweep_sockets by the timer callback
+    _Guarded_by_(s_SamplerLock) static vector<weak_ptr<ctsSocket>> s_AddedSockets;
+    _Guarded_by_(s_SamplerLock) static bool s_SamplerRunning = false;
+    // only reporting once that SIO_TCP_INFO is not supported (before Windows 10 1703)
+    static long s_ReportedUnsupported = 0L;
+
+    ctsTcpInfoSampler::ctsTcpInfoSampler(unsigned long _interval) :
+        base_interval(_interval),
+        sweep_sockets(),
+        timer(new ctThreadpoolTimer())
+    {
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        s_SamplerRunning = true;
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+        ctlScopeGuard(stopRunningOnError, {
+            ::AcquireSRWLockExclusive(&s_SamplerLock);
+            s_SamplerRunning = false;
+            ::ReleaseSRWLockExclusive(&s_SamplerLock); });
+
+        this->timer->schedule_singleton([this] () { this->sweep(); }, this->base_interval);
+
+        stopRunningOnError.dismiss();
+    }
+
+    ctsTcpInfoSampler::~ctsTcpInfoSampler() NOEXCEPT
+    {
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        s_SamplerRunning = false;
+        s_AddedSockets.clear();
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+
+        // waits for a running batch before the other members are destroyed
+        this->timer.reset();
+    }
+
+    void ctsTcpInfoSampler::AddSocket(const weak_ptr<ctsSocket>& _weak_socket) NOEXCEPT
+    {
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        try {
+            if (s_SamplerRunning) {
+                s_AddedSockets.push_back(_weak_socket);
+            }
+        }
+        catch (const exception& e) {
+            // only this connection will go without transport details
+            ctsConfig::PrintException(e);
+        }
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+    }
+
+    unsigned long ctsTcpInfoSampler::NextInterval(unsigned long _base_interval, long long _sweep_cost_microseconds) NOEXCEPT
+    {
+        const long long required_interval = _sweep_cost_microseconds * SweepCostRatio / 1000LL;
+        if (required_interval <= static_cast<long long>(_base_interval)) {
+            return _base_interval;
+        }
+        if (required_interval >= static_cast<long long>(MaximumIntervalMilliseconds)) {
+            return MaximumIntervalMilliseconds;
+        }
+        return static_cast<unsigned long>(required_interval);
+    }
+
+    void ctsTcpInfoSampler::sweep() NOEXCEPT
+    {
+        LARGE_INTEGER sweep_start;
+        ::QueryPerformanceCounter(&sweep_start);
+        ctsTracePoint("ctsTcpInfoSampler::sweep", this, "sockets", this->sweep_sockets.size(), nullptr, 0);
+
+        // pick up the newly added sockets - only taking the lock long enough to move them over
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        try {
+            this->sweep_sockets.insert(end(this->sweep_sockets), begin(s_AddedSockets), end(s_AddedSockets));
+            s_AddedSockets.clear();
+        }
+        catch (const exception& e) {
+            // the added sockets remain in s_AddedSockets to be tried again in the next batch
+            ctsConfig::PrintException(e);
+        }
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+
+        // sample every socket, dropping those which have closed
+        this->sweep_sockets.erase(
+            remove_if(
+                begin(this->sweep_sockets),
+                end(this->sweep_sockets),
+                [] (const weak_ptr<ctsSocket>& _weak_socket) {
+                    auto shared_socket(_weak_socket.lock());
+                    return !shared_socket || !sample_socket(shared_socket);
+                }),
+            end(this->sweep_sockets));
+
+        LARGE_INTEGER sweep_end;
+        ::QueryPerformanceCounter(&sweep_end);
+        const long long sweep_cost_microseconds = (sweep_end.QuadPart - sweep_start.QuadPart) * 1000000LL / ctTimer::snap_qpf();
+        const unsigned long next_interval = NextInterval(this->base_interval, sweep_cost_microseconds);
+        if (next_interval != this->base_interval) {
+            PrintDebugInfo(
+                L"\t\tctsTcpInfoSampler : sampling %Iu connections took %lld microseconds - waiting %lu milliseconds for the next batch\n",
+                this->sweep_sockets.size(), sweep_cost_microseconds, next_interval);
+        }
+
+        try {
+            this->timer->schedule_singleton([this] () { this->sweep(); }, next_interval);
+        }
+        catch (const exception& e) {
+            ctsConfig::PrintException(e);
+        }
+    }
+
+    bool ctsTcpInfoSampler::sample_socket(const shared_ptr<ctsSocket>& _socket) NOEXCEPT
+    {
+        TCP_INFO_v0 tcp_info;
+        // scope for the socket lock: not holding it while updating the statistics
+        {
+            auto socket_lock(ctsGuardSocket(_socket));
+            SOCKET local_socket = socket_lock.get();
+            if (INVALID_SOCKET == local_socket) {
+                return false;
+            }
+
+            DWORD tcp_info_version = 0;
+            DWORD bytes_returned = 0;
+            if (0 != ::WSAIoctl(
+                local_socket,
+                SIO_TCP_INFO,
+                &tcp_info_version,
+                static_cast<DWORD>(sizeof tcp_info_version),
+                &tcp_info,
+                static_cast<DWORD>(sizeof tcp_info),
+                &bytes_returned,
+                nullptr,
+                nullptr)) {
+                auto gle = ::WSAGetLastError();
+                if (WSAEOPNOTSUPP == gle || WSAEINVAL == gle) {
+                    if (0L == ::InterlockedExchange(&s_ReportedUnsupported, 1L)) {
+                        ctsConfig::PrintErrorIfFailed(L"WSAIoctl(SIO_TCP_INFO)", gle);
+                    }
+                } else {
+                    // expected as connections are closing
+                    PrintDebugInfo(L"\t\tctsTcpInfoSampler : WSAIoctl(SIO_TCP_INFO) failed (%d)\n", gle);
+                }
+                return false;
+            }
+        }
+
+        auto pattern(_socket->io_pattern());
+        if (!pattern) {
+            return false;
+        }
+
+        ctsTcpInfoSample sample;
+        sample.sample_time = ctTimer::snap_qpc_as_msec();
+        sample.rtt_us = tcp_info.RttUs;
+        sample.min_rtt_us = tcp_info.MinRttUs;
+        sample.cwnd_bytes = tcp_info.Cwnd;
+        sample.delivered_bytes = static_cast<long long>(tcp_info.BytesOut) - static_cast<long long>(tcp_info.BytesInFlight);
+        sample.bytes_retransmitted = static_cast<long long>(tcp_info.BytesRetrans);
+        sample.retransmits = static_cast<long long>(tcp_info.FastRetrans) + static_cast<long long>(tcp_info.TimeoutEpisodes);
+        pattern->record_tcp_info(sample);
+
+        if (ctsConfig::Settings->SendBacklogFromTcpInfo) {
+            const unsigned long current_backlog = pattern->get_ideal_send_backlog();
+            const unsigned long new_backlog = ctsSendWindowController::NextSendBacklog(
+                current_backlog,
+                ctsConfig::GetMaxBufferSize(),
+                tcp_info.Cwnd,
+                tcp_info.SndWnd,
+                tcp_info.Mss,
+                tcp_info.BytesInFlight);
+            if (new_backlog != current_backlog) {
+                PrintDebugInfo(L"\t\tctsTcpInfoSampler : setting the send backlog to %u bytes\n", new_backlog);
+                pattern->set_ideal_send_backlog(new_backlog);
+            }
+        }
+        return true;
+    }
+
+} // namespace
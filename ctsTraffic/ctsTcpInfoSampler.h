@@ -0,0 +1,79 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <memory>
+#include <vector>
+// os headers
+#include <windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+#include <ctThreadPoolTimer.hpp>
+
+
+namespace ctsTraffic {
+    //
+    // forward declare ctsSocket
+    // - can't include ctsSocket.h in this header to avoid circular declarations
+    //
+    class ctsSocket;
+
+    //
+    // ctsTcpInfoSampler
+    //
+    // Periodically reads the transport details of every connected TCP ctsSocket from the TCP stack
+    // (SIO_TCP_INFO) and records them into that connection's statistics (-TcpInfoInterval)
+    // - with -SendBacklog:tcpinfo each sample also sizes that connection's send backlog
+    // - a single threadpool timer samples all connections in one batch
+    // - the interval backs off as needed so that a batch never costs more than 1% of the interval
+    //
+    class ctsTcpInfoSampler {
+    public:
+        // the time spent sampling is held to at most 1/SweepCostRatio of the interval
+        static const long long SweepCostRatio = 100LL;
+        static const unsigned long MaximumIntervalMilliseconds = 60000UL;
+
+        // only the c'tor can throw
+        explicit ctsTcpInfoSampler(unsigned long _interval);
+        ~ctsTcpInfoSampler() NOEXCEPT;
+
+        //
+        // Adds a connected socket to be sampled until its SOCKET is closed
+        // - a no-op when a sampler is not running
+        //
+        static void AddSocket(const std::weak_ptr<ctsSocket>& _weak_socket) NOEXCEPT;
+
+        //
+        // Returns the interval to wait before the next batch given the time the last batch took
+        //
+        static unsigned long NextInterval(unsigned long _base_interval, long long _sweep_cost_microseconds) NOEXCEPT;
+
+        // not copyable
+        ctsTcpInfoSampler(const ctsTcpInfoSampler&) = delete;
+        ctsTcpInfoSampler& operator=(const ctsTcpInfoSampler&) = delete;
+
+    private:
+        const unsigned long base_interval;
+        // only accessed from the timer callback
+        std::vector<std::weak_ptr<ctsSocket>> sweep_sockets;
+        // the timer must be destroyed first, waiting for any running callback
+        std::unique_ptr<ctl::ctThreadpoolTimer> timer;
+
+        void sweep() NOEXCEPT;
+        // returns false if the socket should no longer be sampled
+        static bool sample_socket(const std::shared_ptr<ctsSocket>& _socket) NOEXCEPT;
+    };
+
+} // namespace
@@ -0,0 +1,132 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// parent header
+#include "ctsTimeSeriesSampler.h"
+
+// cpp headers
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <exception>
+// os headers
+#include <windows.h>
+// ctl headers
+#include <ctThreadPoolTimer.hpp>
+#include <ctScopeGuard.hpp>
+// project headers
+#include "ctsConfig.h"
+#include "ctsSocket.h"
+#include "ctsIOPattern.h"
+#include "ctsTrace.h"
+
+
+namespace ctsTraffic {
+
+    using namespace ctl;
+    using namespace std;
+
+    // statically initialized: sockets can be added while the sampler is being created or destroyed
+    static SRWLOCK s_SamplerLock = SRWLOCK_INIT;
+    // sockets added since the last batch - moved into sweep_sockets by the timer callback
+    _Guarded_by_(s_SamplerLock) static vector<weak_ptr<ctsSocket>> s_AddedSockets;
+    _Guarded_by_(s_SamplerLock) static bool s_SamplerRunning = false;
+
+    ctsTimeSeriesSampler::ctsTimeSeriesSampler(unsigned long _interval) :
+        interval(_interval),
+        sweep_sockets(),
+        timer(new ctThreadpoolTimer())
+    {
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        s_SamplerRunning = true;
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+        ctlScopeGuard(stopRunningOnError, {
+            ::AcquireSRWLockExclusive(&s_SamplerLock);
+            s_SamplerRunning = false;
+            ::ReleaseSRWLockExclusive(&s_SamplerLock); });
+
+        this->timer->schedule_singleton([this] () { this->sweep(); }, this->interval);
+
+        stopRunningOnError.dismiss();
+    }
+
+    ctsTimeSeriesSampler::~ctsTimeSeriesSampler() NOEXCEPT
+    {
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        s_SamplerRunning = false;
+        s_AddedSockets.clear();
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+
+        // waits for a running batch before the other members are destroyed
+        this->timer.reset();
+    }
+
+    void ctsTimeSeriesSampler::AddSocket(const weak_ptr<ctsSocket>& _weak_socket) NOEXCEPT
+    {
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        try {
+            if (s_SamplerRunning) {
+                s_AddedSockets.push_back(_weak_socket);
+            }
+        }
+        catch (const exception& e) {
+            // only this connection will go without periodic samples (its final values are still recorded)
+            ctsConfig::PrintException(e);
+        }
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+    }
+
+    void ctsTimeSeriesSampler::sweep() NOEXCEPT
+    {
+        ctsTracePoint("ctsTimeSeriesSampler::sweep", this, "sockets", this->sweep_sockets.size(), nullptr, 0);
+
+        // pick up the newly added sockets - only taking the lock long enough to move them over
+        ::AcquireSRWLockExclusive(&s_SamplerLock);
+        try {
+            this->sweep_sockets.insert(end(this->sweep_sockets), begin(s_AddedSockets), end(s_AddedSockets));
+            s_AddedSockets.clear();
+        }
+        catch (const exception& e) {
+            // the added sockets remain in s_AddedSockets to be tried again in the next batch
+            ctsConfig::PrintException(e);
+        }
+        ::ReleaseSRWLockExclusive(&s_SamplerLock);
+
+        // sample every connection, dropping those whose socket has been destroyed
+        // - the pattern ignores samples once its connection has ended
+        this->sweep_sockets.erase(
+            remove_if(
+                begin(this->sweep_sockets),
+                end(this->sweep_sockets),
+                [] (const weak_ptr<ctsSocket>& _weak_socket) {
+                    auto shared_socket(_weak_socket.lock());
+                    if (!shared_socket) {
+                        return true;
+                    }
+                    auto pattern(shared_socket->io_pattern());
+                    if (pattern) {
+                        pattern->sample_time_series();
+                    }
+                    return false;
+                }),
+            end(this->sweep_sockets));
+
+        try {
+            this->timer->schedule_singleton([this] () { this->sweep(); }, this->interval);
+        }
+        catch (const exception& e) {
+            ctsConfig::PrintException(e);
+        }
+    }
+
+} // namespace
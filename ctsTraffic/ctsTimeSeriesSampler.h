@@ -0,0 +1,66 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+// cpp headers
+#include <memory>
+#include <vector>
+// os headers
+#include <windows.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+#include <ctThreadPoolTimer.hpp>
+
+
+namespace ctsTraffic {
+    //
+    // forward declare ctsSocket
+    // - can't include ctsSocket.h in this header to avoid circular declarations
+    //
+    class ctsSocket;
+
+    //
+    // ctsTimeSeriesSampler
+    //
+    // Records the counters of every connection into its time-series at the -TimeSeriesInterval
+    // - a single threadpool timer samples all connections in one batch
+    // - driven by the timer rather than by IO completions, so stalled connections keep being sampled
+    //
+    class ctsTimeSeriesSampler {
+    public:
+        // only the c'tor can throw
+        explicit ctsTimeSeriesSampler(unsigned long _interval);
+        ~ctsTimeSeriesSampler() NOEXCEPT;
+
+        //
+        // Adds a socket to be sampled until it is destroyed
+        // - a no-op when a sampler is not running
+        //
+        static void AddSocket(const std::weak_ptr<ctsSocket>& _weak_socket) NOEXCEPT;
+
+        // not copyable
+        ctsTimeSeriesSampler(const ctsTimeSeriesSampler&) = delete;
+        ctsTimeSeriesSampler& operator=(const ctsTimeSeriesSampler&) = delete;
+
+    private:
+        const unsigned long interval;
+        // only accessed from the timer callback
+        std::vector<std::weak_ptr<ctsSocket>> sweep_sockets;
+        // the timer must be destroyed first, waiting for any running callback
+        std::unique_ptr<ctl::ctThreadpoolTimer> timer;
+
+        void sweep() NOEXCEPT;
+    };
+
+} // namespace
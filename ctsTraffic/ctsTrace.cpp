@@ -0,0 +1,173 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+// parent header
+#include "ctsTrace.h"
+
+#ifdef CTSTRAFFIC_TRACING
+
+// cpp headers
+#include <stdio.h>
+#include <new>
+#include <string>
+#include <vector>
+// os headers
+#include <Windows.h>
+// ctl headers
+#include <ctException.hpp>
+#include <ctScopeGuard.hpp>
+
+
+namespace ctsTraffic {
+    namespace ctsTrace {
+
+        using namespace std;
+
+        thread_local ThreadBuffer* t_ThreadBuffer = nullptr;
+
+        // buffers are never freed: threadpool threads can record events until the process exits
+        static SRWLOCK s_ThreadBufferLock = SRWLOCK_INIT;
+        static vector<ThreadBuffer*> s_ThreadBuffers;
+        // the rdtsc and QPC values when the first thread registered, to convert rdtsc values to microseconds
+        static unsigned long long s_StartTimestamp = 0ULL;
+        static LARGE_INTEGER s_StartQpc;
+
+        // flush the formatted events to the file in chunks of this size
+        static const size_t ExportChunkSize = 64 * 1024;
+
+        ThreadBuffer* RegisterThread() NOEXCEPT
+        {
+            ThreadBuffer* thread_buffer = new (nothrow) ThreadBuffer;
+            if (nullptr == thread_buffer) {
+                return nullptr;
+            }
+            thread_buffer->thread_id = ::GetCurrentThreadId();
+            thread_buffer->event_count = 0ULL;
+
+            ::AcquireSRWLockExclusive(&s_ThreadBufferLock);
+            ctlScopeGuard(releaseLockOnExit, { ::ReleaseSRWLockExclusive(&s_ThreadBufferLock); });
+            try {
+                if (s_ThreadBuffers.empty()) {
+                    ::QueryPerformanceCounter(&s_StartQpc);
+                    s_StartTimestamp = ::__rdtsc();
+                }
+                s_ThreadBuffers.push_back(thread_buffer);
+            }
+            catch (const bad_alloc&) {
+                delete thread_buffer;
+                return nullptr;
+            }
+
+            t_ThreadBuffer = thread_buffer;
+            return thread_buffer;
+        }
+
+        static void WriteChunk(HANDLE _file, string& _chunk)
+        {
+            DWORD written;
+            if (!::WriteFile(_file, _chunk.c_str(), static_cast<DWORD>(_chunk.length()), &written, nullptr)) {
+                throw ctl::ctException(::GetLastError(), L"WriteFile", L"ctsTrace::Export", false);
+            }
+            _chunk.clear();
+        }
+
+        static void FormatEvent(const Event& _event, DWORD _process_id, DWORD _thread_id, double _timestamp_us, bool _first_event, string& _chunk)
+        {
+            const TracePoint* trace_point = _event.trace_point;
+            char formatted[512];
+            int length;
+            if (TracePointType::Counter == trace_point->type) {
+                length = ::sprintf_s(formatted,
+                    "%s\n{\"name\":\"%s\",\"cat\":\"ctsTraffic\",\"ph\":\"C\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"args\":{",
+                    _first_event ? "" : ",", trace_point->name, _process_id, _thread_id, _timestamp_us);
+            } else {
+                length = ::sprintf_s(formatted,
+                    "%s\n{\"name\":\"%s\",\"cat\":\"ctsTraffic\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%lu,\"tid\":%lu,\"ts\":%.3f,\"args\":{\"id\":\"%p\"",
+                    _first_event ? "" : ",", trace_point->name, _process_id, _thread_id, _timestamp_us, _event.id);
+            }
+            if (length > 0) {
+                _chunk.append(formatted, length);
+            }
+
+            bool first_arg = (TracePointType::Counter == trace_point->type);
+            if (trace_point->first_name != nullptr) {
+                length = ::sprintf_s(formatted, "%s\"%s\":%lld", first_arg ? "" : ",", trace_point->first_name, _event.first_value);
+                if (length > 0) {
+                    _chunk.append(formatted, length);
+                }
+                first_arg = false;
+            }
+            if (trace_point->second_name != nullptr) {
+                length = ::sprintf_s(formatted, "%s\"%s\":%lld", first_arg ? "" : ",", trace_point->second_name, _event.second_value);
+                if (length > 0) {
+                    _chunk.append(formatted, length);
+                }
+            }
+            _chunk.append("}}");
+        }
+
+        unsigned long long Export(_In_ LPCWSTR _file_name)
+        {
+            HANDLE trace_file = ::CreateFileW(_file_name, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (INVALID_HANDLE_VALUE == trace_file) {
+                throw ctl::ctException(::GetLastError(), L"CreateFile", L"ctsTrace::Export", false);
+            }
+            ctlScopeGuard(closeFileOnExit, { ::CloseHandle(trace_file); });
+
+            ::AcquireSRWLockShared(&s_ThreadBufferLock);
+            ctlScopeGuard(releaseLockOnExit, { ::ReleaseSRWLockShared(&s_ThreadBufferLock); });
+
+            // calibrate rdtsc against QPC over the lifetime of the trace
+            LARGE_INTEGER end_qpc;
+            LARGE_INTEGER qpf;
+            ::QueryPerformanceCounter(&end_qpc);
+            ::QueryPerformanceFrequency(&qpf);
+            const unsigned long long end_timestamp = ::__rdtsc();
+            const double elapsed_us = static_cast<double>(end_qpc.QuadPart - s_StartQpc.QuadPart) * 1000000.0 / static_cast<double>(qpf.QuadPart);
+            double ticks_per_us = (elapsed_us > 0.0) ? static_cast<double>(end_timestamp - s_StartTimestamp) / elapsed_us : 1.0;
+            if (ticks_per_us <= 0.0) {
+                ticks_per_us = 1.0;
+            }
+
+            const DWORD process_id = ::GetCurrentProcessId();
+            unsigned long long events_written = 0ULL;
+            string chunk;
+            chunk.reserve(ExportChunkSize + 1024);
+            chunk.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+            for (const auto& thread_buffer : s_ThreadBuffers) {
+                const unsigned long long event_count = thread_buffer->event_count;
+                const unsigned long long first_index = (event_count > EventsPerThread) ? event_count - EventsPerThread : 0ULL;
+                for (auto index = first_index; index < event_count; ++index) {
+                    const Event& event = thread_buffer->events[index & (EventsPerThread - 1)];
+                    // events recorded before the first registration captured its timestamp are reported at 0
+                    const double timestamp_us = (event.timestamp > s_StartTimestamp) ?
+                        static_cast<double>(event.timestamp - s_StartTimestamp) / ticks_per_us :
+                        0.0;
+                    FormatEvent(event, process_id, thread_buffer->thread_id, timestamp_us, 0ULL == events_written, chunk);
+                    ++events_written;
+
+                    if (chunk.length() >= ExportChunkSize) {
+                        WriteChunk(trace_file, chunk);
+                    }
+                }
+            }
+            chunk.append("\n]}\n");
+            WriteChunk(trace_file, chunk);
+
+            return events_written;
+        }
+
+    } // namespace ctsTrace
+} // namespace ctsTraffic
+
+#endif // CTSTRAFFIC_TRACING
@@ -0,0 +1,132 @@
+/*
+
+Copyright (c) Microsoft Corporation
+All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the ""License""); you may not use this file except in compliance with the License. You may obtain a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+
+THIS CODE IS PROVIDED ON AN  *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+
+See the Apache Version 2.0 License for specific language governing permissions and limitations under the License.
+
+*/
+
+#pragma once
+
+//
+// Structured tracepoints for the IO hot paths
+// - compiled only when CTSTRAFFIC_TRACING is defined (e.g. /D CTSTRAFFIC_TRACING):
+//   otherwise the ctsTracePoint and ctsTraceCounter macros expand to an empty statement and their arguments are never evaluated
+// - when enabled, each event is 40 bytes written to a per-thread ring buffer (no locks, no allocations):
+//   the cost is an rdtsc and a few stores
+// - ctsTrace::Export writes every thread's buffer as a Chrome trace (JSON), loadable in chrome://tracing or ui.perfetto.dev
+//
+#ifdef CTSTRAFFIC_TRACING
+
+// cpp headers
+#include <vector>
+// os headers
+#include <Windows.h>
+#include <intrin.h>
+// ctl headers
+#include <ctVersionConversion.hpp>
+
+
+namespace ctsTraffic {
+    namespace ctsTrace {
+
+        static const LPCWSTR DefaultTraceFilename = L"ctsTraffic.trace.json";
+
+        enum class TracePointType {
+            Instant,
+            Counter
+        };
+
+        //
+        // Every tracepoint call-site has one constant descriptor: events only store a pointer to it
+        //
+        struct TracePoint {
+            LPCSTR name;
+            LPCSTR first_name;
+            LPCSTR second_name;
+            TracePointType type;
+        };
+
+        struct Event {
+            unsigned long long timestamp;
+            const TracePoint* trace_point;
+            const void* id;
+            long long first_value;
+            long long second_value;
+        };
+
+        // must be a power of 2: the oldest events are overwritten once a thread's buffer wraps
+        static const unsigned long EventsPerThread = 64 * 1024;
+
+        struct ThreadBuffer {
+            DWORD thread_id;
+            // the total number of events ever written on this thread
+            unsigned long long event_count;
+            Event events[EventsPerThread];
+        };
+
+        //
+        // allocates and registers the calling thread's buffer on its first event
+        // - returns nullptr if the buffer could not be allocated: those events are dropped
+        //
+        ThreadBuffer* RegisterThread() NOEXCEPT;
+        extern thread_local ThreadBuffer* t_ThreadBuffer;
+
+        inline void Record(_In_ const TracePoint* _trace_point, _In_opt_ const void* _id, long long _first_value, long long _second_value) NOEXCEPT
+        {
+            ThreadBuffer* thread_buffer = t_ThreadBuffer;
+            if (nullptr == thread_buffer) {
+                thread_buffer = RegisterThread();
+                if (nullptr == thread_buffer) {
+                    return;
+                }
+            }
+
+            Event& event = thread_buffer->events[thread_buffer->event_count & (EventsPerThread - 1)];
+            event.timestamp = ::__rdtsc();
+            event.trace_point = _trace_point;
+            event.id = _id;
+            event.first_value = _first_value;
+            event.second_value = _second_value;
+            ++thread_buffer->event_count;
+        }
+
+        //
+        // Writes all buffered events to _file_name in the Chrome trace event format
+        // - must only be called once IO has stopped, as the buffers are read without synchronizing with their threads
+        // - returns the number of events written
+        //
+        unsigned long long Export(_In_ LPCWSTR _file_name);
+
+    } // namespace ctsTrace
+} // namespace ctsTraffic
+
+#define ctsTracePoint(_name, _id, _first_name, _first_value, _second_name, _second_value)          \
+        do {                                                                                        \
+            static const ::ctsTraffic::ctsTrace::TracePoint s_ctsTracePoint = {                     \
+                _name, _first_name, _second_name, ::ctsTraffic::ctsTrace::TracePointType::Instant };\
+            ::ctsTraffic::ctsTrace::Record(                                                         \
+                &s_ctsTracePoint, _id,                                                              \
+                static_cast<long long>(_first_value), static_cast<long long>(_second_value));       \
+        } while (0)
+
+#define ctsTraceCounter(_name, _first_name, _first_value, _second_name, _second_value)             \
+        do {                                                                                        \
+            static const ::ctsTraffic::ctsTrace::TracePoint s_ctsTracePoint = {                     \
+                _name, _first_name, _second_name, ::ctsTraffic::ctsTrace::TracePointType::Counter };\
+            ::ctsTraffic::ctsTrace::Record(                                                         \
+                &s_ctsTracePoint, nullptr,                                                          \
+                static_cast<long long>(_first_value), static_cast<long long>(_second_value));       \
+        } while (0)
+
+#else
+
+#define ctsTracePoint(_name, _id, _first_name, _first_value, _second_name, _second_value) do {} while (0)
+#define ctsTraceCounter(_name, _first_name, _first_value, _second_name, _second_value) do {} while (0)
+
+#endif // CTSTRAFFIC_TRACING
@@ -16,6 +16,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // CRT headers
 #include <stdio.h>
 #include <exception>
+#include <memory>
 // os headers
 #include <Windows.h>
 // ctl headers
@@ -24,6 +25,10 @@ See the Apache Version 2.0 License for specific language governing permissions a
 // local headers
 #include "ctsConfig.h"
 #include "ctsSocketBroker.h"
+#include "ctsMetricsServer.h"
+#include "ctsTcpInfoSampler.h"
+#include "ctsTimeSeriesSampler.h"
+#include "ctsTrace.h"
 
 using namespace ctsTraffic;
 using namespace ctl;
@@ -95,6 +100,16 @@ __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
         ctsConfig::PrintSettings();
         ctsConfig::PrintLegend();
 
+        // created before the broker so it outlives every ctsSocket which could be added to it
+        std::unique_ptr<ctsTcpInfoSampler> tcp_info_sampler;
+        if (ctsConfig::Settings->TcpInfoIntervalMilliseconds != 0) {
+            tcp_info_sampler.reset(new ctsTcpInfoSampler(ctsConfig::Settings->TcpInfoIntervalMilliseconds));
+        }
+        std::unique_ptr<ctsTimeSeriesSampler> time_series_sampler;
+        if (ctsConfig::Settings->TimeSeriesIntervalMilliseconds != 0) {
+            time_series_sampler.reset(new ctsTimeSeriesSampler(ctsConfig::Settings->TimeSeriesIntervalMilliseconds));
+        }
+
         // set the start timer as close as possible to the start of the engine
         ctsConfig::Settings->StartTimeMilliseconds = ctTimer::snap_qpc_as_msec();
         std::shared_ptr<ctsSocketBroker> broker(std::make_shared<ctsSocketBroker>());
@@ -103,6 +118,12 @@ __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
 
         ctThreadpoolTimer status_timer;
         status_timer.schedule_reoccuring(ctsConfig::PrintStatusUpdate, 0LL, ctsConfig::Settings->StatusUpdateFrequencyMilliseconds);
+
+        // optionally serve live counters for external scrapers
+        std::unique_ptr<ctsMetricsServer> metrics_server;
+        if (ctsConfig::Settings->MetricsPort != 0) {
+            metrics_server.reset(new ctsMetricsServer(ctsConfig::Settings->MetricsPort));
+        }
         if (!broker->wait(ctsConfig::Settings->TimeLimit > 0 ? ctsConfig::Settings->TimeLimit : INFINITE)) {
             ctsConfig::PrintSummary(L"\n ** Timelimit of %lu reached **\n", static_cast<unsigned long>(ctsConfig::Settings->TimeLimit));
         }
@@ -133,6 +154,17 @@ __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
     // write out the final status update
     ctsConfig::PrintStatusUpdate();
 
+#ifdef CTSTRAFFIC_TRACING
+    // all IO has stopped, so the per-thread trace buffers are no longer being written
+    try {
+        auto trace_events = ctsTrace::Export(ctsTrace::DefaultTraceFilename);
+        ctsConfig::PrintSummary(L"\n  Trace events written to %ws : %llu\n", ctsTrace::DefaultTraceFilename, trace_events);
+    }
+    catch (const exception& e) {
+        ctsConfig::PrintException(e);
+    }
+#endif
+
     ctsConfig::Shutdown();
 
     ctsConfig::PrintSummary(
@@ -143,6 +175,10 @@ __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
         ctsConfig::Settings->ConnectionStatusDetails.successful_completion_count.get(),
         ctsConfig::Settings->ConnectionStatusDetails.connection_error_count.get(),
         ctsConfig::Settings->ConnectionStatusDetails.protocol_error_count.get());
+    ctsConfig::PrintSummary(
+        L"  Connection objects: Allocated [%lld]   Recycled [%lld]\n",
+        ctsConfig::Settings->ConnectionStatusDetails.allocated_object_count.get(),
+        ctsConfig::Settings->ConnectionStatusDetails.recycled_object_count.get());
 
     if (ctsConfig::Settings->Protocol == ctsConfig::ProtocolType::TCP) {
         ctsConfig::PrintSummary(
@@ -152,8 +188,38 @@ __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
             ctsConfig::Settings->TcpStatusDetails.bytes_recv.get(),
             ctsConfig::Settings->TcpStatusDetails.bytes_sent.get());
     } else {
-        // currently don't track UDP server stats
-        if (!ctsConfig::IsListening()) {
+        if (ctsConfig::IsListening()) {
+            // frames sent more than 1 ms past their deadline (beyond the first 7 buckets, <= 1000 us) indicate the server can't keep up
+            const ctsHistogramStatistics& lateness = ctsConfig::Settings->FrameSchedulingLatenessHistogram;
+            const long long frames_scheduled = lateness.count();
+            long long frames_on_time = 0LL;
+            for (unsigned long bucket = 0; bucket < 7; ++bucket) {
+                frames_on_time += lateness.bucket_value(bucket);
+            }
+            ctsConfig::PrintSummary(
+                L"\n"
+                L"  Total Frames Scheduled : %lld\n"
+                L"  Total Frames Sent Late (> 1 ms) : %lld\n"
+                L"  Average Scheduling Lateness : %lld us.\n",
+                frames_scheduled,
+                frames_scheduled - frames_on_time,
+                (frames_scheduled > 0LL) ? lateness.sum() / frames_scheduled : 0LL);
+            // gaps within the first 3 buckets (<= 10 us) are datagrams sent back-to-back
+            const ctsHistogramStatistics& datagram_gaps = ctsConfig::Settings->DatagramGapHistogram;
+            const long long gaps_measured = datagram_gaps.count();
+            ctsConfig::PrintSummary(
+                L"  Total Datagram Gaps Measured : %lld\n"
+                L"  Datagrams Sent Back-To-Back (<= 10 us) : %lld\n"
+                L"  Average Datagram Gap : %lld us.\n",
+                gaps_measured,
+                datagram_gaps.bucket_value(0) + datagram_gaps.bucket_value(1) + datagram_gaps.bucket_value(2),
+                (gaps_measured > 0LL) ? datagram_gaps.sum() / gaps_measured : 0LL);
+            if (ctsConfig::GetMediaStream().FecDataFrames > 0) {
+                ctsConfig::PrintSummary(
+                    L"  Total Parity Bytes Sent : %lld\n",
+                    ctsConfig::Settings->UdpStatusDetails.parity_bits.get() / 8LL);
+            }
+        } else {
             ctsConfig::PrintSummary(
                 L"\n"
                 L"  Total Bytes Recv : %lld\n"
@@ -166,6 +232,35 @@ __cdecl wmain(_In_ int argc, _In_reads_z_(argc) const wchar_t** argv)
                 ctsConfig::Settings->UdpStatusDetails.dropped_frames.get(),
                 ctsConfig::Settings->UdpStatusDetails.duplicate_frames.get(),
                 ctsConfig::Settings->UdpStatusDetails.error_frames.get());
+            if (ctsConfig::GetMediaStream().AdaptivePlayout) {
+                ctsConfig::PrintSummary(
+                    L"  Total Rebuffer Events : %lld\n"
+                    L"  Total Time Rebuffering : %lld ms.\n"
+                    L"  Average Playout Delay : %lld ms.\n",
+                    ctsConfig::Settings->UdpStatusDetails.rebuffer_count.get(),
+                    ctsConfig::Settings->UdpStatusDetails.buffering_milliseconds.get(),
+                    ctsConfig::Settings->UdpStatusDetails.playout_delay_milliseconds());
+            }
+            if (ctsConfig::GetMediaStream().FecDataFrames > 0) {
+                // parity bytes are not included in the Total Bytes Recv
+                ctsConfig::PrintSummary(
+                    L"  Total Recovered Frames : %lld\n"
+                    L"  Total Unrecoverable Frames : %lld\n"
+                    L"  Total Parity Bytes Recv : %lld\n",
+                    ctsConfig::Settings->UdpStatusDetails.recovered_frames.get(),
+                    ctsConfig::Settings->UdpStatusDetails.unrecoverable_frames.get(),
+                    ctsConfig::Settings->UdpStatusDetails.parity_bits.get() / 8LL);
+            }
+            if (ctsConfig::GetMediaStream().ClockProbeIntervalMilliseconds > 0) {
+                // datagrams received before the clocks were first compared are not measured
+                const ctsHistogramStatistics& delays = ctsConfig::Settings->OneWayDelayHistogram;
+                const long long delays_measured = delays.count();
+                ctsConfig::PrintSummary(
+                    L"  Total Datagram Delays Measured : %lld\n"
+                    L"  Average One-Way Delay : %lld us.\n",
+                    delays_measured,
+                    (delays_measured > 0LL) ? delays.sum() / delays_measured : 0LL);
+            }
         }
     }
     ctsConfig::PrintSummary(
@@ -45,7 +45,7 @@ namespace ctsTraffic {
     wsIOResult ctsWSARecvFrom(
         const std::shared_ptr<ctsSocket>& _shared_socket,
         const ctsIOTask& _task,
-        std::function<void(OVERLAPPED*)>&& _callback) NOEXCEPT
+        ctl::ctThreadIocpCallback&& _callback) NOEXCEPT
     {
         auto socket_lock(ctsGuardSocket(_shared_socket));
         SOCKET socket = socket_lock.get();
@@ -58,12 +58,11 @@ namespace ctsTraffic {
             const auto& io_thread_pool = _shared_socket->thread_pool();
             OVERLAPPED* pov = io_thread_pool->new_request(std::move(_callback));
 
-            WSABUF wsabuf;
-            wsabuf.buf = _task.buffer + _task.buffer_offset;
-            wsabuf.len = _task.buffer_length;
+            WSABUF wsabufs[ctsIOTask::MaxSegments];
+            const DWORD wsabuf_count = _task.fill_wsabufs(wsabufs);
 
             DWORD flags = 0;
-            if (::WSARecvFrom(socket, &wsabuf, 1, nullptr, &flags, nullptr, nullptr, pov, nullptr) != 0) {
+            if (::WSARecvFrom(socket, wsabufs, wsabuf_count, nullptr, &flags, nullptr, nullptr, pov, nullptr) != 0) {
                 return_result.error_code = ::WSAGetLastError();
                 // IO pended == successfully initiating the IO
                 if (return_result.error_code != WSA_IO_PENDING) {
@@ -101,7 +100,7 @@ namespace ctsTraffic {
     wsIOResult ctsWSASendTo(
         const std::shared_ptr<ctsSocket>& _shared_socket,
         const ctsIOTask& _task,
-        std::function<void(OVERLAPPED*)>&& _callback) NOEXCEPT
+        ctl::ctThreadIocpCallback&& _callback) NOEXCEPT
     {
         auto socket_lock(ctsGuardSocket(_shared_socket));
         SOCKET socket = socket_lock.get();
@@ -116,11 +115,10 @@ namespace ctsTraffic {
             const auto& io_thread_pool = _shared_socket->thread_pool();
             OVERLAPPED* pov = io_thread_pool->new_request(std::move(_callback));
 
-            WSABUF wsabuf;
-            wsabuf.buf = _task.buffer + _task.buffer_offset;
-            wsabuf.len = _task.buffer_length;
+            WSABUF wsabufs[ctsIOTask::MaxSegments];
+            const DWORD wsabuf_count = _task.fill_wsabufs(wsabufs);
 
-            if (::WSASendTo(socket, &wsabuf, 1, nullptr, 0, targetAddress.sockaddr(), targetAddress.length(), pov, nullptr) != 0) {
+            if (::WSASendTo(socket, wsabufs, wsabuf_count, nullptr, 0, targetAddress.sockaddr(), targetAddress.length(), pov, nullptr) != 0) {
                 return_result.error_code = ::WSAGetLastError();
                 // IO pended == successfully initiating the IO
                 if (return_result.error_code != WSA_IO_PENDING) {
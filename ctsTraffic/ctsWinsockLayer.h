@@ -22,6 +22,7 @@ See the Apache Version 2.0 License for specific language governing permissions a
 
 // ctl headers
 #include <ctVersionConversion.hpp>
+#include <ctThreadIocp.hpp>
 
 // project headers
 #include "ctsIOTask.hpp"
@@ -55,7 +56,7 @@ namespace ctsTraffic {
     wsIOResult ctsWSARecvFrom(
         const std::shared_ptr<ctsSocket>& _shared_socket,
         const ctsIOTask& _task,
-        std::function<void(OVERLAPPED*)>&& _callback) NOEXCEPT;
+        ctl::ctThreadIocpCallback&& _callback) NOEXCEPT;
 
     //
     // WSASendTo
@@ -63,7 +64,7 @@ namespace ctsTraffic {
     wsIOResult ctsWSASendTo(
         const std::shared_ptr<ctsSocket>& _shared_socket,
         const ctsIOTask& _task,
-        std::function<void(OVERLAPPED*)>&& _callback) NOEXCEPT;
+        ctl::ctThreadIocpCallback&& _callback) NOEXCEPT;
 
     //
     // Set LINGER options to force a RST when the socket is closed